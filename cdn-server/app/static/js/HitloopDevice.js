@@ -19,11 +19,17 @@ class HitloopDevice {
         this.dSW = 0; // South-West distance (bottom-left)
         this.dSE = 0; // South-East distance (bottom-right)
         this.tap = false; // Tap detection state
+        this.px = 0; // On-device position x (0 = west wall, 255 = east wall)
+        this.py = 0; // On-device position y (0 = north wall, 255 = south wall)
+        this.pconf = 0; // Position confidence (0 = no fix)
+        this.health = null; // Latest health report (see HealthProcess), if any
+        this.healthAt = 0; // Time the health report arrived (ms)
     }
 
     /**
      * Parse HEX string received from socket server
      * Format: idHex(4) + ax(2) + ay(2) + az(2) + dTL(2) + dTR(2) + dBR(2) + dBL(2) + tap(2)
+     * Optionally followed by px(2) + py(2) + pconf(2) from firmware with on-device positioning
      * @param {string} hexString - The HEX string to parse
      */
     parseHexData(hexString) {
@@ -75,6 +81,14 @@ class HitloopDevice {
             this.dSE = dSE;
             this.dSW = dSW;
             this.tap = tapValue === 255; // Convert to boolean: 255 = true, 0 = false
+
+            // Optional position extension
+            const posHex = raw.slice(20, 26);
+            if (/^[0-9a-fA-F]{6}$/.test(posHex)) {
+                this.px = parseInt(posHex.substring(0, 2), 16);
+                this.py = parseInt(posHex.substring(2, 4), 16);
+                this.pconf = parseInt(posHex.substring(4, 6), 16);
+            }
             return true;
         } catch (_e) {
             return false;
@@ -104,6 +118,9 @@ class HitloopDevice {
             dSW: this.dSW,
             dSE: this.dSE,
             tap: this.tap,
+            px: this.px,
+            py: this.py,
+            pconf: this.pconf,
             color: this.color,
             motorState: this.motorState
         };
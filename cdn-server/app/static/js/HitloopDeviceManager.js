@@ -112,11 +112,39 @@ class HitloopDeviceManager {
         const text = String(data || '');
         const frames = text.split(/\r?\n/).map(s => s.trim()).filter(Boolean);
         for (const frame of frames) {
+            if (frame.startsWith('health:')) {
+                this.parseHealth(frame);
+                continue;
+            }
             // Parse the HEX data and update the corresponding device
             this.parseAndUpdateDevice(frame);
         }
     }
 
+    /**
+     * Parse a health report and attach it to a known device
+     * Format: health:<idHex(4)>:<json>
+     * @param {string} line - The health line to parse
+     * @returns {boolean} True if the report was attached to a device
+     */
+    parseHealth(line) {
+        const parts = line.split(':');
+        if (parts.length < 3) {
+            return false;
+        }
+        const device = this.devices.get(parts[1].toLowerCase());
+        if (!device) {
+            return false;
+        }
+        try {
+            device.health = JSON.parse(parts.slice(2).join(':'));
+            device.healthAt = Date.now();
+            return true;
+        } catch (e) {
+            return false;
+        }
+    }
+
     /**
      * Parse HEX data and update the corresponding device
      * @param {string} hexString - The HEX string to parse
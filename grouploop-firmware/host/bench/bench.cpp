@@ -0,0 +1,390 @@
+// Microbenchmarks for the firmware hot paths, built natively against the
+// fakes in host/fakes. Every benchmark reports "allocs/op", counted through
+// the global operator new; check_bench.py holds them to budget.json.
+#include <Arduino.h>
+#include <benchmark/benchmark.h>
+#include <new>
+#include <cstdlib>
+#include "Configuration.h"
+#include "ProcessManager.h"
+#include "WebSocketManager.h"
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "Utils.h"
+#include "processes/BLEProcess.h"
+#include "processes/IMUProcess.h"
+#include "processes/PublishProcess.h"
+#include "processes/ReceiveProcess.h"
+#include "processes/LedBehaviors.h"
+#include "processes/LedCompositor.h"
+#include "processes/LedBehaviorPool.h"
+#include "processes/LedProcess.h"
+
+Configuration configuration;
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+// Every form frees through the one that pairs with operator new's malloc().
+// Kept out of line: inlined into a caller, free() on a pointer from
+// new-expression trips -Wmismatched-new-delete.
+__attribute__((noinline)) void operator delete(void* block) noexcept { free(block); }
+void operator delete[](void* block) noexcept { operator delete(block); }
+void operator delete(void* block, size_t) noexcept { operator delete(block); }
+void operator delete[](void* block, size_t) noexcept { operator delete(block); }
+
+// Counts allocations from construction to destruction as "allocs/op"
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state) : state(state), before(allocations) {}
+    ~AllocationCounter() {
+        state.counters["allocs/op"] = benchmark::Counter(
+            (double)(allocations - before), benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state;
+    unsigned long before;
+};
+
+static WebSocketsClient* client;
+static ProcessManager* processes;
+
+// The same wiring as main.cpp for the uplink, without the LED and motor
+static void setupFirmware() {
+    client = WebSocketsClient::latest;
+    processes = new ProcessManager();
+    processes->addProcess("ble", new BLEProcess());
+    processes->addProcess("imu", new IMUProcess());
+    processes->addProcess("publish", new PublishProcess());
+    processes->addProcess("receive", new ReceiveProcess());
+    processes->setupProcesses();
+    webSocketManager.initialize("ws://10.0.0.1:5003/");
+    webSocketManager.setLinkUp(true);
+    client->injectConnected();
+    webSocketManager.service();
+    webSocketManager.dispatch();
+    client->recordSent = false;
+    logger.setSerialLevel(LOG_LEVEL_NONE);
+}
+
+// --- Uplink ---
+
+static void BM_PublishBuildFrame(benchmark::State& state) {
+    PublishProcess* publish = (PublishProcess*)processes->getProcess("publish");
+    char frame[WS_TELEMETRY_MAX_LEN];
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(publish->buildFrame(frame, sizeof(frame)));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PublishBuildFrame);
+
+// A message through the WebSocket event handler, the receive queue and
+// the command registry, as it arrives from the server
+static void BM_ReceiveProcessMessages(benchmark::State& state) {
+    ReceiveProcess* receive = (ReceiveProcess*)processes->getProcess("receive");
+    benchmark::IterationCount handled = 0;
+    commandRegistry.registerCommand("bench", [&handled](const String& params) { handled++; });
+    static const char message[] = "bench:ff8000";
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        client->deliver(WStype_TEXT, message, sizeof(message) - 1);
+        receive->processMessages();
+    }
+    if (handled != state.iterations()) state.SkipWithError("messages were not dispatched");
+}
+BENCHMARK(BM_ReceiveProcessMessages);
+
+// --- CommandRegistry ---
+
+// The commands the firmware registers, plus padding up to 'count' names
+static void fillRegistry(CommandRegistry& registry, int count) {
+    static const char* names[] = {
+        "led", "vibrate", "status", "log", "health", "brightness",
+        "pattern", "reset", "spring_param", "calibrate", "wifi", "coex",
+    };
+    const int known = sizeof(names) / sizeof(names[0]);
+    for (int i = 0; i < count; ++i) {
+        String name = i < known ? String(names[i]) : String("cmd") + String(i);
+        registry.registerCommand(name, [](const String& params) { benchmark::DoNotOptimize(params.length()); });
+    }
+}
+
+// Dispatch by const char*, as ReceiveProcess does; the name is looked up
+// near the end of the alphabetical order
+static void BM_CommandDispatch(benchmark::State& state) {
+    CommandRegistry registry;
+    fillRegistry(registry, state.range(0));
+    String parameters("ff8000");
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.executeCommand("vibrate", parameters));
+    }
+}
+BENCHMARK(BM_CommandDispatch)->Arg(12)->Arg(48);
+
+// The String overload used by serial and local callers
+static void BM_CommandDispatchString(benchmark::State& state) {
+    CommandRegistry registry;
+    fillRegistry(registry, 12);
+    String name("vibrate");
+    String parameters("ff8000");
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.executeCommand(name, parameters));
+    }
+}
+BENCHMARK(BM_CommandDispatchString);
+
+static void BM_CommandUnknown(benchmark::State& state) {
+    CommandRegistry registry;
+    fillRegistry(registry, 12);
+    String parameters;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.executeCommand("nope", parameters));
+    }
+}
+BENCHMARK(BM_CommandUnknown);
+
+// --- LED behaviors ---
+
+// One due update() per iteration: fake time advances past the behavior's
+// update interval each time, so the animation step always runs
+static void runBehavior(benchmark::State& state, LedBehavior& behavior, unsigned long stepMs) {
+    LedFrame frame;
+    behavior.setup(frame);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        fake::advance(stepMs);
+        behavior.update();
+    }
+    benchmark::DoNotOptimize(frame.rgb[0][0]);
+}
+
+static void BM_BreathingUpdate(benchmark::State& state) {
+    BreathingBehavior breathing(0x00FF00, 2000);
+    runBehavior(state, breathing, 21);
+}
+BENCHMARK(BM_BreathingUpdate);
+
+static void BM_HeartBeatUpdate(benchmark::State& state) {
+    HeartBeatBehavior heartbeat(0xFF0000, 770, 2000);
+    runBehavior(state, heartbeat, 21);
+}
+BENCHMARK(BM_HeartBeatUpdate);
+
+static void BM_SpringUpdate(benchmark::State& state) {
+    SpringBehavior spring(0x00FF00);
+    spring.setTargetBrightness(1.0f);
+    runBehavior(state, spring, 17);
+}
+BENCHMARK(BM_SpringUpdate);
+
+static void BM_CycleUpdate(benchmark::State& state) {
+    CycleBehavior cycle(0x0000FF, 100);
+    runBehavior(state, cycle, 101);
+}
+BENCHMARK(BM_CycleUpdate);
+
+static void BM_GradientUpdate(benchmark::State& state) {
+    GradientBehavior gradient;
+    runBehavior(state, gradient, 21);
+}
+BENCHMARK(BM_GradientUpdate);
+
+static void BM_CometUpdate(benchmark::State& state) {
+    CometBehavior comet;
+    runBehavior(state, comet, 21);
+}
+BENCHMARK(BM_CometUpdate);
+
+static void BM_TwinkleUpdate(benchmark::State& state) {
+    TwinkleBehavior twinkle;
+    runBehavior(state, twinkle, 21);
+}
+BENCHMARK(BM_TwinkleUpdate);
+
+static void BM_FireUpdate(benchmark::State& state) {
+    FireBehavior fire;
+    runBehavior(state, fire, 21);
+}
+BENCHMARK(BM_FireUpdate);
+
+// update() when the timer is not due, the common case in the main loop
+static void BM_BreathingIdle(benchmark::State& state) {
+    BreathingBehavior breathing(0x00FF00, 2000);
+    runBehavior(state, breathing, 0);
+}
+BENCHMARK(BM_BreathingIdle);
+
+// A full compositor tick as LedProcess runs it: breathing base, a flash
+// retriggered every 12 frames and the status pixel, blended and shown
+static void BM_CompositorRender(benchmark::State& state) {
+    Adafruit_NeoPixel strip(LED_COUNT, 2, NEO_GRB + NEO_KHZ800);
+    LedCompositor compositor;
+    BreathingBehavior breathing(0x00FF00, 2000);
+    FlashBehavior flash(0xFFFFFF, 250);
+    StatusPixelBehavior status(LED_COUNT - 1, 0x301000);
+    compositor.setBehavior(LED_LAYER_BASE, &breathing);
+    compositor.setBehavior(LED_LAYER_FLASH, &flash);
+    compositor.setBehavior(LED_LAYER_STATUS, &status);
+    int frame = 0;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        fake::advance(21);
+        if (++frame % 12 == 0) flash.trigger();
+        compositor.render(strip);
+    }
+    benchmark::DoNotOptimize(strip.shown[0]);
+}
+BENCHMARK(BM_CompositorRender);
+
+// One 20 ms LED frame of a procedural effect next to the IMU work that
+// shares the loop with it: the effect through the compositor, plus the two
+// readings IMUProcess takes in the same time. Arg: 0 gradient, 1 comet,
+// 2 twinkle, 3 fire.
+static void BM_EffectFrame(benchmark::State& state) {
+    Adafruit_NeoPixel strip(LED_COUNT, 2, NEO_GRB + NEO_KHZ800);
+    LedCompositor compositor;
+    GradientBehavior gradient;
+    CometBehavior comet;
+    TwinkleBehavior twinkle;
+    FireBehavior fire;
+    PaletteBehavior* effects[] = {&gradient, &comet, &twinkle, &fire};
+    StatusPixelBehavior status(LED_COUNT - 1, 0x301000);
+    compositor.setBehavior(LED_LAYER_BASE, effects[state.range(0)]);
+    compositor.setBehavior(LED_LAYER_STATUS, &status);
+    IMUProcess imu;
+    float wobble = 0;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (int reading = 0; reading < 2; ++reading) {
+            fake::advance(11); // a little over 20 ms a frame, so the effect is due every time
+            wobble = wobble > 50 ? -50 : wobble + 7;
+            imu.processReading(wobble, 20 - wobble, 980);
+        }
+        compositor.render(strip);
+    }
+    benchmark::DoNotOptimize(strip.shown[0]);
+}
+BENCHMARK(BM_EffectFrame)->DenseRange(0, 3);
+
+// The same for the motion-reactive behaviors, which read each IMU reading
+// back out of motionSlot: shake, tilt, motion spring
+static void BM_ReactFrame(benchmark::State& state) {
+    Adafruit_NeoPixel strip(LED_COUNT, 2, NEO_GRB + NEO_KHZ800);
+    LedCompositor compositor;
+    ShakeBehavior shake;
+    TiltBehavior tilt;
+    MotionSpringBehavior spring;
+    LedBehavior* behaviors[] = {&shake, &tilt, &spring};
+    compositor.setBehavior(LED_LAYER_BASE, behaviors[state.range(0)]);
+    IMUProcess imu;
+    float wobble = 0;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (int reading = 0; reading < 2; ++reading) {
+            fake::advance(11);
+            wobble = wobble > 500 ? -500 : wobble + 70;
+            imu.processReading(wobble, 200 - wobble, 980);
+        }
+        compositor.render(strip);
+    }
+    benchmark::DoNotOptimize(strip.shown[0]);
+}
+BENCHMARK(BM_ReactFrame)->DenseRange(0, 2);
+
+// A pattern change as the pattern command makes it and the next LED tick
+// takes it up: a behavior built in the pool, swapped onto the base layer
+// and the old one freed
+static void BM_PatternSwitch(benchmark::State& state) {
+    LedProcess led;
+    led.setup();
+    LedBehaviorSpec specs[] = {
+        ledDefaultSpec(LED_BEHAVIOR_BREATHING, 0x00FF00),
+        ledDefaultSpec(LED_BEHAVIOR_FIRE, 0),
+        ledDefaultSpec(LED_BEHAVIOR_HEARTBEAT, 0xFF0000),
+        ledDefaultSpec(LED_BEHAVIOR_TWINKLE, 0),
+    };
+    int next = 0;
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        led.setPattern(specs[next++ & 3]);
+        fake::advance(21);
+        fake::fireTickers();
+    }
+    benchmark::DoNotOptimize(led.pixels.shown[0]);
+}
+BENCHMARK(BM_PatternSwitch);
+
+// --- Configuration ---
+
+static const char* configJson = R"({
+    "wifiSSID": "GroupLoop",
+    "wifiPassword": "grouploop",
+    "socketServerURL": "ws://192.168.1.100:5003/",
+    "LEDPin": 2,
+    "motorPin": 3,
+    "deviceNamePrefix": "HitBall",
+    "roomWidth": 12.5,
+    "roomHeight": 8
+})";
+
+static void BM_ConfigurationParse(benchmark::State& state) {
+    Configuration config;
+    config.loadDefaults();
+    String json(configJson);
+    // The first parse grows the strings; count the steady state. Each
+    // parse saves and says so on Serial, whose captured output would grow.
+    config.parseFromJSON(json);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.parseFromJSON(json));
+        Serial.reset();
+    }
+}
+BENCHMARK(BM_ConfigurationParse);
+
+static void BM_ConfigurationToJSON(benchmark::State& state) {
+    Configuration config;
+    config.loadDefaults();
+    config.addNetwork("Backstage", "secret", 2);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        String json = config.toJSON();
+        benchmark::DoNotOptimize(json.length());
+    }
+}
+BENCHMARK(BM_ConfigurationToJSON);
+
+// --- Utils ---
+
+static void BM_HexToColor(benchmark::State& state) {
+    String hex("#ff8000");
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hexToColor(hex));
+    }
+}
+BENCHMARK(BM_HexToColor);
+
+int main(int argc, char** argv) {
+    fake::setMillis(1000);
+    setupFirmware();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Check firmware benchmark results against the allocation budget and,
+optionally, against a baseline run from the same machine.
+
+  check_bench.py --run build/firmware_bench --budget budget.json
+  check_bench.py results.json --baseline before.json --threshold 0.10
+
+Allocation counts are machine independent, so the budget is committed.
+They are host counts, though: the fake String is a std::string, which keeps
+up to 15 characters inline, where the ESP32 String keeps only 11. A String
+of 12-15 characters allocates on the device but not here, so allocs/op can
+under-report the device for code that builds such Strings.
+Timings are not: record a baseline before a change and compare after it.
+Exits non-zero if a benchmark allocates more than its budget or got slower
+than the threshold allows.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+
+def load_results(path):
+    with open(path) as f:
+        return index(json.load(f))
+
+
+def index(results):
+    # Aggregates (mean/median) take precedence over single repetitions
+    by_name = {}
+    for bench in results.get("benchmarks", []):
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "median":
+            continue
+        name = bench.get("run_name", bench["name"])
+        if bench.get("error_occurred"):
+            raise SystemExit(f"{name}: {bench.get('error_message', 'error')}")
+        by_name[name] = bench
+    return by_name
+
+
+def run(binary):
+    output = subprocess.run(
+        [binary, "--benchmark_format=json", "--benchmark_min_time=0.05"],
+        check=True, capture_output=True, text=True).stdout
+    return index(json.loads(output))
+
+
+def check_budget(results, budget):
+    failures = []
+    for name, allowed in budget.items():
+        bench = results.get(name)
+        if bench is None:
+            failures.append(f"{name}: missing from results")
+            continue
+        allocs = bench.get("allocs/op", 0.0)
+        status = "ok" if allocs <= allowed + 1e-6 else "OVER"
+        print(f"  {name:<36} {allocs:8.2f} allocs/op  (budget {allowed})  {status}")
+        if status != "ok":
+            failures.append(f"{name}: {allocs:.2f} allocs/op, budget {allowed}")
+    return failures
+
+
+def check_baseline(results, baseline, threshold):
+    failures = []
+    for name, bench in sorted(results.items()):
+        before = baseline.get(name)
+        if before is None:
+            continue
+        old, new = before["cpu_time"], bench["cpu_time"]
+        change = (new - old) / old if old > 0 else 0.0
+        status = "ok" if change <= threshold else "SLOWER"
+        print(f"  {name:<36} {old:10.1f} -> {new:10.1f} {bench['time_unit']}  {change:+7.1%}  {status}")
+        if status != "ok":
+            failures.append(f"{name}: {change:+.1%} cpu time (threshold {threshold:.0%})")
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("results", nargs="?", help="--benchmark_format=json output")
+    parser.add_argument("--run", metavar="BINARY", help="run the benchmarks instead of reading results")
+    parser.add_argument("--budget", help="JSON map of benchmark name to allowed allocs/op")
+    parser.add_argument("--baseline", help="results from before the change")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed cpu time increase (default 0.10)")
+    args = parser.parse_args()
+
+    if args.run:
+        results = run(args.run)
+    elif args.results:
+        results = load_results(args.results)
+    else:
+        parser.error("give a results file or --run")
+
+    failures = []
+    if args.budget:
+        with open(args.budget) as f:
+            budget = json.load(f)
+        print("Allocations:")
+        failures += check_budget(results, budget)
+    if args.baseline:
+        print(f"Timing against {args.baseline}:")
+        failures += check_baseline(results, load_results(args.baseline), args.threshold)
+
+    for failure in failures:
+        print(f"FAIL {failure}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,17 @@
+# ArduinoJson is header-only. Reuse the copy `pio test -e native` installs,
+# or point ARDUINOJSON_DIR at any directory holding ArduinoJson.h; as a
+# last resort it is fetched. Expects FIRMWARE_DIR to be set.
+find_path(ARDUINOJSON_DIR ArduinoJson.h
+  PATHS ${FIRMWARE_DIR}/.pio/libdeps/native/ArduinoJson/src
+  NO_DEFAULT_PATH)
+if(NOT ARDUINOJSON_DIR)
+  include(FetchContent)
+  FetchContent_Declare(arduinojson
+    GIT_REPOSITORY https://github.com/bblanchon/ArduinoJson.git
+    GIT_TAG v7.4.2)
+  FetchContent_GetProperties(arduinojson)
+  if(NOT arduinojson_POPULATED)
+    FetchContent_Populate(arduinojson)
+  endif()
+  set(ARDUINOJSON_DIR ${arduinojson_SOURCE_DIR}/src CACHE PATH "" FORCE)
+endif()
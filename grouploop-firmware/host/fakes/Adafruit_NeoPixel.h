@@ -0,0 +1,52 @@
+#ifndef FAKE_ADAFRUIT_NEOPIXEL_H
+#define FAKE_ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+typedef uint16_t neoPixelType;
+
+// Strip stand-in. Colors are stored as given (0x00RRGGBB, brightness not
+// applied); show() snapshots them into 'shown' so a test can tell what was
+// actually pushed to the LEDs from what is only staged.
+class Adafruit_NeoPixel {
+public:
+    Adafruit_NeoPixel(uint16_t count, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+        : pixels(count, 0), shown(count, 0), pin(pin) {}
+
+    void begin() { begun = true; }
+    void show() {
+        shown = pixels;
+        showCount++;
+    }
+    void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+    void fill(uint32_t color = 0, uint16_t first = 0, uint16_t count = 0) {
+        uint16_t end = count == 0 ? numPixels() : std::min<uint16_t>(numPixels(), first + count);
+        for (uint16_t i = first; i < end; ++i) pixels[i] = color;
+    }
+    void setPixelColor(uint16_t index, uint32_t color) {
+        if (index < numPixels()) pixels[index] = color;
+    }
+    void setPixelColor(uint16_t index, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(index, Color(r, g, b)); }
+    uint32_t getPixelColor(uint16_t index) const { return index < numPixels() ? pixels[index] : 0; }
+    void setBrightness(uint8_t value) { brightness = value; }
+    uint8_t getBrightness() const { return brightness; }
+    uint16_t numPixels() const { return (uint16_t)pixels.size(); }
+    int16_t getPin() const { return pin; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+    std::vector<uint32_t> pixels;
+    std::vector<uint32_t> shown;
+    int16_t pin;
+    uint8_t brightness = 255;
+    unsigned long showCount = 0;
+    bool begun = false;
+};
+
+#endif // FAKE_ADAFRUIT_NEOPIXEL_H
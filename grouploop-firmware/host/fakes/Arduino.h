@@ -0,0 +1,264 @@
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+// Host stand-in for the Arduino core, used by [env:native] so the firmware
+// classes compile and run under the unit tests. Only the parts the firmware
+// uses are provided. Time does not pass by itself: tests move it with
+// fake::advance() (delay() does the same), and Serial output is captured in
+// Serial.output instead of going to a port.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+
+using std::abs;
+using std::min;
+using std::max;
+
+#define PI 3.1415926535897932384626433832795
+#define HEX 16
+#define DEC 10
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define IRAM_ATTR
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+namespace fake {
+    inline uint64_t nowMicros = 0;
+    inline int pinLevels[64];
+    inline int analogLevels[64];
+
+    inline void setMillis(unsigned long ms) { nowMicros = (uint64_t)ms * 1000; }
+    inline void advance(unsigned long ms) { nowMicros += (uint64_t)ms * 1000; }
+    inline void advanceMicros(unsigned long us) { nowMicros += us; }
+}
+
+inline unsigned long millis() { return (unsigned long)(fake::nowMicros / 1000); }
+inline unsigned long micros() { return (unsigned long)fake::nowMicros; }
+inline void delay(unsigned long ms) { fake::advance(ms); }
+inline void delayMicroseconds(unsigned int us) { fake::advanceMicros(us); }
+inline void yield() {}
+
+inline void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+inline long random(long howBig) { return howBig > 0 ? rand() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall; }
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int level) { if (pin >= 0 && pin < 64) fake::pinLevels[pin] = level; }
+inline int digitalRead(int pin) { return pin >= 0 && pin < 64 ? fake::pinLevels[pin] : LOW; }
+inline void analogWrite(int pin, int value) { if (pin >= 0 && pin < 64) fake::analogLevels[pin] = value; }
+inline int analogRead(int pin) { return pin >= 0 && pin < 64 ? fake::analogLevels[pin] : 0; }
+
+// Arduino String over std::string, with the Arduino semantics the firmware
+// relies on (out of range substring() is empty, indexOf() returns -1)
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    String(int number, unsigned char base = DEC) { format(base == HEX ? "%x" : "%d", number); }
+    String(unsigned int number, unsigned char base = DEC) { format(base == HEX ? "%x" : "%u", number); }
+    String(long number, unsigned char base = DEC) { format(base == HEX ? "%lx" : "%ld", number); }
+    String(unsigned long number, unsigned char base = DEC) { format(base == HEX ? "%lx" : "%lu", number); }
+    String(float number, unsigned int decimals = 2) { format("%.*f", (int)decimals, (double)number); }
+    String(double number, unsigned int decimals = 2) { format("%.*f", (int)decimals, number); }
+
+    // Copies into the existing buffer, as the Arduino String does
+    String& operator=(const char* text) { value = text ? text : ""; return *this; }
+
+    unsigned int length() const { return (unsigned int)value.size(); }
+    const char* c_str() const { return value.c_str(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    bool isEmpty() const { return value.empty(); }
+
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    bool equals(const String& other) const { return value == other.value; }
+    bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    bool endsWith(const String& suffix) const {
+        return value.size() >= suffix.value.size() &&
+               value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return position(value.find(c, from)); }
+    int indexOf(const String& text, unsigned int from = 0) const { return position(value.find(text.value, from)); }
+    int lastIndexOf(char c) const { return position(value.rfind(c)); }
+
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= value.size()) return String();
+        return String(value.substr(from, to - from));
+    }
+
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    double toDouble() const { return atof(c_str()); }
+
+    void trim() {
+        size_t first = value.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) { value.clear(); return; }
+        value = value.substr(first, value.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    void toLowerCase() { for (char& c : value) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (char& c : value) c = (char)toupper((unsigned char)c); }
+    void remove(unsigned int index, unsigned int count = 1) { if (index < value.size()) value.erase(index, count); }
+    void replace(const String& find, const String& with) {
+        if (find.value.empty()) return;
+        for (size_t at = value.find(find.value); at != std::string::npos; at = value.find(find.value, at + with.value.size())) {
+            value.replace(at, find.value.size(), with.value);
+        }
+    }
+
+    bool concat(const String& other) { value += other.value; return true; }
+    bool concat(const char* text) { if (text) value += text; return true; }
+    bool concat(const char* text, unsigned int length) { value.append(text, length); return true; }
+    bool concat(char c) { value += c; return true; }
+    bool concat(int number) { return concat(String(number)); }
+    bool concat(unsigned int number) { return concat(String(number)); }
+    bool concat(long number) { return concat(String(number)); }
+    bool concat(unsigned long number) { return concat(String(number)); }
+    bool concat(double number) { return concat(String(number)); }
+
+    template <typename T> String& operator+=(const T& other) { concat(other); return *this; }
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* text) const { return value == (text ? text : ""); }
+    bool operator!=(const String& other) const { return !(*this == other); }
+    bool operator!=(const char* text) const { return !(*this == text); }
+    bool operator<(const String& other) const { return value < other.value; }
+
+private:
+    static int position(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+
+    void format(const char* spec, ...) {
+        char buffer[40];
+        va_list args;
+        va_start(args, spec);
+        vsnprintf(buffer, sizeof(buffer), spec, args);
+        va_end(args);
+        value = buffer;
+    }
+
+    std::string value;
+};
+
+// Result type of String concatenation, as in the Arduino core
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& text) : String(text) {}
+};
+
+inline StringSumHelper operator+(const String& left, const String& right) { String sum(left); sum.concat(right); return sum; }
+inline StringSumHelper operator+(const String& left, const char* right) { String sum(left); sum.concat(right); return sum; }
+inline StringSumHelper operator+(const char* left, const String& right) { String sum(left); sum.concat(right); return sum; }
+inline StringSumHelper operator+(const String& left, char right) { String sum(left); sum.concat(right); return sum; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        for (size_t i = 0; i < size; ++i) write(buffer[i]);
+        return size;
+    }
+    size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+
+    size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int number, int base = DEC) { return print((long)number, base); }
+    size_t print(unsigned int number, int base = DEC) { return print((unsigned long)number, base); }
+    size_t print(long number, int base = DEC) { return printf(base == HEX ? "%lX" : "%ld", number); }
+    size_t print(unsigned long number, int base = DEC) { return printf(base == HEX ? "%lX" : "%lu", number); }
+    size_t print(long long number, int base = DEC) { return printf(base == HEX ? "%llX" : "%lld", number); }
+    size_t print(unsigned long long number, int base = DEC) { return printf(base == HEX ? "%llX" : "%llu", number); }
+    size_t print(double number, int decimals = 2) { return printf("%.*f", decimals, number); }
+
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+    template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        return write((const uint8_t*)buffer, std::min((size_t)length, sizeof(buffer) - 1));
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+};
+
+// Serial port: everything printed is appended to 'output' (and echoed to
+// stdout when 'echo' is set); 'input' feeds available()/read()
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c) override {
+        output += (char)c;
+        if (echo) putchar(c);
+        return 1;
+    }
+    using Print::write;
+
+    int available() override { return (int)(input.size() - inputPos); }
+    int read() override { return inputPos < input.size() ? (uint8_t)input[inputPos++] : -1; }
+    int peek() override { return inputPos < input.size() ? (uint8_t)input[inputPos] : -1; }
+
+    void feed(const std::string& text) { input += text; }
+    void reset() { output.clear(); input.clear(); inputPos = 0; }
+
+    std::string output;
+    std::string input;
+    size_t inputPos = 0;
+    bool echo = false;
+};
+
+inline HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return freeHeap; }
+    uint32_t getMinFreeHeap() { return minFreeHeap; }
+    uint32_t getMaxAllocHeap() { return maxAllocHeap; }
+    uint32_t getHeapSize() { return 327680; }
+    uint32_t getCycleCount() { return (uint32_t)(fake::nowMicros * 160); }
+    void restart() { restarts++; }
+
+    uint32_t freeHeap = 200000;
+    uint32_t minFreeHeap = 180000;
+    uint32_t maxAllocHeap = 110000;
+    unsigned restarts = 0;
+};
+
+inline EspClass ESP;
+
+#endif // FAKE_ARDUINO_H
@@ -0,0 +1,17 @@
+#ifndef FAKE_BLE_DEVICE_H
+#define FAKE_BLE_DEVICE_H
+
+#include "Arduino.h"
+#include "esp_gap_ble_api.h"
+#include <string>
+
+// Bluedroid stand-in: only what the beacon scanner uses. Advertisements
+// come in through the GAP handler, see esp_gap_ble_api.h.
+class BLEDevice {
+public:
+    static void init(const std::string& name) {}
+    static void deinit(bool releaseMemory = false) {}
+    static void setCustomGapHandler(esp_gap_ble_cb_t handler) { fake::gapHandler = handler; }
+};
+
+#endif // FAKE_BLE_DEVICE_H
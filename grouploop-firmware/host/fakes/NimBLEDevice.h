@@ -0,0 +1,75 @@
+#ifndef FAKE_NIMBLE_DEVICE_H
+#define FAKE_NIMBLE_DEVICE_H
+
+#include "Arduino.h"
+#include <string>
+#include <vector>
+
+// NimBLE-Arduino 1.4 stand-in. A test delivers an advertisement with
+// NimBLEDevice::getScan()->advertise(...). Addresses are stored in
+// NimBLE's native (reversed) byte order.
+
+class NimBLEAddress {
+public:
+    const uint8_t* getNative() const { return address; }
+    uint8_t address[6] = {0};
+};
+
+class NimBLEAdvertisedDevice {
+public:
+    NimBLEAddress getAddress() { return address; }
+    int getRSSI() { return rssi; }
+    uint8_t* getPayload() { return payload.data(); }
+    size_t getPayloadLength() { return payload.size(); }
+
+    NimBLEAddress address;
+    int rssi = 0;
+    std::vector<uint8_t> payload;
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+public:
+    virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+    virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class NimBLEScanResults {};
+
+class NimBLEScan {
+public:
+    void setActiveScan(bool active) {}
+    void setInterval(uint16_t value) { interval = value; }
+    void setWindow(uint16_t value) { window = value; }
+    void setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks* value, bool wantDuplicates = false) { callbacks = value; }
+    void setDuplicateFilter(bool enabled) {}
+    void setMaxResults(uint8_t count) {}
+    bool start(uint32_t duration, void (*complete)(NimBLEScanResults), bool continuing = false) { scanning = true; return true; }
+    bool stop() { scanning = false; return true; }
+    void clearResults() {}
+
+    // 'address' in display order, like fake::bleAdvertise()
+    void advertise(const uint8_t address[6], int rssi, const uint8_t* payload, size_t length) {
+        if (!scanning || !callbacks) return;
+        NimBLEAdvertisedDevice device;
+        for (int i = 0; i < 6; ++i) device.address.address[i] = address[5 - i];
+        device.rssi = rssi;
+        device.payload.assign(payload, payload + length);
+        callbacks->onResult(&device);
+    }
+
+    NimBLEAdvertisedDeviceCallbacks* callbacks = nullptr;
+    uint16_t interval = 0;
+    uint16_t window = 0;
+    bool scanning = false;
+};
+
+class NimBLEDevice {
+public:
+    static void init(const std::string& name) {}
+    static NimBLEScan* getScan() {
+        static NimBLEScan scan;
+        return &scan;
+    }
+};
+
+#endif // FAKE_NIMBLE_DEVICE_H
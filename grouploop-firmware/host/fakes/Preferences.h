@@ -0,0 +1,97 @@
+#ifndef FAKE_PREFERENCES_H
+#define FAKE_PREFERENCES_H
+
+#include "Arduino.h"
+#include <map>
+
+// NVS stand-in. All namespaces share one in-memory store keyed by
+// "namespace/key", which outlives Preferences objects like flash does;
+// fake::clearPreferences() wipes it between tests.
+namespace fake {
+    inline std::map<std::string, std::string> preferenceStore;
+    inline void clearPreferences() { preferenceStore.clear(); }
+}
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        space = name ? name : "";
+        this->readOnly = readOnly;
+        open = true;
+        return true;
+    }
+    void end() { open = false; }
+
+    bool clear() {
+        if (!writable()) return false;
+        std::string prefix = space + "/";
+        for (auto it = fake::preferenceStore.begin(); it != fake::preferenceStore.end();) {
+            it = it->first.compare(0, prefix.size(), prefix) == 0 ? fake::preferenceStore.erase(it) : std::next(it);
+        }
+        return true;
+    }
+    bool remove(const char* key) { return writable() && fake::preferenceStore.erase(path(key)) > 0; }
+    bool isKey(const char* key) { return open && fake::preferenceStore.count(path(key)) > 0; }
+
+    size_t putString(const char* key, const String& value) { return put(key, value.c_str(), value.length()); }
+    size_t putString(const char* key, const char* value) { return put(key, value, strlen(value)); }
+    String getString(const char* key, const String& defaultValue = String()) {
+        const std::string* stored = find(key);
+        return stored ? String(*stored) : defaultValue;
+    }
+
+    size_t putInt(const char* key, int32_t value) { return putValue(key, value); }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putUInt(const char* key, uint32_t value) { return putValue(key, value); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putUChar(const char* key, uint8_t value) { return putValue(key, value); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putBool(const char* key, bool value) { return putValue(key, value); }
+    bool getBool(const char* key, bool defaultValue = false) { return getValue(key, defaultValue); }
+    size_t putFloat(const char* key, float value) { return putValue(key, value); }
+    float getFloat(const char* key, float defaultValue = NAN) { return getValue(key, defaultValue); }
+
+    size_t putBytes(const char* key, const void* value, size_t length) { return put(key, (const char*)value, length); }
+    size_t getBytesLength(const char* key) {
+        const std::string* stored = find(key);
+        return stored ? stored->size() : 0;
+    }
+    size_t getBytes(const char* key, void* out, size_t size) {
+        const std::string* stored = find(key);
+        if (!stored || stored->size() > size) return 0;
+        memcpy(out, stored->data(), stored->size());
+        return stored->size();
+    }
+
+private:
+    bool writable() const { return open && !readOnly; }
+    std::string path(const char* key) const { return space + "/" + (key ? key : ""); }
+
+    const std::string* find(const char* key) {
+        if (!open) return nullptr;
+        auto it = fake::preferenceStore.find(path(key));
+        return it == fake::preferenceStore.end() ? nullptr : &it->second;
+    }
+
+    size_t put(const char* key, const char* data, size_t length) {
+        if (!writable()) return 0;
+        fake::preferenceStore[path(key)] = std::string(data, length);
+        return length;
+    }
+
+    template <typename T> size_t putValue(const char* key, T value) { return put(key, (const char*)&value, sizeof(value)); }
+
+    template <typename T> T getValue(const char* key, T defaultValue) {
+        const std::string* stored = find(key);
+        if (!stored || stored->size() != sizeof(T)) return defaultValue;
+        T value;
+        memcpy(&value, stored->data(), sizeof(T));
+        return value;
+    }
+
+    std::string space;
+    bool open = false;
+    bool readOnly = false;
+};
+
+#endif // FAKE_PREFERENCES_H
@@ -0,0 +1,34 @@
+#ifndef FAKE_SPARKFUN_LIS2DH12_H
+#define FAKE_SPARKFUN_LIS2DH12_H
+
+#include "Arduino.h"
+#include <Wire.h>
+
+#define LIS2DH12_HR_12bit 0
+#define LIS2DH12_NM_10bit 1
+#define LIS2DH12_LP_8bit 2
+#define LIS2DH12_ODR_100Hz 5
+#define LIS2DH12_2g 0
+#define LIS2DH12_4g 1
+
+// Accelerometer stand-in: reports the values in x/y/z (milli-g), which
+// default to lying flat
+class SPARKFUN_LIS2DH12 {
+public:
+    bool begin(uint8_t address = 0x19, TwoWire& bus = Wire) { return present; }
+    bool isConnected() { return present; }
+    bool available() { return present; }
+    void setMode(uint8_t mode) {}
+    void setDataRate(uint8_t rate) {}
+    void setScale(uint8_t scale) {}
+    float getX() { return x; }
+    float getY() { return y; }
+    float getZ() { return z; }
+
+    bool present = true;
+    float x = 0;
+    float y = 0;
+    float z = 1000;
+};
+
+#endif // FAKE_SPARKFUN_LIS2DH12_H
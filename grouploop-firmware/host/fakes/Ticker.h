@@ -0,0 +1,50 @@
+#ifndef FAKE_TICKER_H
+#define FAKE_TICKER_H
+
+#include "Arduino.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+class Ticker;
+
+namespace fake {
+    inline std::vector<Ticker*> tickers;
+
+    // Run every attached ticker once, as the timer task would
+    inline void fireTickers();
+}
+
+// Timer stand-in. Nothing fires by itself; fire() runs the attached
+// callback, as the timer task would after each period.
+class Ticker {
+public:
+    Ticker() { fake::tickers.push_back(this); }
+    ~Ticker() { fake::tickers.erase(std::find(fake::tickers.begin(), fake::tickers.end(), this)); }
+    Ticker(const Ticker&) = delete;
+    Ticker& operator=(const Ticker&) = delete;
+
+    void attach_ms(uint32_t milliseconds, void (*callback)()) { arm(milliseconds, [callback]() { callback(); }); }
+    template <typename T>
+    void attach_ms(uint32_t milliseconds, void (*callback)(T), T arg) { arm(milliseconds, [callback, arg]() { callback(arg); }); }
+    void detach() { action = nullptr; period = 0; }
+    bool active() const { return (bool)action; }
+
+    void fire() { if (action) action(); }
+
+    uint32_t period = 0;
+
+private:
+    void arm(uint32_t milliseconds, std::function<void()> callback) {
+        period = milliseconds;
+        action = callback;
+    }
+
+    std::function<void()> action;
+};
+
+inline void fake::fireTickers() {
+    for (Ticker* ticker : fake::tickers) ticker->fire();
+}
+
+#endif // FAKE_TICKER_H
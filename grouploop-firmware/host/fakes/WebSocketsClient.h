@@ -0,0 +1,117 @@
+#ifndef FAKE_WEBSOCKETS_CLIENT_H
+#define FAKE_WEBSOCKETS_CLIENT_H
+
+#include "Arduino.h"
+#include <functional>
+#include <deque>
+#include <vector>
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+// links2004 WebSockets client stand-in. Tests queue server-side events with
+// inject(); they are delivered from loop(), on whichever thread services
+// the client, like the real library. Frames written with sendTXT() are kept
+// in 'sent' (only counted when 'recordSent' is off, so a soak test does
+// not grow the heap); set 'failSends' to simulate a stalled connection.
+// 'latest' points at the most recently constructed client, which lets a
+// test reach the one owned by a global such as webSocketManager.
+class WebSocketsClient {
+public:
+    typedef std::function<void(WStype_t type, uint8_t* payload, size_t length)> WebSocketClientEvent;
+
+    WebSocketsClient() { latest = this; }
+
+    void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino") {
+        this->host = host;
+        this->port = port;
+        this->url = url;
+        started = true;
+    }
+    void begin(const String& host, uint16_t port, const String& url = "/", const String& protocol = "arduino") {
+        begin(host.c_str(), port, url.c_str(), protocol.c_str());
+    }
+
+    void onEvent(WebSocketClientEvent callback) { handler = callback; }
+    void setReconnectInterval(unsigned long interval) { reconnectInterval = interval; }
+    void enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectCount) {}
+
+    void loop() {
+        loops++;
+        while (!inbox.empty()) {
+            Pending event = std::move(inbox.front());
+            inbox.pop_front();
+            if (event.type == WStype_CONNECTED) connected = true;
+            if (event.type == WStype_DISCONNECTED) connected = false;
+            if (handler) handler(event.type, (uint8_t*)event.payload.data(), event.payload.size());
+        }
+    }
+
+    void disconnect() {
+        if (connected && handler) handler(WStype_DISCONNECTED, nullptr, 0);
+        connected = false;
+    }
+
+    bool isConnected() { return connected; }
+
+    bool sendTXT(uint8_t* payload, size_t length = 0, bool headerToPayload = false) {
+        if (length == 0) length = strlen((const char*)payload);
+        if (failSends || !connected) return false;
+        sentCount++;
+        if (recordSent) sent.emplace_back((const char*)payload, length);
+        return true;
+    }
+    bool sendTXT(const uint8_t* payload, size_t length = 0) { return sendTXT((uint8_t*)payload, length); }
+    bool sendTXT(char* payload, size_t length = 0, bool headerToPayload = false) { return sendTXT((uint8_t*)payload, length); }
+    bool sendTXT(const char* payload) { return sendTXT((uint8_t*)payload, strlen(payload)); }
+    bool sendTXT(String& payload) { return sendTXT((uint8_t*)payload.c_str(), payload.length()); }
+
+    // --- Test controls ---
+
+    void inject(WStype_t type, const std::string& payload = std::string()) {
+        inbox.push_back(Pending{type, payload});
+    }
+    void injectText(const std::string& text) { inject(WStype_TEXT, text); }
+    void injectConnected() { inject(WStype_CONNECTED, "/"); }
+    void injectDisconnected() { inject(WStype_DISCONNECTED); }
+
+    // Run the event handler right away instead of from loop(); copies
+    // nothing, for benchmarks that count allocations
+    void deliver(WStype_t type, const char* payload, size_t length) {
+        if (handler) handler(type, (uint8_t*)payload, length);
+    }
+
+    struct Pending {
+        WStype_t type;
+        std::string payload;
+    };
+
+    WebSocketClientEvent handler;
+    std::deque<Pending> inbox;
+    std::vector<std::string> sent;
+    unsigned long sentCount = 0;
+    bool recordSent = true;
+    bool connected = false;
+    bool failSends = false;
+    bool started = false;
+    unsigned long reconnectInterval = 0;
+    unsigned long loops = 0;
+    std::string host;
+    uint16_t port = 0;
+    std::string url;
+
+    static inline WebSocketsClient* latest = nullptr;
+};
+
+#endif // FAKE_WEBSOCKETS_CLIENT_H
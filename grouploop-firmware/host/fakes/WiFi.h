@@ -0,0 +1,134 @@
+#ifndef FAKE_WIFI_H
+#define FAKE_WIFI_H
+
+#include "Arduino.h"
+#include <functional>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_SCAN_DONE = 1,
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+} arduino_event_id_t;
+
+typedef struct { uint8_t reason; } wifi_event_sta_disconnected_t;
+typedef union { wifi_event_sta_disconnected_t wifi_sta_disconnected; } arduino_event_info_t;
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+typedef enum { WIFI_FAST_SCAN = 0, WIFI_ALL_CHANNEL_SCAN = 1 } wifi_scan_method_t;
+typedef enum { WIFI_CONNECT_AP_BY_SIGNAL = 0, WIFI_CONNECT_AP_BY_SECURITY = 1 } wifi_sort_method_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+#define WIFI_REASON_ASSOC_LEAVE 8
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : address(address) {}
+
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        if (sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    bool fromString(const String& text) { return fromString(text.c_str()); }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(address & 255), (unsigned)((address >> 8) & 255),
+                 (unsigned)((address >> 16) & 255), (unsigned)(address >> 24));
+        return String(text);
+    }
+    operator uint32_t() const { return address; }
+
+private:
+    uint32_t address;
+};
+
+// Station interface stand-in. It never associates on its own: tests set
+// 'state' (and fire events through onEvent handlers if they need to).
+// Scans find nothing.
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t value) { currentMode = value; return true; }
+    wl_status_t status() { return state; }
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true) {
+        ssidText = ssid ? ssid : "";
+        beginCount++;
+        return state;
+    }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()) { return true; }
+    bool disconnect(bool wifiOff = false, bool eraseAp = false) { state = WL_DISCONNECTED; return true; }
+    bool reconnect() { return true; }
+    bool setAutoReconnect(bool value) { return true; }
+    void persistent(bool value) {}
+    bool setSleep(bool value) { return true; }
+    bool setHostname(const char* name) { return true; }
+    void setScanMethod(wifi_scan_method_t method) {}
+    void setSortMethod(wifi_sort_method_t method) {}
+
+    IPAddress localIP() { return state == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress(); }
+    String SSID() const { return String(ssidText); }
+    String SSID(uint8_t index) const { return String(); }
+    int8_t RSSI() { return rssi; }
+    int32_t RSSI(uint8_t index) { return 0; }
+    uint8_t* BSSID() { return bssid; }
+    uint8_t* BSSID(uint8_t index) { return bssid; }
+    String BSSIDstr() {
+        char text[18];
+        snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+        return String(text);
+    }
+    int32_t channel() { return 1; }
+    int32_t channel(uint8_t index) { return 0; }
+
+    uint8_t* macAddress(uint8_t* out) { memcpy(out, mac, 6); return out; }
+    String macAddress() {
+        char text[18];
+        snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        return String(text);
+    }
+
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = (arduino_event_id_t)0) {
+        eventHandler = callback;
+        return 1;
+    }
+
+    int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false, uint32_t maxMsPerChannel = 300, uint8_t channel = 0) { return async ? WIFI_SCAN_RUNNING : 0; }
+    int16_t scanComplete() { return 0; }
+    void scanDelete() {}
+
+    wl_status_t state = WL_DISCONNECTED;
+    wifi_mode_t currentMode = WIFI_OFF;
+    std::string ssidText;
+    int8_t rssi = -60;
+    uint8_t bssid[6] = {0x02, 0, 0, 0, 0, 0x01};
+    uint8_t mac[6] = {0x64, 0xE8, 0x33, 0x00, 0xAB, 0xCD};
+    unsigned beginCount = 0;
+    WiFiEventFuncCb eventHandler;
+};
+
+inline WiFiClass WiFi;
+
+#endif // FAKE_WIFI_H
@@ -0,0 +1,12 @@
+#ifndef FAKE_WIFI_MULTI_H
+#define FAKE_WIFI_MULTI_H
+
+#include "WiFi.h"
+
+class WiFiMulti {
+public:
+    bool addAP(const char* ssid, const char* passphrase = nullptr) { return true; }
+    uint8_t run(uint32_t connectTimeout = 5000) { return WiFi.status(); }
+};
+
+#endif // FAKE_WIFI_MULTI_H
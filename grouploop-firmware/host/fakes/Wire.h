@@ -0,0 +1,24 @@
+#ifndef FAKE_WIRE_H
+#define FAKE_WIRE_H
+
+#include "Arduino.h"
+
+// I2C bus stand-in; nothing is attached, the IMU is faked at driver level
+class TwoWire {
+public:
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frequency = 0) { return true; }
+    void setClock(uint32_t frequency) { clock = frequency; }
+    void beginTransmission(uint8_t address) {}
+    uint8_t endTransmission(bool stop = true) { return 2; } // NACK on address
+    uint8_t requestFrom(uint8_t address, uint8_t count) { return 0; }
+    size_t write(uint8_t value) { return 1; }
+    int available() { return 0; }
+    int read() { return -1; }
+
+    uint32_t clock = 100000;
+};
+
+inline TwoWire Wire;
+
+#endif // FAKE_WIRE_H
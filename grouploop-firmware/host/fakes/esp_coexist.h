@@ -0,0 +1,22 @@
+#ifndef FAKE_ESP_COEXIST_H
+#define FAKE_ESP_COEXIST_H
+
+#include "esp_system.h"
+
+typedef enum {
+    ESP_COEX_PREFER_WIFI = 0,
+    ESP_COEX_PREFER_BT,
+    ESP_COEX_PREFER_BALANCE,
+    ESP_COEX_PREFER_NUM,
+} esp_coex_prefer_t;
+
+namespace fake {
+    inline esp_coex_prefer_t coexPreference = ESP_COEX_PREFER_BALANCE;
+}
+
+inline esp_err_t esp_coex_preference_set(esp_coex_prefer_t preference) {
+    fake::coexPreference = preference;
+    return ESP_OK;
+}
+
+#endif // FAKE_ESP_COEXIST_H
@@ -0,0 +1,95 @@
+#ifndef FAKE_ESP_GAP_BLE_API_H
+#define FAKE_ESP_GAP_BLE_API_H
+
+#include "esp_system.h"
+#include <string.h>
+
+// The part of the Bluedroid GAP API the beacon scanner uses. A test
+// delivers an advertisement with fake::bleAdvertise(), which calls the
+// registered GAP handler while a scan is running.
+
+typedef uint8_t esp_bd_addr_t[6];
+
+#define ESP_BLE_ADV_DATA_LEN_MAX 31
+#define ESP_BLE_SCAN_RSP_DATA_LEN_MAX 31
+
+typedef enum {
+    ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT = 2,
+    ESP_GAP_BLE_SCAN_RESULT_EVT = 3,
+    ESP_GAP_BLE_SCAN_START_COMPLETE_EVT = 7,
+    ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT = 18,
+} esp_gap_ble_cb_event_t;
+
+typedef enum {
+    ESP_GAP_SEARCH_INQ_RES_EVT = 0,
+    ESP_GAP_SEARCH_INQ_CMPL_EVT = 1,
+} esp_gap_search_evt_t;
+
+typedef enum { BLE_SCAN_TYPE_PASSIVE = 0, BLE_SCAN_TYPE_ACTIVE } esp_ble_scan_type_t;
+typedef enum { BLE_ADDR_TYPE_PUBLIC = 0, BLE_ADDR_TYPE_RANDOM } esp_ble_addr_type_t;
+typedef enum { BLE_SCAN_FILTER_ALLOW_ALL = 0 } esp_ble_scan_filter_t;
+typedef enum { BLE_SCAN_DUPLICATE_DISABLE = 0, BLE_SCAN_DUPLICATE_ENABLE } esp_ble_scan_duplicate_t;
+
+typedef struct {
+    esp_ble_scan_type_t scan_type;
+    esp_ble_addr_type_t own_addr_type;
+    esp_ble_scan_filter_t scan_filter_policy;
+    uint16_t scan_interval;
+    uint16_t scan_window;
+    esp_ble_scan_duplicate_t scan_duplicate;
+} esp_ble_scan_params_t;
+
+typedef union {
+    struct ble_scan_result_evt_param {
+        esp_gap_search_evt_t search_evt;
+        esp_bd_addr_t bda;
+        int rssi;
+        uint8_t ble_adv[ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX];
+        uint8_t adv_data_len;
+        uint8_t scan_rsp_len;
+    } scan_rst;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+namespace fake {
+    inline esp_gap_ble_cb_t gapHandler = nullptr;
+    inline esp_ble_scan_params_t scanParams = {};
+    inline bool bleScanning = false;
+
+    // 'address' in display order, as Bluedroid reports it
+    inline void bleAdvertise(const uint8_t address[6], int rssi, const uint8_t* payload, size_t length) {
+        if (!bleScanning || !gapHandler) return;
+        esp_ble_gap_cb_param_t param = {};
+        param.scan_rst.search_evt = ESP_GAP_SEARCH_INQ_RES_EVT;
+        memcpy(param.scan_rst.bda, address, 6);
+        param.scan_rst.rssi = rssi;
+        if (length > sizeof(param.scan_rst.ble_adv)) length = sizeof(param.scan_rst.ble_adv);
+        memcpy(param.scan_rst.ble_adv, payload, length);
+        param.scan_rst.adv_data_len = (uint8_t)(length > ESP_BLE_ADV_DATA_LEN_MAX ? ESP_BLE_ADV_DATA_LEN_MAX : length);
+        param.scan_rst.scan_rsp_len = (uint8_t)(length - param.scan_rst.adv_data_len);
+        gapHandler(ESP_GAP_BLE_SCAN_RESULT_EVT, &param);
+    }
+}
+
+inline esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback) {
+    fake::gapHandler = callback;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t* params) {
+    fake::scanParams = *params;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ble_gap_start_scanning(uint32_t duration) {
+    fake::bleScanning = true;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ble_gap_stop_scanning() {
+    fake::bleScanning = false;
+    return ESP_OK;
+}
+
+#endif // FAKE_ESP_GAP_BLE_API_H
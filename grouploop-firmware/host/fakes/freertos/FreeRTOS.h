@@ -0,0 +1,28 @@
+#ifndef FAKE_FREERTOS_H
+#define FAKE_FREERTOS_H
+
+#include <stdint.h>
+
+// The host build is single threaded: critical sections are no-ops and
+// tasks are never started (tests call the task body's work directly)
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct { int locked; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+#endif // FAKE_FREERTOS_H
@@ -0,0 +1,25 @@
+#ifndef FAKE_FREERTOS_TASK_H
+#define FAKE_FREERTOS_TASK_H
+
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+namespace fake {
+    inline unsigned tasksCreated = 0;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+    fake::tasksCreated++;
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t ticks) {}
+inline void vTaskDelete(TaskHandle_t task) {}
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+#endif // FAKE_FREERTOS_TASK_H
@@ -0,0 +1,57 @@
+#ifndef FLEET_STATS_H
+#define FLEET_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+// Latency samples in microseconds, for the current report window and for
+// the whole run
+class LatencySamples {
+public:
+    void add(uint64_t us) {
+        uint32_t value = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+        window.push_back(value);
+        total.push_back(value);
+    }
+
+    // "p50 1.2 p90 3.4 p99 8.0 max 12.1 ms (n=1234)", and clear the window
+    void printWindow(FILE* out, const char* label) { print(out, label, window); window.clear(); }
+    void printTotal(FILE* out, const char* label) { print(out, label, total); }
+
+private:
+    static void print(FILE* out, const char* label, std::vector<uint32_t>& samples) {
+        if (samples.empty()) {
+            fprintf(out, "  %-18s -\n", label);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [&samples](double q) { return samples[(size_t)(q * (samples.size() - 1))] / 1000.0; };
+        fprintf(out, "  %-18s p50 %7.2f  p90 %7.2f  p99 %7.2f  max %8.2f ms  (n=%zu)\n",
+                label, at(0.50), at(0.90), at(0.99), samples.back() / 1000.0, samples.size());
+    }
+
+    std::vector<uint32_t> window;
+    std::vector<uint32_t> total;
+};
+
+struct FleetStats {
+    uint64_t framesSent = 0;
+    uint64_t framesDropped = 0;      // socket backed up, frame skipped (latest wins)
+    uint64_t framesFannedOut = 0;    // seen again on the subscriber connection
+    uint64_t framesUnmatched = 0;    // of those, not pending: another client's or too late
+    uint64_t commandsSent = 0;
+    uint64_t commandsReceived = 0;   // by the virtual devices
+    uint64_t commandFailures = 0;    // cmd:result other than success
+    uint64_t connects = 0;
+    uint64_t connectFailures = 0;
+    uint64_t disconnects = 0;
+
+    LatencySamples fanout;           // device -> server -> subscriber
+    LatencySamples commandDelivery;  // controller -> server -> device
+    LatencySamples commandRoundTrip; // controller -> device -> health reply -> subscriber
+    LatencySamples broadcastDelivery;// controller "cmd:all" -> each device
+};
+
+#endif // FLEET_STATS_H
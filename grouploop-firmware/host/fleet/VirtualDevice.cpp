@@ -0,0 +1,225 @@
+#include "VirtualDevice.h"
+#include "Stats.h"
+
+#include <math.h>
+#include <string.h>
+
+VirtualDevice::VirtualDevice(uint16_t id, uint32_t seed, const FleetRoom& room, FleetStats& stats)
+    : commandSentUs(0),
+      broadcastSentUs(0),
+      random(seed ? seed : 1),
+      room(room),
+      stats(stats),
+      pixels(LED_COUNT, 2, NEO_GRB + NEO_KHZ800),
+      pattern(ledDefaultSpec(LED_BEHAVIOR_BREATHING, 0xFFFFFF)),
+      behavior(nullptr),
+      flash(LED_FLASH_COLOR, LED_FLASH_MS),
+      publishTimer(PUBLISH_INTERVAL_MS),
+      scanTimer(BLE_SCAN_INTERVAL * 5),
+      lastSimulation(millis()),
+      vx(0.0f),
+      vy(0.0f),
+      tapped(false),
+      pendingHead(0),
+      pendingCount(0) {
+    snprintf(deviceId, sizeof(deviceId), "%04X", id);
+    messageBuffer[0] = '\0';
+    x = room.width * (random % 1000) / 1000.0f;
+    y = room.height * ((random >> 10) % 1000) / 1000.0f;
+    phase = (random % 6283) / 1000.0f;
+    for (int i = 0; i < ANCHOR_COUNT; ++i) rssi[i] = -128;
+    positionFix = PositionFix{0.0f, 0.0f, 0.0f, false};
+
+    // Spread the publish instants over the interval, as real devices are
+    publishTimer.reset();
+    publishTimer.last_update -= random % PUBLISH_INTERVAL_MS;
+
+    pixels.begin();
+    registerCommands();
+    compositor.setBehavior(LED_LAYER_FLASH, &flash);
+    setPattern(pattern);
+}
+
+// A fresh behavior for 'spec' on the base layer, as LedProcess makes them;
+// there is no ticker here, so it goes on at once. False for an invalid spec.
+bool VirtualDevice::setPattern(const LedBehaviorSpec& spec) {
+    LedBehavior* next = pool.create(spec);
+    if (!next) return false;
+    compositor.setBehavior(LED_LAYER_BASE, next);
+    pool.release(behavior);
+    behavior = next;
+    pattern = spec;
+    return true;
+}
+
+// The LED commands of LedProcess plus the ones the server sends most,
+// registered on this device's own registry
+void VirtualDevice::registerCommands() {
+    commands.registerCommand("led", [this](const String& params) {
+        if (params.length() == 0) return;
+        LedBehaviorSpec spec = pattern;
+        spec.color = strtoul(params.c_str(), NULL, 16);
+        setPattern(spec);
+    });
+    commands.registerCommand("pattern", [this](const String& params) {
+        LedBehaviorSpec spec;
+        if (ledParseSpec(params.c_str(), pattern.color, spec)) setPattern(spec);
+    });
+    commands.registerCommand("reset", [this](const String& params) {
+        setPattern(pattern);
+    });
+    commands.registerCommand("brightness", [this](const String& params) {
+        int brightness = params.toInt();
+        if (brightness >= 0 && brightness <= 255) {
+            pixels.setBrightness(brightness);
+            compositor.invalidate();
+        }
+    });
+    commands.registerCommand("flash", [this](const String& params) {
+        if (params.length() > 0) flash.setColor(strtoul(params.c_str(), NULL, 16));
+        flash.trigger();
+    });
+    commands.registerCommand("vibrate", [](const String& params) {});
+    commands.registerCommand("health", [this](const String& params) {
+        char frame[WS_EVENT_MAX_LEN];
+        int length = snprintf(frame, sizeof(frame), "health:%s:{\"up\":%lu,\"fleet\":true}",
+                              deviceId, (unsigned long)(millis() / 1000));
+        if (length > 0) connection.sendText(frame, (size_t)length);
+    });
+}
+
+void VirtualDevice::receive(const char* data, size_t length, uint64_t nowUs) {
+    // Truncated like WebSocketManager's receive queue
+    if (length > WS_RX_MAX_LEN) length = WS_RX_MAX_LEN;
+    memcpy(messageBuffer, data, length);
+    messageBuffer[length] = '\0';
+
+    if (commandSentUs && strncmp(messageBuffer, "health", 6) == 0) {
+        stats.commandDelivery.add(nowUs - commandSentUs);
+    }
+    if (broadcastSentUs && strncmp(messageBuffer, "pattern", 7) == 0) {
+        stats.broadcastDelivery.add(nowUs - broadcastSentUs);
+        broadcastSentUs = 0;
+    }
+    if (commands.executeMessage(messageBuffer)) stats.commandsReceived++;
+}
+
+void VirtualDevice::update(uint64_t nowUs) {
+    unsigned long now = millis();
+    float dt = (now - lastSimulation) / 1000.0f;
+    if (dt >= 0.02f) {
+        simulate(dt);
+        lastSimulation = now;
+    }
+    compositor.render(pixels);
+    if (connection.isOpen() && publishTimer.checkAndReset()) publish(nowUs);
+}
+
+float VirtualDevice::noise() {
+    // Sum of uniforms, roughly normal with unit variance
+    float sum = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        sum += (random & 0xFFFF) / 65535.0f;
+    }
+    return (sum - 2.0f) * 1.732f;
+}
+
+void VirtualDevice::simulate(float dt) {
+    // Wander: velocity drifts randomly and bounces off the walls
+    vx = vx * 0.98f + noise() * 0.05f;
+    vy = vy * 0.98f + noise() * 0.05f;
+    x += vx * dt;
+    y += vy * dt;
+    if (x < 0.0f) { x = 0.0f; vx = -vx; }
+    if (x > room.width) { x = room.width; vx = -vx; }
+    if (y < 0.0f) { y = 0.0f; vy = -vy; }
+    if (y > room.height) { y = room.height; vy = -vy; }
+    phase += dt * 2.0f;
+    tapped = (noise() > 2.8f); // a few taps a minute
+    if (tapped) flash.trigger();
+
+    if (!scanTimer.checkAndReset()) return;
+
+    // A BLE scan: beacon RSSI from the log-distance model, then the same
+    // position update as BLEProcess::updatePosition()
+    const Anchor anchors[ANCHOR_COUNT] = {
+        {0.0f, 0.0f}, {room.width, 0.0f}, {room.width, room.height}, {0.0f, room.height}
+    };
+    float distances[ANCHOR_COUNT];
+    bool present[ANCHOR_COUNT];
+    for (int i = 0; i < ANCHOR_COUNT; ++i) {
+        float d = hypotf(x - anchors[i].x, y - anchors[i].y);
+        if (d < 0.1f) d = 0.1f;
+        rssi[i] = (int)lroundf(room.rssiAt1m - 10.0f * room.pathLossExponent * log10f(d) + noise() * room.rssiNoiseDb);
+        present[i] = true;
+        distances[i] = rssiToDistance(rssi[i], room.rssiAt1m, room.pathLossExponent);
+    }
+
+    float speed = hypotf(vx, vy);
+    positionFilter.predict(scanTimer.interval / 1000.0f, speed > 0.1f ? 0.2f : 0.0f);
+    float fx, fy, rmsError;
+    if (trilaterate(anchors, distances, present, ANCHOR_COUNT, fx, fy, rmsError)) {
+        fx = constrain(fx, 0.0f, room.width);
+        fy = constrain(fy, 0.0f, room.height);
+        float variance = rmsError * rmsError;
+        if (variance < 0.25f) variance = 0.25f;
+        positionFilter.update(fx, fy, variance);
+    }
+    positionFix.valid = positionFilter.isInitialized();
+    positionFix.x = positionFilter.getX();
+    positionFix.y = positionFilter.getY();
+    positionFix.confidence = positionFilter.getConfidence();
+}
+
+void VirtualDevice::publish(uint64_t nowUs) {
+    TelemetrySample sample = {};
+    sample.ax = 0.3f * sinf(phase) + noise() * 0.02f;
+    sample.ay = 0.3f * cosf(phase * 0.7f) + noise() * 0.02f;
+    sample.az = 1.0f + noise() * 0.02f + (tapped ? 1.5f : 0.0f);
+    sample.tapped = tapped;
+    sample.hasBeacons = true;
+    // Calibrated as in BLEProcess::getBeaconCalibratedRSSI()
+    sample.rssiNW = rssi[0] - room.rssiAt1m + BEACON_DEFAULT_RSSI_AT_1M;
+    sample.rssiNE = rssi[1] - room.rssiAt1m + BEACON_DEFAULT_RSSI_AT_1M;
+    sample.rssiSE = rssi[2] - room.rssiAt1m + BEACON_DEFAULT_RSSI_AT_1M;
+    sample.rssiSW = rssi[3] - room.rssiAt1m + BEACON_DEFAULT_RSSI_AT_1M;
+    sample.position = positionFix;
+
+    char frame[WS_TELEMETRY_MAX_LEN];
+    size_t length = formatTelemetryFrame(frame, sizeof(frame), deviceId, sample, room.width, room.height);
+    if (length == 0) return;
+    // Latest wins, like the telemetry slot: skip the frame if the socket is backed up
+    if (!connection.sendText(frame, length, 4 * length)) {
+        stats.framesDropped++;
+        return;
+    }
+    stats.framesSent++;
+
+    if (pendingCount == PENDING_FRAMES) {
+        pendingHead = (pendingHead + 1) % PENDING_FRAMES;
+        pendingCount--;
+    }
+    PendingFrame& entry = pending[(pendingHead + pendingCount) % PENDING_FRAMES];
+    entry.sentUs = nowUs;
+    size_t textLength = length - 1 < sizeof(entry.text) - 1 ? length - 1 : sizeof(entry.text) - 1;
+    for (size_t i = 0; i < textLength; ++i) entry.text[i] = (char)tolower((unsigned char)frame[i]);
+    entry.text[textLength] = '\0';
+    pendingCount++;
+}
+
+uint64_t VirtualDevice::takePending(const char* text, size_t length) {
+    // Frames arrive in order, so anything older than the match was lost
+    for (int n = 0; n < pendingCount; ++n) {
+        PendingFrame& entry = pending[(pendingHead + n) % PENDING_FRAMES];
+        if (strlen(entry.text) == length && memcmp(entry.text, text, length) == 0) {
+            uint64_t sentUs = entry.sentUs;
+            pendingHead = (pendingHead + n + 1) % PENDING_FRAMES;
+            pendingCount -= n + 1;
+            return sentUs;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef FLEET_VIRTUAL_DEVICE_H
+#define FLEET_VIRTUAL_DEVICE_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <stdint.h>
+#include "config.h"
+#include "Timer.h"
+#include "CommandRegistry.h"
+#include "Positioning.h"
+#include "TelemetryFrame.h"
+#include "processes/LedBehaviors.h"
+#include "processes/LedBehaviorPool.h"
+#include "processes/LedCompositor.h"
+#include "WebSocketConnection.h"
+
+struct FleetStats;
+
+// Room and radio model shared by the fleet
+struct FleetRoom {
+    float width = 10.0f;
+    float height = 10.0f;
+    int rssiAt1m = -59;
+    float pathLossExponent = 2.5f;
+    float rssiNoiseDb = 3.0f;
+};
+
+// One simulated device: the firmware's frame formatter, command registry
+// and LED compositor over a WebSocketConnection, fed with synthetic IMU and
+// beacon data. The device walks around the room; its beacon RSSI follows
+// the log-distance model with noise, and its position fix comes from the
+// firmware's trilateration and Kalman filter.
+class VirtualDevice {
+public:
+    // Frames sent but not yet seen by the subscriber, oldest first; about
+    // three seconds of frames, so a lagging server still gets measured
+    static const int PENDING_FRAMES = 64;
+    struct PendingFrame {
+        uint64_t sentUs;
+        char text[32]; // lower case, without the newline
+    };
+
+    VirtualDevice(uint16_t id, uint32_t seed, const FleetRoom& room, FleetStats& stats);
+
+    // Advance the simulation and LED behavior; publish when the interval is due
+    void update(uint64_t nowUs);
+
+    // A message from the server, as ReceiveProcess would take it
+    void receive(const char* data, size_t length, uint64_t nowUs);
+
+    // Match a frame echoed by the server's fan-out; returns the time it was
+    // sent, 0 if it is not (or no longer) pending
+    uint64_t takePending(const char* text, size_t length);
+
+    const char* getDeviceId() const { return deviceId; }
+
+    WebSocketConnection connection;
+    uint64_t commandSentUs; // set by the controller, 0 when none pending
+    uint64_t broadcastSentUs;
+
+private:
+    void registerCommands();
+    bool setPattern(const LedBehaviorSpec& spec);
+    void simulate(float dt);
+    void publish(uint64_t nowUs);
+    float noise();
+
+    char deviceId[5];
+    uint32_t random;
+    const FleetRoom& room;
+    FleetStats& stats;
+
+    CommandRegistry commands;
+    char messageBuffer[WS_RX_MAX_LEN + 1];
+
+    Adafruit_NeoPixel pixels;
+    LedBehaviorPool pool;
+    LedBehaviorSpec pattern;
+    LedBehavior* behavior;      // made from 'pattern', in the pool
+    LedCompositor compositor;
+    FlashBehavior flash;
+
+    Timer publishTimer;
+    Timer scanTimer;
+    unsigned long lastSimulation;
+
+    // Ground truth and the firmware-side estimate
+    float x, y, vx, vy;
+    float phase;
+    bool tapped;
+    int rssi[ANCHOR_COUNT];
+    PositionFilter positionFilter;
+    PositionFix positionFix;
+
+    PendingFrame pending[PENDING_FRAMES];
+    int pendingHead;
+    int pendingCount;
+};
+
+#endif // FLEET_VIRTUAL_DEVICE_H
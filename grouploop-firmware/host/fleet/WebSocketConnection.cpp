@@ -0,0 +1,280 @@
+#include "WebSocketConnection.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+
+namespace {
+
+const uint8_t OPCODE_CONTINUATION = 0x0;
+const uint8_t OPCODE_TEXT = 0x1;
+const uint8_t OPCODE_BINARY = 0x2;
+const uint8_t OPCODE_CLOSE = 0x8;
+const uint8_t OPCODE_PING = 0x9;
+const uint8_t OPCODE_PONG = 0xA;
+
+// Larger messages are a protocol error for this server
+const size_t MAX_MESSAGE = 1 << 20;
+
+std::string base64(const uint8_t* data, size_t length) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = data[i] << 16;
+        if (i + 1 < length) chunk |= data[i + 1] << 8;
+        if (i + 2 < length) chunk |= data[i + 2];
+        out += table[(chunk >> 18) & 0x3F];
+        out += table[(chunk >> 12) & 0x3F];
+        out += i + 1 < length ? table[(chunk >> 6) & 0x3F] : '=';
+        out += i + 2 < length ? table[chunk & 0x3F] : '=';
+    }
+    return out;
+}
+
+uint32_t nextRandom(uint32_t& state) {
+    // xorshift32: masks only have to be unpredictable to proxies, not secure
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+WebSocketConnection::WebSocketConnection()
+    : socketFd(-1), currentState(State::Idle), fragmentOpcode(0) {
+    static uint32_t counter = 0;
+    maskSeed = (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count() ^ (++counter * 0x9E3779B9u);
+    if (maskSeed == 0) maskSeed = 1;
+}
+
+WebSocketConnection::~WebSocketConnection() {
+    if (socketFd >= 0) ::close(socketFd);
+}
+
+bool WebSocketConnection::connect(const sockaddr_in& address, const std::string& host, const std::string& path) {
+    if (socketFd >= 0) ::close(socketFd);
+    input.clear();
+    output.clear();
+    fragments.clear();
+    fragmentOpcode = 0;
+    socketFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socketFd < 0) return false;
+    int one = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t key[16];
+    for (int i = 0; i < 16; i += 4) {
+        uint32_t value = nextRandom(maskSeed);
+        memcpy(key + i, &value, 4);
+    }
+    request = "GET " + path + " HTTP/1.1\r\n"
+              "Host: " + host + "\r\n"
+              "Upgrade: websocket\r\n"
+              "Connection: Upgrade\r\n"
+              "Sec-WebSocket-Key: " + base64(key, sizeof(key)) + "\r\n"
+              "Sec-WebSocket-Version: 13\r\n\r\n";
+
+    currentState = State::Connecting;
+    if (::connect(socketFd, (const sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+        fail(strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void WebSocketConnection::close() {
+    if (currentState == State::Open) {
+        queueFrame(OPCODE_CLOSE, "\x03\xe8", 2); // 1000, normal closure
+        flush();
+    }
+    if (socketFd >= 0) ::close(socketFd);
+    socketFd = -1;
+    currentState = State::Closed;
+}
+
+bool WebSocketConnection::sendText(const char* data, size_t length, size_t maxBuffered) {
+    if (currentState != State::Open || output.size() > maxBuffered) return false;
+    queueFrame(OPCODE_TEXT, data, length);
+    flush();
+    return currentState == State::Open;
+}
+
+void WebSocketConnection::queueFrame(uint8_t opcode, const char* data, size_t length) {
+    uint8_t header[14];
+    size_t headerLength = 0;
+    header[headerLength++] = 0x80 | opcode; // FIN, never fragmented
+    if (length < 126) {
+        header[headerLength++] = 0x80 | (uint8_t)length;
+    } else if (length < 65536) {
+        header[headerLength++] = 0x80 | 126;
+        header[headerLength++] = (uint8_t)(length >> 8);
+        header[headerLength++] = (uint8_t)length;
+    } else {
+        header[headerLength++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) header[headerLength++] = (uint8_t)((uint64_t)length >> shift);
+    }
+    uint32_t maskValue = nextRandom(maskSeed);
+    uint8_t mask[4];
+    memcpy(mask, &maskValue, 4);
+    memcpy(header + headerLength, mask, 4);
+    headerLength += 4;
+
+    size_t start = output.size();
+    output.append((const char*)header, headerLength);
+    output.append(data, length);
+    char* payload = &output[start + headerLength];
+    for (size_t i = 0; i < length; ++i) payload[i] ^= mask[i & 3];
+}
+
+void WebSocketConnection::flush() {
+    while (!output.empty() && socketFd >= 0) {
+        ssize_t written = send(socketFd, output.data(), output.size(), MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            fail(strerror(errno));
+            return;
+        }
+        output.erase(0, (size_t)written);
+    }
+}
+
+void WebSocketConnection::onWritable() {
+    if (currentState == State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            fail(strerror(error));
+            return;
+        }
+        currentState = State::Handshake;
+        output = request;
+    }
+    flush();
+}
+
+void WebSocketConnection::onReadable() {
+    char buffer[16384];
+    while (socketFd >= 0) {
+        ssize_t received = recv(socketFd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            input.append(buffer, (size_t)received);
+            continue;
+        }
+        if (received == 0) {
+            fail("closed by server");
+            return;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        if (errno == EINTR) continue;
+        fail(strerror(errno));
+        return;
+    }
+
+    if (currentState == State::Handshake && !parseHandshake()) return;
+    if (currentState == State::Open) parseFrames();
+}
+
+// The Sec-WebSocket-Accept value is not checked: the server is our own
+bool WebSocketConnection::parseHandshake() {
+    size_t end = input.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (input.size() > 8192) fail("handshake response too long");
+        return false;
+    }
+    if (input.compare(0, 12, "HTTP/1.1 101") != 0) {
+        fail("handshake rejected");
+        return false;
+    }
+    input.erase(0, end + 4);
+    currentState = State::Open;
+    if (onOpen) onOpen();
+    return currentState == State::Open;
+}
+
+void WebSocketConnection::parseFrames() {
+    size_t offset = 0;
+    while (currentState == State::Open) {
+        size_t available = input.size() - offset;
+        if (available < 2) break;
+        const uint8_t* frame = (const uint8_t*)input.data() + offset;
+        bool fin = frame[0] & 0x80;
+        uint8_t opcode = frame[0] & 0x0F;
+        bool masked = frame[1] & 0x80;
+        uint64_t length = frame[1] & 0x7F;
+        size_t headerLength = 2;
+        if (length == 126) {
+            if (available < 4) break;
+            length = (frame[2] << 8) | frame[3];
+            headerLength = 4;
+        } else if (length == 127) {
+            if (available < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; ++i) length = (length << 8) | frame[2 + i];
+            headerLength = 10;
+        }
+        if (masked) headerLength += 4;
+        if (length > MAX_MESSAGE) {
+            fail("message too large");
+            return;
+        }
+        if (available < headerLength + length) break;
+
+        char* payload = &input[offset + headerLength];
+        if (masked) {
+            const uint8_t* mask = frame + headerLength - 4;
+            for (uint64_t i = 0; i < length; ++i) payload[i] ^= mask[i & 3];
+        }
+        offset += headerLength + (size_t)length;
+
+        switch (opcode) {
+            case OPCODE_TEXT:
+            case OPCODE_BINARY:
+                if (fin) {
+                    if (onMessage) onMessage(payload, (size_t)length);
+                } else {
+                    fragmentOpcode = opcode;
+                    fragments.assign(payload, (size_t)length);
+                }
+                break;
+            case OPCODE_CONTINUATION:
+                fragments.append(payload, (size_t)length);
+                if (fin && fragmentOpcode != 0) {
+                    fragmentOpcode = 0;
+                    if (onMessage) onMessage(fragments.data(), fragments.size());
+                }
+                break;
+            case OPCODE_PING:
+                queueFrame(OPCODE_PONG, payload, (size_t)length);
+                flush();
+                break;
+            case OPCODE_PONG:
+                break;
+            case OPCODE_CLOSE:
+                queueFrame(OPCODE_CLOSE, payload, length >= 2 ? 2 : 0);
+                flush();
+                fail("closed by server");
+                return;
+            default:
+                fail("unknown opcode");
+                return;
+        }
+    }
+    input.erase(0, offset);
+}
+
+void WebSocketConnection::fail(const char* reason) {
+    if (socketFd >= 0) ::close(socketFd);
+    socketFd = -1;
+    bool wasClosed = currentState == State::Closed;
+    currentState = State::Closed;
+    output.clear();
+    input.clear();
+    if (!wasClosed && onClose) onClose(reason);
+}
@@ -0,0 +1,65 @@
+#ifndef FLEET_WEBSOCKET_CONNECTION_H
+#define FLEET_WEBSOCKET_CONNECTION_H
+
+#include <netinet/in.h>
+#include <functional>
+#include <string>
+
+// Minimal non-blocking WebSocket client (RFC 6455, ws:// only) for the
+// fleet load generator. One connection per virtual device, all driven from
+// a single epoll loop: the owner registers fd() and calls onReadable() /
+// onWritable() when the socket is ready.
+//
+// Text and binary messages are delivered whole through onMessage; pings are
+// answered; a close frame or a socket error ends in onClose. Outgoing data
+// is buffered while the socket is full, up to a caller-chosen limit.
+class WebSocketConnection {
+public:
+    enum class State { Idle, Connecting, Handshake, Open, Closed };
+
+    std::function<void()> onOpen;
+    std::function<void(const char* data, size_t length)> onMessage;
+    std::function<void(const char* reason)> onClose;
+
+    WebSocketConnection();
+    ~WebSocketConnection();
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+
+    // Start connecting, or reconnecting after a close; false if the socket
+    // could not be created
+    bool connect(const sockaddr_in& address, const std::string& host, const std::string& path);
+    void close();
+
+    // Queue a text message. False when not open or when 'maxBuffered' bytes
+    // are already waiting for the socket (the message is dropped then).
+    bool sendText(const char* data, size_t length, size_t maxBuffered = 64 * 1024);
+
+    void onReadable();
+    void onWritable();
+
+    int fd() const { return socketFd; }
+    State state() const { return currentState; }
+    bool isOpen() const { return currentState == State::Open; }
+    // epoll should report writability: connecting or output pending
+    bool wantsWrite() const { return currentState == State::Connecting || !output.empty(); }
+    size_t buffered() const { return output.size(); }
+
+private:
+    void queueFrame(uint8_t opcode, const char* data, size_t length);
+    void flush();
+    bool parseHandshake();
+    void parseFrames();
+    void fail(const char* reason);
+
+    int socketFd;
+    State currentState;
+    std::string request;
+    std::string input;
+    std::string output;
+    std::string fragments;
+    uint8_t fragmentOpcode;
+    uint32_t maskSeed;
+};
+
+#endif // FLEET_WEBSOCKET_CONNECTION_H
@@ -0,0 +1,458 @@
+// Virtual device fleet: load-tests the socket server with thousands of
+// simulated devices, each running the firmware's telemetry formatter,
+// command registry and LED behaviors over its own WebSocket connection.
+//
+//   fleet --url ws://127.0.0.1:5003/ --devices 2000 --duration 60
+//
+// Besides the devices it opens two connections of its own: a subscriber
+// ("s") that receives the server's fan-out, and a controller that sends
+// commands. From those it reports:
+//   fan-out        device frame -> server -> subscriber
+//   cmd delivery   controller "cmd:<id>:health" -> device
+//   cmd round trip controller -> device -> health reply -> subscriber
+//   broadcast      controller "cmd:all:pattern:..." -> every device
+#include <Arduino.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Log.h"
+#include "Stats.h"
+#include "VirtualDevice.h"
+
+namespace {
+
+struct Options {
+    std::string url = "ws://127.0.0.1:5003/";
+    int devices = 100;
+    int firstId = 0x1000;
+    double duration = 30.0;       // seconds, 0 = until interrupted
+    double connectRate = 200.0;   // new connections per second
+    double commandRate = 10.0;    // unicast health commands per second
+    double broadcastEvery = 5.0;  // seconds between cmd:all pattern changes, 0 = never
+    double reportEvery = 5.0;     // seconds
+    uint32_t seed = 1;
+};
+
+void usage() {
+    fprintf(stderr,
+        "usage: fleet [options]\n"
+        "  --url URL            socket server (default ws://127.0.0.1:5003/)\n"
+        "  --devices N          virtual devices (default 100)\n"
+        "  --first-id HEX       id of the first device (default 1000)\n"
+        "  --duration S         run time in seconds, 0 = until Ctrl-C (default 30)\n"
+        "  --connect-rate N     connections opened per second (default 200)\n"
+        "  --command-rate N     unicast health commands per second (default 10)\n"
+        "  --broadcast-every S  seconds between cmd:all pattern changes, 0 = off (default 5)\n"
+        "  --report-every S     seconds between reports (default 5)\n"
+        "  --seed N             simulation seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--url") options.url = value;
+        else if (arg == "--devices") options.devices = atoi(value);
+        else if (arg == "--first-id") options.firstId = (int)strtol(value, NULL, 16);
+        else if (arg == "--duration") options.duration = atof(value);
+        else if (arg == "--connect-rate") options.connectRate = atof(value);
+        else if (arg == "--command-rate") options.commandRate = atof(value);
+        else if (arg == "--broadcast-every") options.broadcastEvery = atof(value);
+        else if (arg == "--report-every") options.reportEvery = atof(value);
+        else if (arg == "--seed") options.seed = (uint32_t)strtoul(value, NULL, 10);
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (options.devices < 1 || options.firstId < 0 || options.firstId + options.devices > 0x10000) {
+        fprintf(stderr, "device ids must fit in 4 hex digits\n");
+        return false;
+    }
+    if (options.connectRate <= 0.0 || options.reportEvery <= 0.0) {
+        fprintf(stderr, "--connect-rate and --report-every must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+// ws://host[:port][/path]
+bool parseUrl(const std::string& url, std::string& host, std::string& port, std::string& path) {
+    if (url.compare(0, 5, "ws://") != 0) return false;
+    std::string rest = url.substr(5);
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    path = slash == std::string::npos ? "/" : rest.substr(slash);
+    size_t colon = authority.rfind(':');
+    host = authority.substr(0, colon);
+    port = colon == std::string::npos ? "80" : authority.substr(colon + 1);
+    return !host.empty();
+}
+
+uint64_t nowMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+volatile sig_atomic_t interrupted = 0;
+
+// Epoll tags for the two fleet connections; devices use their index
+const uint64_t TAG_SUBSCRIBER = UINT64_MAX;
+const uint64_t TAG_CONTROLLER = UINT64_MAX - 1;
+
+struct Watched {
+    WebSocketConnection* connection;
+    uint64_t tag;
+    int registeredFd = -1;
+    bool armedWrite = false;
+};
+
+class Fleet {
+public:
+    Fleet(const Options& options, const sockaddr_in& address, const std::string& host, const std::string& path)
+        : options(options), address(address), host(host), path(path) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+
+    int run();
+
+private:
+    void connectSome(uint64_t now);
+    void watch(Watched& watched);
+    void handleSubscriber(const char* data, size_t length, uint64_t now);
+    void sendCommands(uint64_t now);
+    void report(uint64_t now, bool final);
+
+    const Options& options;
+    sockaddr_in address;
+    std::string host;
+    std::string path;
+    int epollFd;
+
+    FleetRoom room;
+    FleetStats stats;
+    std::vector<std::unique_ptr<VirtualDevice>> devices;
+    std::vector<Watched> deviceWatch;
+    std::vector<uint64_t> reconnectAt; // 0 = connected or never started
+    std::vector<bool> opened;
+    WebSocketConnection subscriber;
+    WebSocketConnection controller;
+    Watched subscriberWatch{&subscriber, TAG_SUBSCRIBER};
+    Watched controllerWatch{&controller, TAG_CONTROLLER};
+    int nextToConnect = 0;
+    int openDevices = 0;
+    uint32_t random = 0;
+    int patternIndex = 0;
+    uint64_t commandsDue = 0;
+    uint64_t nextBroadcast = 0;
+    uint64_t subscriberReconnectAt = 0;
+    uint64_t controllerReconnectAt = 0;
+    uint64_t framesSentAtReport = 0;
+    uint64_t framesFannedOutAtReport = 0;
+    uint64_t lastReport = 0;
+};
+
+void Fleet::watch(Watched& watched) {
+    int fd = watched.connection->fd();
+    bool wantsWrite = watched.connection->wantsWrite();
+    if (fd < 0) {
+        watched.registeredFd = -1; // closing the socket removed it from epoll
+        return;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN | (wantsWrite ? EPOLLOUT : 0);
+    event.data.u64 = watched.tag;
+    if (watched.registeredFd != fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        watched.registeredFd = fd;
+        watched.armedWrite = wantsWrite;
+    } else if (watched.armedWrite != wantsWrite) {
+        // A reused descriptor number may have left epoll with the old socket
+        if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) < 0 && errno == ENOENT) {
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        }
+        watched.armedWrite = wantsWrite;
+    }
+}
+
+// Open device connections at the configured rate, and reopen dropped ones
+// (the fleet's own included) after a second, like the firmware does
+void Fleet::connectSome(uint64_t now) {
+    uint64_t allowed = (uint64_t)(now / 1e6 * options.connectRate) + 1;
+    while (nextToConnect < (int)devices.size() && (uint64_t)nextToConnect < allowed) {
+        VirtualDevice& device = *devices[nextToConnect];
+        if (!device.connection.connect(address, host, path)) stats.connectFailures++;
+        watch(deviceWatch[nextToConnect]);
+        nextToConnect++;
+    }
+    for (int i = 0; i < nextToConnect; ++i) {
+        if (reconnectAt[i] == 0 || reconnectAt[i] > now) continue;
+        reconnectAt[i] = 0;
+        if (!devices[i]->connection.connect(address, host, path)) stats.connectFailures++;
+    }
+    if (subscriberReconnectAt && subscriberReconnectAt <= now) {
+        subscriberReconnectAt = 0;
+        subscriber.connect(address, host, path);
+    }
+    if (controllerReconnectAt && controllerReconnectAt <= now) {
+        controllerReconnectAt = 0;
+        controller.connect(address, host, path);
+    }
+}
+
+void Fleet::handleSubscriber(const char* data, size_t length, uint64_t now) {
+    // One frame or health report per message, newline terminated
+    while (length > 0 && (data[length - 1] == '\n' || data[length - 1] == '\r')) length--;
+    if (length >= 7 && memcmp(data, "health:", 7) == 0 && length >= 11) {
+        int id = (int)strtol(std::string(data + 7, 4).c_str(), NULL, 16);
+        int index = id - options.firstId;
+        if (index < 0 || index >= (int)devices.size()) return;
+        VirtualDevice& device = *devices[index];
+        if (device.commandSentUs) {
+            stats.commandRoundTrip.add(now - device.commandSentUs);
+            device.commandSentUs = 0;
+        }
+        return;
+    }
+    if (length != 20 && length != 26) return;
+    stats.framesFannedOut++;
+    int id = (int)strtol(std::string(data, 4).c_str(), NULL, 16);
+    int index = id - options.firstId;
+    uint64_t sentUs = index >= 0 && index < (int)devices.size() ? devices[index]->takePending(data, length) : 0;
+    if (sentUs == 0) {
+        stats.framesUnmatched++;
+        return;
+    }
+    stats.fanout.add(now - sentUs);
+}
+
+void Fleet::sendCommands(uint64_t now) {
+    if (!controller.isOpen() || openDevices == 0) return;
+    char message[64];
+
+    uint64_t target = (uint64_t)(now / 1e6 * options.commandRate);
+    while (commandsDue < target) {
+        commandsDue++;
+        // A random open device without a command in flight
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            random = random * 1664525u + 1013904223u;
+            VirtualDevice& device = *devices[(random >> 8) % devices.size()];
+            if (!device.connection.isOpen()) continue;
+            if (device.commandSentUs && now - device.commandSentUs < 5000000) continue;
+            // The server registers devices by lower case id
+            char id[5];
+            for (int i = 0; i < 5; ++i) id[i] = (char)tolower((unsigned char)device.getDeviceId()[i]);
+            int length = snprintf(message, sizeof(message), "cmd:%s:health", id);
+            device.commandSentUs = now;
+            controller.sendText(message, (size_t)length);
+            stats.commandsSent++;
+            break;
+        }
+    }
+
+    if (options.broadcastEvery > 0.0 && now >= nextBroadcast) {
+        if (nextBroadcast != 0) {
+            static const char* patterns[] = {"breathing", "heartbeat", "cycle", "spring", "solid",
+                                             "gradient", "comet", "twinkle", "fire"};
+            const char* pattern = patterns[patternIndex++ % (sizeof(patterns) / sizeof(patterns[0]))];
+            int length = snprintf(message, sizeof(message), "cmd:all:pattern:%s", pattern);
+            for (auto& device : devices) {
+                if (device->connection.isOpen()) device->broadcastSentUs = now;
+            }
+            controller.sendText(message, (size_t)length);
+            stats.commandsSent++;
+        }
+        nextBroadcast = now + (uint64_t)(options.broadcastEvery * 1e6);
+    }
+}
+
+void Fleet::report(uint64_t now, bool final) {
+    double seconds = (now - lastReport) / 1e6;
+    if (final) seconds = now / 1e6;
+    uint64_t sent = final ? stats.framesSent : stats.framesSent - framesSentAtReport;
+    uint64_t fanned = final ? stats.framesFannedOut : stats.framesFannedOut - framesFannedOutAtReport;
+    printf("%s %7.1f s  devices %d/%d open  frames out %.0f/s  fan-out in %.0f/s  dropped %llu  unmatched %llu\n",
+           final ? "TOTAL" : "-----", now / 1e6, openDevices, (int)devices.size(),
+           seconds > 0 ? sent / seconds : 0.0, seconds > 0 ? fanned / seconds : 0.0,
+           (unsigned long long)stats.framesDropped, (unsigned long long)stats.framesUnmatched);
+    printf("  commands sent %llu  received by devices %llu  failed %llu  connects %llu  failures %llu  disconnects %llu\n",
+           (unsigned long long)stats.commandsSent, (unsigned long long)stats.commandsReceived,
+           (unsigned long long)stats.commandFailures, (unsigned long long)stats.connects,
+           (unsigned long long)stats.connectFailures, (unsigned long long)stats.disconnects);
+    if (final) {
+        stats.fanout.printTotal(stdout, "fan-out");
+        stats.commandDelivery.printTotal(stdout, "cmd delivery");
+        stats.commandRoundTrip.printTotal(stdout, "cmd round trip");
+        stats.broadcastDelivery.printTotal(stdout, "broadcast");
+    } else {
+        stats.fanout.printWindow(stdout, "fan-out");
+        stats.commandDelivery.printWindow(stdout, "cmd delivery");
+        stats.commandRoundTrip.printWindow(stdout, "cmd round trip");
+        stats.broadcastDelivery.printWindow(stdout, "broadcast");
+    }
+    fflush(stdout);
+    framesSentAtReport = stats.framesSent;
+    framesFannedOutAtReport = stats.framesFannedOut;
+    lastReport = now;
+}
+
+int Fleet::run() {
+    if (epollFd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+    random = options.seed;
+    devices.reserve(options.devices);
+    for (int i = 0; i < options.devices; ++i) {
+        uint32_t seed = options.seed * 2654435761u + (uint32_t)i * 40503u + 1;
+        devices.emplace_back(new VirtualDevice((uint16_t)(options.firstId + i), seed, room, stats));
+    }
+    deviceWatch.resize(devices.size());
+    reconnectAt.assign(devices.size(), 0);
+    opened.assign(devices.size(), false);
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        VirtualDevice* device = devices[i].get();
+        deviceWatch[i].connection = &device->connection;
+        deviceWatch[i].tag = i;
+    }
+
+    subscriber.onOpen = [this]() { subscriber.sendText("s", 1); };
+    subscriber.onMessage = [this](const char* data, size_t length) { handleSubscriber(data, length, nowMicros()); };
+    subscriber.onClose = [this](const char* reason) {
+        fprintf(stderr, "subscriber closed: %s\n", reason);
+        subscriberReconnectAt = nowMicros() + 1000000;
+    };
+    controller.onMessage = [this](const char* data, size_t length) {
+        static const char result[] = "cmd:result:";
+        if (length > sizeof(result) - 1 && memcmp(data, result, sizeof(result) - 1) == 0) {
+            std::string value(data + sizeof(result) - 1, length - (sizeof(result) - 1));
+            if (value != "success" && value.compare(0, 8, "sent_to_") != 0) stats.commandFailures++;
+        }
+    };
+    controller.onClose = [this](const char* reason) {
+        fprintf(stderr, "controller closed: %s\n", reason);
+        controllerReconnectAt = nowMicros() + 1000000;
+    };
+    if (!subscriber.connect(address, host, path) || !controller.connect(address, host, path)) {
+        fprintf(stderr, "cannot connect to %s\n", options.url.c_str());
+        return 1;
+    }
+    watch(subscriberWatch);
+    watch(controllerWatch);
+
+    // Device callbacks are set once; connections are replaced on reconnect
+    auto bind = [this](size_t i) {
+        VirtualDevice* device = devices[i].get();
+        device->connection.onOpen = [this, i]() { stats.connects++; opened[i] = true; };
+        device->connection.onMessage = [device](const char* data, size_t length) {
+            device->receive(data, length, nowMicros());
+        };
+        device->connection.onClose = [this, i](const char* reason) {
+            if (opened[i]) stats.disconnects++;
+            else stats.connectFailures++;
+            opened[i] = false;
+            reconnectAt[i] = nowMicros() + 1000000;
+        };
+    };
+    for (size_t i = 0; i < devices.size(); ++i) bind(i);
+
+    std::vector<epoll_event> events(1024);
+    uint64_t end = options.duration > 0.0 ? (uint64_t)(options.duration * 1e6) : UINT64_MAX;
+    uint64_t reportInterval = (uint64_t)(options.reportEvery * 1e6);
+    while (!interrupted) {
+        uint64_t now = nowMicros();
+        if (now >= end) break;
+        fake::nowMicros = now + 1000000; // the firmware classes read millis()
+
+        connectSome(now);
+
+        int ready = epoll_wait(epollFd, events.data(), (int)events.size(), 1);
+        now = nowMicros();
+        for (int n = 0; n < ready; ++n) {
+            uint64_t tag = events[n].data.u64;
+            WebSocketConnection* connection = tag == TAG_SUBSCRIBER ? &subscriber
+                : tag == TAG_CONTROLLER ? &controller : &devices[tag]->connection;
+            if (events[n].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) connection->onWritable();
+            if (events[n].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) connection->onReadable();
+        }
+
+        fake::nowMicros = now + 1000000;
+        openDevices = 0;
+        for (size_t i = 0; i < devices.size(); ++i) {
+            devices[i]->update(now);
+            if (devices[i]->connection.isOpen()) openDevices++;
+        }
+        sendCommands(now);
+
+        for (size_t i = 0; i < devices.size(); ++i) watch(deviceWatch[i]);
+        watch(subscriberWatch);
+        watch(controllerWatch);
+
+        if (now - lastReport >= reportInterval) report(now, false);
+    }
+    report(nowMicros(), true);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    std::string host, port, path;
+    if (!parseUrl(options.url, host, port, path)) {
+        fprintf(stderr, "expected a ws://host:port/path URL, got %s\n", options.url.c_str());
+        return 2;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* resolved = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved) != 0 || !resolved) {
+        fprintf(stderr, "cannot resolve %s\n", host.c_str());
+        return 1;
+    }
+    sockaddr_in address = *(sockaddr_in*)resolved->ai_addr;
+    freeaddrinfo(resolved);
+
+    // One descriptor per device plus the subscriber and controller
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < (rlim_t)options.devices + 16) {
+            fprintf(stderr, "warning: open file limit %llu is below %d devices; raise it with ulimit -n\n",
+                    (unsigned long long)limit.rlim_cur, options.devices);
+        }
+    }
+
+    signal(SIGINT, [](int) { interrupted = 1; });
+    signal(SIGPIPE, SIG_IGN);
+    logger.setSerialLevel(LOG_LEVEL_NONE);
+
+    printf("fleet: %d devices %04X-%04X against %s\n", options.devices, options.firstId,
+           options.firstId + options.devices - 1, options.url.c_str());
+    Fleet fleet(options, address, host, path);
+    return fleet.run();
+}
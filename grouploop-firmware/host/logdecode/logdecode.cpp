@@ -0,0 +1,169 @@
+// Expands binary log uploads from the firmware (see include/LogFormat.h and
+// include/processes/LogProcess.h) into text.
+//
+//   logdecode <firmware.elf> [capture.txt]
+//
+// Reads lines from the capture file (or stdin) and decodes every
+// "log:<device id>:<hex>" found in them, so socket server output or a
+// subscriber capture can be piped in as is. Records hold the address of
+// their format string; the strings are read from the ELF's loaded
+// sections, so the ELF must be the exact build that produced the log.
+
+#include "LogFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Section {
+    uint64_t address;
+    uint64_t size;
+    uint64_t offset;
+};
+
+// Just enough ELF to map a target address to bytes in the file: the
+// section table of a 32 or 64-bit little-endian image
+class ElfImage {
+public:
+    bool load(const char* path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (bytes.size() < 52 || memcmp(bytes.data(), "\x7f" "ELF", 4) != 0) return false;
+        if (bytes[5] != 1) return false; // little-endian only
+
+        bool is64 = bytes[4] == 2;
+        addressBytes = is64 ? 8 : 4;
+        uint64_t sectionOffset = is64 ? get(0x28, 8) : get(0x20, 4);
+        size_t entrySize = (size_t)get(is64 ? 0x3A : 0x2E, 2);
+        size_t count = (size_t)get(is64 ? 0x3C : 0x30, 2);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t entry = sectionOffset + i * entrySize;
+            if (entry + entrySize > bytes.size()) return false;
+            uint32_t type = (uint32_t)get(entry + 4, 4);
+            uint64_t flags = is64 ? get(entry + 8, 8) : get(entry + 8, 4);
+            const uint64_t SHF_ALLOC = 0x2, SHT_NOBITS = 8;
+            if (!(flags & SHF_ALLOC) || type == SHT_NOBITS) continue;
+            Section section;
+            section.address = is64 ? get(entry + 0x10, 8) : get(entry + 0x0C, 4);
+            section.offset = is64 ? get(entry + 0x18, 8) : get(entry + 0x10, 4);
+            section.size = is64 ? get(entry + 0x20, 8) : get(entry + 0x14, 4);
+            if (section.address != 0 && section.offset + section.size <= bytes.size()) {
+                sections.push_back(section);
+            }
+        }
+        return !sections.empty();
+    }
+
+    // NUL-terminated string at a target address, or nullptr
+    const char* stringAt(uint64_t address) const {
+        for (const Section& section : sections) {
+            if (address < section.address || address >= section.address + section.size) continue;
+            uint64_t start = section.offset + (address - section.address);
+            uint64_t end = section.offset + section.size;
+            if (!memchr(bytes.data() + start, '\0', end - start)) return nullptr;
+            return bytes.data() + start;
+        }
+        return nullptr;
+    }
+
+    size_t getAddressBytes() const { return addressBytes; }
+
+private:
+    uint64_t get(uint64_t offset, size_t size) const {
+        if (offset + size > bytes.size()) return 0;
+        return logGetLE(reinterpret_cast<const uint8_t*>(bytes.data()) + offset, size);
+    }
+
+    std::vector<char> bytes;
+    std::vector<Section> sections;
+    size_t addressBytes = 4;
+};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool isHexId(const std::string& text, size_t pos) {
+    if (pos + 5 > text.size() || text[pos + 4] != ':') return false;
+    for (size_t i = 0; i < 4; ++i) {
+        if (hexValue(text[pos + i]) < 0) return false;
+    }
+    return true;
+}
+
+void decodeRecords(const ElfImage& elf, const std::string& deviceId, const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        LogRecordView view;
+        if (!logParseRecord(data.data() + offset, data.size() - offset, elf.getAddressBytes(), view)) {
+            std::printf("%s  <malformed record at byte %zu>\n", deviceId.c_str(), offset);
+            return;
+        }
+        const char* format = elf.stringAt(view.formatAddress);
+        char line[512];
+        if (format) {
+            logFormatLine(line, sizeof(line), format, view);
+        } else {
+            std::snprintf(line, sizeof(line), "%8lu %c <unknown format 0x%llx, %u args>",
+                          (unsigned long)view.timestamp, logLevelLetter(view.level),
+                          (unsigned long long)view.formatAddress, (unsigned)view.argCount);
+        }
+        std::printf("%s %s\n", deviceId.c_str(), line);
+        offset += data[offset];
+    }
+}
+
+void decodeLine(const ElfImage& elf, const std::string& text) {
+    size_t pos = 0;
+    while ((pos = text.find("log:", pos)) != std::string::npos) {
+        pos += 4;
+        if (!isHexId(text, pos)) continue;
+        std::string deviceId = text.substr(pos, 4);
+        pos += 5;
+        std::vector<uint8_t> data;
+        while (pos + 1 < text.size() && hexValue(text[pos]) >= 0 && hexValue(text[pos + 1]) >= 0) {
+            data.push_back((uint8_t)(hexValue(text[pos]) << 4 | hexValue(text[pos + 1])));
+            pos += 2;
+        }
+        decodeRecords(elf, deviceId, data);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s <firmware.elf> [capture.txt]\n", argv[0]);
+        return 2;
+    }
+    ElfImage elf;
+    if (!elf.load(argv[1])) {
+        std::fprintf(stderr, "%s: not a readable little-endian ELF with loaded sections\n", argv[1]);
+        return 1;
+    }
+
+    std::ifstream capture;
+    if (argc == 3) {
+        capture.open(argv[2]);
+        if (!capture) {
+            std::fprintf(stderr, "%s: cannot open\n", argv[2]);
+            return 1;
+        }
+    }
+    std::istream& input = argc == 3 ? capture : std::cin;
+    std::string text;
+    while (std::getline(input, text)) {
+        decodeLine(elf, text);
+    }
+    return 0;
+}
@@ -0,0 +1,333 @@
+#ifndef REPLAY_TRACE_REPLAY_H
+#define REPLAY_TRACE_REPLAY_H
+
+#include <Arduino.h>
+#include <chrono>
+#include <istream>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "TraceFormat.h"
+#include "ProcessManager.h"
+#include "WebSocketManager.h"
+#include "processes/IMUProcess.h"
+#include "processes/BLEProcess.h"
+#include "processes/LedProcess.h"
+#include "processes/VibrationProcess.h"
+#include "processes/PublishProcess.h"
+#include "processes/ReceiveProcess.h"
+#include "processes/HealthProcess.h"
+
+// A trace put back together from "trace:<id>:<offset>:<hex>" uploads (see
+// TraceProcess.h): whole records in stream order
+struct TraceCapture {
+    std::string deviceId;           // lower case
+    std::vector<uint8_t> records;
+    uint32_t chunks = 0;
+    uint32_t gaps = 0;              // places where records were overwritten before upload
+    uint32_t droppedBytes = 0;      // partial records cut off by a gap or the end
+};
+
+inline int traceHexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Puts the upload chunks of one device back together by offset. Chunks are
+// cut at any byte; a segment starts at a record boundary (the start of the
+// capture, or where the device resumed after records were overwritten).
+class TraceAssembler {
+public:
+    explicit TraceAssembler(TraceCapture& capture) : capture(capture) {}
+
+    void addChunk(uint32_t offset, const uint8_t* data, size_t length) {
+        capture.chunks++;
+        if (!started) {
+            started = true;
+            expected = offset;
+        }
+        int32_t ahead = (int32_t)(offset - expected);
+        if (ahead > 0) {
+            // Records in between were overwritten on the device
+            flush(true);
+            capture.gaps++;
+            expected = offset;
+        } else if (ahead < 0) {
+            // Sent again (trace:send after a stream); keep only what is new
+            size_t overlap = (size_t)-ahead;
+            if (overlap >= length) return;
+            data += overlap;
+            length -= overlap;
+        }
+        segment.insert(segment.end(), data, data + length);
+        expected += (uint32_t)length;
+        flush(false);
+    }
+
+    void finish() { flush(true); }
+
+private:
+    // Move whole records to the capture; 'end' drops a partial one
+    void flush(bool end) {
+        size_t position = 0;
+        while (size_t length = traceRecordLength(segment.data() + position, segment.size() - position)) {
+            capture.records.insert(capture.records.end(), segment.begin() + position, segment.begin() + position + length);
+            position += length;
+        }
+        segment.erase(segment.begin(), segment.begin() + position);
+        // A full-size partial record would be a corrupt length
+        if (end || segment.size() >= TRACE_RECORD_MAX) {
+            capture.droppedBytes += segment.size();
+            segment.clear();
+        }
+    }
+
+    TraceCapture& capture;
+    std::vector<uint8_t> segment;
+    uint32_t expected = 0;
+    bool started = false;
+};
+
+// Read every "trace:<id>:<offset>:<hex>" in the input (socket server
+// output or a subscriber capture, as is) for one device, or for the first
+// device seen when 'deviceId' is empty. False if none was found.
+inline bool traceLoadCapture(std::istream& in, const std::string& deviceId, TraceCapture& capture) {
+    TraceAssembler assembler(capture);
+    capture.deviceId.clear();
+    for (char c : deviceId) capture.deviceId += (char)tolower((unsigned char)c);
+    std::string line;
+    std::vector<uint8_t> bytes;
+    while (std::getline(in, line)) {
+        size_t pos = 0;
+        while ((pos = line.find("trace:", pos)) != std::string::npos) {
+            pos += 6;
+            size_t idEnd = line.find(':', pos);
+            if (idEnd == std::string::npos || idEnd - pos != 4 || idEnd + 10 > line.size() || line[idEnd + 9] != ':') continue;
+            std::string id = line.substr(pos, 4);
+            for (char& c : id) c = (char)tolower((unsigned char)c);
+            uint32_t offset = 0;
+            bool valid = true;
+            for (size_t i = idEnd + 1; i < idEnd + 9; ++i) {
+                int digit = traceHexValue(line[i]);
+                if (digit < 0) valid = false;
+                offset = offset << 4 | (uint32_t)(digit & 0x0F);
+            }
+            if (!valid) continue;
+            if (capture.deviceId.empty()) capture.deviceId = id;
+            if (id != capture.deviceId) continue;
+
+            bytes.clear();
+            pos = idEnd + 10;
+            while (pos + 1 < line.size() && traceHexValue(line[pos]) >= 0 && traceHexValue(line[pos + 1]) >= 0) {
+                bytes.push_back((uint8_t)(traceHexValue(line[pos]) << 4 | traceHexValue(line[pos + 1])));
+                pos += 2;
+            }
+            assembler.addChunk(offset, bytes.data(), bytes.size());
+        }
+    }
+    assembler.finish();
+    return capture.chunks > 0;
+}
+
+// Feeds a trace through the firmware's processes on the fake clock: each
+// record is delivered at its recorded time, and the main loop runs every
+// 'loopPeriodUs' in between, so a trace of minutes replays in well under a
+// second. The tickers fire every LED_FRAME_MS of trace time, and each frame
+// that changes what the LEDs show is kept in 'leds'. IMU readings go to IMUProcess::processReading, scan windows and
+// advertisements to BLEProcess, messages to WebSocketManager::queueReceived;
+// IMUProcess and BLEProcess are not updated by the loop, their input comes
+// only from the trace. Everything the device sends is kept in 'output'.
+//
+// Uses the global webSocketManager and commandRegistry, so one replay per
+// program: connection listeners registered by the processes can't be
+// removed again.
+class TraceReplayer {
+public:
+    struct Output {
+        unsigned long atMs;
+        std::string message;        // telemetry frame or event
+    };
+
+    struct LedFrame {
+        unsigned long atMs;
+        std::vector<uint32_t> pixels;   // as shown, 0x00RRGGBB
+    };
+
+    struct ProcessTiming {
+        std::string name;
+        Process* process;
+        uint64_t calls;
+        uint64_t totalNs;
+        uint64_t maxNs;
+    };
+
+    explicit TraceReplayer(unsigned long loopPeriodUs = 1000) : loopPeriodUs(loopPeriodUs) {}
+
+    // Replay 'length' bytes of records. False if the data ends in the
+    // middle of a record (the records before it are still replayed).
+    bool run(const uint8_t* trace, size_t length) {
+        TraceRecordView view;
+        if (!traceParseRecord(trace, length, view)) return length == 0;
+        fake::nowMicros = view.timestamp;
+        uint32_t lastTimestamp = view.timestamp;
+        begin();
+
+        auto wallStart = std::chrono::steady_clock::now();
+        uint64_t startUs = fake::nowMicros;
+        uint64_t at = startUs;
+        size_t position = 0;
+        while (traceParseRecord(trace + position, length - position, view)) {
+            // Timestamps are 32-bit micros(), which wraps after 71 minutes
+            at += (uint32_t)(view.timestamp - lastTimestamp);
+            lastTimestamp = view.timestamp;
+            runUntil(at);
+            deliver(view);
+            position += traceRecordLength(trace + position, length - position);
+        }
+        runLoop();
+        traceUs = fake::nowMicros - startUs;
+        wallNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - wallStart).count();
+        return position == length;
+    }
+
+    const std::vector<Output>& getOutput() const { return output; }
+    const std::vector<LedFrame>& getLeds() const { return leds; }
+    const std::vector<ProcessTiming>& getTimings() const { return timings; }
+    IMUProcess* getIMUProcess() { return imu; }
+    BLEProcess* getBLEProcess() { return ble; }
+    LedProcess* getLedProcess() { return led; }
+
+    uint32_t imuReadings = 0;
+    uint32_t scans = 0;
+    uint32_t adverts = 0;
+    uint32_t messages = 0;
+    uint32_t unknownRecords = 0;
+    uint64_t loops = 0;
+    uint64_t ledFrames = 0;
+    uint64_t inputNs = 0;           // host time spent delivering records
+    uint64_t inputMaxNs = 0;
+    uint64_t traceUs = 0;           // span of the trace on the device
+    uint64_t wallNs = 0;            // host time for the whole replay
+
+private:
+    void begin() {
+        client = WebSocketsClient::latest; // the one owned by webSocketManager
+        client->sent.clear();
+        webSocketManager.initialize("ws://replay/");
+        webSocketManager.setLinkUp(true);
+        if (!client->isConnected()) client->injectConnected();
+        webSocketManager.service();
+
+        // The device's process set, minus the ones that need WiFi and
+        // Serial configuration. The loop updates them in name order, as
+        // ProcessManager does.
+        imu = new IMUProcess();
+        ble = new BLEProcess();
+        processManager.addProcess("health", new HealthProcess());
+        processManager.addProcess("ble", ble);
+        processManager.addProcess("imu", imu);
+        led = new LedProcess();
+        processManager.addProcess("led", led);
+        processManager.addProcess("publish", new PublishProcess());
+        processManager.addProcess("receive", new ReceiveProcess());
+        processManager.addProcess("vibration", new VibrationProcess());
+        processManager.setupProcesses();
+        webSocketManager.dispatch();
+        for (const char* name : {"health", "led", "publish", "receive", "vibration"}) {
+            timings.push_back(ProcessTiming{name, processManager.getProcess(name), 0, 0, 0});
+        }
+        nextLoopUs = fake::nowMicros;
+        nextFrameUs = fake::nowMicros;
+    }
+
+    // The loops and the frames due up to 'at', in time order; a frame
+    // due with a loop is drawn first, as the ticker preempts the loop
+    void runUntil(uint64_t at) {
+        while (nextLoopUs <= at || nextFrameUs <= at) {
+            if (nextFrameUs <= nextLoopUs) {
+                fake::nowMicros = nextFrameUs;
+                runFrame();
+                nextFrameUs += LED_FRAME_MS * 1000;
+            } else {
+                fake::nowMicros = nextLoopUs;
+                runLoop();
+                nextLoopUs += loopPeriodUs;
+            }
+        }
+        fake::nowMicros = at;
+    }
+
+    void runFrame() {
+        ledFrames++;
+        fake::fireTickers();
+        const std::vector<uint32_t>& shown = led->pixels.shown;
+        if (leds.empty() || leds.back().pixels != shown) leds.push_back(LedFrame{millis(), shown});
+    }
+
+    void runLoop() {
+        loops++;
+        for (ProcessTiming& timing : timings) {
+            if (!timing.process->isProcessRunning()) continue;
+            auto start = std::chrono::steady_clock::now();
+            timing.process->update();
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            timing.calls++;
+            timing.totalNs += ns;
+            if (ns > timing.maxNs) timing.maxNs = ns;
+        }
+        // The network task, once per loop instead of every WS_SERVICE_INTERVAL_MS
+        webSocketManager.service();
+        webSocketManager.dispatch();
+        for (std::string& message : client->sent) {
+            output.push_back(Output{millis(), std::move(message)});
+        }
+        client->sent.clear();
+    }
+
+    void deliver(const TraceRecordView& view) {
+        auto start = std::chrono::steady_clock::now();
+        int16_t x, y, z;
+        const uint8_t* address;
+        const uint8_t* payload;
+        size_t payloadLength;
+        int rssi;
+        if (traceReadImu(view, x, y, z)) {
+            imu->processReading(x, y, z);
+            imuReadings++;
+        } else if (view.type == TRACE_SCAN && view.payloadLength == 1) {
+            if (view.payload[0]) ble->startScan();
+            else ble->stopScan();
+            scans++;
+        } else if (traceReadAdvert(view, address, rssi, payload, payloadLength)) {
+            ble->onAdvertisement(address, rssi, payload, payloadLength);
+            adverts++;
+        } else if (view.type == TRACE_MESSAGE) {
+            webSocketManager.queueReceived((const char*)view.payload, view.payloadLength);
+            messages++;
+        } else if (view.type != TRACE_START) {
+            unknownRecords++;
+        }
+        uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        inputNs += ns;
+        if (ns > inputMaxNs) inputMaxNs = ns;
+    }
+
+    unsigned long loopPeriodUs;
+    uint64_t nextLoopUs = 0;
+    uint64_t nextFrameUs = 0;
+    ProcessManager processManager;
+    IMUProcess* imu = nullptr;
+    BLEProcess* ble = nullptr;
+    LedProcess* led = nullptr;
+    WebSocketsClient* client = nullptr;
+    std::vector<ProcessTiming> timings;
+    std::vector<Output> output;
+    std::vector<LedFrame> leds;
+};
+
+#endif // REPLAY_TRACE_REPLAY_H
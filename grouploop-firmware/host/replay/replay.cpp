@@ -0,0 +1,156 @@
+// Replays an input trace captured on a device (see include/TraceFormat.h
+// and include/processes/TraceProcess.h) through the firmware's processes
+// on the host, faster than real time.
+//
+//   replay [options] <capture.txt | trace.bin>
+//
+// The input is socket server output or a subscriber capture holding
+// "trace:<id>:<offset>:<hex>" lines, or a binary trace written by --save.
+// The replay is deterministic: the same trace and configuration give the
+// same output every time, so --output files can be diffed between
+// firmware versions. Timings are host time, for finding hot spots; they
+// are not device timings.
+
+#include "TraceReplay.h"
+#include "Configuration.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+Configuration configuration;
+
+namespace {
+
+struct Options {
+    const char* input = nullptr;
+    std::string device;
+    const char* config = nullptr;
+    const char* output = nullptr;
+    const char* save = nullptr;
+    unsigned long loopUs = 1000;
+    bool serial = false;
+};
+
+void usage() {
+    fprintf(stderr,
+            "usage: replay [options] <capture.txt | trace.bin>\n"
+            "  --device <id>     device to replay from a capture holding several (default: the first)\n"
+            "  --config <file>   configuration JSON the device ran with (beacons, room size)\n"
+            "  --output <file>   write every frame and event the device sent, \"<millis> <message>\"\n"
+            "  --save <file>     write the assembled binary trace\n"
+            "  --loop-us <n>     main loop period to simulate (default 1000)\n"
+            "  --serial          echo the firmware's Serial output\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--device") == 0 && hasValue) options.device = argv[++i];
+        else if (strcmp(arg, "--config") == 0 && hasValue) options.config = argv[++i];
+        else if (strcmp(arg, "--output") == 0 && hasValue) options.output = argv[++i];
+        else if (strcmp(arg, "--save") == 0 && hasValue) options.save = argv[++i];
+        else if (strcmp(arg, "--loop-us") == 0 && hasValue) options.loopUs = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--serial") == 0) options.serial = true;
+        else if (arg[0] != '-' && !options.input) options.input = arg;
+        else return false;
+    }
+    return options.input && options.loopUs > 0;
+}
+
+bool readFile(const char* path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+void printTiming(const char* label, uint64_t calls, uint64_t totalNs, uint64_t maxNs) {
+    printf("  %-12s %10llu calls  %8.3f ms total  %7.0f ns avg  %8.0f ns max\n", label,
+           (unsigned long long)calls, totalNs / 1e6, calls ? (double)totalNs / calls : 0.0, (double)maxNs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    std::string contents;
+    if (!readFile(options.input, contents)) {
+        fprintf(stderr, "replay: cannot read %s\n", options.input);
+        return 1;
+    }
+    TraceCapture capture;
+    if (contents.find("trace:") != std::string::npos) {
+        std::istringstream in(contents);
+        if (!traceLoadCapture(in, options.device, capture)) {
+            fprintf(stderr, "replay: no trace for %s in %s\n",
+                    options.device.empty() ? "any device" : options.device.c_str(), options.input);
+            return 1;
+        }
+        printf("device %s: %u chunks, %u gaps, %u bytes of partial records dropped\n",
+               capture.deviceId.c_str(), capture.chunks, capture.gaps, capture.droppedBytes);
+    } else {
+        capture.records.assign(contents.begin(), contents.end());
+    }
+
+    if (options.save) {
+        std::ofstream file(options.save, std::ios::binary);
+        file.write((const char*)capture.records.data(), (std::streamsize)capture.records.size());
+        if (!file) {
+            fprintf(stderr, "replay: cannot write %s\n", options.save);
+            return 1;
+        }
+    }
+
+    if (options.config) {
+        std::string json;
+        if (!readFile(options.config, json) || !configuration.parseFromJSON(String(json))) {
+            fprintf(stderr, "replay: cannot use configuration %s\n", options.config);
+            return 1;
+        }
+    }
+    Serial.echo = options.serial;
+
+    TraceReplayer replayer(options.loopUs);
+    bool complete = replayer.run(capture.records.data(), capture.records.size());
+    if (!complete) fprintf(stderr, "replay: trace ends in a partial record\n");
+
+    printf("replayed %.3f s of input in %.3f s (%.0fx real time), %llu loops, %llu LED frames\n",
+           replayer.traceUs / 1e6, replayer.wallNs / 1e9,
+           replayer.wallNs ? replayer.traceUs * 1e3 / replayer.wallNs : 0.0,
+           (unsigned long long)replayer.loops, (unsigned long long)replayer.ledFrames);
+    printf("input: %u IMU readings, %u scan events, %u advertisements, %u messages, %u unknown records\n",
+           replayer.imuReadings, replayer.scans, replayer.adverts, replayer.messages, replayer.unknownRecords);
+    printf("output: %zu frames and events, %zu LED changes\n", replayer.getOutput().size(), replayer.getLeds().size());
+    printf("host time per process update:\n");
+    for (const TraceReplayer::ProcessTiming& timing : replayer.getTimings()) {
+        printTiming(timing.name.c_str(), timing.calls, timing.totalNs, timing.maxNs);
+    }
+    uint32_t records = replayer.imuReadings + replayer.scans + replayer.adverts + replayer.messages;
+    printTiming("input", records, replayer.inputNs, replayer.inputMaxNs);
+
+    if (options.output) {
+        FILE* file = fopen(options.output, "w");
+        if (!file) {
+            fprintf(stderr, "replay: cannot write %s\n", options.output);
+            return 1;
+        }
+        for (const TraceReplayer::Output& line : replayer.getOutput()) {
+            // Frames end in a newline already
+            fprintf(file, "%lu %s", line.atMs, line.message.c_str());
+            if (line.message.empty() || line.message.back() != '\n') fputc('\n', file);
+        }
+        fclose(file);
+    }
+    return complete ? 0 : 1;
+}
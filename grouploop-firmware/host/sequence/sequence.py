@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Build LED keyframe sequences and upload them to devices through the
+socket server.
+
+  sequence.py build show.json -o show.seq
+  sequence.py upload show.json --server ws://localhost:5003 --device 1a2b
+  sequence.py upload show.json --server ws://localhost:5003 --device all --play-in 3000
+
+A sequence is written as JSON:
+
+  {
+    "duration": 4000,
+    "loop": [0, 4000],
+    "keyframes": [
+      {"time": 0,    "pixel": "all", "color": "000000"},
+      {"time": 1000, "pixel": "all", "color": "ff0000", "mode": "ease"},
+      {"time": 2000, "pixel": 0,     "color": "0000ff", "mode": "linear"}
+    ]
+  }
+
+"loop" is optional; "mode" is step, linear (the default) or ease. The
+binary layout is documented in include/SequenceFormat.h.
+
+--play-in starts the sequence on every device at the same server time, that
+many ms after the upload: this script asks the server for its clock the
+same way the devices do and sends seq:play:<server ms>.
+"""
+
+import argparse
+import asyncio
+import json
+import struct
+import sys
+import time
+import zlib
+
+import websockets
+
+FORMAT_VERSION = 1
+ALL_PIXELS = 0xFF
+MODES = {"step": 0, "linear": 1, "ease": 2}
+MAX_BYTES = 4096  # SEQUENCE_MAX_BYTES
+
+# A device receives seq:data:<8 hex digits>:<hex>; keep it under its
+# 256-byte receive limit (WS_RX_MAX_LEN)
+CHUNK_BYTES = 112
+# The device runs one received command per 10 ms from a queue of 4
+CHUNK_INTERVAL_S = 0.03
+
+
+def build(spec):
+    keyframes = sorted(spec["keyframes"], key=lambda k: k["time"])
+    duration = spec.get("duration", keyframes[-1]["time"] if keyframes else 0)
+    loop_start, loop_end = spec.get("loop", [0, 0])
+    data = struct.pack("<BBHIII", FORMAT_VERSION, 0, len(keyframes), duration, loop_start, loop_end)
+    for keyframe in keyframes:
+        pixel = keyframe.get("pixel", "all")
+        color = int(str(keyframe["color"]).lstrip("#"), 16)
+        data += struct.pack(
+            "<IBBBBB",
+            keyframe["time"],
+            ALL_PIXELS if pixel == "all" else int(pixel),
+            MODES[keyframe.get("mode", "linear")],
+            (color >> 16) & 0xFF,
+            (color >> 8) & 0xFF,
+            color & 0xFF,
+        )
+    return data
+
+
+async def server_offset(ws):
+    """Server ms minus local ms, from the fastest of a few clock probes"""
+    best = None
+    for _ in range(5):
+        sent = int(time.time() * 1000)
+        await ws.send(f"clock:host:{sent}")
+        while True:
+            reply = await asyncio.wait_for(ws.recv(), timeout=2)
+            parts = reply.split(":")
+            if len(parts) == 3 and parts[0] == "clock" and parts[1] == str(sent):
+                break
+        now = int(time.time() * 1000)
+        rtt = now - sent
+        offset = int(parts[2]) - (sent + rtt // 2)
+        if best is None or rtt < best[0]:
+            best = (rtt, offset)
+    return best[1]
+
+
+async def upload(data, server, device, play_in):
+    async with websockets.connect(server) as ws:
+        await ws.recv()  # greeting
+        await ws.send("s")
+
+        async def command(text):
+            await ws.send(f"cmd:{device}:seq:{text}")
+            await asyncio.sleep(CHUNK_INTERVAL_S)
+
+        await command(f"begin:{len(data)}")
+        for offset in range(0, len(data), CHUNK_BYTES):
+            await command(f"data:{offset:08x}:{data[offset:offset + CHUNK_BYTES].hex()}")
+        crc = zlib.crc32(data) & 0xFFFFFFFF
+        await command(f"end:{crc:08x}")
+
+        # Results come back as seq:<device id>:<loaded|error>:<detail>
+        failed = False
+        deadline = time.monotonic() + 3
+        while time.monotonic() < deadline:
+            try:
+                message = await asyncio.wait_for(ws.recv(), timeout=deadline - time.monotonic())
+            except asyncio.TimeoutError:
+                break
+            for line in str(message).splitlines():
+                if line.startswith("seq:"):
+                    print(line)
+                    failed |= ":error:" in line
+                    if device != "all" and line.startswith(f"seq:{device}:"):
+                        deadline = 0
+
+        if play_in is not None and not failed:
+            start = int(time.time() * 1000) + await server_offset(ws) + play_in
+            await ws.send(f"cmd:{device}:seq:play:{start}")
+            print(f"playing from server time {start}")
+        return not failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="action", required=True)
+    build_parser = sub.add_parser("build", help="write the binary sequence")
+    build_parser.add_argument("spec")
+    build_parser.add_argument("-o", "--output", required=True)
+    upload_parser = sub.add_parser("upload", help="upload to a device through the socket server")
+    upload_parser.add_argument("spec")
+    upload_parser.add_argument("--server", required=True, help="socket server URL, e.g. ws://localhost:5003")
+    upload_parser.add_argument("--device", required=True, help="device id, or all")
+    upload_parser.add_argument("--play-in", type=int, help="start playing this many ms after the upload")
+    args = parser.parse_args()
+
+    with open(args.spec) as f:
+        data = build(json.load(f))
+    if len(data) > MAX_BYTES:
+        sys.exit(f"{len(data)} bytes, the devices take at most {MAX_BYTES}")
+    if args.action == "build":
+        with open(args.output, "wb") as f:
+            f.write(data)
+        print(f"{len(data)} bytes, crc32 {zlib.crc32(data) & 0xFFFFFFFF:08x}")
+        return
+    if not asyncio.run(upload(data, args.server, args.device.lower(), args.play_in)):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
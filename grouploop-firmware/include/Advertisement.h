@@ -0,0 +1,73 @@
+#ifndef ADVERTISEMENT_H
+#define ADVERTISEMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Utils.h"
+
+// Raw BLE advertisement helpers. These work directly on the advertisement
+// payload bytes so scan callbacks can reject foreign devices without
+// constructing any objects.
+
+// AD structure types (Bluetooth Core Supplement, part A)
+#define AD_TYPE_INCOMPLETE_UUID128 0x06
+#define AD_TYPE_COMPLETE_UUID128 0x07
+#define AD_TYPE_TX_POWER_LEVEL 0x0A
+
+// Parse "19b10000-e8f2-537e-4f6c-d104768a1214" into the 16 bytes as they
+// appear on air (little-endian, so the last byte of the string comes first).
+static inline bool parseUuid128(const char* text, uint8_t out[16]) {
+    if (!text) return false;
+    int byteIndex = 15;
+    int high = -1;
+    for (const char* p = text; *p; ++p) {
+        if (*p == '-') continue;
+        int nibble = hexNibble(*p);
+        if (nibble < 0 || byteIndex < 0) return false;
+        if (high < 0) {
+            high = nibble;
+        } else {
+            out[byteIndex--] = (uint8_t)((high << 4) | nibble);
+            high = -1;
+        }
+    }
+    return byteIndex == -1 && high < 0;
+}
+
+// Walk the AD structures and check whether any 128-bit service UUID list
+// contains 'uuid' (on-air byte order).
+static inline bool advertisesService128(const uint8_t* payload, size_t length, const uint8_t uuid[16]) {
+    size_t pos = 0;
+    while (pos < length) {
+        uint8_t fieldLength = payload[pos];
+        if (fieldLength == 0 || pos + 1 + fieldLength > length) return false;
+        uint8_t type = payload[pos + 1];
+        if (type == AD_TYPE_INCOMPLETE_UUID128 || type == AD_TYPE_COMPLETE_UUID128) {
+            const uint8_t* data = payload + pos + 2;
+            for (size_t offset = 0; offset + 16 <= (size_t)(fieldLength - 1); offset += 16) {
+                if (memcmp(data + offset, uuid, 16) == 0) return true;
+            }
+        }
+        pos += 1 + fieldLength;
+    }
+    return false;
+}
+
+// Find the advertised TX power level (dBm, measured at 0 m). Returns false
+// when the advertisement does not carry one.
+static inline bool findTxPowerLevel(const uint8_t* payload, size_t length, int8_t& txPower) {
+    size_t pos = 0;
+    while (pos < length) {
+        uint8_t fieldLength = payload[pos];
+        if (fieldLength == 0 || pos + 1 + fieldLength > length) return false;
+        if (payload[pos + 1] == AD_TYPE_TX_POWER_LEVEL && fieldLength >= 2) {
+            txPower = (int8_t)payload[pos + 2];
+            return true;
+        }
+        pos += 1 + fieldLength;
+    }
+    return false;
+}
+
+#endif // ADVERTISEMENT_H
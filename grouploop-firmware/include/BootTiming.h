@@ -0,0 +1,68 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include "Arduino.h"
+
+// Milestones from power-on to the first sensor frame leaving the device.
+// All times are millis() since boot; 0 means "not reached yet". Only the
+// first occurrence after boot is recorded, later reconnects don't move them.
+class BootTiming {
+public:
+    void markWiFiConnected(bool viaFastPath) {
+        if (wifiConnectedMs) return;
+        wifiConnectedMs = nonZeroMillis();
+        fastPath = viaFastPath;
+    }
+
+    void markSocketConnected() {
+        if (!socketConnectedMs) socketConnectedMs = nonZeroMillis();
+    }
+
+    // Returns true the first time only, so the caller can report once
+    bool markFirstFrame() {
+        if (firstFrameMs) return false;
+        firstFrameMs = nonZeroMillis();
+        return true;
+    }
+
+    unsigned long getWiFiConnectedMs() const { return wifiConnectedMs; }
+    unsigned long getSocketConnectedMs() const { return socketConnectedMs; }
+    unsigned long getFirstFrameMs() const { return firstFrameMs; }
+    bool usedFastPath() const { return fastPath; }
+
+    void print() const {
+        Serial.print("Boot timing: WiFi ");
+        printMilestone(wifiConnectedMs);
+        Serial.print(fastPath ? " (fast path)" : " (full scan)");
+        Serial.print(", socket ");
+        printMilestone(socketConnectedMs);
+        Serial.print(", first frame ");
+        printMilestone(firstFrameMs);
+        Serial.println();
+    }
+
+private:
+    static unsigned long nonZeroMillis() {
+        unsigned long now = millis();
+        return now ? now : 1;
+    }
+
+    static void printMilestone(unsigned long ms) {
+        if (ms) {
+            Serial.print(ms);
+            Serial.print(" ms");
+        } else {
+            Serial.print("-");
+        }
+    }
+
+    unsigned long wifiConnectedMs = 0;
+    unsigned long socketConnectedMs = 0;
+    unsigned long firstFrameMs = 0;
+    bool fastPath = false;
+};
+
+// Global boot timing instance
+extern BootTiming bootTiming;
+
+#endif // BOOT_TIMING_H
@@ -0,0 +1,61 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+#include "config.h"
+
+// The server's clock (milliseconds since the Unix epoch) as seen from
+// millis(). The device sends clock:<id>:<millis> probes and the server
+// answers clock:<millis>:<server ms>; assuming the reply took half the
+// round trip, the server read its clock at sent + rtt / 2. Probes go out in
+// bursts and the one with the shortest round trip of a burst sets the
+// offset, as it waited least in queues on the way.
+class ClockSync {
+public:
+    ClockSync() : offset(0), synced(false), burstRtt(UINT32_MAX), burstOffset(0), bestRtt(0) {}
+
+    // A reply to the probe sent at 'sentMs', received at 'nowMs'
+    void onReply(unsigned long sentMs, uint64_t serverMs, unsigned long nowMs) {
+        uint32_t rtt = (uint32_t)(nowMs - sentMs);
+        if (rtt > CLOCK_SYNC_MAX_RTT_MS) return;
+        if (rtt < burstRtt) {
+            burstRtt = rtt;
+            burstOffset = (int64_t)serverMs - ((int64_t)sentMs + rtt / 2);
+        }
+        // The first reply is better than nothing until the burst ends
+        if (!synced) endBurst();
+    }
+
+    // Take the best reply of the burst, if there was one
+    void endBurst() {
+        if (burstRtt == UINT32_MAX) return;
+        offset = burstOffset;
+        bestRtt = burstRtt;
+        synced = true;
+        burstRtt = UINT32_MAX;
+    }
+
+    bool isSynced() const { return synced; }
+
+    // Server time 'serverMs' in local millis(), as a signed value: negative
+    // or past the wrap when it is before boot or far away
+    int64_t toLocal(uint64_t serverMs) const {
+        return (int64_t)serverMs - offset;
+    }
+
+    uint64_t serverNow(unsigned long nowMs) const {
+        return (uint64_t)((int64_t)nowMs + offset);
+    }
+
+    // Round trip of the reply the offset came from
+    uint32_t getRtt() const { return bestRtt; }
+
+private:
+    int64_t offset;         // server ms - local ms
+    bool synced;
+    uint32_t burstRtt;      // best of the current burst, UINT32_MAX for none
+    int64_t burstOffset;
+    uint32_t bestRtt;
+};
+
+#endif // CLOCK_SYNC_H
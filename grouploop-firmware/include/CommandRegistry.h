@@ -2,49 +2,76 @@
 #define COMMAND_REGISTRY_H
 
 #include "Arduino.h"
+#include "Log.h"
+#include "config.h"
 #include <map>
 #include <functional>
 
+// Orders command names by strcmp. Transparent, so a name can be looked up
+// as a const char* without building a String for it.
+struct CommandNameLess {
+    typedef void is_transparent;
+    bool operator()(const String& a, const String& b) const { return strcmp(a.c_str(), b.c_str()) < 0; }
+    bool operator()(const String& a, const char* b) const { return strcmp(a.c_str(), b) < 0; }
+    bool operator()(const char* a, const String& b) const { return strcmp(a, b.c_str()) < 0; }
+};
+
 class CommandRegistry {
 private:
-    std::map<String, std::function<void(const String&)>> handlers;
+    std::map<String, std::function<void(const String&)>, CommandNameLess> handlers;
+    // Parameters of the message being executed. Reserved for the longest
+    // message up front, so copying them in never allocates.
+    String messageParameters;
     
 public:
-    CommandRegistry() {}
+    CommandRegistry() {
+        messageParameters.reserve(WS_RX_MAX_LEN);
+    }
     
     // Register a command handler
     void registerCommand(const String& name, std::function<void(const String&)> handler) {
         handlers[name] = handler;
-        Serial.print("Registered command: ");
-        Serial.println(name);
+        LOG_DEBUG("Registered command: %s", name.c_str());
     }
     
     // Execute a command with parameters
     bool executeCommand(const String& command, const String& parameters) {
-        if (handlers.count(command)) {
+        return executeCommand(command.c_str(), parameters);
+    }
+
+    // Same, looking the name up without building a String for it, so a
+    // command parsed in place from a receive buffer costs no allocation
+    bool executeCommand(const char* command, const String& parameters) {
+        auto handler = handlers.find(command);
+        if (handler != handlers.end()) {
             try {
-                handlers[command](parameters);
-                Serial.print("Executed command: ");
-                Serial.print(command);
-                if (parameters.length() > 0) {
-                    Serial.print(" with parameters: ");
-                    Serial.println(parameters);
-                } else {
-                    Serial.println();
-                }
+                handler->second(parameters);
+                LOG_DEBUG_EVERY(LOG_HOT_INTERVAL_MS, "Executed command: %s:%s", command, parameters.c_str());
                 return true;
             } catch (...) {
-                Serial.print("Error executing command: ");
-                Serial.println(command);
+                LOG_ERROR("Error executing command: %s", command);
                 return false;
             }
         } else {
-            Serial.print("Unknown command: ");
-            Serial.println(command);
+            LOG_WARN_EVERY(LOG_HOT_INTERVAL_MS, "Unknown command: %s", command);
             return false;
         }
     }
     
+    // Execute a "command:parameters" message, splitting it in place at the
+    // first colon; a message without one is a command without parameters.
+    // Not reentrant: a handler must not execute another message.
+    bool executeMessage(char* message) {
+        const char* parameters = "";
+        char* colon = strchr(message, ':');
+        if (colon && colon != message) {
+            *colon = '\0';
+            parameters = colon + 1;
+        }
+        messageParameters = parameters;
+        return executeCommand(message, messageParameters);
+    }
+
     // Check if a command is registered
     bool hasCommand(const String& command) const {
         return handlers.count(command) > 0;
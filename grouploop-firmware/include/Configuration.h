@@ -5,11 +5,25 @@
 #include <ArduinoJson.h>
 #include <Preferences.h>
 
+// Maximum number of known WiFi networks, the primary one included
+#define MAX_WIFI_NETWORKS 4
+
+// A WiFi network the device may join. When several are in range the one
+// with the highest priority wins, then the one with the strongest signal.
+struct WiFiNetwork {
+    String ssid;
+    String password;
+    int priority;
+};
+
 class Configuration {
 private:    
     // Device-specific configuration variables
-    String wifiSSID;
-    String wifiPassword;
+    // The primary network: wifiSSID, wifiPassword and wifiPriority
+    WiFiNetwork primaryNetwork;
+    // Additional networks besides the primary one, e.g. one per hall
+    WiFiNetwork extraNetworks[MAX_WIFI_NETWORKS - 1];
+    int extraNetworkCount;
     String socketServerURL;
     int LEDPin;
     int motorPin;
@@ -21,6 +35,31 @@ private:
     String beaconSE;
     String beaconSW;
     
+    // Positioning: room size in meters, path-loss exponent and the
+    // per-anchor reference RSSI measured at 1 m (0 = not calibrated, use the
+    // beacon's advertised TX power)
+    float roomWidth;
+    float roomHeight;
+    float pathLossExponent;
+    int rssiAt1mNE;
+    int rssiAt1mNW;
+    int rssiAt1mSE;
+    int rssiAt1mSW;
+    
+    // WiFi/BLE coexistence preference (0 = balance, 1 = WiFi, 2 = BLE)
+    int coexPreference;
+    
+    // Optional static IP configuration (empty = DHCP)
+    String staticIP;
+    String gateway;
+    String subnet;
+    String dns;
+    
+    // Last access point we joined, used for the fast reconnect path
+    String lastSSID;
+    String lastBSSID;
+    int lastChannel;
+    
     // Preferences object for NVS storage
     Preferences preferences;
     
@@ -35,11 +74,18 @@ private:
     static const String DEFAULT_BEACON_NW;
     static const String DEFAULT_BEACON_SE;
     static const String DEFAULT_BEACON_SW;
+    static const float DEFAULT_ROOM_WIDTH;
+    static const float DEFAULT_ROOM_HEIGHT;
+    static const float DEFAULT_PATH_LOSS_EXPONENT;
+    static const int DEFAULT_RSSI_AT_1M;
+    static const String DEFAULT_SUBNET;
     
     // NVS key names
     static const char* NVS_NAMESPACE;
     static const char* KEY_WIFI_SSID;
     static const char* KEY_WIFI_PASSWORD;
+    static const char* KEY_WIFI_PRIORITY;
+    static const char* KEY_NETWORK_COUNT;
     static const char* KEY_SOCKET_SERVER_URL;
     static const char* KEY_LED_PIN;
     static const char* KEY_MOTOR_PIN;
@@ -48,6 +94,34 @@ private:
     static const char* KEY_BEACON_NW;
     static const char* KEY_BEACON_SE;
     static const char* KEY_BEACON_SW;
+    static const char* KEY_ROOM_WIDTH;
+    static const char* KEY_ROOM_HEIGHT;
+    static const char* KEY_PATH_LOSS_EXPONENT;
+    static const char* KEY_RSSI_1M_NE;
+    static const char* KEY_RSSI_1M_NW;
+    static const char* KEY_RSSI_1M_SE;
+    static const char* KEY_RSSI_1M_SW;
+    static const char* KEY_COEX_PREFERENCE;
+    static const char* KEY_STATIC_IP;
+    static const char* KEY_GATEWAY;
+    static const char* KEY_SUBNET;
+    static const char* KEY_DNS;
+    static const char* KEY_LAST_SSID;
+    static const char* KEY_LAST_BSSID;
+    static const char* KEY_LAST_CHANNEL;
+    
+    // NVS key of a field of an additional network, e.g. "net0_ssid"
+    static const char* networkKey(char* key, int index, const char* field) {
+        snprintf(key, 16, "net%d_%s", index, field);
+        return key;
+    }
+    
+    int findExtraNetwork(const String& ssid) const {
+        for (int i = 0; i < extraNetworkCount; ++i) {
+            if (extraNetworks[i].ssid == ssid) return i;
+        }
+        return -1;
+    }
 
 public:
 
@@ -64,8 +138,17 @@ public:
         }
         
         // Load values from NVS, use defaults if not found
-        wifiSSID = preferences.getString(KEY_WIFI_SSID, DEFAULT_WIFI_SSID);
-        wifiPassword = preferences.getString(KEY_WIFI_PASSWORD, DEFAULT_WIFI_PASSWORD);
+        primaryNetwork.ssid = preferences.getString(KEY_WIFI_SSID, DEFAULT_WIFI_SSID);
+        primaryNetwork.password = preferences.getString(KEY_WIFI_PASSWORD, DEFAULT_WIFI_PASSWORD);
+        primaryNetwork.priority = preferences.getInt(KEY_WIFI_PRIORITY, 0);
+        extraNetworkCount = preferences.getInt(KEY_NETWORK_COUNT, 0);
+        if (extraNetworkCount < 0 || extraNetworkCount > MAX_WIFI_NETWORKS - 1) extraNetworkCount = 0;
+        for (int i = 0; i < extraNetworkCount; ++i) {
+            char key[16];
+            extraNetworks[i].ssid = preferences.getString(networkKey(key, i, "ssid"), "");
+            extraNetworks[i].password = preferences.getString(networkKey(key, i, "pass"), "");
+            extraNetworks[i].priority = preferences.getInt(networkKey(key, i, "prio"), 0);
+        }
         socketServerURL = preferences.getString(KEY_SOCKET_SERVER_URL, DEFAULT_SOCKET_SERVER_URL);
         LEDPin = preferences.getInt(KEY_LED_PIN, DEFAULT_LED_PIN);
         motorPin = preferences.getInt(KEY_MOTOR_PIN, DEFAULT_MOTOR_PIN);
@@ -74,6 +157,21 @@ public:
         beaconNW = preferences.getString(KEY_BEACON_NW, DEFAULT_BEACON_NW);
         beaconSE = preferences.getString(KEY_BEACON_SE, DEFAULT_BEACON_SE);
         beaconSW = preferences.getString(KEY_BEACON_SW, DEFAULT_BEACON_SW);
+        roomWidth = preferences.getFloat(KEY_ROOM_WIDTH, DEFAULT_ROOM_WIDTH);
+        roomHeight = preferences.getFloat(KEY_ROOM_HEIGHT, DEFAULT_ROOM_HEIGHT);
+        pathLossExponent = preferences.getFloat(KEY_PATH_LOSS_EXPONENT, DEFAULT_PATH_LOSS_EXPONENT);
+        rssiAt1mNE = preferences.getInt(KEY_RSSI_1M_NE, DEFAULT_RSSI_AT_1M);
+        rssiAt1mNW = preferences.getInt(KEY_RSSI_1M_NW, DEFAULT_RSSI_AT_1M);
+        rssiAt1mSE = preferences.getInt(KEY_RSSI_1M_SE, DEFAULT_RSSI_AT_1M);
+        rssiAt1mSW = preferences.getInt(KEY_RSSI_1M_SW, DEFAULT_RSSI_AT_1M);
+        coexPreference = preferences.getInt(KEY_COEX_PREFERENCE, 0);
+        staticIP = preferences.getString(KEY_STATIC_IP, "");
+        gateway = preferences.getString(KEY_GATEWAY, "");
+        subnet = preferences.getString(KEY_SUBNET, DEFAULT_SUBNET);
+        dns = preferences.getString(KEY_DNS, "");
+        lastSSID = preferences.getString(KEY_LAST_SSID, "");
+        lastBSSID = preferences.getString(KEY_LAST_BSSID, "");
+        lastChannel = preferences.getInt(KEY_LAST_CHANNEL, 0);
         
         preferences.end();
         
@@ -82,8 +180,10 @@ public:
     
     // Load default values
     void loadDefaults() {
-        wifiSSID = DEFAULT_WIFI_SSID;
-        wifiPassword = DEFAULT_WIFI_PASSWORD;
+        primaryNetwork.ssid = DEFAULT_WIFI_SSID;
+        primaryNetwork.password = DEFAULT_WIFI_PASSWORD;
+        primaryNetwork.priority = 0;
+        extraNetworkCount = 0;
         socketServerURL = DEFAULT_SOCKET_SERVER_URL;
         LEDPin = DEFAULT_LED_PIN;
         motorPin = DEFAULT_MOTOR_PIN;
@@ -92,6 +192,21 @@ public:
         beaconNW = DEFAULT_BEACON_NW;
         beaconSE = DEFAULT_BEACON_SE;
         beaconSW = DEFAULT_BEACON_SW;
+        roomWidth = DEFAULT_ROOM_WIDTH;
+        roomHeight = DEFAULT_ROOM_HEIGHT;
+        pathLossExponent = DEFAULT_PATH_LOSS_EXPONENT;
+        rssiAt1mNE = DEFAULT_RSSI_AT_1M;
+        rssiAt1mNW = DEFAULT_RSSI_AT_1M;
+        rssiAt1mSE = DEFAULT_RSSI_AT_1M;
+        rssiAt1mSW = DEFAULT_RSSI_AT_1M;
+        coexPreference = 0;
+        staticIP = "";
+        gateway = "";
+        subnet = DEFAULT_SUBNET;
+        dns = "";
+        lastSSID = "";
+        lastBSSID = "";
+        lastChannel = 0;
         Serial.println("Configuration loaded with default values");
     }
     
@@ -102,8 +217,16 @@ public:
             return false;
         }
         
-        preferences.putString(KEY_WIFI_SSID, wifiSSID);
-        preferences.putString(KEY_WIFI_PASSWORD, wifiPassword);
+        preferences.putString(KEY_WIFI_SSID, primaryNetwork.ssid);
+        preferences.putString(KEY_WIFI_PASSWORD, primaryNetwork.password);
+        preferences.putInt(KEY_WIFI_PRIORITY, primaryNetwork.priority);
+        preferences.putInt(KEY_NETWORK_COUNT, extraNetworkCount);
+        for (int i = 0; i < extraNetworkCount; ++i) {
+            char key[16];
+            preferences.putString(networkKey(key, i, "ssid"), extraNetworks[i].ssid);
+            preferences.putString(networkKey(key, i, "pass"), extraNetworks[i].password);
+            preferences.putInt(networkKey(key, i, "prio"), extraNetworks[i].priority);
+        }
         preferences.putString(KEY_SOCKET_SERVER_URL, socketServerURL);
         preferences.putInt(KEY_LED_PIN, LEDPin);
         preferences.putInt(KEY_MOTOR_PIN, motorPin);
@@ -112,6 +235,18 @@ public:
         preferences.putString(KEY_BEACON_NW, beaconNW);
         preferences.putString(KEY_BEACON_SE, beaconSE);
         preferences.putString(KEY_BEACON_SW, beaconSW);
+        preferences.putFloat(KEY_ROOM_WIDTH, roomWidth);
+        preferences.putFloat(KEY_ROOM_HEIGHT, roomHeight);
+        preferences.putFloat(KEY_PATH_LOSS_EXPONENT, pathLossExponent);
+        preferences.putInt(KEY_RSSI_1M_NE, rssiAt1mNE);
+        preferences.putInt(KEY_RSSI_1M_NW, rssiAt1mNW);
+        preferences.putInt(KEY_RSSI_1M_SE, rssiAt1mSE);
+        preferences.putInt(KEY_RSSI_1M_SW, rssiAt1mSW);
+        preferences.putInt(KEY_COEX_PREFERENCE, coexPreference);
+        preferences.putString(KEY_STATIC_IP, staticIP);
+        preferences.putString(KEY_GATEWAY, gateway);
+        preferences.putString(KEY_SUBNET, subnet);
+        preferences.putString(KEY_DNS, dns);
         
         preferences.end();
         
@@ -132,11 +267,28 @@ public:
         
         // Parse each configuration value if present
         if (doc["wifiSSID"].is<String>()) {
-            wifiSSID = doc["wifiSSID"].as<String>();
+            primaryNetwork.ssid = doc["wifiSSID"].as<String>();
         }
         
         if (doc["wifiPassword"].is<String>()) {
-            wifiPassword = doc["wifiPassword"].as<String>();
+            primaryNetwork.password = doc["wifiPassword"].as<String>();
+        }
+        
+        if (doc["wifiPriority"].is<int>()) {
+            primaryNetwork.priority = doc["wifiPriority"].as<int>();
+        }
+        
+        // A "networks" array replaces the list of additional networks
+        if (doc["networks"].is<JsonArray>()) {
+            extraNetworkCount = 0;
+            for (JsonVariant network : doc["networks"].as<JsonArray>()) {
+                if (extraNetworkCount >= MAX_WIFI_NETWORKS - 1) break;
+                if (!network["ssid"].is<String>()) continue;
+                WiFiNetwork& entry = extraNetworks[extraNetworkCount++];
+                entry.ssid = network["ssid"].as<String>();
+                entry.password = network["password"].is<String>() ? network["password"].as<String>() : String("");
+                entry.priority = network["priority"].is<int>() ? network["priority"].as<int>() : 0;
+            }
         }
         
         if (doc["socketServerURL"].is<String>()) {
@@ -171,6 +323,54 @@ public:
             beaconSW = doc["beaconSW"].as<String>();
         }
         
+        if (doc["roomWidth"].is<float>()) {
+            roomWidth = doc["roomWidth"].as<float>();
+        }
+        
+        if (doc["roomHeight"].is<float>()) {
+            roomHeight = doc["roomHeight"].as<float>();
+        }
+        
+        if (doc["pathLossExponent"].is<float>()) {
+            pathLossExponent = doc["pathLossExponent"].as<float>();
+        }
+        
+        if (doc["rssiAt1mNE"].is<int>()) {
+            rssiAt1mNE = doc["rssiAt1mNE"].as<int>();
+        }
+        
+        if (doc["rssiAt1mNW"].is<int>()) {
+            rssiAt1mNW = doc["rssiAt1mNW"].as<int>();
+        }
+        
+        if (doc["rssiAt1mSE"].is<int>()) {
+            rssiAt1mSE = doc["rssiAt1mSE"].as<int>();
+        }
+        
+        if (doc["rssiAt1mSW"].is<int>()) {
+            rssiAt1mSW = doc["rssiAt1mSW"].as<int>();
+        }
+        
+        if (doc["coexPreference"].is<int>()) {
+            coexPreference = doc["coexPreference"].as<int>();
+        }
+        
+        if (doc["staticIP"].is<String>()) {
+            staticIP = doc["staticIP"].as<String>();
+        }
+        
+        if (doc["gateway"].is<String>()) {
+            gateway = doc["gateway"].as<String>();
+        }
+        
+        if (doc["subnet"].is<String>()) {
+            subnet = doc["subnet"].as<String>();
+        }
+        
+        if (doc["dns"].is<String>()) {
+            dns = doc["dns"].as<String>();
+        }
+        
         // Save the updated configuration to NVS
         save();
         
@@ -178,8 +378,19 @@ public:
     }
     
     // Getter methods
-    const String& getWifiSSID() const { return wifiSSID; }
-    const String& getWifiPassword() const { return wifiPassword; }
+    const String& getWifiSSID() const { return primaryNetwork.ssid; }
+    const String& getWifiPassword() const { return primaryNetwork.password; }
+    int getWifiPriority() const { return primaryNetwork.priority; }
+    
+    // Known networks: index 0 is the primary wifiSSID, followed by the
+    // additional networks
+    int getNetworkCount() const { return 1 + extraNetworkCount; }
+    const WiFiNetwork& getNetwork(int index) const {
+        static const WiFiNetwork none = {String(""), String(""), 0};
+        if (index <= 0) return primaryNetwork;
+        if (index > extraNetworkCount) return none;
+        return extraNetworks[index - 1];
+    }
     const String& getSocketServerURL() const { return socketServerURL; }
     int getLEDPin() const { return LEDPin; }
     int getMotorPin() const { return motorPin; }
@@ -188,16 +399,70 @@ public:
     const String& getBeaconNW() const { return beaconNW; }
     const String& getBeaconSE() const { return beaconSE; }
     const String& getBeaconSW() const { return beaconSW; }
+    float getRoomWidth() const { return roomWidth; }
+    float getRoomHeight() const { return roomHeight; }
+    float getPathLossExponent() const { return pathLossExponent; }
+    int getRssiAt1mNE() const { return rssiAt1mNE; }
+    int getRssiAt1mNW() const { return rssiAt1mNW; }
+    int getRssiAt1mSE() const { return rssiAt1mSE; }
+    int getRssiAt1mSW() const { return rssiAt1mSW; }
+    int getCoexPreference() const { return coexPreference; }
+    const String& getStaticIP() const { return staticIP; }
+    const String& getGateway() const { return gateway; }
+    const String& getSubnet() const { return subnet; }
+    const String& getDNS() const { return dns; }
+    const String& getLastSSID() const { return lastSSID; }
+    const String& getLastBSSID() const { return lastBSSID; }
+    int getLastChannel() const { return lastChannel; }
     
     // Setter methods (for runtime configuration changes)
     void setWifiSSID(const String& ssid) { 
-        wifiSSID = ssid; 
+        primaryNetwork.ssid = ssid; 
         save();
     }
     void setWifiPassword(const String& password) { 
-        wifiPassword = password; 
+        primaryNetwork.password = password; 
+        save();
+    }
+    void setWifiPriority(int priority) { 
+        primaryNetwork.priority = priority; 
+        save();
+    }
+    
+    // Add a network, or update password and priority when the SSID is
+    // already known. Returns false when the list is full.
+    bool addNetwork(const String& ssid, const String& password, int priority) {
+        if (ssid == primaryNetwork.ssid) {
+            primaryNetwork.password = password;
+            primaryNetwork.priority = priority;
+            save();
+            return true;
+        }
+        int index = findExtraNetwork(ssid);
+        if (index < 0) {
+            if (extraNetworkCount >= MAX_WIFI_NETWORKS - 1) return false;
+            index = extraNetworkCount++;
+        }
+        extraNetworks[index].ssid = ssid;
+        extraNetworks[index].password = password;
+        extraNetworks[index].priority = priority;
         save();
+        return true;
+    }
+    
+    // Remove an additional network. The primary network can only be
+    // replaced, not removed.
+    bool removeNetwork(const String& ssid) {
+        int index = findExtraNetwork(ssid);
+        if (index < 0) return false;
+        for (int i = index; i < extraNetworkCount - 1; ++i) {
+            extraNetworks[i] = extraNetworks[i + 1];
+        }
+        extraNetworkCount--;
+        save();
+        return true;
     }
+    
     void setSocketServerURL(const String& url) { 
         socketServerURL = url; 
         save();
@@ -230,13 +495,71 @@ public:
         beaconSW = beaconId; 
         save();
     }
+    void setRoomSize(float width, float height) { 
+        roomWidth = width; 
+        roomHeight = height; 
+        save();
+    }
+    void setPathLossExponent(float exponent) { 
+        pathLossExponent = exponent; 
+        save();
+    }
+    void setRssiAt1mNE(int rssi) { 
+        rssiAt1mNE = rssi; 
+        save();
+    }
+    void setRssiAt1mNW(int rssi) { 
+        rssiAt1mNW = rssi; 
+        save();
+    }
+    void setRssiAt1mSE(int rssi) { 
+        rssiAt1mSE = rssi; 
+        save();
+    }
+    void setRssiAt1mSW(int rssi) { 
+        rssiAt1mSW = rssi; 
+        save();
+    }
+    void setCoexPreference(int preference) { 
+        coexPreference = preference; 
+        save();
+    }
+    void setStaticIP(const String& ip, const String& gatewayIP, const String& subnetMask, const String& dnsIP) { 
+        staticIP = ip; 
+        gateway = gatewayIP; 
+        subnet = subnetMask; 
+        dns = dnsIP; 
+        save();
+    }
+    
+    // Remember the access point we joined. Called on every connect, so only
+    // these keys are written, and only when they actually changed.
+    void setLastAccessPoint(const String& ssid, const String& bssid, int channel) {
+        if (ssid == lastSSID && bssid == lastBSSID && channel == lastChannel) return;
+        lastSSID = ssid;
+        lastBSSID = bssid;
+        lastChannel = channel;
+        if (!preferences.begin(NVS_NAMESPACE, false)) return;
+        preferences.putString(KEY_LAST_SSID, lastSSID);
+        preferences.putString(KEY_LAST_BSSID, lastBSSID);
+        preferences.putInt(KEY_LAST_CHANNEL, lastChannel);
+        preferences.end();
+    }
     
     // Generate JSON string from current configuration
     String toJSON() const {
         JsonDocument doc;
         
-        doc["wifiSSID"] = wifiSSID;
-        doc["wifiPassword"] = wifiPassword;
+        doc["wifiSSID"] = primaryNetwork.ssid;
+        doc["wifiPassword"] = primaryNetwork.password;
+        doc["wifiPriority"] = primaryNetwork.priority;
+        JsonArray networks = doc["networks"].to<JsonArray>();
+        for (int i = 0; i < extraNetworkCount; ++i) {
+            JsonObject network = networks.add<JsonObject>();
+            network["ssid"] = extraNetworks[i].ssid;
+            network["password"] = extraNetworks[i].password;
+            network["priority"] = extraNetworks[i].priority;
+        }
         doc["socketServerURL"] = socketServerURL;
         doc["LEDPin"] = LEDPin;
         doc["motorPin"] = motorPin;
@@ -245,6 +568,18 @@ public:
         doc["beaconNW"] = beaconNW;
         doc["beaconSE"] = beaconSE;
         doc["beaconSW"] = beaconSW;
+        doc["roomWidth"] = roomWidth;
+        doc["roomHeight"] = roomHeight;
+        doc["pathLossExponent"] = pathLossExponent;
+        doc["rssiAt1mNE"] = rssiAt1mNE;
+        doc["rssiAt1mNW"] = rssiAt1mNW;
+        doc["rssiAt1mSE"] = rssiAt1mSE;
+        doc["rssiAt1mSW"] = rssiAt1mSW;
+        doc["coexPreference"] = coexPreference;
+        doc["staticIP"] = staticIP;
+        doc["gateway"] = gateway;
+        doc["subnet"] = subnet;
+        doc["dns"] = dns;
         
         String output;
         serializeJson(doc, output);
@@ -255,9 +590,18 @@ public:
     void printConfiguration() const {
         Serial.println("=== Configuration ===");
         Serial.print("WiFi SSID: ");
-        Serial.println(wifiSSID);
+        Serial.println(primaryNetwork.ssid);
         Serial.print("WiFi Password: ");
-        Serial.println(wifiPassword);
+        Serial.println(primaryNetwork.password);
+        Serial.print("WiFi Priority: ");
+        Serial.println(primaryNetwork.priority);
+        for (int i = 0; i < extraNetworkCount; ++i) {
+            Serial.print("Extra Network: ");
+            Serial.print(extraNetworks[i].ssid);
+            Serial.print(" (priority ");
+            Serial.print(extraNetworks[i].priority);
+            Serial.println(")");
+        }
         Serial.print("Socket Server URL: ");
         Serial.println(socketServerURL);
         Serial.print("LED Pin: ");
@@ -274,6 +618,42 @@ public:
         Serial.println(beaconSE);
         Serial.print("Beacon SW: ");
         Serial.println(beaconSW);
+        Serial.print("Room Size: ");
+        Serial.print(roomWidth);
+        Serial.print(" x ");
+        Serial.print(roomHeight);
+        Serial.println(" m");
+        Serial.print("Path Loss Exponent: ");
+        Serial.println(pathLossExponent);
+        Serial.print("RSSI at 1m (NE/NW/SE/SW): ");
+        Serial.print(rssiAt1mNE);
+        Serial.print(" / ");
+        Serial.print(rssiAt1mNW);
+        Serial.print(" / ");
+        Serial.print(rssiAt1mSE);
+        Serial.print(" / ");
+        Serial.println(rssiAt1mSW);
+        Serial.print("Coex Preference: ");
+        Serial.println(coexPreference);
+        Serial.print("Static IP: ");
+        Serial.println(staticIP.length() > 0 ? staticIP : String("DHCP"));
+        if (staticIP.length() > 0) {
+            Serial.print("Gateway / Subnet / DNS: ");
+            Serial.print(gateway);
+            Serial.print(" / ");
+            Serial.print(subnet);
+            Serial.print(" / ");
+            Serial.println(dns);
+        }
+        Serial.print("Last AP: ");
+        Serial.print(lastBSSID.length() > 0 ? lastBSSID : String("none"));
+        if (lastSSID.length() > 0) {
+            Serial.print(" (");
+            Serial.print(lastSSID);
+            Serial.print(")");
+        }
+        Serial.print(" channel ");
+        Serial.println(lastChannel);
         Serial.println("====================");
     }
 };
@@ -289,11 +669,18 @@ const String Configuration::DEFAULT_BEACON_NE = "64:e8:33:84:43:9a";
 const String Configuration::DEFAULT_BEACON_NW = "64:e8:33:87:0d:62";
 const String Configuration::DEFAULT_BEACON_SE = "98:3d:ae:aa:16:8a";
 const String Configuration::DEFAULT_BEACON_SW = "98:3d:ae:ab:b2:7a";
+const float Configuration::DEFAULT_ROOM_WIDTH = 10.0f;
+const float Configuration::DEFAULT_ROOM_HEIGHT = 10.0f;
+const float Configuration::DEFAULT_PATH_LOSS_EXPONENT = 2.5f;
+const int Configuration::DEFAULT_RSSI_AT_1M = 0;
+const String Configuration::DEFAULT_SUBNET = "255.255.255.0";
 
 // Define NVS key names
 const char* Configuration::NVS_NAMESPACE = "config";
 const char* Configuration::KEY_WIFI_SSID = "wifi_ssid";
 const char* Configuration::KEY_WIFI_PASSWORD = "wifi_pass";
+const char* Configuration::KEY_WIFI_PRIORITY = "wifi_prio";
+const char* Configuration::KEY_NETWORK_COUNT = "net_count";
 const char* Configuration::KEY_SOCKET_SERVER_URL = "socket_url";
 const char* Configuration::KEY_LED_PIN = "led_pin";
 const char* Configuration::KEY_MOTOR_PIN = "motor_pin";
@@ -302,6 +689,21 @@ const char* Configuration::KEY_BEACON_NE = "beacon_ne";
 const char* Configuration::KEY_BEACON_NW = "beacon_nw";
 const char* Configuration::KEY_BEACON_SE = "beacon_se";
 const char* Configuration::KEY_BEACON_SW = "beacon_sw";
+const char* Configuration::KEY_ROOM_WIDTH = "room_w";
+const char* Configuration::KEY_ROOM_HEIGHT = "room_h";
+const char* Configuration::KEY_PATH_LOSS_EXPONENT = "pl_exp";
+const char* Configuration::KEY_RSSI_1M_NE = "rssi1m_ne";
+const char* Configuration::KEY_RSSI_1M_NW = "rssi1m_nw";
+const char* Configuration::KEY_RSSI_1M_SE = "rssi1m_se";
+const char* Configuration::KEY_RSSI_1M_SW = "rssi1m_sw";
+const char* Configuration::KEY_COEX_PREFERENCE = "coex";
+const char* Configuration::KEY_STATIC_IP = "static_ip";
+const char* Configuration::KEY_GATEWAY = "gateway";
+const char* Configuration::KEY_SUBNET = "subnet";
+const char* Configuration::KEY_DNS = "dns";
+const char* Configuration::KEY_LAST_SSID = "last_ssid";
+const char* Configuration::KEY_LAST_BSSID = "last_bssid";
+const char* Configuration::KEY_LAST_CHANNEL = "last_channel";
 
 extern Configuration configuration;
 
@@ -0,0 +1,61 @@
+#ifndef LED_FRAME_H
+#define LED_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+
+// The pixels of one compositor layer, 8-bit RGB. Behaviors draw into a
+// frame with the calls they used on the strip (fill, clear, setPixelColor,
+// show); show() only marks the frame as new, LedCompositor blends the
+// layers and shows the strip once.
+class LedFrame {
+public:
+    LedFrame() : changed(false) {
+        clear();
+    }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return (uint32_t)r << 16 | (uint32_t)g << 8 | b;
+    }
+
+    uint16_t numPixels() const { return LED_COUNT; }
+
+    void setPixelColor(uint16_t n, uint32_t color) {
+        if (n >= LED_COUNT) return;
+        rgb[n][0] = (uint8_t)(color >> 16);
+        rgb[n][1] = (uint8_t)(color >> 8);
+        rgb[n][2] = (uint8_t)color;
+    }
+
+    uint32_t getPixelColor(uint16_t n) const {
+        if (n >= LED_COUNT) return 0;
+        return Color(rgb[n][0], rgb[n][1], rgb[n][2]);
+    }
+
+    void fill(uint32_t color) {
+        for (uint16_t i = 0; i < LED_COUNT; ++i) setPixelColor(i, color);
+    }
+
+    void clear() {
+        memset(rgb, 0, sizeof(rgb));
+    }
+
+    void show() {
+        changed = true;
+    }
+
+    // True once after each show()
+    bool takeChanged() {
+        bool wasChanged = changed;
+        changed = false;
+        return wasChanged;
+    }
+
+    uint8_t rgb[LED_COUNT][3];
+
+private:
+    bool changed;
+};
+
+#endif // LED_FRAME_H
@@ -0,0 +1,168 @@
+#ifndef LED_MATH_H
+#define LED_MATH_H
+
+#include <stdint.h>
+
+// Integer kernels for the LED animations. The ESP32-C3 has no FPU, so
+// float and double math in a behavior's update() all runs in software.
+
+// t / 255 rounded down, for t up to 255 * 255: the same result as the
+// division, without one
+constexpr uint8_t ledDiv255(uint32_t t) {
+    return (uint8_t)((t + 1 + (t >> 8)) >> 8);
+}
+
+// value * scale / 255, rounded down
+constexpr uint8_t ledScale8(uint8_t value, uint8_t scale) {
+    return ledDiv255((uint32_t)value * scale);
+}
+
+// Position in a period as a 16-bit phase, 65536 to the period
+inline uint16_t ledPhase16(uint32_t elapsed, uint32_t period) {
+    if (period == 0) return 0;
+    uint32_t offset = elapsed % period;
+    if (period <= 0xFFFF) return (uint16_t)((offset << 16) / period);
+    return (uint16_t)(((uint64_t)offset << 16) / period);
+}
+
+// Sine for building the table at compile time: a Taylor series, good to
+// well under 1e-9 over one period
+constexpr double ledTableSin(double x) {
+    const double pi = 3.14159265358979323846;
+    if (x > pi) x -= 2 * pi;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; ++n) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// (sin + 1) / 2 * 255 over one period in 256 steps, in 1/256ths, plus the
+// first entry again so the last step interpolates
+struct LedSineTable {
+    uint16_t values[257];
+};
+
+constexpr LedSineTable ledMakeSineTable() {
+    LedSineTable table{};
+    for (int i = 0; i <= 256; ++i) {
+        double wave = (ledTableSin(2 * 3.14159265358979323846 * (i % 256) / 256) + 1) / 2;
+        table.values[i] = (uint16_t)(wave * 255 * 256 + 0.5);
+    }
+    return table;
+}
+
+inline constexpr LedSineTable LED_SINE_TABLE = ledMakeSineTable();
+
+// (sin(2 pi phase / 65536) + 1) / 2 * 255 in 1/256ths, interpolated
+// between table entries
+inline uint16_t ledSineWave(uint16_t phase) {
+    uint16_t index = phase >> 8;
+    int32_t low = LED_SINE_TABLE.values[index];
+    int32_t high = LED_SINE_TABLE.values[index + 1];
+    return (uint16_t)(low + (((high - low) * (int32_t)(phase & 0xFF)) >> 8));
+}
+
+// x^g for x in [0, 1], for building tables at compile time: logarithm
+// and exponential series after reducing to a power of two
+constexpr double ledTablePow(double x, double g) {
+    if (x <= 0) return 0;
+    const double ln2 = 0.69314718055994530942;
+    int exponent = 0;
+    while (x < 0.5) {
+        x *= 2;
+        exponent--;
+    }
+    double z = (x - 1) / (x + 1);
+    double power = z;
+    double ln = 0;
+    for (int n = 1; n < 40; n += 2) {
+        ln += power / n;
+        power *= z * z;
+    }
+    double y = g * (2 * ln + exponent * ln2);
+
+    int halvings = 0;
+    while (y < 0) {
+        y += ln2;
+        halvings++;
+    }
+    double term = 1;
+    double result = 1;
+    for (int n = 1; n < 20; ++n) {
+        term *= y / n;
+        result += term;
+    }
+    for (int i = 0; i < halvings; ++i) result /= 2;
+    return result;
+}
+
+// Linear 8-bit level to output level under a gamma, in 1/256ths of a
+// step, so the fraction can be dithered
+struct LedGammaTable {
+    uint16_t values[256];
+};
+
+constexpr LedGammaTable ledMakeGammaTable(double gamma) {
+    LedGammaTable table{};
+    for (int i = 0; i < 256; ++i) {
+        table.values[i] = (uint16_t)(ledTablePow(i / 255.0, gamma) * 255 * 256 + 0.5);
+    }
+    return table;
+}
+
+// Q16.16 product, rounded; the spring's fixed-point steps
+inline int64_t ledMulQ16(int64_t a, int64_t b) {
+    return (a * b + 0x8000) >> 16;
+}
+
+// xorshift32: a few shifts per number, plenty random for sparkles. The
+// state must not be 0.
+inline uint32_t ledRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Random number in [0, range), from the top bits, without a division
+inline uint8_t ledRandom8(uint32_t& state, uint16_t range = 256) {
+    return (uint8_t)(((ledRandom(state) >> 24) * range) >> 8);
+}
+
+// a + b and a - b, clamped to 0-255
+constexpr uint8_t ledAdd8(uint8_t a, uint8_t b) {
+    return a + b > 255 ? 255 : (uint8_t)(a + b);
+}
+
+constexpr uint8_t ledSub8(uint8_t a, uint8_t b) {
+    return a > b ? (uint8_t)(a - b) : 0;
+}
+
+// Direction of (x, y) as a fraction of a turn, 256 to the circle,
+// counterclockwise from +x. atan(t) ~ pi/4 t + 0.273 t (1 - t) within an
+// octant, good to about two degrees.
+inline uint8_t ledAtan2_8(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) return 0;
+    uint32_t ax = x < 0 ? -x : x;
+    uint32_t ay = y < 0 ? -y : y;
+    bool steep = ay > ax;
+    uint32_t t = steep ? (ax << 8) / ay : (ay << 8) / ax;    // Q8, 0-256
+    uint32_t angle = (t * 32 + ((11 * t * (256 - t)) >> 8)) >> 8; // 0-32
+    if (steep) angle = 64 - angle;
+    if (x < 0) angle = 128 - angle;
+    if (y < 0) angle = 256 - angle;
+    return (uint8_t)angle;
+}
+
+// Length of (x, y) without a square root: the larger plus 3/8 of the
+// smaller, within 7%
+inline uint32_t ledHypot(int32_t x, int32_t y) {
+    uint32_t ax = x < 0 ? -x : x;
+    uint32_t ay = y < 0 ? -y : y;
+    return ax > ay ? ax + (ay * 3 >> 3) : ay + (ax * 3 >> 3);
+}
+
+#endif // LED_MATH_H
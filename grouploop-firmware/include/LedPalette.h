@@ -0,0 +1,94 @@
+#ifndef LED_PALETTE_H
+#define LED_PALETTE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// 256-entry color tables for the procedural LED effects, built at compile
+// time from a few gradient stops and kept in flash. An effect works out an
+// 8-bit index per pixel and looks the color up; it never blends colors
+// itself.
+
+struct LedPalette {
+    uint8_t rgb[256][3];
+};
+
+struct LedPaletteStop {
+    uint8_t position;       // index the color is at, the first 0, the last 255
+    uint32_t color;         // 0xRRGGBB
+};
+
+// Straight fades between the stops
+template <size_t N>
+constexpr LedPalette ledMakePalette(const LedPaletteStop (&stops)[N]) {
+    LedPalette palette{};
+    size_t stop = 0;
+    for (int i = 0; i < 256; ++i) {
+        while (stop + 2 < N && i > stops[stop + 1].position) stop++;
+        const LedPaletteStop& from = stops[stop];
+        const LedPaletteStop& to = stops[stop + 1];
+        int span = to.position - from.position;
+        int t = span > 0 ? (i - from.position) * 256 / span : 0;
+        for (int c = 0; c < 3; ++c) {
+            int shift = 16 - 8 * c;
+            int a = (from.color >> shift) & 0xFF;
+            int b = (to.color >> shift) & 0xFF;
+            palette.rgb[i][c] = (uint8_t)(a + (b - a) * t / 256);
+        }
+    }
+    return palette;
+}
+
+inline constexpr LedPaletteStop LED_RAINBOW_STOPS[] = {
+    {0, 0xFF0000}, {43, 0xFFFF00}, {85, 0x00FF00}, {128, 0x00FFFF},
+    {170, 0x0000FF}, {213, 0xFF00FF}, {255, 0xFF0000},
+};
+inline constexpr LedPaletteStop LED_FIRE_STOPS[] = {
+    {0, 0x000000}, {80, 0xA00000}, {150, 0xFF4000}, {210, 0xFFB000}, {255, 0xFFFFA0},
+};
+inline constexpr LedPaletteStop LED_OCEAN_STOPS[] = {
+    {0, 0x000010}, {96, 0x0020A0}, {176, 0x00A0C0}, {255, 0xC0FFFF},
+};
+inline constexpr LedPaletteStop LED_FOREST_STOPS[] = {
+    {0, 0x001000}, {96, 0x006010}, {176, 0x60A000}, {255, 0xD0FF60},
+};
+
+inline constexpr LedPalette LED_PALETTE_RAINBOW = ledMakePalette(LED_RAINBOW_STOPS);
+inline constexpr LedPalette LED_PALETTE_FIRE = ledMakePalette(LED_FIRE_STOPS);
+inline constexpr LedPalette LED_PALETTE_OCEAN = ledMakePalette(LED_OCEAN_STOPS);
+inline constexpr LedPalette LED_PALETTE_FOREST = ledMakePalette(LED_FOREST_STOPS);
+
+// Palettes by name for the palette command; "mono" is no table, the
+// effects then use shades of the behavior's color
+struct LedPaletteEntry {
+    const char* name;
+    const LedPalette* palette;
+};
+
+inline constexpr LedPaletteEntry LED_PALETTES[] = {
+    {"rainbow", &LED_PALETTE_RAINBOW},
+    {"fire", &LED_PALETTE_FIRE},
+    {"ocean", &LED_PALETTE_OCEAN},
+    {"forest", &LED_PALETTE_FOREST},
+    {"mono", nullptr},
+};
+
+inline bool ledFindPalette(const char* name, const LedPalette*& palette) {
+    for (const LedPaletteEntry& entry : LED_PALETTES) {
+        if (strcmp(entry.name, name) == 0) {
+            palette = entry.palette;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline const char* ledPaletteName(const LedPalette* palette) {
+    for (const LedPaletteEntry& entry : LED_PALETTES) {
+        if (entry.palette == palette) return entry.name;
+    }
+    return "";
+}
+
+#endif // LED_PALETTE_H
@@ -0,0 +1,152 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "Arduino.h"
+#include "config.h"
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include "LogFormat.h"
+
+// Levels, lowest number = most important
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Messages above LOG_LEVEL are compiled out entirely (format strings
+// included). Set it per build with -DLOG_LEVEL=<n>; see platformio.ini.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Messages at or below this level are also echoed to Serial at runtime.
+// Everything that is compiled in goes to the RAM ring, and can be uploaded
+// over the WebSocket (see LogProcess.h).
+#ifndef LOG_SERIAL_LEVEL
+#define LOG_SERIAL_LEVEL LOG_LEVEL
+#endif
+
+// Per call site rate limit for the *_EVERY macros. Counts what it
+// suppressed so the next line that gets through can report it.
+struct LogRateLimit {
+    unsigned long lastAt = 0;
+    uint32_t suppressed = 0;
+    bool started = false;
+
+    bool allow(unsigned long intervalMs, uint32_t& skipped) {
+        unsigned long now = millis();
+        if (started && now - lastAt < intervalMs) {
+            suppressed++;
+            return false;
+        }
+        started = true;
+        lastAt = now;
+        skipped = suppressed;
+        suppressed = 0;
+        return true;
+    }
+};
+
+// Keeps binary records (see LogFormat.h) in a RAM ring, oldest records
+// overwritten first. Writing a record only copies the arguments; text is
+// produced when the ring is dumped, echoed to Serial, or decoded on a host
+// from an uploaded copy. Safe to call from the network task.
+class Logger {
+public:
+    template <typename... Args>
+    void write(uint8_t level, const char* format, Args... args) {
+        writeLimited(level, 0, format, args...);
+    }
+
+    // Same, noting how many messages the call site's rate limit dropped
+    template <typename... Args>
+    void writeLimited(uint8_t level, uint32_t suppressed, const char* format, Args... args) {
+        uint8_t record[LOG_RECORD_MAX];
+        LogRecordWriter writer(record, sizeof(record));
+        writer.begin(level, suppressed, millis(), format);
+        logAddArgs(writer, args...);
+        commit(level, record, writer.finish());
+    }
+
+    // Print the ring, oldest record first
+    void dump();
+    void clear();
+
+    // Copy the record at absolute position 'position' (moved forward to
+    // the oldest record if it was overwritten) and advance past it.
+    // Returns the record length, 0 once 'position' reaches the head.
+    size_t readRecord(uint32_t& position, uint8_t* out, size_t size);
+    uint32_t getHeadPosition();
+
+    // True once after any error was logged
+    bool takeErrorFlag();
+
+    void setSerialLevel(uint8_t level) { serialLevel = level; }
+    uint8_t getSerialLevel() const { return serialLevel; }
+    uint32_t getOverwrittenCount() const { return overwritten; }
+
+    static const char* levelName(uint8_t level);
+    static bool parseLevel(const String& name, uint8_t& level);
+
+private:
+    void commit(uint8_t level, const uint8_t* record, size_t length);
+    static void printRecord(const uint8_t* record, size_t length);
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t ring[LOG_RING_SIZE];
+    // Absolute byte positions; index into ring modulo LOG_RING_SIZE
+    uint32_t headPos = 0;
+    uint32_t tailPos = 0;
+    uint32_t overwritten = 0;       // records dropped to make room
+    volatile bool errorLogged = false;
+    uint8_t serialLevel = LOG_SERIAL_LEVEL;
+};
+
+// Global logger instance
+extern Logger logger;
+
+// Never called; lets the compiler check the format against the arguments
+static inline void logCheckFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+static inline void logCheckFormat(const char*, ...) {}
+
+#define LOG_EVERY_(level, intervalMs, ...) do { \
+        static LogRateLimit logLimit_; \
+        uint32_t logSkipped_; \
+        if (0) logCheckFormat(__VA_ARGS__); \
+        if (logLimit_.allow(intervalMs, logSkipped_)) logger.writeLimited(level, logSkipped_, __VA_ARGS__); \
+    } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) do { if (0) logCheckFormat(__VA_ARGS__); logger.write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#define LOG_ERROR_EVERY(intervalMs, ...) LOG_EVERY_(LOG_LEVEL_ERROR, intervalMs, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#define LOG_ERROR_EVERY(intervalMs, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) do { if (0) logCheckFormat(__VA_ARGS__); logger.write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#define LOG_WARN_EVERY(intervalMs, ...) LOG_EVERY_(LOG_LEVEL_WARN, intervalMs, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#define LOG_WARN_EVERY(intervalMs, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) do { if (0) logCheckFormat(__VA_ARGS__); logger.write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#define LOG_INFO_EVERY(intervalMs, ...) LOG_EVERY_(LOG_LEVEL_INFO, intervalMs, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#define LOG_INFO_EVERY(intervalMs, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) do { if (0) logCheckFormat(__VA_ARGS__); logger.write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#define LOG_DEBUG_EVERY(intervalMs, ...) LOG_EVERY_(LOG_LEVEL_DEBUG, intervalMs, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#define LOG_DEBUG_EVERY(intervalMs, ...) do {} while (0)
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,326 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <type_traits>
+
+// Binary log record format, shared by the firmware (Log.h) and the host
+// decoder (host/logdecode). A record stores the address of its format
+// string instead of the text, plus the raw arguments; formatting happens
+// later, on the device when the log is dumped or on a host that reads the
+// format strings from the firmware ELF.
+//
+// Layout, little-endian:
+//   0  uint8   record length, header included
+//   1  uint8   level
+//   2  uint8   argument count
+//   3  uint16  messages suppressed by the call site's rate limit
+//   5  uint32  timestamp, millis()
+//   9  uintN   format string address (4 bytes on the ESP32)
+//   .. arguments, each a tag byte followed by its value:
+//        LOG_ARG_INT32   4 bytes
+//        LOG_ARG_INT64   8 bytes
+//        LOG_ARG_DOUBLE  8 bytes (IEEE 754 bits)
+//        LOG_ARG_STRING  uint8 length + bytes (no terminator)
+
+#define LOG_RECORD_HEADER_SIZE 9 // without the format address
+
+#define LOG_ARG_INT32 1
+#define LOG_ARG_INT64 2
+#define LOG_ARG_DOUBLE 3
+#define LOG_ARG_STRING 4
+
+#ifndef LOG_STRING_MAX
+#define LOG_STRING_MAX 32 // String arguments are truncated to this
+#endif
+
+static inline void logPutLE(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline uint64_t logGetLE(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+// Builds one record into a caller buffer. Arguments that don't fit are
+// left out; the decoder prints them as '?'.
+class LogRecordWriter {
+public:
+    LogRecordWriter(uint8_t* buffer, size_t capacity)
+        : data(buffer), capacity(capacity > 255 ? 255 : capacity), length(0), argCount(0), full(false) {}
+
+    void begin(uint8_t level, uint32_t suppressed, uint32_t timestamp, const void* format) {
+        data[1] = level;
+        logPutLE(data + 3, suppressed > 0xFFFF ? 0xFFFF : suppressed, 2);
+        logPutLE(data + 5, timestamp, 4);
+        logPutLE(data + LOG_RECORD_HEADER_SIZE, (uintptr_t)format, sizeof(uintptr_t));
+        length = LOG_RECORD_HEADER_SIZE + sizeof(uintptr_t);
+    }
+
+    void addInteger(int64_t value) {
+        if (value >= INT32_MIN && value <= INT32_MAX) {
+            if (!reserve(5)) return;
+            data[length] = LOG_ARG_INT32;
+            logPutLE(data + length + 1, (uint64_t)value, 4);
+            length += 5;
+        } else {
+            if (!reserve(9)) return;
+            data[length] = LOG_ARG_INT64;
+            logPutLE(data + length + 1, (uint64_t)value, 8);
+            length += 9;
+        }
+        argCount++;
+    }
+
+    // Values above INT32_MAX need the 64-bit slot even when they came from
+    // a 32-bit unsigned; the formatter narrows INT32 values for %u/%x
+    void addUnsigned(uint64_t value) {
+        if (value <= INT32_MAX) {
+            addInteger((int64_t)value);
+            return;
+        }
+        if (!reserve(9)) return;
+        data[length] = LOG_ARG_INT64;
+        logPutLE(data + length + 1, value, 8);
+        length += 9;
+        argCount++;
+    }
+
+    void addReal(double value) {
+        if (!reserve(9)) return;
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        data[length] = LOG_ARG_DOUBLE;
+        logPutLE(data + length + 1, bits, 8);
+        length += 9;
+        argCount++;
+    }
+
+    void addString(const char* text) {
+        if (!text) text = "(null)";
+        size_t textLength = 0;
+        while (textLength < LOG_STRING_MAX && text[textLength]) textLength++;
+        if (!reserve(2 + textLength)) return;
+        data[length] = LOG_ARG_STRING;
+        data[length + 1] = (uint8_t)textLength;
+        memcpy(data + length + 2, text, textLength);
+        length += 2 + textLength;
+        argCount++;
+    }
+
+    // Completes the header; returns the record length
+    size_t finish() {
+        data[0] = (uint8_t)length;
+        data[2] = argCount;
+        return length;
+    }
+
+private:
+    bool reserve(size_t bytes) {
+        if (full || length + bytes > capacity) {
+            full = true;
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t* data;
+    size_t capacity;
+    size_t length;
+    uint8_t argCount;
+    bool full;
+};
+
+// Argument encoding by type, picked at compile time
+template <typename T>
+static inline typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) || std::is_enum<T>::value>::type
+logAddArg(LogRecordWriter& writer, T value) {
+    writer.addInteger((int64_t)value);
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+logAddArg(LogRecordWriter& writer, T value) {
+    writer.addUnsigned((uint64_t)value);
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+logAddArg(LogRecordWriter& writer, T value) {
+    writer.addReal((double)value);
+}
+
+static inline void logAddArg(LogRecordWriter& writer, const char* value) { writer.addString(value); }
+static inline void logAddArg(LogRecordWriter& writer, char* value) { writer.addString(value); }
+static inline void logAddArg(LogRecordWriter& writer, const void* value) { writer.addInteger((int64_t)(uintptr_t)value); }
+
+static inline void logAddArgs(LogRecordWriter&) {}
+
+template <typename T, typename... Rest>
+static inline void logAddArgs(LogRecordWriter& writer, T value, Rest... rest) {
+    logAddArg(writer, value);
+    logAddArgs(writer, rest...);
+}
+
+// A parsed record; 'args' points into the record bytes
+struct LogRecordView {
+    uint8_t level;
+    uint8_t argCount;
+    uint16_t suppressed;
+    uint32_t timestamp;
+    uint64_t formatAddress;
+    const uint8_t* args;
+    size_t argsLength;
+};
+
+// 'addressBytes' is the target's pointer size: sizeof(uintptr_t) on the
+// device, the ELF class on the host
+static inline bool logParseRecord(const uint8_t* data, size_t available, size_t addressBytes, LogRecordView& view) {
+    size_t headerSize = LOG_RECORD_HEADER_SIZE + addressBytes;
+    if (available < headerSize || data[0] < headerSize || data[0] > available) return false;
+    view.level = data[1];
+    view.argCount = data[2];
+    view.suppressed = (uint16_t)logGetLE(data + 3, 2);
+    view.timestamp = (uint32_t)logGetLE(data + 5, 4);
+    view.formatAddress = logGetLE(data + LOG_RECORD_HEADER_SIZE, addressBytes);
+    view.args = data + headerSize;
+    view.argsLength = data[0] - headerSize;
+    return true;
+}
+
+struct LogArgValue {
+    uint8_t tag;
+    int64_t integer;
+    double real;
+    char text[LOG_STRING_MAX + 1];
+};
+
+static inline bool logReadArg(const LogRecordView& view, size_t& offset, LogArgValue& arg) {
+    if (offset >= view.argsLength) return false;
+    const uint8_t* p = view.args + offset;
+    size_t remaining = view.argsLength - offset;
+    arg.tag = p[0];
+    switch (arg.tag) {
+        case LOG_ARG_INT32:
+            if (remaining < 5) return false;
+            arg.integer = (int32_t)(uint32_t)logGetLE(p + 1, 4);
+            offset += 5;
+            return true;
+        case LOG_ARG_INT64:
+            if (remaining < 9) return false;
+            arg.integer = (int64_t)logGetLE(p + 1, 8);
+            offset += 9;
+            return true;
+        case LOG_ARG_DOUBLE: {
+            if (remaining < 9) return false;
+            uint64_t bits = logGetLE(p + 1, 8);
+            memcpy(&arg.real, &bits, sizeof(bits));
+            offset += 9;
+            return true;
+        }
+        case LOG_ARG_STRING: {
+            if (remaining < 2 || p[1] > LOG_STRING_MAX || remaining < 2u + p[1]) return false;
+            memcpy(arg.text, p + 2, p[1]);
+            arg.text[p[1]] = '\0';
+            offset += 2 + p[1];
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Expand 'format' with the record's arguments, one conversion at a time.
+// Length modifiers in the format are ignored: values are printed from
+// their recorded width. Returns the formatted length.
+static inline size_t logFormatMessage(char* out, size_t size, const char* format, const LogRecordView& view) {
+    if (size == 0) return 0;
+    size_t length = 0;
+    size_t offset = 0;
+    uint8_t index = 0;
+    const char* p = format;
+    while (*p && length < size - 1) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        char spec[16];
+        size_t specLength = 0;
+        spec[specLength++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && specLength < sizeof(spec) - 4) spec[specLength++] = *p++;
+        while (*p && strchr("hlLzjtq", *p)) p++;
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+
+        LogArgValue arg;
+        bool have = index < view.argCount && logReadArg(view, offset, arg);
+        index++;
+        char* dest = out + length;
+        size_t room = size - length;
+        int written;
+        if (!have) {
+            written = snprintf(dest, room, "?");
+        } else if (strchr("di", conversion)) {
+            memcpy(spec + specLength, "lld", 4);
+            written = snprintf(dest, room, spec, (long long)(arg.tag == LOG_ARG_DOUBLE ? (int64_t)arg.real : arg.integer));
+        } else if (strchr("uxXo", conversion)) {
+            // A negative 32-bit value prints as its 32-bit pattern, like on the device
+            unsigned long long value = arg.tag == LOG_ARG_INT32 ? (uint32_t)arg.integer : (uint64_t)arg.integer;
+            spec[specLength++] = 'l';
+            spec[specLength++] = 'l';
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            written = snprintf(dest, room, spec, value);
+        } else if (conversion == 'c') {
+            memcpy(spec + specLength, "c", 2);
+            written = snprintf(dest, room, spec, (int)arg.integer);
+        } else if (conversion == 'p') {
+            written = snprintf(dest, room, "0x%llx", (unsigned long long)arg.integer);
+        } else if (strchr("fFeEgGaA", conversion)) {
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            written = snprintf(dest, room, spec, arg.tag == LOG_ARG_DOUBLE ? arg.real : (double)arg.integer);
+        } else if (conversion == 's') {
+            memcpy(spec + specLength, "s", 2);
+            written = snprintf(dest, room, spec, arg.tag == LOG_ARG_STRING ? arg.text : "?");
+        } else {
+            written = snprintf(dest, room, "?");
+        }
+        if (written < 0) break;
+        length += (size_t)written < room ? (size_t)written : room - 1;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+static inline char logLevelLetter(uint8_t level) {
+    static const char letters[] = "-EWID";
+    return level < sizeof(letters) - 1 ? letters[level] : 'D';
+}
+
+// One display line: "<millis> <level letter> <message>[ (N suppressed)]"
+static inline size_t logFormatLine(char* out, size_t size, const char* format, const LogRecordView& view) {
+    if (size == 0) return 0;
+    int prefix = snprintf(out, size, "%8lu %c ", (unsigned long)view.timestamp, logLevelLetter(view.level));
+    if (prefix < 0 || (size_t)prefix >= size) return size - 1;
+    size_t length = prefix + logFormatMessage(out + prefix, size - prefix, format, view);
+    if (view.suppressed > 0 && length < size - 1) {
+        int extra = snprintf(out + length, size - length, " (%u suppressed)", (unsigned)view.suppressed);
+        if (extra > 0) length += (size_t)extra < size - length ? (size_t)extra : size - length - 1;
+    }
+    return length;
+}
+
+#endif // LOG_FORMAT_H
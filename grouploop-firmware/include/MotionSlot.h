@@ -0,0 +1,75 @@
+#ifndef MOTION_SLOT_H
+#define MOTION_SLOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// The latest IMU reading, in integer units for the LED behaviors
+struct MotionSample {
+    int16_t x;              // acceleration, mg
+    int16_t y;
+    int16_t z;
+    uint16_t motion;        // |magnitude - 1 g|, mg: 0 at rest
+    uint32_t taps;          // taps since boot
+    uint32_t time;          // millis() of the reading
+};
+
+// Hands the newest MotionSample from IMUProcess (the main loop) to the LED
+// behaviors (the LED ticker) without a lock: a sequence lock with one
+// writer. The writer makes the sequence odd, writes, and makes it even
+// again; a reader copies the sample and keeps it only if the sequence was
+// even and unchanged around the copy. Neither side ever waits on the
+// other, and a reader always gets a whole sample, never half of two.
+class MotionSlot {
+public:
+    MotionSlot() : sequence(0) {
+        for (int i = 0; i < 4; ++i) words[i] = 0;
+    }
+
+    // Writer side; one writer only
+    void publish(const MotionSample& sample) {
+        uint32_t next = sequence.load(std::memory_order_relaxed) + 1;
+        sequence.store(next, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        words[0] = (uint16_t)sample.x | (uint32_t)(uint16_t)sample.y << 16;
+        words[1] = (uint16_t)sample.z | (uint32_t)sample.motion << 16;
+        words[2] = sample.taps;
+        words[3] = sample.time;
+        sequence.store(next + 1, std::memory_order_release);
+    }
+
+    // False if nothing was published yet, or the writer kept getting in
+    // the way (a few retries; the next frame tries again)
+    bool read(MotionSample& sample) const {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue;
+            uint32_t copy[4];
+            for (int i = 0; i < 4; ++i) copy[i] = words[i];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) != before) continue;
+            sample.x = (int16_t)(copy[0] & 0xFFFF);
+            sample.y = (int16_t)(copy[0] >> 16);
+            sample.z = (int16_t)(copy[1] & 0xFFFF);
+            sample.motion = (uint16_t)(copy[1] >> 16);
+            sample.taps = copy[2];
+            sample.time = copy[3];
+            return true;
+        }
+        return false;
+    }
+
+    // Changes with every sample; a reader can tell whether it has seen it
+    uint32_t getSequence() const {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<uint32_t> sequence;
+    volatile uint32_t words[4];
+};
+
+extern MotionSlot motionSlot;
+
+#endif // MOTION_SLOT_H
@@ -0,0 +1,201 @@
+#ifndef POSITIONING_H
+#define POSITIONING_H
+
+#include <math.h>
+
+// Number of beacon anchors (NW, NE, SE, SW)
+#define ANCHOR_COUNT 4
+
+// Motion (deviation of |a| from 1 g) below which the device counts as still
+#define STILL_THRESHOLD_G 0.08f
+// Kalman process noise for a still / moving device (m^2/s^3)
+#define STILL_PROCESS_NOISE 0.001f
+#define MOVING_PROCESS_NOISE 0.5f
+// Velocity variance after a zero-velocity update ((m/s)^2)
+#define ZUPT_VELOCITY_VARIANCE 0.01f
+
+// Anchor position in room coordinates (meters). x grows east, y grows south,
+// so NW is the origin, matching the simulator's top-left convention.
+struct Anchor {
+    float x;
+    float y;
+};
+
+// Result of a position estimate
+struct PositionFix {
+    float x;            // meters from the west wall
+    float y;            // meters from the north wall
+    float confidence;   // 0.0 (unknown) .. 1.0 (very certain)
+    bool valid;
+};
+
+// --- Log-distance path-loss model ---
+// rssi = rssiAt1m - 10 * n * log10(d)  =>  d = 10 ^ ((rssiAt1m - rssi) / (10 * n))
+inline float rssiToDistance(int rssi, int rssiAt1m, float exponent) {
+    if (exponent <= 0.0f) exponent = 2.0f;
+    return powf(10.0f, (float)(rssiAt1m - rssi) / (10.0f * exponent));
+}
+
+// --- Weighted least-squares trilateration ---
+// Gauss-Newton on the range equations, starting from a weighted centroid.
+// Ranges are weighted by 1/d^2 because log-normal shadowing makes the range
+// error grow proportionally with distance. Returns false when fewer than
+// three anchors are available. 'rmsError' receives the weighted RMS range
+// residual in meters.
+inline bool trilaterate(const Anchor* anchors, const float* distances, const bool* present, int count,
+                        float& x, float& y, float& rmsError) {
+    float w[ANCHOR_COUNT];
+    int used = 0;
+    float sumW = 0.0f, cx = 0.0f, cy = 0.0f;
+    for (int i = 0; i < count && i < ANCHOR_COUNT; ++i) {
+        if (!present[i] || distances[i] <= 0.0f) { w[i] = 0.0f; continue; }
+        float d = distances[i] < 0.1f ? 0.1f : distances[i];
+        w[i] = 1.0f / (d * d);
+        // Centroid uses 1/d so the closest anchors pull the starting point
+        float cw = 1.0f / d;
+        cx += anchors[i].x * cw;
+        cy += anchors[i].y * cw;
+        sumW += cw;
+        used++;
+    }
+    if (used < 3) return false;
+
+    x = cx / sumW;
+    y = cy / sumW;
+
+    for (int iter = 0; iter < 8; ++iter) {
+        // Normal equations (J^T W J) delta = -J^T W r for a 2D point
+        float a11 = 0.0f, a12 = 0.0f, a22 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+        for (int i = 0; i < count && i < ANCHOR_COUNT; ++i) {
+            if (w[i] == 0.0f) continue;
+            float dx = x - anchors[i].x;
+            float dy = y - anchors[i].y;
+            float range = sqrtf(dx * dx + dy * dy);
+            if (range < 1e-3f) range = 1e-3f;
+            float jx = dx / range;
+            float jy = dy / range;
+            float r = range - distances[i];
+            a11 += w[i] * jx * jx;
+            a12 += w[i] * jx * jy;
+            a22 += w[i] * jy * jy;
+            b1 -= w[i] * jx * r;
+            b2 -= w[i] * jy * r;
+        }
+        float det = a11 * a22 - a12 * a12;
+        if (fabsf(det) < 1e-9f) break;
+        float stepX = (a22 * b1 - a12 * b2) / det;
+        float stepY = (a11 * b2 - a12 * b1) / det;
+        x += stepX;
+        y += stepY;
+        if (fabsf(stepX) < 0.01f && fabsf(stepY) < 0.01f) break;
+    }
+
+    float sumSq = 0.0f, sumWr = 0.0f;
+    for (int i = 0; i < count && i < ANCHOR_COUNT; ++i) {
+        if (w[i] == 0.0f) continue;
+        float dx = x - anchors[i].x;
+        float dy = y - anchors[i].y;
+        float r = sqrtf(dx * dx + dy * dy) - distances[i];
+        sumSq += w[i] * r * r;
+        sumWr += w[i];
+    }
+    rmsError = sqrtf(sumSq / sumWr);
+    return true;
+}
+
+// --- Constant-velocity Kalman filter ---
+// The x and y axes are independent (diagonal measurement noise), so each axis
+// runs its own 2-state [position, velocity] filter. IMU motion drives the
+// process noise: a device lying still gets a near-zero velocity prior
+// (zero-velocity update), a device being carried around is allowed to move.
+class PositionFilter {
+public:
+    PositionFilter() { reset(); }
+
+    void reset() {
+        initialized = false;
+        axisX = Axis();
+        axisY = Axis();
+    }
+
+    // dt in seconds, motion in g (deviation of |a| from 1 g)
+    void predict(float dt, float motion) {
+        if (!initialized || dt <= 0.0f) return;
+        float q = motion > STILL_THRESHOLD_G ? MOVING_PROCESS_NOISE : STILL_PROCESS_NOISE;
+        axisX.predict(dt, q);
+        axisY.predict(dt, q);
+        if (motion <= STILL_THRESHOLD_G) {
+            axisX.zeroVelocity();
+            axisY.zeroVelocity();
+        }
+    }
+
+    // Measurement variance in m^2
+    void update(float x, float y, float variance) {
+        if (!initialized) {
+            axisX.init(x, variance);
+            axisY.init(y, variance);
+            initialized = true;
+            return;
+        }
+        axisX.update(x, variance);
+        axisY.update(y, variance);
+    }
+
+    bool isInitialized() const { return initialized; }
+    float getX() const { return axisX.p; }
+    float getY() const { return axisY.p; }
+
+    // Map the positional standard deviation to 0..1 (1 m std-dev -> 0.5)
+    float getConfidence() const {
+        if (!initialized) return 0.0f;
+        float sigma = sqrtf(axisX.P00 + axisY.P00);
+        return 1.0f / (1.0f + sigma);
+    }
+
+private:
+    struct Axis {
+        float p = 0.0f, v = 0.0f;
+        float P00 = 0.0f, P01 = 0.0f, P11 = 0.0f;
+
+        void init(float z, float r) {
+            p = z; v = 0.0f;
+            P00 = r; P01 = 0.0f; P11 = 1.0f;
+        }
+
+        void predict(float dt, float q) {
+            p += v * dt;
+            // P = F P F^T + Q, with Q from a white-noise acceleration model
+            float dt2 = dt * dt;
+            float n00 = P00 + dt * (2.0f * P01 + dt * P11) + q * dt2 * dt / 3.0f;
+            float n01 = P01 + dt * P11 + q * dt2 / 2.0f;
+            float n11 = P11 + q * dt;
+            P00 = n00; P01 = n01; P11 = n11;
+        }
+
+        void update(float z, float r) {
+            float s = P00 + r;
+            float k0 = P00 / s;
+            float k1 = P01 / s;
+            float innovation = z - p;
+            p += k0 * innovation;
+            v += k1 * innovation;
+            float n00 = (1.0f - k0) * P00;
+            float n01 = (1.0f - k0) * P01;
+            float n11 = P11 - k1 * P01;
+            P00 = n00; P01 = n01; P11 = n11;
+        }
+
+        void zeroVelocity() {
+            v = 0.0f;
+            P01 = 0.0f;
+            P11 = ZUPT_VELOCITY_VARIANCE;
+        }
+    };
+
+    bool initialized;
+    Axis axisX;
+    Axis axisY;
+};
+
+#endif // POSITIONING_H
@@ -15,12 +15,22 @@ public:
     virtual ~Process() {}
     virtual void setup() { }
     virtual void update() = 0;
-    virtual String getState() { return String(); }
+    virtual const char* getState() { return ""; }
+    // Called when a running process is halted: update() stops being
+    // called, so stop anything it would have stopped later (a scan, a timer)
+    virtual void onHalt() { }
     
     // State management methods
     bool isProcessRunning() const { return isRunning; }
-    void setRunning(bool running) { isRunning = running; }
-    void halt() { isRunning = false; }
+    void setRunning(bool running) {
+        if (running) start();
+        else halt();
+    }
+    void halt() {
+        if (!isRunning) return;
+        isRunning = false;
+        onHalt();
+    }
     void start() { isRunning = true; }
     
     // ProcessManager reference
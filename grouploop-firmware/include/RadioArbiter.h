@@ -0,0 +1,164 @@
+#ifndef RADIO_ARBITER_H
+#define RADIO_ARBITER_H
+
+#include "Arduino.h"
+#include "config.h"
+#include <esp_coexist.h>
+
+// Which side the coexistence arbiter favours when WiFi and BLE want the
+// shared 2.4 GHz radio at the same time
+enum class CoexPreference { BALANCE = 0, WIFI = 1, BLE = 2 };
+
+// Uplink send timing, split by whether a BLE scan was running
+struct UplinkTiming {
+    uint32_t sends;
+    uint32_t sendTotalUs;       // time spent inside sendMessage()
+    uint32_t sendMaxUs;
+    uint32_t jitterTotalMs;     // |interval between sends - publish period|
+    uint32_t jitterMaxMs;
+};
+
+// Shares the ESP32-C3's single radio between the WiFi uplink and BLE
+// scanning. PublishProcess reports its period and brackets every send;
+// BLEProcess only starts a scan right after a publish slot and uses a scan
+// interval equal to the publish period, with a window RADIO_UPLINK_GUARD_MS
+// shorter. That caps BLE at (period - guard) / period of the radio time and
+// leaves at least RADIO_UPLINK_GUARD_MS free in every period. It is not a
+// phase lock: only the first window starts in the gap after a frame. The
+// controller's interval and the loop's publish timer run on different
+// clocks, and the loop adds jitter, so later windows drift across the
+// publish slots. A frame that lands in a window is sent by the coexistence
+// arbiter, which may delay it; the "during scan" timing shows by how much.
+class RadioArbiter {
+public:
+    RadioArbiter()
+        : publishPeriodMs(0)
+        , lastSlotAt(0)
+        , sendStartedUs(0)
+        , scanActive(false)
+        , preference(CoexPreference::BALANCE)
+    {
+        resetStats();
+    }
+
+    // --- Uplink side ---
+
+    void setPublishPeriod(unsigned long periodMs) { publishPeriodMs = periodMs; }
+    unsigned long getPublishPeriod() const { return publishPeriodMs; }
+
+    void beginSend() { sendStartedUs = micros(); }
+
+    void endSend() {
+        uint32_t durationUs = micros() - sendStartedUs;
+        unsigned long now = millis();
+        UplinkTiming& timing = scanActive ? inScan : outsideScan;
+        timing.sends++;
+        timing.sendTotalUs += durationUs;
+        if (durationUs > timing.sendMaxUs) timing.sendMaxUs = durationUs;
+        // Interval jitter only makes sense between consecutive frames
+        if (lastSlotAt != 0 && now - lastSlotAt < 4 * publishPeriodMs) {
+            long interval = (long)(now - lastSlotAt);
+            uint32_t jitter = (uint32_t)labs(interval - (long)publishPeriodMs);
+            timing.jitterTotalMs += jitter;
+            if (jitter > timing.jitterMaxMs) timing.jitterMaxMs = jitter;
+        }
+        lastSlotAt = now;
+    }
+
+    // --- BLE side ---
+
+    // True when the uplink is idle, or a frame has just gone out so a scan
+    // started now has the whole gap until the next slot
+    bool scanSlotOpen() const {
+        if (!uplinkActive()) return true;
+        return millis() - lastSlotAt <= RADIO_SLOT_GRACE_MS;
+    }
+
+    // Scan interval/window (ms) to use for the next scan: the publish
+    // period, minus the guard for the window, as a duty cycle
+    void getScanTiming(uint16_t& intervalMs, uint16_t& windowMs) const {
+        if (!uplinkActive() || publishPeriodMs <= RADIO_UPLINK_GUARD_MS + RADIO_MIN_SCAN_WINDOW_MS) {
+            intervalMs = BLE_SCAN_INTERVAL;
+            windowMs = BLE_SCAN_WINDOW;
+            return;
+        }
+        intervalMs = (uint16_t)publishPeriodMs;
+        windowMs = (uint16_t)(publishPeriodMs - RADIO_UPLINK_GUARD_MS);
+    }
+
+    void onScanStarted() { scanActive = true; }
+    void onScanStopped() { scanActive = false; }
+    bool isScanActive() const { return scanActive; }
+
+    // --- Coexistence ---
+
+    bool setCoexPreference(CoexPreference newPreference) {
+        esp_coex_prefer_t prefer = ESP_COEX_PREFER_BALANCE;
+        if (newPreference == CoexPreference::WIFI) prefer = ESP_COEX_PREFER_WIFI;
+        else if (newPreference == CoexPreference::BLE) prefer = ESP_COEX_PREFER_BT;
+        if (esp_coex_preference_set(prefer) != ESP_OK) return false;
+        preference = newPreference;
+        return true;
+    }
+
+    CoexPreference getCoexPreference() const { return preference; }
+
+    static const char* coexName(CoexPreference value) {
+        switch (value) {
+            case CoexPreference::WIFI: return "wifi";
+            case CoexPreference::BLE: return "ble";
+            default: return "balance";
+        }
+    }
+
+    static bool parseCoexName(const String& name, CoexPreference& value) {
+        if (name == "wifi") value = CoexPreference::WIFI;
+        else if (name == "ble") value = CoexPreference::BLE;
+        else if (name == "balance") value = CoexPreference::BALANCE;
+        else return false;
+        return true;
+    }
+
+    // --- Metrics ---
+
+    const UplinkTiming& getTiming(bool duringScan) const { return duringScan ? inScan : outsideScan; }
+
+    void resetStats() {
+        inScan = UplinkTiming{0, 0, 0, 0, 0};
+        outsideScan = UplinkTiming{0, 0, 0, 0, 0};
+    }
+
+    void printStats() const {
+        Serial.printf("Radio: coex %s, publish period %lu ms\n",
+                      coexName(preference), (unsigned long)publishPeriodMs);
+        printTiming("outside scan", outsideScan);
+        printTiming("during scan", inScan);
+    }
+
+private:
+    // Publishing counts as active while frames keep arriving on schedule
+    bool uplinkActive() const {
+        return publishPeriodMs > 0 && lastSlotAt != 0 && millis() - lastSlotAt < 4 * publishPeriodMs;
+    }
+
+    static void printTiming(const char* label, const UplinkTiming& timing) {
+        uint32_t sends = timing.sends ? timing.sends : 1;
+        Serial.printf("Uplink %s: %lu sends, send avg %lu us max %lu us, jitter avg %lu ms max %lu ms\n",
+                      label, (unsigned long)timing.sends,
+                      (unsigned long)(timing.sendTotalUs / sends), (unsigned long)timing.sendMaxUs,
+                      (unsigned long)(timing.jitterTotalMs / sends), (unsigned long)timing.jitterMaxMs);
+    }
+
+    unsigned long publishPeriodMs;
+    unsigned long lastSlotAt;
+    uint32_t sendStartedUs;
+    volatile bool scanActive;
+    CoexPreference preference;
+    UplinkTiming inScan;
+    UplinkTiming outsideScan;
+};
+
+// Global radio arbiter instance
+extern RadioArbiter radioArbiter;
+
+#endif // RADIO_ARBITER_H
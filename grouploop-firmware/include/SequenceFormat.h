@@ -0,0 +1,94 @@
+#ifndef SEQUENCE_FORMAT_H
+#define SEQUENCE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LogFormat.h"
+
+// Binary LED sequence, uploaded with the seq command (SequenceProcess.h)
+// and played on the device by SequenceBehavior. host/sequence builds them.
+//
+// Layout, little-endian:
+//   0  uint8   format version
+//   1  uint8   flags, 0
+//   2  uint16  keyframe count
+//   4  uint32  duration, ms; a sequence without a loop holds its last frame
+//   8  uint32  loop start, ms
+//  12  uint32  loop end, ms; 0 = no loop. Past the end, playback repeats
+//              [loop start, loop end) for as long as it runs.
+//  16  keyframes, 9 bytes each, in time order:
+//        0  uint32  time, ms
+//        4  uint8   pixel, SEQUENCE_ALL_PIXELS for every pixel
+//        5  uint8   how the pixel gets here from its previous keyframe
+//        6  uint8   red, green, blue
+//
+// A pixel is black at time 0 until its first keyframe, so a first
+// keyframe with SEQUENCE_LINEAR fades in from the start.
+
+#define SEQUENCE_FORMAT_VERSION 1
+#define SEQUENCE_HEADER_SIZE 16
+#define SEQUENCE_KEYFRAME_SIZE 9
+#define SEQUENCE_ALL_PIXELS 0xFF
+
+#define SEQUENCE_STEP 0     // jump at the keyframe's time
+#define SEQUENCE_LINEAR 1   // straight fade
+#define SEQUENCE_EASE 2     // smoothstep fade, slow at both ends
+
+struct SequenceView {
+    uint16_t keyframeCount;
+    uint32_t duration;
+    uint32_t loopStart;
+    uint32_t loopEnd;
+    const uint8_t* keyframes;
+};
+
+struct SequenceKeyframe {
+    uint32_t time;
+    uint8_t pixel;
+    uint8_t mode;
+    uint32_t color;         // 0xRRGGBB
+};
+
+static inline SequenceKeyframe sequenceKeyframe(const SequenceView& view, uint16_t index) {
+    const uint8_t* p = view.keyframes + (size_t)index * SEQUENCE_KEYFRAME_SIZE;
+    SequenceKeyframe keyframe;
+    keyframe.time = (uint32_t)logGetLE(p, 4);
+    keyframe.pixel = p[4];
+    keyframe.mode = p[5];
+    keyframe.color = (uint32_t)p[6] << 16 | (uint32_t)p[7] << 8 | p[8];
+    return keyframe;
+}
+
+// Check a whole sequence and point 'view' into it. False if the version,
+// length, loop points or keyframe order are wrong.
+static inline bool sequenceParse(const uint8_t* data, size_t length, SequenceView& view) {
+    if (length < SEQUENCE_HEADER_SIZE || data[0] != SEQUENCE_FORMAT_VERSION) return false;
+    view.keyframeCount = (uint16_t)logGetLE(data + 2, 2);
+    view.duration = (uint32_t)logGetLE(data + 4, 4);
+    view.loopStart = (uint32_t)logGetLE(data + 8, 4);
+    view.loopEnd = (uint32_t)logGetLE(data + 12, 4);
+    view.keyframes = data + SEQUENCE_HEADER_SIZE;
+    if (length != SEQUENCE_HEADER_SIZE + (size_t)view.keyframeCount * SEQUENCE_KEYFRAME_SIZE) return false;
+    if (view.loopEnd != 0 && (view.loopStart >= view.loopEnd || view.loopEnd > view.duration)) return false;
+    uint32_t previous = 0;
+    for (uint16_t i = 0; i < view.keyframeCount; ++i) {
+        SequenceKeyframe keyframe = sequenceKeyframe(view, i);
+        if (keyframe.time < previous || keyframe.time > view.duration || keyframe.mode > SEQUENCE_EASE) return false;
+        previous = keyframe.time;
+    }
+    return true;
+}
+
+// CRC-32 as zlib computes it, to check an upload against the sender's
+static inline uint32_t sequenceCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#endif // SEQUENCE_FORMAT_H
@@ -0,0 +1,67 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <math.h>
+#include <stdio.h>
+#include "Positioning.h"
+
+// Sensor values behind one telemetry frame, before they are scaled to bytes
+struct TelemetrySample {
+    float ax, ay, az;       // acceleration in g
+    bool hasBeacons;        // false: the beacon distances are sent as 0
+    int rssiNW, rssiNE, rssiSE, rssiSW; // calibrated RSSI in dBm
+    bool tapped;
+    PositionFix position;
+};
+
+inline int telemetryClamp(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+inline int telemetryFloatToByte(float v, float inMin, float inMax) {
+    if (v < inMin) v = inMin;
+    if (v > inMax) v = inMax;
+    float t = (v - inMin) / (inMax - inMin);
+    int b = (int)lroundf(t * 255.0f);
+    return telemetryClamp(b, 0, 255);
+}
+
+inline int telemetryRssiToByte(int rssiDbm) {
+    // Simple linear map: -100 dBm -> 0, -40 dBm -> 255
+    // Expects calibrated RSSI, so the scale is the same for every beacon
+    if (rssiDbm < -100) rssiDbm = -100;
+    if (rssiDbm > -40) rssiDbm = -40;
+    float t = (float)(rssiDbm + 100) / 60.0f; // 0..1
+    int b = (int)lroundf(t * 255.0f);
+    return telemetryClamp(b, 0, 255);
+}
+
+// Format the frame PublishProcess sends: the device id followed by 8 sensor
+// bytes and 3 position bytes in hex. The simulator expects TL->dNW first;
+// tap is 0 or 255; px is 0 at the west wall, py 0 at the north wall; pconf
+// 0 means no fix. Returns the length, 0 if it didn't fit.
+inline size_t formatTelemetryFrame(char* out, size_t size, const char* deviceId, const TelemetrySample& sample,
+                                   float roomWidth, float roomHeight) {
+    int ax = telemetryFloatToByte(sample.ax, -2.0f, 2.0f);
+    int ay = telemetryFloatToByte(sample.ay, -2.0f, 2.0f);
+    int az = telemetryFloatToByte(sample.az, -2.0f, 2.0f);
+    int dNW = 0, dNE = 0, dSE = 0, dSW = 0;
+    if (sample.hasBeacons) {
+        dNW = telemetryRssiToByte(sample.rssiNW);
+        dNE = telemetryRssiToByte(sample.rssiNE);
+        dSE = telemetryRssiToByte(sample.rssiSE);
+        dSW = telemetryRssiToByte(sample.rssiSW);
+    }
+    int tap = sample.tapped ? 255 : 0;
+    int px = 0, py = 0, pconf = 0;
+    if (sample.position.valid) {
+        px = telemetryFloatToByte(sample.position.x, 0.0f, roomWidth);
+        py = telemetryFloatToByte(sample.position.y, 0.0f, roomHeight);
+        pconf = telemetryFloatToByte(sample.position.confidence, 0.0f, 1.0f);
+    }
+
+    int length = snprintf(out, size, "%s%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
+        deviceId, ax, ay, az, dNW, dNE, dSE, dSW, tap, px, py, pconf);
+    if (length < 0 || length >= (int)size) return 0;
+    return (size_t)length;
+}
+
+#endif // TELEMETRY_FRAME_H
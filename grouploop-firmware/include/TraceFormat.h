@@ -0,0 +1,99 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "config.h"
+#include "LogFormat.h"
+
+// Binary input trace format, shared by the firmware (TraceRecorder.h) and
+// the host replay harness (host/replay). A trace is the raw input the
+// firmware saw, in arrival order: accelerometer readings, BLE
+// advertisements and scan windows, and received WebSocket messages.
+//
+// Record layout, little-endian:
+//   0  uint16  record length, header included
+//   2  uint8   type
+//   3  uint32  timestamp, micros()
+//   7  payload:
+//        TRACE_START   uint8 format version
+//        TRACE_IMU     int16 x, y, z as the sensor reported them
+//        TRACE_SCAN    uint8 1 = scan started, 0 = scan stopped
+//        TRACE_ADVERT  6 address bytes, int8 RSSI, advertisement payload
+//        TRACE_MESSAGE message bytes, as queued for ReceiveProcess
+
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_RECORD_HEADER_SIZE 7
+
+#define TRACE_START 1
+#define TRACE_IMU 2
+#define TRACE_SCAN 3
+#define TRACE_ADVERT 4
+#define TRACE_MESSAGE 5
+
+// Longest record: a whole received message
+#define TRACE_RECORD_MAX (TRACE_RECORD_HEADER_SIZE + WS_RX_MAX_LEN)
+
+// Write the header for a record with 'payloadLength' payload bytes; returns
+// the header size. The caller appends the payload.
+static inline size_t traceWriteHeader(uint8_t* out, uint8_t type, uint32_t timestamp, size_t payloadLength) {
+    logPutLE(out, TRACE_RECORD_HEADER_SIZE + payloadLength, 2);
+    out[2] = type;
+    logPutLE(out + 3, timestamp, 4);
+    return TRACE_RECORD_HEADER_SIZE;
+}
+
+// The sensor reports whole milli-g, so a reading fits an int16 exactly
+static inline int16_t traceSampleToInt16(float value) {
+    if (value > 32767.0f) return 32767;
+    if (value < -32768.0f) return -32768;
+    return (int16_t)lroundf(value);
+}
+
+// A parsed record; 'payload' points into the record bytes
+struct TraceRecordView {
+    uint8_t type;
+    uint32_t timestamp;
+    const uint8_t* payload;
+    size_t payloadLength;
+};
+
+// Length of the record at 'data', 0 if fewer than 'available' bytes hold a
+// whole one or the length is invalid
+static inline size_t traceRecordLength(const uint8_t* data, size_t available) {
+    if (available < 2) return 0;
+    size_t length = (size_t)logGetLE(data, 2);
+    if (length < TRACE_RECORD_HEADER_SIZE || length > TRACE_RECORD_MAX || length > available) return 0;
+    return length;
+}
+
+static inline bool traceParseRecord(const uint8_t* data, size_t available, TraceRecordView& view) {
+    size_t length = traceRecordLength(data, available);
+    if (length == 0) return false;
+    view.type = data[2];
+    view.timestamp = (uint32_t)logGetLE(data + 3, 4);
+    view.payload = data + TRACE_RECORD_HEADER_SIZE;
+    view.payloadLength = length - TRACE_RECORD_HEADER_SIZE;
+    return true;
+}
+
+static inline bool traceReadImu(const TraceRecordView& view, int16_t& x, int16_t& y, int16_t& z) {
+    if (view.type != TRACE_IMU || view.payloadLength != 6) return false;
+    x = (int16_t)logGetLE(view.payload, 2);
+    y = (int16_t)logGetLE(view.payload + 2, 2);
+    z = (int16_t)logGetLE(view.payload + 4, 2);
+    return true;
+}
+
+static inline bool traceReadAdvert(const TraceRecordView& view, const uint8_t*& address, int& rssi,
+                                   const uint8_t*& payload, size_t& length) {
+    if (view.type != TRACE_ADVERT || view.payloadLength < 7) return false;
+    address = view.payload;
+    rssi = (int8_t)view.payload[6];
+    payload = view.payload + 7;
+    length = view.payloadLength - 7;
+    return true;
+}
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,71 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "Arduino.h"
+#include "config.h"
+#include <freertos/FreeRTOS.h>
+#include "TraceFormat.h"
+
+// Captures the firmware's raw input into a RAM ring of binary records (see
+// TraceFormat.h), oldest records overwritten first, so a problem seen at
+// the venue can be replayed on a host (host/replay). Off until start();
+// while off, each recording call costs one flag check. Safe to call from
+// the BLE and network tasks.
+class TraceRecorder {
+public:
+    // Clear the ring and start capturing with a TRACE_START record
+    void start();
+    void stop() { capturing = false; }
+    bool isCapturing() const { return capturing; }
+
+    void recordImu(float x, float y, float z) {
+        if (capturing) writeImu(x, y, z);
+    }
+
+    void recordScan(bool started) {
+        if (capturing) writeScan(started);
+    }
+
+    void recordAdvert(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) {
+        if (capturing) writeAdvert(address, rssi, payload, length);
+    }
+
+    void recordMessage(const char* data, size_t length) {
+        if (capturing) writeMessage(data, length);
+    }
+
+    // Copy up to 'size' bytes of the record stream from absolute position
+    // 'position', which is first moved forward to the oldest record if it
+    // was overwritten. Does not advance 'position'. Returns the number of
+    // bytes copied, 0 once 'position' reaches the head.
+    size_t read(uint32_t& position, uint8_t* out, size_t size);
+    uint32_t getHeadPosition();
+    void clear();
+
+    uint32_t getRecordCount() const { return records; }
+    uint32_t getOverwrittenCount() const { return overwritten; }
+    uint32_t getSkippedCount() const { return skipped; }
+    uint32_t getBufferedBytes();
+
+private:
+    void writeImu(float x, float y, float z);
+    void writeScan(bool started);
+    void writeAdvert(const uint8_t* address, int rssi, const uint8_t* payload, size_t length);
+    void writeMessage(const char* data, size_t length);
+    void commit(const uint8_t* record, size_t length);
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t ring[TRACE_RING_SIZE];
+    // Absolute byte positions; index into ring modulo TRACE_RING_SIZE
+    uint32_t headPos = 0;
+    uint32_t tailPos = 0;
+    uint32_t records = 0;
+    uint32_t overwritten = 0;       // records dropped to make room
+    uint32_t skipped = 0;           // input too long to record
+    volatile bool capturing = false;
+};
+
+// Global trace recorder instance
+extern TraceRecorder traceRecorder;
+
+#endif // TRACE_RECORDER_H
@@ -10,4 +10,33 @@ static uint32_t hexToColor(String hex) {
     return (uint32_t)strtol(("0x" + hex).c_str(), NULL, 16);
 }
 
+static inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse "64:e8:33:84:43:9a" into 6 bytes in display order
+static inline bool parseMacAddress(const char* text, uint8_t out[6]) {
+    if (!text) return false;
+    for (int i = 0; i < 6; ++i) {
+        int high = hexNibble(text[0]);
+        int low = high < 0 ? -1 : hexNibble(text[1]);
+        if (high < 0 || low < 0) return false;
+        out[i] = (uint8_t)((high << 4) | low);
+        text += 2;
+        if (i < 5) {
+            if (*text != ':' && *text != '-') return false;
+            text++;
+        }
+    }
+    return *text == '\0';
+}
+
+// Format 6 bytes as "64:e8:33:84:43:9a" ('out' must hold 18 chars)
+static inline void formatMacAddress(const uint8_t* mac, char* out) {
+    snprintf(out, 18, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
 #endif // UTILS_H 
\ No newline at end of file
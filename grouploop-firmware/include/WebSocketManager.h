@@ -5,128 +5,352 @@
 #include <WebSocketsClient.h>
 #include <WiFi.h>
 #include <functional>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "BootTiming.h"
+#include "RadioArbiter.h"
+#include "TraceRecorder.h"
 
-// Forward declarations
-class WebSocketManager;
+// WebSocket connection state. DISCONNECTED means there is no network link
+// (or no server configured); CONNECTING means the client is (re)trying.
+enum class ConnectionState { DISCONNECTED, CONNECTING, CONNECTED };
 
-// Message callback type
-typedef std::function<void(const String&)> MessageCallback;
+// Called from dispatch() when the connection state changes
+typedef std::function<void(ConnectionState)> ConnectionListener;
 
+#define WS_MAX_CONNECTION_LISTENERS 4
+
+// Outbound traffic counters
+struct UplinkStats {
+    uint32_t telemetrySent;
+    uint32_t telemetryCoalesced;    // replaced by a newer frame before sending
+    uint32_t eventsSent;
+    uint32_t eventsDropped;         // rejected because the event queue was full
+    uint32_t sendFailures;          // sendTXT() returned false
+    uint32_t rxDropped;             // inbound messages lost (queue full/too long)
+    uint8_t eventQueueHighWater;
+};
+
+// Shared WebSocket connection. The socket itself is only touched by
+// service(), which NetworkProcess runs on its own task, so a slow or stalled
+// TCP connection never blocks the main loop. The main loop talks to it
+// through fixed-size queues:
+//  - telemetry is latest-wins: a frame that has not gone out yet is
+//    replaced by the next one (counted as coalesced)
+//  - events (acks, replies, logs) are kept in order and retried until sent;
+//    only a full queue rejects new ones
+//  - received messages are queued for ReceiveProcess
+// Connection state changes are reported to listeners from dispatch(), which
+// runs on the main loop.
 class WebSocketManager {
 private:
     WebSocketsClient webSocket;
-    bool connected = false;
+    volatile ConnectionState connectionState = ConnectionState::DISCONNECTED;
+    ConnectionState notifiedState = ConnectionState::DISCONNECTED;
+    volatile bool linkUp = false;
     String wsHost;
     int wsPort = 80;
     String wsPath = "/";
-    String deviceIdHex;
-    String state;
-    
-    // Message handling
-    MessageCallback messageCallback;
-    String lastReceivedMessage;
-    bool hasNewMessage = false;
-    
+    char deviceIdHex[5];
+
+    ConnectionListener listeners[WS_MAX_CONNECTION_LISTENERS];
+    int listenerCount = 0;
+
+    // Guards the queues below and the stats; they are shared between the
+    // main loop and the network task. Held only for short copies.
+    mutable portMUX_TYPE queueLock = portMUX_INITIALIZER_UNLOCKED;
+
+    char telemetryBuffer[WS_TELEMETRY_MAX_LEN];
+    size_t telemetryLength = 0;
+    bool telemetryPending = false;
+
+    struct QueuedMessage {
+        size_t length;
+        char data[WS_EVENT_MAX_LEN];
+    };
+    QueuedMessage eventQueue[WS_EVENT_QUEUE_DEPTH];
+    uint8_t eventHead = 0;
+    uint8_t eventCount = 0;
+
+    struct ReceivedMessage {
+        size_t length;
+        char data[WS_RX_MAX_LEN];
+    };
+    ReceivedMessage rxQueue[WS_RX_QUEUE_DEPTH];
+    uint8_t rxHead = 0;
+    uint8_t rxCount = 0;
+
+    // Network task only: staging buffer for the frame being written
+    char txBuffer[WS_EVENT_MAX_LEN];
+
+    UplinkStats stats;
+
     // Connection management
     bool isInitialized = false;
-    unsigned long lastReconnectAttempt = 0;
     const unsigned long RECONNECT_INTERVAL = 5000; // 5 seconds
 
 public:
-    WebSocketManager() 
-        : connected(false)
-        , deviceIdHex("0000")
-        , state("DISCONNECTED")
-        , hasNewMessage(false)
+    WebSocketManager()
+        : connectionState(ConnectionState::DISCONNECTED)
+        , notifiedState(ConnectionState::DISCONNECTED)
+        , linkUp(false)
         , isInitialized(false)
-        , lastReconnectAttempt(0)
-    {}
+    {
+        strcpy(deviceIdHex, "0000");
+        stats = UplinkStats{0, 0, 0, 0, 0, 0, 0};
+    }
 
     // Initialize the WebSocket connection
     void initialize(const String& wsUrl) {
         if (isInitialized) return;
-        
+
         // Build device ID from MAC address
         uint8_t mac[6];
         WiFi.macAddress(mac);
-        char idBuf[5];
-        snprintf(idBuf, sizeof(idBuf), "%02X%02X", mac[4], mac[5]);
-        deviceIdHex = String(idBuf);
-        
+        snprintf(deviceIdHex, sizeof(deviceIdHex), "%02X%02X", mac[4], mac[5]);
+
         parseAndConnect(wsUrl);
         isInitialized = true;
     }
 
-    // Update the WebSocket connection (call this in main loop)
-    void update() {
+    // --- Network task ---
+
+    // Run the client and drain the outbound queues: the pending telemetry
+    // frame and at most WS_DRAIN_BUDGET events per pass. The client
+    // reconnects by itself every RECONNECT_INTERVAL.
+    void service() {
         if (!isInitialized) return;
-        
+
+        if (!linkUp) {
+            if (connectionState != ConnectionState::DISCONNECTED) {
+                connectionState = ConnectionState::DISCONNECTED;
+                webSocket.disconnect();
+            }
+            return;
+        }
+        if (connectionState == ConnectionState::DISCONNECTED) {
+            connectionState = ConnectionState::CONNECTING;
+        }
         webSocket.loop();
-        state = connected ? String("CONNECTED") : String("CONNECTING");
-        
-        // Handle reconnection if needed
-        if (!connected && (millis() - lastReconnectAttempt) > RECONNECT_INTERVAL) {
-            lastReconnectAttempt = millis();
-            reconnect();
+        if (connectionState != ConnectionState::CONNECTED) return;
+
+        drainTelemetry();
+        for (int i = 0; i < WS_DRAIN_BUDGET; ++i) {
+            if (!drainEvent()) break;
         }
     }
 
-    // Send a message through the WebSocket
-    bool sendMessage(const String& message) {
-        if (!connected) return false;
-        
-        String msg = message; // Create a non-const copy
-        webSocket.sendTXT(msg);
+    // --- Main loop ---
+
+    // Report connection state changes to the listeners (NetworkProcess
+    // calls this every loop)
+    void dispatch() {
+        ConnectionState current = connectionState;
+        if (current == notifiedState) return;
+        notifiedState = current;
+        for (int i = 0; i < listenerCount; ++i) {
+            listeners[i](current);
+        }
+    }
+
+    // Whether the network link (WiFi) is up; while it is down the socket is
+    // dropped instead of waiting for a timeout
+    void setLinkUp(bool up) {
+        linkUp = up;
+    }
+
+    // Register for connection state changes. Returns false when full.
+    bool addConnectionListener(ConnectionListener listener) {
+        if (listenerCount >= WS_MAX_CONNECTION_LISTENERS) return false;
+        listeners[listenerCount++] = listener;
+        return true;
+    }
+
+    // Queue a telemetry frame. Replaces a frame that has not been sent yet.
+    bool sendTelemetry(const char* data, size_t length) {
+        if (!isConnected() || length > WS_TELEMETRY_MAX_LEN) return false;
+        portENTER_CRITICAL(&queueLock);
+        if (telemetryPending) stats.telemetryCoalesced++;
+        memcpy(telemetryBuffer, data, length);
+        telemetryLength = length;
+        telemetryPending = true;
+        portEXIT_CRITICAL(&queueLock);
         return true;
     }
 
-    // Check if there's a new message available
+    // Queue an event (ack, reply, log). Kept until sent; returns false when
+    // the queue is full or the message is empty or too long.
+    bool sendEvent(const char* data, size_t length) {
+        if (length == 0) return false;
+        bool queued = false;
+        portENTER_CRITICAL(&queueLock);
+        if (length <= WS_EVENT_MAX_LEN && eventCount < WS_EVENT_QUEUE_DEPTH) {
+            QueuedMessage& slot = eventQueue[(eventHead + eventCount) % WS_EVENT_QUEUE_DEPTH];
+            memcpy(slot.data, data, length);
+            slot.length = length;
+            eventCount++;
+            if (eventCount > stats.eventQueueHighWater) stats.eventQueueHighWater = eventCount;
+            queued = true;
+        } else {
+            stats.eventsDropped++;
+        }
+        portEXIT_CRITICAL(&queueLock);
+        return queued;
+    }
+
+    // Send a message through the WebSocket (queued as an event)
+    bool sendMessage(const String& message) {
+        return sendEvent(message.c_str(), message.length());
+    }
+
+    // Check if there's a received message waiting
     bool hasMessage() const {
-        return hasNewMessage;
+        return rxCount > 0;
     }
 
-    // Get the last received message and mark it as processed
-    String getMessage() {
-        hasNewMessage = false;
-        return lastReceivedMessage;
+    // Copy the oldest received message into 'out' (NUL-terminated,
+    // truncated to fit) and drop it from the queue. Returns the copied
+    // length, 0 when nothing was waiting.
+    size_t getMessage(char* out, size_t size) {
+        if (size == 0) return 0;
+        size_t length = 0;
+        portENTER_CRITICAL(&queueLock);
+        if (rxCount > 0) {
+            ReceivedMessage& slot = rxQueue[rxHead];
+            length = slot.length < size - 1 ? slot.length : size - 1;
+            memcpy(out, slot.data, length);
+            rxHead = (rxHead + 1) % WS_RX_QUEUE_DEPTH;
+            rxCount--;
+        }
+        portEXIT_CRITICAL(&queueLock);
+        out[length] = '\0';
+        return length;
     }
 
-    // Set callback for incoming messages
-    void setMessageCallback(MessageCallback callback) {
-        messageCallback = callback;
+    // Queue a received message for ReceiveProcess. Called on the network
+    // task from webSocket.loop(); public so a trace replay (host/replay)
+    // can feed recorded messages in.
+    void queueReceived(const char* data, size_t length) {
+        traceRecorder.recordMessage(data, length);
+        portENTER_CRITICAL(&queueLock);
+        if (rxCount < WS_RX_QUEUE_DEPTH && length <= WS_RX_MAX_LEN) {
+            ReceivedMessage& slot = rxQueue[(rxHead + rxCount) % WS_RX_QUEUE_DEPTH];
+            memcpy(slot.data, data, length);
+            slot.length = length;
+            rxCount++;
+        } else {
+            stats.rxDropped++;
+        }
+        portEXIT_CRITICAL(&queueLock);
     }
 
     // Get connection state
     bool isConnected() const {
-        return connected;
+        return connectionState == ConnectionState::CONNECTED;
+    }
+
+    ConnectionState getConnectionState() const {
+        return connectionState;
+    }
+
+    // A consistent copy of the counters
+    UplinkStats getUplinkStats() const {
+        portENTER_CRITICAL(&queueLock);
+        UplinkStats copy = stats;
+        portEXIT_CRITICAL(&queueLock);
+        return copy;
+    }
+
+    void printUplinkStats() const {
+        UplinkStats snapshot = getUplinkStats();
+        Serial.printf("Uplink: telemetry %lu sent, %lu coalesced; events %lu sent, %lu dropped, queue high water %u/%u\n",
+                      (unsigned long)snapshot.telemetrySent, (unsigned long)snapshot.telemetryCoalesced,
+                      (unsigned long)snapshot.eventsSent, (unsigned long)snapshot.eventsDropped,
+                      (unsigned)snapshot.eventQueueHighWater, (unsigned)WS_EVENT_QUEUE_DEPTH);
+        Serial.printf("Uplink: %lu send failures, %lu inbound dropped\n",
+                      (unsigned long)snapshot.sendFailures, (unsigned long)snapshot.rxDropped);
     }
 
     // Get device ID
-    String getDeviceId() const {
+    const char* getDeviceId() const {
         return deviceIdHex;
     }
 
-    // Get connection state string
-    String getState() const {
-        return state;
+    // Get connection state name
+    const char* getStateName() const {
+        return stateName(connectionState);
     }
 
-    // Force reconnection
-    void reconnect() {
-        if (wsHost.length() > 0) {
-            webSocket.begin(wsHost.c_str(), wsPort, wsPath.c_str());
+    static const char* stateName(ConnectionState value) {
+        switch (value) {
+            case ConnectionState::CONNECTED: return "CONNECTED";
+            case ConnectionState::CONNECTING: return "CONNECTING";
+            default: return "DISCONNECTED";
         }
     }
 
 private:
+    // Send the pending telemetry frame, if any. Telemetry is never retried:
+    // the next frame is due soon and is more current anyway.
+    void drainTelemetry() {
+        size_t length = 0;
+        portENTER_CRITICAL(&queueLock);
+        if (telemetryPending) {
+            length = telemetryLength;
+            memcpy(txBuffer, telemetryBuffer, length);
+            telemetryPending = false;
+        }
+        portEXIT_CRITICAL(&queueLock);
+        if (length == 0) return;
+
+        radioArbiter.beginSend();
+        bool sent = webSocket.sendTXT((uint8_t*)txBuffer, length);
+        radioArbiter.endSend();
+        portENTER_CRITICAL(&queueLock);
+        if (sent) {
+            stats.telemetrySent++;
+        } else {
+            stats.sendFailures++;
+        }
+        portEXIT_CRITICAL(&queueLock);
+        if (sent && bootTiming.markFirstFrame()) bootTiming.print();
+    }
+
+    // Send the oldest event. It stays queued until the write succeeds.
+    // Returns false when there is nothing (more) to send this pass.
+    bool drainEvent() {
+        size_t length = 0;
+        bool waiting = false;
+        portENTER_CRITICAL(&queueLock);
+        if (eventCount > 0) {
+            waiting = true;
+            length = eventQueue[eventHead].length;
+            memcpy(txBuffer, eventQueue[eventHead].data, length);
+        }
+        portEXIT_CRITICAL(&queueLock);
+        if (!waiting) return false;
+
+        bool sent = webSocket.sendTXT((uint8_t*)txBuffer, length);
+        portENTER_CRITICAL(&queueLock);
+        if (sent) {
+            eventHead = (eventHead + 1) % WS_EVENT_QUEUE_DEPTH;
+            eventCount--;
+            stats.eventsSent++;
+        } else {
+            stats.sendFailures++;
+        }
+        portEXIT_CRITICAL(&queueLock);
+        return sent;
+    }
+
     void parseAndConnect(const String& wsUrl) {
         if (!wsUrl.startsWith("ws://")) return;
-        
+
         String rest = wsUrl.substring(5);
         int slash = rest.indexOf('/');
         String hostPort = slash >= 0 ? rest.substring(0, slash) : rest;
         wsPath = slash >= 0 ? rest.substring(slash) : "/";
-        
+
         int colon = hostPort.indexOf(':');
         if (colon >= 0) {
             wsHost = hostPort.substring(0, colon);
@@ -135,56 +359,43 @@ private:
             wsHost = hostPort;
             wsPort = 80;
         }
-        
-        // Set up event handlers
+
+        // Set up event handlers (run on the network task)
         webSocket.onEvent([this](WStype_t type, uint8_t * payload, size_t length) {
             if (type == WStype_CONNECTED) {
-                connected = true;
-                Serial.println("WebSocketManager: Connected");
+                connectionState = ConnectionState::CONNECTED;
+                bootTiming.markSocketConnected();
             }
             else if (type == WStype_DISCONNECTED) {
-                connected = false;
-                Serial.println("WebSocketManager: Disconnected");
+                // The client keeps retrying unless the link itself is down
+                if (connectionState != ConnectionState::DISCONNECTED) {
+                    connectionState = ConnectionState::CONNECTING;
+                }
+                // A stale frame must not go out on the next connection
+                portENTER_CRITICAL(&queueLock);
+                telemetryPending = false;
+                portEXIT_CRITICAL(&queueLock);
             }
             else if (type == WStype_TEXT) {
-                // Handle incoming text message
-                String message = String((char*)payload);
-                Serial.print("WebSocketManager: Received: ");
-                Serial.println(message);
-                
-                // Store the message
-                lastReceivedMessage = message;
-                hasNewMessage = true;
-                
-                // Call callback if set
-                if (messageCallback) {
-                    messageCallback(message);
-                }
+                queueReceived((const char*)payload, length);
             }
             else if (type == WStype_BIN) {
-                // Handle incoming binary message
-                Serial.print("WebSocketManager: Received binary message of length: ");
-                Serial.println(length);
-                
-                // Convert binary to hex string
-                String hexMessage = "";
-                for (size_t i = 0; i < length; i++) {
-                    char hex[3];
-                    snprintf(hex, sizeof(hex), "%02x", payload[i]);
-                    hexMessage += hex;
+                // Binary messages are handed on as a hex string
+                char hexMessage[WS_RX_MAX_LEN];
+                if (length * 2 >= sizeof(hexMessage)) {
+                    portENTER_CRITICAL(&queueLock);
+                    stats.rxDropped++;
+                    portEXIT_CRITICAL(&queueLock);
+                    return;
                 }
-                
-                lastReceivedMessage = hexMessage;
-                hasNewMessage = true;
-                
-                // Call callback if set
-                if (messageCallback) {
-                    messageCallback(hexMessage);
+                for (size_t i = 0; i < length; i++) {
+                    snprintf(hexMessage + 2 * i, 3, "%02x", payload[i]);
                 }
+                queueReceived(hexMessage, length * 2);
             }
         });
-        
-        webSocket.setReconnectInterval(5000);
+
+        webSocket.setReconnectInterval(RECONNECT_INTERVAL);
         webSocket.begin(wsHost.c_str(), wsPort, wsPath.c_str());
     }
 };
@@ -0,0 +1,30 @@
+#ifndef BEACON_SCANNER_H
+#define BEACON_SCANNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Receives raw advertisements from a scanner backend. Called from the BLE
+// stack's task, so implementations must be short and allocation-free.
+class AdvertisementSink {
+public:
+    virtual ~AdvertisementSink() {}
+    // 'address' is 6 bytes in display order (as printed, MSB first)
+    virtual void onAdvertisement(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) = 0;
+};
+
+// Minimal interface BLEProcess needs from a BLE stack: passive scanning with
+// every advertisement (duplicates included) forwarded to a sink, and no
+// result accumulation inside the stack.
+class BeaconScanner {
+public:
+    virtual ~BeaconScanner() {}
+    virtual void begin(AdvertisementSink* sink) = 0;
+    // Scan interval and window in ms, applied from the next start()
+    virtual void setScanTiming(uint16_t intervalMs, uint16_t windowMs) = 0;
+    virtual void start() = 0;
+    virtual void stop() = 0;
+    virtual const char* getName() const = 0;
+};
+
+#endif // BEACON_SCANNER_H
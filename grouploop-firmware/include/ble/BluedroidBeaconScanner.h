@@ -0,0 +1,77 @@
+#ifndef BLUEDROID_BEACON_SCANNER_H
+#define BLUEDROID_BEACON_SCANNER_H
+
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include "ble/BeaconScanner.h"
+#include "config.h"
+
+// Scanner backed by the Arduino-ESP32 Bluedroid stack. BLEScan builds a
+// BLEAdvertisedDevice (strings, maps) for every advertisement, so it is
+// not used: the scan is driven through the GAP API and the raw scan
+// results are read in a custom GAP handler, without allocating. Only one
+// instance can exist, since the handler is a plain function.
+class BluedroidBeaconScanner : public BeaconScanner {
+public:
+    BluedroidBeaconScanner() : sink(nullptr), scanning(false) {
+        scanParams.scan_type = BLE_SCAN_TYPE_PASSIVE;
+        scanParams.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+        scanParams.scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL;
+        scanParams.scan_duplicate = BLE_SCAN_DUPLICATE_DISABLE;
+        setScanTiming(BLE_SCAN_INTERVAL, BLE_SCAN_WINDOW);
+        instance = this;
+    }
+
+    ~BluedroidBeaconScanner() {
+        if (instance == this) instance = nullptr;
+    }
+
+    void begin(AdvertisementSink* advertisementSink) override {
+        sink = advertisementSink;
+        BLEDevice::init("");
+        // BLEDevice's own handler still runs, but with BLEDevice::getScan()
+        // never called there is no BLEScan for it to pass results to
+        BLEDevice::setCustomGapHandler(handleGapEvent);
+    }
+
+    // In units of 0.625 ms, as the controller takes them
+    void setScanTiming(uint16_t intervalMs, uint16_t windowMs) override {
+        scanParams.scan_interval = (uint16_t)(intervalMs * 8 / 5);
+        scanParams.scan_window = (uint16_t)(windowMs * 8 / 5);
+    }
+
+    void start() override {
+        // The stack runs the two in order; duration 0 scans until stopped
+        esp_ble_gap_set_scan_params(&scanParams);
+        esp_ble_gap_start_scanning(0);
+        scanning = true;
+    }
+
+    void stop() override {
+        scanning = false;
+        esp_ble_gap_stop_scanning();
+    }
+
+    const char* getName() const override { return "bluedroid"; }
+
+private:
+    AdvertisementSink* sink;
+    esp_ble_scan_params_t scanParams;
+    volatile bool scanning;
+
+    static inline BluedroidBeaconScanner* instance = nullptr;
+
+    // On the Bluedroid task. The advertising data and the scan response
+    // are back to back in ble_adv; bda is in display order already.
+    static void handleGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+        if (event != ESP_GAP_BLE_SCAN_RESULT_EVT) return;
+        BluedroidBeaconScanner* scanner = instance;
+        if (!scanner || !scanner->scanning || !scanner->sink) return;
+        const auto& result = param->scan_rst;
+        if (result.search_evt != ESP_GAP_SEARCH_INQ_RES_EVT) return;
+        scanner->sink->onAdvertisement(result.bda, result.rssi, result.ble_adv,
+                                       (size_t)result.adv_data_len + result.scan_rsp_len);
+    }
+};
+
+#endif // BLUEDROID_BEACON_SCANNER_H
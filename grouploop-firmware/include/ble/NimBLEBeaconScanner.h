@@ -0,0 +1,57 @@
+#ifndef NIMBLE_BEACON_SCANNER_H
+#define NIMBLE_BEACON_SCANNER_H
+
+#include <NimBLEDevice.h>
+#include "ble/BeaconScanner.h"
+#include "config.h"
+
+// Scanner backed by NimBLE-Arduino (1.4.x). Uses noticeably less RAM and
+// flash than Bluedroid; enable with -DBLE_BACKEND_NIMBLE.
+class NimBLEBeaconScanner : public BeaconScanner, public NimBLEAdvertisedDeviceCallbacks {
+public:
+    NimBLEBeaconScanner() : pBLEScan(nullptr), sink(nullptr) {}
+
+    void begin(AdvertisementSink* advertisementSink) override {
+        sink = advertisementSink;
+        NimBLEDevice::init("");
+        pBLEScan = NimBLEDevice::getScan();
+        pBLEScan->setActiveScan(false);
+        pBLEScan->setInterval(BLE_SCAN_INTERVAL);
+        pBLEScan->setWindow(BLE_SCAN_WINDOW);
+        // Deliver every advertisement and never store results
+        pBLEScan->setAdvertisedDeviceCallbacks(this, true);
+        pBLEScan->setDuplicateFilter(false);
+        pBLEScan->setMaxResults(0);
+    }
+
+    void setScanTiming(uint16_t intervalMs, uint16_t windowMs) override {
+        pBLEScan->setInterval(intervalMs);
+        pBLEScan->setWindow(windowMs);
+    }
+
+    void start() override {
+        pBLEScan->start(0, nullptr, false);
+    }
+
+    void stop() override {
+        pBLEScan->stop();
+        pBLEScan->clearResults();
+    }
+
+    const char* getName() const override { return "nimble"; }
+
+    void onResult(NimBLEAdvertisedDevice* advertisedDevice) override {
+        // NimBLE stores addresses little-endian; flip to display order
+        const uint8_t* native = advertisedDevice->getAddress().getNative();
+        uint8_t address[6];
+        for (int i = 0; i < 6; ++i) address[i] = native[5 - i];
+        sink->onAdvertisement(address, advertisedDevice->getRSSI(),
+                              advertisedDevice->getPayload(), advertisedDevice->getPayloadLength());
+    }
+
+private:
+    NimBLEScan* pBLEScan;
+    AdvertisementSink* sink;
+};
+
+#endif // NIMBLE_BEACON_SCANNER_H
@@ -7,19 +7,96 @@
 #define BLE_SCAN_WINDOW 50
 #define WIFI_CONNECT_DELAY 500
 #define WIFI_SEND_DELAY 3000
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // Give up on a single attempt after this
+#define WIFI_BACKOFF_BASE_MS 1000 // First retry delay, doubled per failure
+#define WIFI_BACKOFF_MAX_MS 60000 // Retry delay cap
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000 // Direct join to the cached BSSID/channel
+#define WIFI_SCAN_TIMEOUT_MS 10000 // Give up on an async network scan
+#define WIFI_RSSI_CHECK_MS 2000 // Link quality sample interval while connected
+#define WIFI_ROAM_RSSI_THRESHOLD -72 // Look for a better AP below this (dBm)
+#define WIFI_ROAM_HYSTERESIS_DB 8 // A roam target must be this much stronger
+#define WIFI_ROAM_COOLDOWN_MS 30000 // Minimum time between roam scans
+#define WIFI_PRIORITY_STEP_DB 10 // One priority step outweighs this much RSSI
 #define SERIAL_BAUD_RATE 115200
 #define SETUP_DELAY 1000
 #define SCAN_DURATION 1 // Scan for 2 seconds
 #define SCAN_INTERVAL_MS (5000 - (SCAN_DURATION * 1000)) // Interval between scans
+#define PUBLISH_INTERVAL_MS 50 // Sensor frame period (20 Hz)
+
+#define HEALTH_INTERVAL_MS 30000 // Health frame period
+
+// Logging (see Log.h); LOG_LEVEL itself is a build flag
+#define LOG_RING_SIZE 2048 // RAM kept for recent binary log records
+#define LOG_RECORD_MAX 120 // Longest record; must fit hex-encoded in one WS event
+#define LOG_LINE_MAX 128 // Longest formatted line when dumping or echoing
+#define LOG_UPLOAD_EVENTS_PER_UPDATE 2 // Log upload messages queued per loop
+#define LOG_ERROR_UPLOAD_INTERVAL_MS 10000 // Minimum time between automatic uploads after errors
+#define LOG_HOT_INTERVAL_MS 1000 // Minimum time between per-message/per-advert log lines
+
+// Input capture for replay on a host (see TraceRecorder.h)
+#define TRACE_RING_SIZE 8192 // RAM kept for recent input records (~5 s of IMU and BLE)
+#define TRACE_UPLOAD_EVENTS_PER_UPDATE 2 // Trace upload messages queued per loop
+
+// Outbound/inbound WebSocket queues (see WebSocketManager.h)
+#define WS_TELEMETRY_MAX_LEN 64 // Longest telemetry frame
+#define WS_EVENT_QUEUE_DEPTH 8 // Queued events (acks, replies, logs)
+#define WS_EVENT_MAX_LEN 256 // Longest event message
+#define WS_RX_QUEUE_DEPTH 4 // Received messages waiting for ReceiveProcess
+#define WS_RX_MAX_LEN 256 // Longest received message
+#define WS_DRAIN_BUDGET 4 // Events written per service pass
+#define WS_SERVICE_INTERVAL_MS 2 // Network task period
+#define WS_TASK_STACK_SIZE 6144
+
+// Radio sharing between the uplink and BLE scans (see RadioArbiter.h)
+#define RADIO_UPLINK_GUARD_MS 15 // Radio time per publish period kept free of BLE scanning
+#define RADIO_SLOT_GRACE_MS 5 // A scan may start this long after a publish slot
+#define RADIO_MIN_SCAN_WINDOW_MS 10 // Below this, use the default scan timing
 
 // The service UUID of the beacons to scan for
 #define BEACON_SERVICE_UUID "19b10000-e8f2-537e-4f6c-d104768a1214"
 
+// Reference RSSI at 1 m used when a beacon is neither calibrated nor
+// advertises its TX power. Calibrated RSSI values are normalized to it.
+#define BEACON_DEFAULT_RSSI_AT_1M -59
+// Path loss between the 0 m TX power level and 1 m (free space, 2.4 GHz)
+#define TX_POWER_TO_1M_LOSS 41
+// Number of scans averaged by the calibrate command
+#define CALIBRATION_SCANS 3
+// A calibration not done by then is abandoned (the anchor was not heard)
+#define CALIBRATION_TIMEOUT_MS 60000
+
 #define BOOT_BUTTON_PIN 9
 
 #define IMU_UPDATE_INTERVAL_MS 10
 
 #define LED_COUNT 6
+// The LED ticker's period; every frame is drawn on it
+#define LED_FRAME_MS 20
+// Compositor overlays (see processes/LedCompositor.h): the flash on a tap,
+// and the pixel that lights while the server link is down
+#define LED_FLASH_COLOR 0xFFFFFF
+#define LED_FLASH_MS 250
+#define LED_STATUS_PIXEL (LED_COUNT - 1)
+#define LED_STATUS_OFFLINE_COLOR 0x301000
+// Output stage: gamma per channel, and how often a steady frame is sent
+// again so its dithered fractions average out
+#define LED_GAMMA_RED 2.2
+#define LED_GAMMA_GREEN 2.2
+#define LED_GAMMA_BLUE 2.2
+#define LED_DITHER_INTERVAL_MS 20
+// Motion-reactive behaviors ignore an IMU reading older than this
+#define LED_MOTION_STALE_MS 100
+// Behaviors made from pattern specs (see processes/LedBehaviorPool.h): the
+// one showing, one waiting for the next frame, and one being made
+#define LED_BEHAVIOR_SLOTS 3
+
+// Uploaded LED sequences (see processes/SequenceProcess.h)
+#define SEQUENCE_MAX_BYTES 4096 // Largest sequence, 16-byte header plus 9 bytes per keyframe
+// Server clock sync for starting sequences together (see ClockSync.h)
+#define CLOCK_SYNC_PROBES 5 // Probes per burst; the fastest reply wins
+#define CLOCK_SYNC_PROBE_MS 200 // Time between the probes of a burst
+#define CLOCK_SYNC_INTERVAL_MS 60000 // Time between bursts, against clock drift
+#define CLOCK_SYNC_MAX_RTT_MS 1000 // Replies slower than this are ignored
 
 #define VIBRATION_MOTOR_PIN 0
 
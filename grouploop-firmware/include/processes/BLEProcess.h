@@ -1,48 +1,105 @@
 #ifndef BLE_PROCESS_H
 #define BLE_PROCESS_H
 
-#include <BLEDevice.h>
-#include <BLEScan.h>
 #include "Process.h"
+#include "ProcessManager.h"
 #include "Timer.h"
 #include "config.h"
+#include "Configuration.h"
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "Positioning.h"
+#include "Advertisement.h"
+#include "processes/IMUProcess.h"
+#include "ble/BeaconScanner.h"
+#include "RadioArbiter.h"
+#include "TraceRecorder.h"
 
-// Forward declaration for the global pointer
-class BLEProcess;
-extern BLEProcess* g_BLEProcess;
+// Select the BLE stack at build time
+#if defined(BLE_BACKEND_NIMBLE)
+#include "ble/NimBLEBeaconScanner.h"
+typedef NimBLEBeaconScanner PlatformBeaconScanner;
+#else
+#include "ble/BluedroidBeaconScanner.h"
+typedef BluedroidBeaconScanner PlatformBeaconScanner;
+#endif
 
-// The callback function that is executed when the scan is complete.
-void scanCompleteCallback(BLEScanResults results);
+// Resource and timing figures used to compare BLE backends
+struct BLEScanStats {
+    const char* backend;
+    uint32_t readyAtMs;          // millis() since boot when scanning was ready
+    uint32_t initMs;             // time spent in the stack's init
+    int32_t initHeapCost;        // free heap consumed by the stack's init
+    uint32_t callbackCount;
+    uint32_t callbackTotalUs;
+    uint32_t callbackMaxUs;
+};
+
+// Marks an anchor whose advertisements carry no TX power level
+#define TX_POWER_UNKNOWN 127
 
-class BLEProcess : public Process {
+class BLEProcess : public Process, public AdvertisementSink {
 public:
     BLEProcess()
         : Process(),
           scanOnTimer((unsigned long)(SCAN_DURATION * 1000)),
           scanOffTimer(SCAN_INTERVAL_MS),
-          pBLEScan(nullptr),
-          scanning(false)
+          scanning(false),
+          scanPending(false),
+          imuProcess(nullptr),
+          lastFixTime(0),
+          calibrationIndex(-1),
+          calibrationSum(0),
+          calibrationScans(0),
+          calibrationStartedAt(0),
+          advertsSeen(0),
+          advertsMatched(0)
     {
-        g_BLEProcess = this;
         // Initialize RSSI buffer
-        for (int i = 0; i < 4; ++i) beaconRssi[i] = -128;
+        for (int i = 0; i < 4; ++i) {
+            beaconRssi[i] = -128;
+            advertisedTxPower[i] = TX_POWER_UNKNOWN;
+        }
+        resetAccumulators();
+        positionFix = PositionFix{0.0f, 0.0f, 0.0f, false};
+        scanStats = BLEScanStats{scanner.getName(), 0, 0, 0, 0, 0, 0};
     }
 
     void setup() override {
-        Process::setup();        
-        BLEDevice::init("");
-        pBLEScan = BLEDevice::getScan();
-        pBLEScan->setActiveScan(false);
-        pBLEScan->setInterval(BLE_SCAN_INTERVAL);
-        pBLEScan->setWindow(BLE_SCAN_WINDOW);
+        Process::setup();
+        uint32_t heapBefore = ESP.getFreeHeap();
+        unsigned long initStart = millis();
+        scanner.begin(this);
+        scanStats.initMs = millis() - initStart;
+        scanStats.initHeapCost = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+        scanStats.readyAtMs = millis();
+        radioArbiter.setCoexPreference((CoexPreference)configuration.getCoexPreference());
+        // Decode the match targets once instead of per advertisement
+        parseUuid128(BEACON_SERVICE_UUID, serviceUuid);
+        loadAnchorAddresses();
+        // IMU motion feeds the position filter
+        if (processManager) {
+            imuProcess = static_cast<IMUProcess*>(processManager->getProcess("imu"));
+        }
+        lastFixTime = millis();
+        registerCommands();
         // Start in OFF period; will begin scanning after the first off interval elapses
         scanOffTimer.reset();
-        Serial.println("BLE Initialized");
+        LOG_INFO("BLE Initialized (%s): init %lu ms, heap cost %ld bytes, free heap %lu",
+                 scanStats.backend, (unsigned long)scanStats.initMs, (long)scanStats.initHeapCost,
+                 (unsigned long)ESP.getFreeHeap());
     }
 
     void update() override {
+        if (calibrationIndex >= 0 && millis() - calibrationStartedAt > CALIBRATION_TIMEOUT_MS) {
+            abortCalibration();
+        }
         if (!scanning) {
             if (scanOffTimer.checkAndReset()) {
+                scanPending = true;
+            }
+            // Wait for the gap right after an uplink frame
+            if (scanPending && radioArbiter.scanSlotOpen()) {
                 startScan();
             }
         } else {
@@ -52,52 +109,288 @@ public:
         }
     }
 
-    void onScanComplete(BLEScanResults results) {
-        Serial.printf("Scan complete! Found %d devices.\n", results.getCount());
-        BLEUUID targetUUID(BEACON_SERVICE_UUID);
-        int matched = 0;
-        // reset buffer for this scan cycle
-        for (int k = 0; k < 4; ++k) beaconRssi[k] = -128;
-        for (int i = 0; i < results.getCount(); ++i) {
-            BLEAdvertisedDevice dev = results.getDevice(i);
-            if (dev.isAdvertisingService(targetUUID)) {
-                matched++;
-                // Handle beacon device here (e.g., store, publish, etc.)
-                // Example: print address and RSSI for matches
-                Serial.printf("Beacon %s RSSI %d\n", dev.getAddress().toString().c_str(), dev.getRSSI());
-                // Store RSSI in first four slots
-                if (matched <= 4) {
-                    beaconRssi[matched - 1] = dev.getRSSI();
-                }
-            }
-        }
-        Serial.printf("Matched %d beacon devices with UUID %s\n", matched, BEACON_SERVICE_UUID);
+    // Halted while WiFi is down: close the scan window now, or the radio
+    // keeps scanning and the arbiter keeps holding uplink frames for it
+    void onHalt() override {
+        stopScan();
+        scanPending = false;
     }
 
-private:
+    // Called from the BLE stack's task for every received advertisement.
+    // Must stay allocation-free: only the raw payload and address are read.
+    void onAdvertisement(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) override {
+        traceRecorder.recordAdvert(address, rssi, payload, length);
+        unsigned long start = micros();
+        handleAdvertisement(address, rssi, payload, length);
+        uint32_t elapsed = micros() - start;
+        scanStats.callbackCount++;
+        scanStats.callbackTotalUs += elapsed;
+        if (elapsed > scanStats.callbackMaxUs) scanStats.callbackMaxUs = elapsed;
+    }
+
+    const BLEScanStats& getScanStats() const { return scanStats; }
+
+    // Print backend resource usage (used by the status command)
+    void printScanStats() const {
+        uint32_t average = scanStats.callbackCount ? scanStats.callbackTotalUs / scanStats.callbackCount : 0;
+        Serial.printf("BLE backend: %s, ready at %lu ms, init %lu ms, heap cost %ld bytes\n",
+                      scanStats.backend, (unsigned long)scanStats.readyAtMs, (unsigned long)scanStats.initMs,
+                      (long)scanStats.initHeapCost);
+        Serial.printf("BLE callbacks: %lu, avg %lu us, max %lu us\n",
+                      (unsigned long)scanStats.callbackCount, (unsigned long)average,
+                      (unsigned long)scanStats.callbackMaxUs);
+    }
+
+    // Scan windows normally follow the timers in update(); a trace replay
+    // (host/replay) opens and closes them at the recorded times instead
     void startScan() {
-        Serial.println("Starting BLE scan...");
         if (scanning) return;
-        // duration=0 -> indefinite scan; we'll stop manually with timers
-        pBLEScan->start(0, nullptr, false);
+        LOG_DEBUG("Starting BLE scan");
+        resetAccumulators();
+        uint16_t intervalMs, windowMs;
+        radioArbiter.getScanTiming(intervalMs, windowMs);
+        scanner.setScanTiming(intervalMs, windowMs);
+        scanner.start();
+        radioArbiter.onScanStarted();
+        traceRecorder.recordScan(true);
         scanning = true;
+        scanPending = false;
         scanOnTimer.reset();
     }
 
     void stopScan() {
         if (!scanning) return;
-        Serial.println("Stopping BLE scan...");
-        pBLEScan->stop();
+        LOG_DEBUG("Stopping BLE scan");
+        scanner.stop();
+        radioArbiter.onScanStopped();
+        traceRecorder.recordScan(false);
         scanning = false;
-        // Optionally emit completion behavior similar to callback
-        onScanComplete(pBLEScan->getResults());
+        onScanComplete();
         scanOffTimer.reset();
     }
 
+    // Fold this scan window's advertisements into the per-anchor RSSI
+    void onScanComplete() {
+        for (int k = 0; k < 4; ++k) {
+            beaconRssi[k] = rssiCount[k] > 0 ? (int)(rssiSum[k] / (int32_t)rssiCount[k]) : -128;
+        }
+        LOG_DEBUG("Scan complete: %lu adverts, %lu from beacons",
+                  (unsigned long)advertsSeen, (unsigned long)advertsMatched);
+        if (calibrationIndex >= 0) {
+            updateCalibration();
+        }
+        updatePosition();
+    }
+
+private:
+    void handleAdvertisement(const uint8_t* address, int rssi, const uint8_t* payload, size_t length) {
+        advertsSeen++;
+        if (!advertisesService128(payload, length, serviceUuid)) return;
+        advertsMatched++;
+        int index = anchorIndexForAddress(address);
+        if (index < 0) return;
+        LOG_DEBUG_EVERY(LOG_HOT_INTERVAL_MS, "Beacon %s RSSI %d", anchorKeyForIndex(index), rssi);
+        // Average the duplicates received during this scan window
+        rssiSum[index] += rssi;
+        rssiCount[index]++;
+        int8_t txPower;
+        if (findTxPowerLevel(payload, length, txPower)) {
+            advertisedTxPower[index] = txPower;
+        }
+    }
+
+    void resetAccumulators() {
+        for (int k = 0; k < 4; ++k) {
+            rssiSum[k] = 0;
+            rssiCount[k] = 0;
+        }
+        advertsSeen = 0;
+        advertsMatched = 0;
+    }
+
+    // Decode the configured anchor addresses (NW, NE, SE, SW) to raw bytes
+    void loadAnchorAddresses() {
+        const String* addresses[4] = {
+            &configuration.getBeaconNW(),
+            &configuration.getBeaconNE(),
+            &configuration.getBeaconSE(),
+            &configuration.getBeaconSW()
+        };
+        for (int i = 0; i < 4; ++i) {
+            anchorValid[i] = parseMacAddress(addresses[i]->c_str(), anchorAddress[i]);
+        }
+    }
+
+    // Map a beacon address to its anchor slot (NW, NE, SE, SW)
+    int anchorIndexForAddress(const uint8_t* address) const {
+        for (int i = 0; i < 4; ++i) {
+            if (anchorValid[i] && memcmp(address, anchorAddress[i], 6) == 0) return i;
+        }
+        return -1;
+    }
+
+    static int anchorIndexForKey(const char* key) {
+        if (!key) return -1;
+        if (strcmp(key, "NW") == 0) return 0;
+        if (strcmp(key, "NE") == 0) return 1;
+        if (strcmp(key, "SE") == 0) return 2;
+        if (strcmp(key, "SW") == 0) return 3;
+        return -1;
+    }
+
+    static const char* anchorKeyForIndex(int index) {
+        static const char* const anchorKeys[4] = {"NW", "NE", "SE", "SW"};
+        return index >= 0 && index < 4 ? anchorKeys[index] : "";
+    }
+
+    static int configuredRssiAt1m(int index) {
+        switch (index) {
+            case 0: return configuration.getRssiAt1mNW();
+            case 1: return configuration.getRssiAt1mNE();
+            case 2: return configuration.getRssiAt1mSE();
+            default: return configuration.getRssiAt1mSW();
+        }
+    }
+
+    static void setConfiguredRssiAt1m(int index, int rssi) {
+        switch (index) {
+            case 0: configuration.setRssiAt1mNW(rssi); break;
+            case 1: configuration.setRssiAt1mNE(rssi); break;
+            case 2: configuration.setRssiAt1mSE(rssi); break;
+            default: configuration.setRssiAt1mSW(rssi); break;
+        }
+    }
+
+    // Expected RSSI at 1 m for an anchor: the calibrated value if present,
+    // else derived from the advertised TX power, else the global default.
+    int rssiAt1mForIndex(int index) const {
+        int calibrated = configuredRssiAt1m(index);
+        if (calibrated != 0) return calibrated;
+        if (advertisedTxPower[index] != TX_POWER_UNKNOWN) {
+            return advertisedTxPower[index] - TX_POWER_TO_1M_LOSS;
+        }
+        return BEACON_DEFAULT_RSSI_AT_1M;
+    }
+
+    // Average the anchor's RSSI over CALIBRATION_SCANS scans while the device
+    // is held 1 m from it, then store the result as its reference RSSI
+    void updateCalibration() {
+        if (rssiCount[calibrationIndex] == 0) return;
+        calibrationSum += beaconRssi[calibrationIndex];
+        calibrationScans++;
+        if (calibrationScans < CALIBRATION_SCANS) return;
+
+        int reference = calibrationSum / calibrationScans;
+        setConfiguredRssiAt1m(calibrationIndex, reference);
+        Serial.print("Calibrated ");
+        Serial.print(anchorKeyForIndex(calibrationIndex));
+        Serial.print(" RSSI at 1m: ");
+        Serial.println(reference);
+        calibrationIndex = -1;
+    }
+
+    // The anchor wasn't heard often enough in time: keep the reference RSSI
+    // it had, so the distances stay as they were
+    void abortCalibration() {
+        LOG_WARN("Calibration of %s timed out after %d of %d scans", anchorKeyForIndex(calibrationIndex),
+                 calibrationScans, CALIBRATION_SCANS);
+        Serial.print("Calibration failed: ");
+        Serial.print(anchorKeyForIndex(calibrationIndex));
+        Serial.println(" not heard, previous value kept");
+        calibrationIndex = -1;
+    }
+
+    void registerCommands() {
+        // calibrate:<NW|NE|SE|SW> records the reference RSSI at 1 m,
+        // calibrate:clear falls back to advertised TX power / defaults
+        commandRegistry.registerCommand("calibrate", [this](const String& params) {
+            if (params == "clear") {
+                for (int i = 0; i < 4; ++i) setConfiguredRssiAt1m(i, 0);
+                calibrationIndex = -1;
+                Serial.println("Cleared beacon calibration");
+                return;
+            }
+            int index = anchorIndexForKey(params.c_str());
+            if (index < 0) {
+                Serial.println("calibrate requires NW, NE, SE, SW or clear");
+                return;
+            }
+            calibrationIndex = index;
+            calibrationSum = 0;
+            calibrationScans = 0;
+            calibrationStartedAt = millis();
+            Serial.print("Calibrating ");
+            Serial.print(params);
+            Serial.println(" - hold the device 1 m from the beacon");
+        });
+    }
+
+    // Estimate the position from this scan's RSSI values and feed the filter
+    void updatePosition() {
+        float width = configuration.getRoomWidth();
+        float height = configuration.getRoomHeight();
+        const Anchor anchors[ANCHOR_COUNT] = {
+            {0.0f, 0.0f},       // NW
+            {width, 0.0f},      // NE
+            {width, height},    // SE
+            {0.0f, height}      // SW
+        };
+
+        float distances[ANCHOR_COUNT];
+        bool present[ANCHOR_COUNT];
+        for (int i = 0; i < ANCHOR_COUNT; ++i) {
+            present[i] = beaconRssi[i] > -128;
+            distances[i] = present[i]
+                ? rssiToDistance(beaconRssi[i], rssiAt1mForIndex(i), configuration.getPathLossExponent())
+                : 0.0f;
+        }
+
+        unsigned long now = millis();
+        float dt = (now - lastFixTime) / 1000.0f;
+        lastFixTime = now;
+        float motion = imuProcess ? imuProcess->takePeakMotion() : 0.0f;
+        positionFilter.predict(dt, motion);
+
+        float x, y, rmsError;
+        if (trilaterate(anchors, distances, present, ANCHOR_COUNT, x, y, rmsError)) {
+            x = constrain(x, 0.0f, width);
+            y = constrain(y, 0.0f, height);
+            // Never trust a fix more than ~0.5 m, even with a perfect residual
+            float variance = rmsError * rmsError;
+            if (variance < 0.25f) variance = 0.25f;
+            positionFilter.update(x, y, variance);
+        }
+
+        positionFix.valid = positionFilter.isInitialized();
+        positionFix.x = positionFilter.getX();
+        positionFix.y = positionFilter.getY();
+        positionFix.confidence = positionFilter.getConfidence();
+    }
+
     Timer scanOnTimer;   // how long to scan (ms)
     Timer scanOffTimer;  // gap between scans (ms)
-    BLEScan* pBLEScan;
+    PlatformBeaconScanner scanner;
+    BLEScanStats scanStats;
     bool scanning;
+    bool scanPending;               // off period over, waiting for a radio slot
+    IMUProcess* imuProcess;
+    PositionFilter positionFilter;
+    PositionFix positionFix;
+    unsigned long lastFixTime;
+    int calibrationIndex;       // anchor being calibrated, -1 when idle
+    int calibrationSum;
+    int calibrationScans;
+    unsigned long calibrationStartedAt;
+
+    uint8_t serviceUuid[16];
+    uint8_t anchorAddress[4][6];
+    bool anchorValid[4];
+    // Written from the BLE task while scanning, read after the scan stops
+    volatile int32_t rssiSum[4];
+    volatile uint16_t rssiCount[4];
+    volatile uint32_t advertsSeen;
+    volatile uint32_t advertsMatched;
+    volatile int8_t advertisedTxPower[4];
 
 public:
     int getBeaconRSSIByIndex(int index) const {
@@ -106,23 +399,33 @@ public:
     }
 
     int getBeaconRSSI(const char* key) const {
-        if (!key) return -128;
-        if (strcmp(key, "NW") == 0) return beaconRssi[0];
-        if (strcmp(key, "NE") == 0) return beaconRssi[1];
-        if (strcmp(key, "SE") == 0) return beaconRssi[2];
-        if (strcmp(key, "SW") == 0) return beaconRssi[3];
-        return -128;
+        int index = anchorIndexForKey(key);
+        return index >= 0 ? beaconRssi[index] : -128;
+    }
+
+    // RSSI corrected for the anchor's own reference level and normalized to
+    // BEACON_DEFAULT_RSSI_AT_1M, so all beacon hardware reads the same at
+    // the same distance
+    int getBeaconCalibratedRSSI(const char* key) const {
+        int index = anchorIndexForKey(key);
+        if (index < 0 || beaconRssi[index] <= -128) return -128;
+        return beaconRssi[index] - rssiAt1mForIndex(index) + BEACON_DEFAULT_RSSI_AT_1M;
+    }
+
+    // Estimated distance to an anchor in meters, -1 when it was not seen
+    float getBeaconDistance(const char* key) const {
+        int index = anchorIndexForKey(key);
+        if (index < 0 || beaconRssi[index] <= -128) return -1.0f;
+        return rssiToDistance(beaconRssi[index], rssiAt1mForIndex(index), configuration.getPathLossExponent());
+    }
+
+    // Latest filtered position estimate in room coordinates (meters)
+    PositionFix getPositionFix() const {
+        return positionFix;
     }
 
 private:
     int beaconRssi[4];
 };
 
-// Define the callback function to pass to the BLE scanner
-inline void scanCompleteCallback(BLEScanResults results) {
-    if (g_BLEProcess) {
-        g_BLEProcess->onScanComplete(results);
-    }
-}
-
 #endif // BLE_PROCESS_H 
\ No newline at end of file
@@ -47,7 +47,7 @@ public:
         }
     }
     
-    String getState() override {
+    const char* getState() override {
         if (configurationMode) {
             return "configuration_mode";
         }
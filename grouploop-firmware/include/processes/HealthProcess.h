@@ -0,0 +1,134 @@
+#ifndef HEALTH_PROCESS_H
+#define HEALTH_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "Timer.h"
+#include "config.h"
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "WebSocketManager.h"
+#include "processes/WiFiProcess.h"
+#include "processes/BLEProcess.h"
+#include <esp_system.h>
+
+// Periodically reports device health to the server as
+//   health:<device id>:{"up":...,"heap":...,...}
+// so degrading devices can be spotted across the fleet without a serial
+// cable. The frame is formatted into a fixed buffer and queued as an event.
+class HealthProcess : public Process {
+public:
+    HealthProcess()
+        : Process(),
+          reportTimer(HEALTH_INTERVAL_MS),
+          wifiProcess(nullptr),
+          bleProcess(nullptr),
+          loopCount(0),
+          loopWindowStart(0),
+          loopRate(0)
+    {
+        frame[0] = '\0';
+    }
+
+    void setup() override {
+        if (processManager) {
+            wifiProcess = static_cast<WiFiProcess*>(processManager->getProcess("wifi"));
+            bleProcess = static_cast<BLEProcess*>(processManager->getProcess("ble"));
+        }
+        loopWindowStart = millis();
+        registerCommands();
+    }
+
+    // Called once per loop iteration, which is what the loop rate counts
+    void update() override {
+        loopCount++;
+        if (!reportTimer.checkAndReset()) return;
+
+        unsigned long now = millis();
+        unsigned long window = now - loopWindowStart;
+        loopRate = window > 0 ? (uint32_t)((uint64_t)loopCount * 1000 / window) : 0;
+        loopCount = 0;
+        loopWindowStart = now;
+
+        sendReport();
+    }
+
+    // Format the health frame; returns its length, or 0 if it didn't fit
+    size_t buildFrame() {
+        const UplinkStats& uplink = webSocketManager.getUplinkStats();
+        uint32_t bleCallbacks = 0, bleMaxUs = 0;
+        if (bleProcess) {
+            bleCallbacks = bleProcess->getScanStats().callbackCount;
+            bleMaxUs = bleProcess->getScanStats().callbackMaxUs;
+        }
+        int rssi = wifiProcess ? wifiProcess->getRSSI() : 0;
+        uint32_t reconnects = wifiProcess ? wifiProcess->getReconnectCount() : 0;
+        uint32_t roams = wifiProcess ? wifiProcess->getRoamCount() : 0;
+
+        int length = snprintf(frame, sizeof(frame),
+            "health:%s:{\"up\":%lu,\"reset\":\"%s\",\"heap\":%lu,\"minHeap\":%lu,\"maxBlock\":%lu,"
+            "\"loopHz\":%lu,\"rssi\":%d,\"reconn\":%lu,\"roams\":%lu,\"wsFail\":%lu,\"wsDrop\":%lu,"
+            "\"wsCoal\":%lu,\"rxDrop\":%lu,\"bleCb\":%lu,\"bleMaxUs\":%lu}",
+            webSocketManager.getDeviceId(),
+            (unsigned long)(millis() / 1000), resetReasonName(esp_reset_reason()),
+            (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+            (unsigned long)ESP.getMaxAllocHeap(), (unsigned long)loopRate, rssi,
+            (unsigned long)reconnects, (unsigned long)roams,
+            (unsigned long)uplink.sendFailures, (unsigned long)uplink.eventsDropped,
+            (unsigned long)uplink.telemetryCoalesced, (unsigned long)uplink.rxDropped,
+            (unsigned long)bleCallbacks, (unsigned long)bleMaxUs);
+        if (length < 0 || length >= (int)sizeof(frame)) {
+            frame[0] = '\0';
+            return 0;
+        }
+        return (size_t)length;
+    }
+
+    uint32_t getLoopRate() const { return loopRate; }
+
+    static const char* resetReasonName(esp_reset_reason_t reason) {
+        switch (reason) {
+            case ESP_RST_POWERON: return "poweron";
+            case ESP_RST_EXT: return "external";
+            case ESP_RST_SW: return "software";
+            case ESP_RST_PANIC: return "panic";
+            case ESP_RST_INT_WDT: return "int_wdt";
+            case ESP_RST_TASK_WDT: return "task_wdt";
+            case ESP_RST_WDT: return "wdt";
+            case ESP_RST_DEEPSLEEP: return "deepsleep";
+            case ESP_RST_BROWNOUT: return "brownout";
+            case ESP_RST_SDIO: return "sdio";
+            default: return "unknown";
+        }
+    }
+
+private:
+    void sendReport() {
+        size_t length = buildFrame();
+        if (length == 0) {
+            LOG_WARN("Health frame too long");
+            return;
+        }
+        if (webSocketManager.isConnected()) {
+            webSocketManager.sendEvent(frame, length);
+        }
+    }
+
+    void registerCommands() {
+        // health: send a report now and print it
+        commandRegistry.registerCommand("health", [this](const String& params) {
+            sendReport();
+            Serial.println(frame);
+        });
+    }
+
+    Timer reportTimer;
+    WiFiProcess* wifiProcess;
+    BLEProcess* bleProcess;
+    uint32_t loopCount;
+    unsigned long loopWindowStart;
+    uint32_t loopRate;              // loop iterations per second
+    char frame[WS_EVENT_MAX_LEN];
+};
+
+#endif // HEALTH_PROCESS_H
@@ -3,6 +3,9 @@
 
 #include "Process.h"
 #include "Timer.h"
+#include "Log.h"
+#include "TraceRecorder.h"
+#include "MotionSlot.h"
 #include "SparkFun_LIS2DH12.h"
 #include <Wire.h>
 #include <math.h>
@@ -25,8 +28,10 @@ private:
     SPARKFUN_LIS2DH12 sensor;       //Create instance
     bool sensorOk = false;
 
-    IMUData data;
+    IMUData data = {0.0f, 0.0f, 0.0f};
     bool tap = false;               // Tap detection flag
+    uint32_t tapCount = 0;          // Readings over the tap threshold since boot
+    float peakMotion = 0.0f;        // Largest |magnitude - 1g| since last read
     
 public:
     IMUProcess() : 
@@ -40,34 +45,67 @@ public:
         
         // The begin function returns a status, 0 on success
         if (sensor.begin() != 0) {
-            Serial.println("IMU sensor initialized successfully.");
+            LOG_INFO("IMU sensor initialized successfully.");
             sensorOk = true;
             sensor.setMode(LIS2DH12_NM_10bit);
             sensor.setDataRate(LIS2DH12_ODR_100Hz);
             sensor.setScale(LIS2DH12_4g);
         } else {            
-            Serial.println("Could not initialize IMU sensor.");
+            LOG_ERROR("Could not initialize IMU sensor.");
         }
     
     }
 
     void update() override {
         if (sensorOk && readTimer.checkAndReset() && sensor.available()) {
-            // --- 1. Read and Convert Data ---            
-            data.x_g = sensor.getX() * CMS2_TO_G;
-            data.y_g = sensor.getY() * CMS2_TO_G;
-            data.z_g = sensor.getZ() * CMS2_TO_G;
-            
-            // --- 2. Calculate acceleration magnitude ---
-            float magnitude = sqrt(data.x_g * data.x_g + data.y_g * data.y_g + data.z_g * data.z_g);
-            
-            // --- 3. Tap detection ---
-            if (magnitude > TAP_THRESHOLD) {
-                tap = true;
-            }
+            processReading(sensor.getX(), sensor.getY(), sensor.getZ());
         }
     }
 
+    // Take one reading in sensor units. Public so a trace replay
+    // (host/replay) can feed recorded readings in.
+    void processReading(float x, float y, float z) {
+        traceRecorder.recordImu(x, y, z);
+
+        // --- 1. Convert Data ---
+        data.x_g = x * CMS2_TO_G;
+        data.y_g = y * CMS2_TO_G;
+        data.z_g = z * CMS2_TO_G;
+        
+        // --- 2. Calculate acceleration magnitude ---
+        float magnitude = sqrt(data.x_g * data.x_g + data.y_g * data.y_g + data.z_g * data.z_g);
+        
+        // Track motion for the position filter
+        float motion = fabsf(magnitude - 1.0f);
+        if (motion > peakMotion) {
+            peakMotion = motion;
+        }
+        
+        // --- 3. Tap detection ---
+        if (magnitude > TAP_THRESHOLD) {
+            tap = true;
+            tapCount++;
+        }
+
+        // --- 4. Hand the reading to the LED behaviors ---
+        MotionSample sample;
+        sample.x = toMilliG(data.x_g);
+        sample.y = toMilliG(data.y_g);
+        sample.z = toMilliG(data.z_g);
+        sample.motion = (uint16_t)toMilliG(motion);
+        sample.taps = tapCount;
+        sample.time = millis();
+        motionSlot.publish(sample);
+    }
+
+    // g to mg, clamped to what an int16_t holds
+    static int16_t toMilliG(float g) {
+        float mg = g * 1000.0f;
+        if (mg > 32767.0f) return 32767;
+        if (mg < -32768.0f) return -32768;
+        return (int16_t)mg;
+    }
+
     IMUData getIMUData() const {
         return data;
     }
@@ -77,6 +115,19 @@ public:
         tap = false;  // Reset tap flag after reading
         return wasTapped;
     }
+    
+    // Unlike isTapped() this leaves the flag alone, so other processes can
+    // follow taps by comparing counts
+    uint32_t getTapCount() const {
+        return tapCount;
+    }
+
+    // Peak deviation from 1g (in g) since the previous call
+    float takePeakMotion() {
+        float motion = peakMotion;
+        peakMotion = 0.0f;
+        return motion;
+    }
  
 };
 
@@ -0,0 +1,214 @@
+#ifndef LED_BEHAVIOR_POOL_H
+#define LED_BEHAVIOR_POOL_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <initializer_list>
+#include <new>
+#include "config.h"
+#include "LedBehaviors.h"
+
+// LED patterns as values: a LedBehaviorSpec names a behavior type and its
+// parameters, and ledMakeBehavior() builds a fresh behavior from one. The
+// behaviors live in a LedBehaviorPool, a few fixed slots sized for the
+// largest type, so switching patterns never touches the heap and no two
+// uses of a pattern share parameters.
+
+enum LedBehaviorType : uint8_t {
+    LED_BEHAVIOR_OFF,
+    LED_BEHAVIOR_SOLID,
+    LED_BEHAVIOR_BREATHING,
+    LED_BEHAVIOR_HEARTBEAT,
+    LED_BEHAVIOR_CYCLE,
+    LED_BEHAVIOR_SPRING,
+    LED_BEHAVIOR_GRADIENT,
+    LED_BEHAVIOR_COMET,
+    LED_BEHAVIOR_TWINKLE,
+    LED_BEHAVIOR_FIRE,
+    LED_BEHAVIOR_SHAKE,
+    LED_BEHAVIOR_TILT,
+    LED_BEHAVIOR_MOTION_SPRING,
+    LED_BEHAVIOR_TYPE_COUNT
+};
+
+#define LED_BEHAVIOR_PARAMS 4
+
+// A behavior and everything it is built from; the parameters mean what
+// LED_BEHAVIOR_INFO lists for the type
+struct LedBehaviorSpec {
+    LedBehaviorType type;
+    uint32_t color;
+    uint16_t params[LED_BEHAVIOR_PARAMS];
+};
+
+// One parameter: its name, the value it has unless given, and its range.
+// A nullptr name ends the list.
+struct LedBehaviorParam {
+    const char* name;
+    uint16_t value;
+    uint16_t low;
+    uint16_t high;
+};
+
+struct LedBehaviorInfo {
+    const char* name;       // as in pattern:<name>
+    LedBehaviorParam params[LED_BEHAVIOR_PARAMS];
+};
+
+// Palettes are given by their index in LED_PALETTES; the spring's k,
+// damping and mass in tenths
+inline constexpr LedBehaviorInfo LED_BEHAVIOR_INFO[LED_BEHAVIOR_TYPE_COUNT] = {
+    {"off", {}},
+    {"solid", {}},
+    {"breathing", {{"duration", 2000, 100, 60000}}},
+    {"heartbeat", {{"duration", 770, 100, 10000}, {"interval", 2000, 0, 60000}}},
+    {"cycle", {{"delay", 100, 10, 10000}}},
+    {"spring", {{"k", 201, 0, 2550}, {"damping", 20, 0, 2550}, {"mass", 10, 1, 2560}}},
+    {"gradient", {{"palette", 0, 0, 4}, {"speed", 64, 1, 255}, {"period", 4000, 100, 60000}}},
+    {"comet", {{"palette", 0, 0, 4}, {"speed", 64, 1, 255}, {"period", 1200, 100, 60000}, {"decay", 230, 0, 255}}},
+    {"twinkle", {{"palette", 0, 0, 4}, {"speed", 64, 1, 255}, {"density", 8, 0, 255}, {"fade", 8, 1, 255}}},
+    {"fire", {{"palette", 1, 0, 4}, {"speed", 64, 1, 255}, {"cooling", 40, 0, 255}, {"sparking", 120, 0, 255}}},
+    {"shake", {{"mg", 1000, 100, 16000}, {"floor", 16, 0, 255}, {"release", 12, 1, 255}}},
+    {"tilt", {{"palette", 0, 0, 4}, {"mg", 1000, 100, 16000}, {"floor", 24, 0, 255}}},
+    {"motionspring", {{"mg", 1000, 100, 16000}, {"kick", 80, 0, 1000}}},
+};
+
+static_assert(sizeof(LED_PALETTES) / sizeof(LED_PALETTES[0]) == 5, "palette parameters range over LED_PALETTES");
+
+// 'type' with its default parameters
+inline LedBehaviorSpec ledDefaultSpec(LedBehaviorType type, uint32_t color) {
+    LedBehaviorSpec spec{type, color, {0, 0, 0, 0}};
+    for (int i = 0; i < LED_BEHAVIOR_PARAMS; ++i) spec.params[i] = LED_BEHAVIOR_INFO[type].params[i].value;
+    return spec;
+}
+
+// The type named by the first 'length' characters of 'name', or -1
+inline int ledFindBehaviorType(const char* name, size_t length) {
+    for (int type = 0; type < LED_BEHAVIOR_TYPE_COUNT; ++type) {
+        const char* candidate = LED_BEHAVIOR_INFO[type].name;
+        if (strlen(candidate) == length && strncmp(candidate, name, length) == 0) return type;
+    }
+    return -1;
+}
+
+// Index of the parameter 'name' of 'type', or -1 if it has none
+inline int ledFindBehaviorParam(LedBehaviorType type, const char* name) {
+    for (int i = 0; i < LED_BEHAVIOR_PARAMS; ++i) {
+        const char* candidate = LED_BEHAVIOR_INFO[type].params[i].name;
+        if (candidate && strcmp(candidate, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Known type, every parameter in its range
+inline bool ledSpecValid(const LedBehaviorSpec& spec) {
+    if (spec.type >= LED_BEHAVIOR_TYPE_COUNT) return false;
+    for (int i = 0; i < LED_BEHAVIOR_PARAMS; ++i) {
+        const LedBehaviorParam& param = LED_BEHAVIOR_INFO[spec.type].params[i];
+        if (param.name && (spec.params[i] < param.low || spec.params[i] > param.high)) return false;
+    }
+    return true;
+}
+
+// <name>[:<param>...] as the pattern command takes it, in 'color'; the
+// parameters not given keep their defaults, a palette may be given by
+// name. False on an unknown name or a value out of range.
+bool ledParseSpec(const char* text, uint32_t color, LedBehaviorSpec& spec);
+
+// The spec as ledParseSpec() reads it, e.g. "breathing:2000"
+int ledFormatSpec(const LedBehaviorSpec& spec, char* buffer, size_t size);
+
+constexpr size_t ledLargest(std::initializer_list<size_t> values) {
+    size_t largest = 0;
+    for (size_t value : values) largest = value > largest ? value : largest;
+    return largest;
+}
+
+// Every type ledMakeBehavior() builds. All derive from LedBehavior alone,
+// so a behavior's address is its slot's.
+#define LED_BEHAVIOR_TYPES LedsOffBehavior, SolidBehavior, BreathingBehavior, HeartBeatBehavior, \
+    CycleBehavior, SpringBehavior, GradientBehavior, CometBehavior, TwinkleBehavior, FireBehavior, \
+    ShakeBehavior, TiltBehavior, MotionSpringBehavior
+
+template <typename... T>
+constexpr size_t ledMaxSize() { return ledLargest({sizeof(T)...}); }
+template <typename... T>
+constexpr size_t ledMaxAlign() { return ledLargest({alignof(T)...}); }
+
+inline constexpr size_t LED_BEHAVIOR_SIZE = ledMaxSize<LED_BEHAVIOR_TYPES>();
+inline constexpr size_t LED_BEHAVIOR_ALIGN = ledMaxAlign<LED_BEHAVIOR_TYPES>();
+
+// Build the behavior 'spec' describes in 'memory' (LED_BEHAVIOR_SIZE bytes,
+// aligned to LED_BEHAVIOR_ALIGN) with placement new. nullptr for a spec
+// that is not ledSpecValid().
+LedBehavior* ledMakeBehavior(const LedBehaviorSpec& spec, void* memory);
+
+// Fixed slots for behaviors made from specs. create() and release() may
+// run on different tasks (a command on the main loop, the LED ticker):
+// a slot is claimed and handed back through an atomic flag, and the
+// behavior in it belongs to whoever claimed it until then.
+class LedBehaviorPool {
+public:
+    LedBehaviorPool() {
+        for (int i = 0; i < LED_BEHAVIOR_SLOTS; ++i) used[i].store(false, std::memory_order_relaxed);
+    }
+
+    ~LedBehaviorPool() {
+        for (int i = 0; i < LED_BEHAVIOR_SLOTS; ++i) {
+            if (used[i].load(std::memory_order_acquire)) behaviorAt(i)->~LedBehavior();
+        }
+    }
+
+    LedBehaviorPool(const LedBehaviorPool&) = delete;
+    LedBehaviorPool& operator=(const LedBehaviorPool&) = delete;
+
+    // nullptr if every slot is taken or the spec is invalid
+    LedBehavior* create(const LedBehaviorSpec& spec) {
+        for (int i = 0; i < LED_BEHAVIOR_SLOTS; ++i) {
+            bool expected = false;
+            if (!used[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) continue;
+            LedBehavior* behavior = ledMakeBehavior(spec, slots[i].bytes);
+            if (!behavior) used[i].store(false, std::memory_order_release);
+            return behavior;
+        }
+        return nullptr;
+    }
+
+    // Destroy a behavior from create() and free its slot; anything else,
+    // nullptr included, is left alone
+    void release(LedBehavior* behavior) {
+        int slot = slotOf(behavior);
+        if (slot < 0) return;
+        behavior->~LedBehavior();
+        used[slot].store(false, std::memory_order_release);
+    }
+
+    bool owns(const LedBehavior* behavior) const { return slotOf(behavior) >= 0; }
+
+    int inUse() const {
+        int count = 0;
+        for (int i = 0; i < LED_BEHAVIOR_SLOTS; ++i) count += used[i].load(std::memory_order_relaxed);
+        return count;
+    }
+
+private:
+    struct alignas(LED_BEHAVIOR_ALIGN) Slot {
+        uint8_t bytes[LED_BEHAVIOR_SIZE];
+    };
+
+    LedBehavior* behaviorAt(int slot) {
+        return std::launder(reinterpret_cast<LedBehavior*>(slots[slot].bytes));
+    }
+
+    int slotOf(const LedBehavior* behavior) const {
+        for (int i = 0; i < LED_BEHAVIOR_SLOTS; ++i) {
+            if ((const void*)behavior == (const void*)slots[i].bytes) return i;
+        }
+        return -1;
+    }
+
+    Slot slots[LED_BEHAVIOR_SLOTS];
+    std::atomic<bool> used[LED_BEHAVIOR_SLOTS];
+};
+
+#endif // LED_BEHAVIOR_POOL_H
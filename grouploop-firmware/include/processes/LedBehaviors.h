@@ -1,7 +1,10 @@
 #ifndef LED_BEHAVIORS_H
 #define LED_BEHAVIORS_H
 
-#include <Adafruit_NeoPixel.h>
+#include "LedFrame.h"
+#include "LedMath.h"
+#include "LedPalette.h"
+#include "MotionSlot.h"
 #include "Timer.h"
 #include "Utils.h"
 
@@ -13,8 +16,8 @@ protected:
 public:
     const char* type;
     virtual ~LedBehavior() {}
-    virtual void setup(Adafruit_NeoPixel& pixels) {
-        this->pixels = &pixels;
+    virtual void setup(LedFrame& frame) {
+        this->frame = &frame;
     }
     virtual void update() = 0;
     virtual void updateParams() {}
@@ -31,14 +34,27 @@ public:
     }
 
 protected:
-    LedBehavior(const char* type) : type(type) {        
+    LedBehavior(const char* type) : type(type), frame(nullptr) {        
     }
-    Adafruit_NeoPixel* pixels;
+    LedFrame* frame;
+
+    // The latest IMU reading, if there is one from the last
+    // LED_MOTION_STALE_MS; read straight from IMUProcess without a lock
+    static bool readMotion(MotionSample& sample) {
+        return motionSlot.read(sample) && millis() - sample.time < LED_MOTION_STALE_MS;
+    }
+
+    // 'value' on a scale of 0-255 where 'fullScale' is 255
+    static uint8_t motionLevel(uint32_t value, uint16_t fullScale) {
+        if (fullScale == 0 || value >= fullScale) return 255;
+        return (uint8_t)(value * 255 / fullScale);
+    }
+
     uint32_t scaleColor(uint32_t color, uint8_t brightness) {
-        uint8_t r = (uint8_t)(((color >> 16) & 0xFF) * brightness / 255);
-        uint8_t g = (uint8_t)(((color >> 8) & 0xFF) * brightness / 255);
-        uint8_t b = (uint8_t)((color & 0xFF) * brightness / 255);
-        return pixels->Color(r, g, b);
+        uint8_t r = ledScale8((uint8_t)(color >> 16), brightness);
+        uint8_t g = ledScale8((uint8_t)(color >> 8), brightness);
+        uint8_t b = ledScale8((uint8_t)color, brightness);
+        return LedFrame::Color(r, g, b);
     }
 };
 
@@ -48,10 +64,10 @@ protected:
 class LedsOffBehavior : public LedBehavior {
 public:
     LedsOffBehavior() : LedBehavior("Off") {}
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
-        this->pixels->clear();
-        this->pixels->show();
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        this->frame->clear();
+        this->frame->show();
     }
     void update() override {
         // Do nothing, LEDs are off
@@ -65,10 +81,10 @@ public:
         setColor(color);
     }
   
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
-        this->pixels->fill(color);
-        this->pixels->show();
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        this->frame->fill(color);
+        this->frame->show();
     }
     void update() override {
         // Do nothing, color is set in setup.
@@ -84,17 +100,17 @@ public:
         setTimerInterval(1000 / 50);
     } // 50Hz for smooth animation
 
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
         updateTimer.reset();
     }
 
     void update() override {
         if (updateTimer.checkAndReset()) {
-            float sine_wave = sin(updateTimer.elapsed() * 2.0 * PI / duration); // 4-second period
-            uint8_t brightness = (uint8_t)(((sine_wave + 1.0) / 2.0) * 255.0);
-            pixels->fill(scaleColor(color, brightness));
-            pixels->show();
+            // One sine period per 'duration', from the table
+            uint8_t brightness = ledSineWave(ledPhase16(updateTimer.elapsed(), duration)) >> 8;
+            frame->fill(scaleColor(color, brightness));
+            frame->show();
         }
     }
 
@@ -117,14 +133,14 @@ public:
         setTimerInterval(20); // 50Hz update rate for smooth animation
     }    
 
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
         state = IDLE;
         stateStartTime = updateTimer.elapsed();
         currentStateDuration = pulse_interval;
         updateTimer.reset();
-        this->pixels->clear();
-        this->pixels->show();
+        this->frame->clear();
+        this->frame->show();
     }
 
     void update() override {
@@ -142,26 +158,26 @@ public:
                 
             case FADE_IN_1: {
                 if (elapsed >= currentStateDuration) {
-                    pixels->fill(color);
-                    pixels->show();
+                    frame->fill(color);
+                    frame->show();
                     startState(FADE_OUT_1, getScaledDuration(FADE_OUT_1_DUR));
                 } else {
                     uint8_t brightness = (elapsed * 255) / currentStateDuration;
-                    pixels->fill(scaleColor(color, brightness));
-                    pixels->show();
+                    frame->fill(scaleColor(color, brightness));
+                    frame->show();
                 }
                 break;
             }
             
             case FADE_OUT_1: {
                 if (elapsed >= currentStateDuration) {
-                    pixels->clear();
-                    pixels->show();
+                    frame->clear();
+                    frame->show();
                     startState(PAUSE, getScaledDuration(PAUSE_DUR));
                 } else {
                     uint8_t brightness = 255 - (elapsed * 255 / currentStateDuration);
-                    pixels->fill(scaleColor(color, brightness));
-                    pixels->show();
+                    frame->fill(scaleColor(color, brightness));
+                    frame->show();
                 }
                 break;
             }
@@ -174,26 +190,26 @@ public:
                 
             case FADE_IN_2: {
                 if (elapsed >= currentStateDuration) {
-                    pixels->fill(color);
-                    pixels->show();
+                    frame->fill(color);
+                    frame->show();
                     startState(FADE_OUT_2, getScaledDuration(FADE_OUT_2_DUR));
                 } else {
                     uint8_t brightness = (elapsed * 255) / currentStateDuration;
-                    pixels->fill(scaleColor(color, brightness));
-                    pixels->show();
+                    frame->fill(scaleColor(color, brightness));
+                    frame->show();
                 }
                 break;
             }
             
             case FADE_OUT_2: {
                 if (elapsed >= currentStateDuration) {
-                    pixels->clear();
-                    pixels->show();
+                    frame->clear();
+                    frame->show();
                     startState(IDLE, pulse_interval);
                 } else {
                     uint8_t brightness = 255 - (elapsed * 255 / currentStateDuration);
-                    pixels->fill(scaleColor(color, brightness));
-                    pixels->show();
+                    frame->fill(scaleColor(color, brightness));
+                    frame->show();
                 }
                 break;
             }
@@ -241,18 +257,18 @@ public:
         setTimerInterval(delay);
     }
 
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
         updateTimer.reset();
         currentPixel = 0;
     }
 
     void update() override {
         if (updateTimer.checkAndReset()) {
-            pixels->clear();
-            pixels->setPixelColor(currentPixel, color);
-            pixels->show();
-            currentPixel = (currentPixel + 1) % pixels->numPixels();
+            frame->clear();
+            frame->setPixelColor(currentPixel, color);
+            frame->show();
+            currentPixel = (currentPixel + 1) % frame->numPixels();
         }
     }
 
@@ -260,7 +276,9 @@ private:
     int currentPixel;
 };
 
-// 5. SpringBehavior - Implements Hooke's law for LED brightness
+// 5. SpringBehavior - Implements Hooke's law for LED brightness. The
+// parameters are floats; the simulation runs in fixed point, brightness
+// and velocity in Q15 (32768 is full brightness).
 class SpringBehavior : public LedBehavior {
 public:
     float targetBrightness;    // Target brightness (0.0 to 1.0)
@@ -274,18 +292,19 @@ public:
           springConstant(springConstant),
           damping(damping),
           mass(mass),
-          currentBrightness(1.0f),
-          velocity(0.0f),
+          currentBrightness(ONE),
+          velocity(0),
           lastUpdateTime(0) {
         setColor(color);
         setTimerInterval(16); // ~60Hz for smooth physics simulation
+        updateCoefficients();
     }
 
-    void setup(Adafruit_NeoPixel& pixels) override {
-        LedBehavior::setup(pixels);
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
         updateTimer.reset();
-        currentBrightness = 1.0f;
-        velocity = 0.0f;
+        currentBrightness = ONE;
+        velocity = 0;
         lastUpdateTime = 0;
     }
 
@@ -297,71 +316,515 @@ public:
                 return;
             }
             
-            // Calculate delta time in seconds
-            float deltaTime = (currentTime - lastUpdateTime) / 1000.0f;
+            // Delta time in seconds, Q16
+            int64_t deltaTime = ((int64_t)(currentTime - lastUpdateTime) << 16) / 1000;
             lastUpdateTime = currentTime;
             
-            // Hooke's law: F = -k * x (where x is displacement from equilibrium)
-            float displacement = currentBrightness - targetBrightness;
-            float springForce = -springConstant * displacement;
-            
-            // Apply damping force (proportional to velocity)
-            float dampingForce = -damping * velocity;
-            
-            // Net force
-            float netForce = springForce + dampingForce;
-            
-            // Newton's second law: F = ma, so a = F/m
-            float acceleration = netForce / mass;
+            // Hooke's law with damping, divided by the mass:
+            // a = (-k * x - c * v) / m
+            int64_t displacement = (int64_t)currentBrightness - target;
+            int64_t acceleration = -ledMulQ16(stiffness, displacement) - ledMulQ16(friction, velocity);
             
             // Update velocity and position using simple Euler integration
-            velocity += acceleration * deltaTime;
-            currentBrightness += velocity * deltaTime;
-            
-            // Clamp brightness to valid range
-            //currentBrightness = constrain(currentBrightness, 0.0f, 1.0f);
+            velocity = clampState(velocity + ledMulQ16(acceleration, deltaTime));
+            currentBrightness = clampState(currentBrightness + ledMulQ16(velocity, deltaTime));
             
-            // Convert to 8-bit brightness and apply to LEDs
-            uint8_t brightness = (uint8_t)(abs(currentBrightness) * 255.0f);
-            pixels->fill(scaleColor(color, brightness));
-            pixels->show();
+            // Convert to 8-bit brightness and apply to LEDs. An overshoot
+            // past full brightness saturates instead of wrapping to dark.
+            int32_t level = currentBrightness < 0 ? -currentBrightness : currentBrightness;
+            if (level > ONE) level = ONE;
+            uint8_t brightness = (uint8_t)((level * 255) >> 15);
+            frame->fill(scaleColor(color, brightness));
+            frame->show();
         }
     }
 
     void setTargetBrightness(float target) {
         targetBrightness = constrain(target, 0.0f, 1.0f);
+        updateCoefficients();
     }
 
     void setSpringParams(float k, float damp, float m) {
         springConstant = k;
         damping = damp;
         mass = m;
+        updateCoefficients();
     }
 
     void reset() override {
         LedBehavior::reset();
     
-        currentBrightness = 1.0f;
+        currentBrightness = ONE;
         targetBrightness = 0.0f;
-        velocity = 0.0f;
+        velocity = 0;
         lastUpdateTime = 0;
+        updateCoefficients();
     }
 
 private:
-    float currentBrightness;   // Current brightness (0.0 to 1.0)
-    float velocity;            // Current velocity of the spring
+    static const int32_t ONE = 1 << 15;
+    // Far past anything a sane spring reaches; keeps a diverging one from
+    // overflowing
+    static const int32_t STATE_LIMIT = 1 << 30;
+
+    static int32_t clampState(int64_t value) {
+        if (value > STATE_LIMIT) return STATE_LIMIT;
+        if (value < -STATE_LIMIT) return -STATE_LIMIT;
+        return (int32_t)value;
+    }
+
+    // The float parameters in fixed point, once per change instead of
+    // once per frame
+    void updateCoefficients() {
+        float m = mass > 0.0f ? mass : 0.001f;
+        target = (int32_t)(targetBrightness * ONE);
+        stiffness = (int64_t)(springConstant / m * 65536.0f);
+        friction = (int64_t)(damping / m * 65536.0f);
+    }
+
+    int32_t currentBrightness;    // Current brightness, Q15
+    int32_t velocity;             // Current velocity, Q15 per second
+    int32_t target;               // targetBrightness, Q15
+    int64_t stiffness;            // k / m, Q16
+    int64_t friction;             // damping / m, Q16
     unsigned long lastUpdateTime; // Last update time for delta calculation
 };
 
-// --- Global LED Behavior Instances ---
-// These instances are available globally to any file that includes LedBehaviors.h
+// 6. FlashBehavior - a short flash that fades out, for feedback on an
+// overlay layer. Dark (transparent) until trigger().
+class FlashBehavior : public LedBehavior {
+public:
+    unsigned long duration;
+
+    FlashBehavior(uint32_t color = 0xFFFFFF, unsigned long duration = 250)
+        : LedBehavior("Flash"), duration(duration), active(false), startTime(0) {
+        setColor(color);
+        setTimerInterval(20);
+    }
+
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        active = false;
+        this->frame->clear();
+        this->frame->show();
+    }
+
+    // Start the flash at full brightness; a flash in progress starts over
+    void trigger() {
+        active = true;
+        startTime = millis();
+        updateTimer.reset();
+        frame->fill(color);
+        frame->show();
+    }
+
+    void update() override {
+        if (!active || !updateTimer.checkAndReset()) return;
+        unsigned long elapsed = millis() - startTime;
+        if (elapsed >= duration) {
+            active = false;
+            frame->clear();
+        } else {
+            frame->fill(scaleColor(color, 255 - elapsed * 255 / duration));
+        }
+        frame->show();
+    }
+
+    bool isActive() const { return active; }
+
+private:
+    bool active;
+    unsigned long startTime;
+};
+
+// 7. StatusPixelBehavior - one pixel in a color, the rest dark; black
+// turns the indicator off
+class StatusPixelBehavior : public LedBehavior {
+public:
+    uint16_t pixel;
+
+    StatusPixelBehavior(uint16_t pixel, uint32_t color = 0) : LedBehavior("Status"), pixel(pixel) {
+        setColor(color);
+    }
+
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        draw();
+    }
+
+    void setStatus(uint32_t status) {
+        if (status == color) return;
+        setColor(status);
+        if (frame) draw();
+    }
+
+    void update() override {
+        // Do nothing, redrawn by setStatus()
+    }
+
+private:
+    void draw() {
+        frame->clear();
+        frame->setPixelColor(pixel, color);
+        frame->show();
+    }
+};
+
+// 8. PaletteBehavior - base of the procedural effects: a color per pixel,
+// looked up in a palette (LedPalette.h) by an 8-bit index, or shades of
+// the behavior's color without one. The effect runs on a clock of its own,
+// 'speed' / 64 times real time, so a change of speed does not jump.
+class PaletteBehavior : public LedBehavior {
+public:
+    const LedPalette* palette;
+    uint8_t speed;
+
+    void setPalette(const LedPalette* palette) {
+        this->palette = palette;
+    }
+
+    void setSpeed(uint8_t speed) {
+        this->speed = speed;
+    }
+
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        updateTimer.reset();
+        lastMillis = millis();
+        remainder = 0;
+        clock = 0;
+        stepped = 0;
+    }
+
+protected:
+    PaletteBehavior(const char* type, const LedPalette* palette, uint8_t speed)
+        : LedBehavior(type), palette(palette), speed(speed), clock(0), lastMillis(0), remainder(0), stepped(0) {
+        setColor(0xFFFFFF);
+        setTimerInterval(20); // 50Hz
+    }
+
+    // Move the effect clock up to now
+    void tick() {
+        unsigned long now = millis();
+        uint32_t scaled = (uint32_t)(now - lastMillis) * speed + remainder;
+        lastMillis = now;
+        remainder = scaled & 63;
+        clock += scaled >> 6;
+    }
+
+    // Whole steps of 'stepMs' on the effect clock since the last call, at
+    // most 'limit' so a long stall does not run the effect for seconds
+    uint32_t takeSteps(uint32_t stepMs, uint32_t limit) {
+        uint32_t due = clock / stepMs - stepped;
+        stepped += due;
+        return due < limit ? due : limit;
+    }
+
+    uint32_t colorAt(uint8_t index, uint8_t level) const {
+        if (!palette) {
+            uint8_t scale = ledScale8(index, level);
+            return LedFrame::Color(ledScale8((uint8_t)(color >> 16), scale),
+                                   ledScale8((uint8_t)(color >> 8), scale),
+                                   ledScale8((uint8_t)color, scale));
+        }
+        const uint8_t* rgb = palette->rgb[index];
+        return LedFrame::Color(ledScale8(rgb[0], level), ledScale8(rgb[1], level), ledScale8(rgb[2], level));
+    }
+
+    uint32_t clock;               // effect time, ms
+
+private:
+    unsigned long lastMillis;
+    uint32_t remainder;           // fraction of an effect ms, 1/64ths
+    uint32_t stepped;             // steps taken, in takeSteps() units
+};
+
+// 9. GradientBehavior - the whole palette spread over the pixels, turning
+// once per 'period' ms at speed 64
+class GradientBehavior : public PaletteBehavior {
+public:
+    uint32_t period;
+
+    GradientBehavior(const LedPalette* palette = &LED_PALETTE_RAINBOW, uint8_t speed = 64, uint32_t period = 4000)
+        : PaletteBehavior("Gradient", palette, speed), period(period) {}
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        tick();
+        uint8_t offset = ledPhase16(clock, period) >> 8;
+        for (uint16_t i = 0; i < LED_COUNT; ++i) {
+            frame->setPixelColor(i, colorAt((uint8_t)(offset + i * 256 / LED_COUNT), 255));
+        }
+        frame->show();
+    }
+};
+
+// 10. CometBehavior - a bright head going round the pixels once per
+// 'period' ms, moving between pixels smoothly, with a trail that keeps
+// 'decay' / 256 of its brightness every 20 ms. The brightness is also the
+// palette index, so the trail cools down the palette.
+class CometBehavior : public PaletteBehavior {
+public:
+    uint32_t period;
+    uint8_t decay;
+
+    CometBehavior(const LedPalette* palette = &LED_PALETTE_RAINBOW, uint8_t speed = 64, uint32_t period = 1200, uint8_t decay = 230)
+        : PaletteBehavior("Comet", palette, speed), period(period), decay(decay) {}
+
+    void setup(LedFrame& frame) override {
+        PaletteBehavior::setup(frame);
+        memset(level, 0, sizeof(level));
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        tick();
+        for (uint32_t steps = takeSteps(20, 16); steps > 0; --steps) {
+            for (uint16_t i = 0; i < LED_COUNT; ++i) level[i] = ledScale8(level[i], decay);
+        }
+
+        // Head position in 1/256ths of a pixel
+        uint32_t position = (uint32_t)ledPhase16(clock, period) * LED_COUNT >> 8;
+        uint16_t pixel = position >> 8;
+        uint8_t fraction = (uint8_t)position;
+        uint16_t next = (pixel + 1) % LED_COUNT;
+        if (level[pixel] < 255 - fraction) level[pixel] = 255 - fraction;
+        if (level[next] < fraction) level[next] = fraction;
 
-// Basic behaviors
-extern LedsOffBehavior ledsOff;
-extern SolidBehavior ledsSolid;
-extern BreathingBehavior ledsBreathing;
-extern HeartBeatBehavior ledsHeartBeat;
-extern CycleBehavior ledsCycle;
-extern SpringBehavior ledsSpring;
+        for (uint16_t i = 0; i < LED_COUNT; ++i) frame->setPixelColor(i, colorAt(level[i], level[i]));
+        frame->show();
+    }
+
+    uint8_t getLevel(uint16_t pixel) const { return level[pixel]; }
+
+private:
+    uint8_t level[LED_COUNT];
+};
+
+// 11. TwinkleBehavior - dark pixels light up at random in a random palette
+// color and fade out; every 20 ms a dark pixel lights with a chance of
+// 'density' / 256 and a lit one loses 'fade'
+class TwinkleBehavior : public PaletteBehavior {
+public:
+    uint8_t density;
+    uint8_t fade;
+
+    TwinkleBehavior(const LedPalette* palette = &LED_PALETTE_RAINBOW, uint8_t speed = 64, uint8_t density = 8, uint8_t fade = 8)
+        : PaletteBehavior("Twinkle", palette, speed), density(density), fade(fade), seed(0x9E3779B9) {}
+
+    // Start the random sequence over from 'value' (not 0)
+    void setSeed(uint32_t value) {
+        seed = value ? value : 1;
+    }
+
+    void setup(LedFrame& frame) override {
+        PaletteBehavior::setup(frame);
+        memset(level, 0, sizeof(level));
+        memset(index, 0, sizeof(index));
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        tick();
+        for (uint32_t steps = takeSteps(20, 16); steps > 0; --steps) {
+            for (uint16_t i = 0; i < LED_COUNT; ++i) {
+                if (level[i] > 0) {
+                    level[i] = ledSub8(level[i], fade);
+                } else if (ledRandom8(seed) < density) {
+                    level[i] = 255;
+                    index[i] = ledRandom8(seed);
+                }
+            }
+        }
+        for (uint16_t i = 0; i < LED_COUNT; ++i) frame->setPixelColor(i, colorAt(index[i], level[i]));
+        frame->show();
+    }
+
+private:
+    uint32_t seed;
+    uint8_t level[LED_COUNT];
+    uint8_t index[LED_COUNT];
+};
+
+// 12. FireBehavior - flickering flames rising from pixel 0: every 30 ms
+// each pixel cools by up to 'cooling', heat drifts away from pixel 0, and
+// with a chance of 'sparking' / 256 a spark heats one of the first two
+// pixels. The heat is the palette index.
+class FireBehavior : public PaletteBehavior {
+public:
+    uint8_t cooling;
+    uint8_t sparking;
+
+    FireBehavior(const LedPalette* palette = &LED_PALETTE_FIRE, uint8_t speed = 64, uint8_t cooling = 40, uint8_t sparking = 120)
+        : PaletteBehavior("Fire", palette, speed), cooling(cooling), sparking(sparking), seed(0x2545F491) {}
+
+    void setSeed(uint32_t value) {
+        seed = value ? value : 1;
+    }
+
+    void setup(LedFrame& frame) override {
+        PaletteBehavior::setup(frame);
+        memset(heat, 0, sizeof(heat));
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        tick();
+        for (uint32_t steps = takeSteps(30, 16); steps > 0; --steps) {
+            for (uint16_t i = 0; i < LED_COUNT; ++i) {
+                heat[i] = ledSub8(heat[i], ledRandom8(seed, cooling + 1));
+            }
+            for (uint16_t i = LED_COUNT - 1; i >= 2; --i) {
+                heat[i] = (uint8_t)((heat[i - 1] + 2 * heat[i - 2]) / 3);
+            }
+            if (ledRandom8(seed) < sparking) {
+                uint8_t pixel = ledRandom8(seed, LED_COUNT < 2 ? LED_COUNT : 2);
+                heat[pixel] = ledAdd8(heat[pixel], 160 + ledRandom8(seed, 96));
+            }
+        }
+        for (uint16_t i = 0; i < LED_COUNT; ++i) frame->setPixelColor(i, colorAt(heat[i], 255));
+        frame->show();
+    }
+
+    uint8_t getHeat(uint16_t pixel) const { return heat[pixel]; }
+
+private:
+    uint32_t seed;
+    uint8_t heat[LED_COUNT];
+};
+
+// 13. ShakeBehavior - the color, brighter the harder the device is moved:
+// full brightness at 'fullScale' mg away from 1 g, 'floor' at rest. It
+// brightens at once and falls back by 'release' levels every 20 ms.
+class ShakeBehavior : public LedBehavior {
+public:
+    uint16_t fullScale;
+    uint8_t floor;
+    uint8_t release;
+
+    ShakeBehavior(uint32_t color = 0xFFFFFF, uint16_t fullScale = 1000, uint8_t floor = 16, uint8_t release = 12)
+        : LedBehavior("Shake"), fullScale(fullScale), floor(floor), release(release), level(0) {
+        setColor(color);
+        setTimerInterval(20); // 50Hz, as the ticker
+    }
+
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        updateTimer.reset();
+        level = 0;
+        draw();
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        MotionSample sample;
+        uint8_t target = readMotion(sample) ? motionLevel(sample.motion, fullScale) : 0;
+        uint8_t next = target > level ? target : ledSub8(level, release);
+        if (next == level) return;
+        level = next;
+        draw();
+    }
+
+private:
+    void draw() {
+        frame->fill(scaleColor(color, ledAdd8(floor, ledScale8(level, 255 - floor))));
+        frame->show();
+    }
+
+    uint8_t level;
+};
+
+// 14. TiltBehavior - the palette color for the direction the device leans
+// to, brighter the further it leans: full brightness on its side
+// ('fullScale' mg of gravity across it), 'floor' when flat
+class TiltBehavior : public PaletteBehavior {
+public:
+    uint16_t fullScale;
+    uint8_t floor;
+
+    TiltBehavior(const LedPalette* palette = &LED_PALETTE_RAINBOW, uint16_t fullScale = 1000, uint8_t floor = 24)
+        : PaletteBehavior("Tilt", palette, 64), fullScale(fullScale), floor(floor), index(0), level(0) {}
+
+    void setup(LedFrame& frame) override {
+        PaletteBehavior::setup(frame);
+        index = 0;
+        level = 0;
+        draw();
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+        MotionSample sample;
+        if (!readMotion(sample)) return;
+        uint8_t nextIndex = ledAtan2_8(sample.y, sample.x);
+        uint8_t nextLevel = motionLevel(ledHypot(sample.x, sample.y), fullScale);
+        if (nextIndex == index && nextLevel == level) return;
+        index = nextIndex;
+        level = nextLevel;
+        draw();
+    }
+
+private:
+    void draw() {
+        frame->fill(colorAt(index, ledAdd8(floor, ledScale8(level, 255 - floor))));
+        frame->show();
+    }
+
+    uint8_t index;
+    uint8_t level;
+};
+
+// 15. MotionSpringBehavior - the spring, pulled toward how hard the device
+// moves (full at 'fullScale' mg) and yanked to full brightness for
+// 'kickMs' on every tap, so it overshoots and settles back
+class MotionSpringBehavior : public SpringBehavior {
+public:
+    uint16_t fullScale;
+    unsigned long kickMs;
+
+    MotionSpringBehavior(uint32_t color = 0xFFFFFF, uint16_t fullScale = 1000, unsigned long kickMs = 80)
+        : SpringBehavior(color, 0.0f, 400.0f, 8.0f, 1.0f),
+          fullScale(fullScale), kickMs(kickMs), seenTaps(0), kickedAt(0), kicking(false), target(0) {
+        type = "MotionSpring";
+    }
+
+    void setup(LedFrame& frame) override {
+        SpringBehavior::setup(frame);
+        MotionSample sample;
+        seenTaps = readMotion(sample) ? sample.taps : 0;
+        kicking = false;
+        target = 0;
+        setTargetBrightness(0.0f);
+    }
+
+    void update() override {
+        MotionSample sample;
+        uint8_t next = 0;
+        if (readMotion(sample)) {
+            if (sample.taps != seenTaps) {
+                seenTaps = sample.taps;
+                kicking = true;
+                kickedAt = millis();
+            }
+            next = motionLevel(sample.motion, fullScale);
+        }
+        if (kicking && millis() - kickedAt < kickMs) next = 255;
+        else kicking = false;
+        // In 1/32 steps, so the float parameters are only worked out again
+        // when the target really moved
+        next &= 0xF8;
+        if (next != target) {
+            target = next;
+            setTargetBrightness(target / 255.0f);
+        }
+        SpringBehavior::update();
+    }
+
+private:
+    uint32_t seenTaps;
+    unsigned long kickedAt;
+    bool kicking;
+    uint8_t target;
+};
 
 #endif // LED_BEHAVIORS_H 
\ No newline at end of file
@@ -0,0 +1,232 @@
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include <Adafruit_NeoPixel.h>
+#include <string.h>
+#include "config.h"
+#include "LedFrame.h"
+#include "LedMath.h"
+#include "LedBehaviors.h"
+#include "Timer.h"
+
+// How a layer goes onto the layers below it. 'opacity' scales the layer
+// first. ALPHA mixes toward the layer's pixels and leaves black pixels
+// alone, so a layer only covers what it lights.
+enum LedBlendMode : uint8_t {
+    LED_BLEND_ADD,      // sum, saturating
+    LED_BLEND_ALPHA,    // mix by opacity where the layer is lit
+    LED_BLEND_MAX       // brighter of the two, per channel
+};
+
+inline constexpr LedGammaTable LED_GAMMA_TABLES[3] = {
+    ledMakeGammaTable(LED_GAMMA_RED),
+    ledMakeGammaTable(LED_GAMMA_GREEN),
+    ledMakeGammaTable(LED_GAMMA_BLUE),
+};
+
+// Layers, bottom to top
+enum LedLayer {
+    LED_LAYER_BASE,     // the pattern
+    LED_LAYER_FLASH,    // short feedback, e.g. on a tap
+    LED_LAYER_STATUS,   // one indicator pixel
+    LED_LAYER_COUNT
+};
+
+// Runs one behavior per layer, each drawing into its own LedFrame, and
+// blends the layers onto the strip. render() shows the strip only when a
+// layer drew a new frame and the blend came out different from what is
+// on the strip.
+//
+// The output stage corrects the linear blend for gamma and keeps the
+// fraction of a step each channel lost, adding it to the next frame
+// (temporal dithering), so dim levels between two steps average out
+// instead of jumping. While any fraction is left, a steady frame is sent
+// again every LED_DITHER_INTERVAL_MS.
+class LedCompositor {
+public:
+    struct Layer {
+        LedFrame frame;
+        LedBehavior* behavior;
+        LedBlendMode mode;
+        uint8_t opacity;
+    };
+
+    LedCompositor() : ditherTimer(LED_DITHER_INTERVAL_MS), redraw(true), correction(true), dithering(false), showCount(0) {
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+            layers[i].behavior = nullptr;
+            layers[i].mode = LED_BLEND_ALPHA;
+            layers[i].opacity = 255;
+        }
+        layers[LED_LAYER_FLASH].mode = LED_BLEND_ADD;
+        memset(blended, 0, sizeof(blended));
+        memset(residual, 0, sizeof(residual));
+    }
+
+    // Run 'behavior' on 'layer' from a dark frame; nullptr empties the layer
+    void setBehavior(int layer, LedBehavior* behavior) {
+        if (layer < 0 || layer >= LED_LAYER_COUNT) return;
+        Layer& target = layers[layer];
+        target.behavior = behavior;
+        target.frame.clear();
+        target.frame.show();
+        if (behavior) behavior->setup(target.frame);
+    }
+
+    LedBehavior* getBehavior(int layer) const {
+        if (layer < 0 || layer >= LED_LAYER_COUNT) return nullptr;
+        return layers[layer].behavior;
+    }
+
+    void setBlend(int layer, LedBlendMode mode, uint8_t opacity) {
+        if (layer < 0 || layer >= LED_LAYER_COUNT) return;
+        layers[layer].mode = mode;
+        layers[layer].opacity = opacity;
+        layers[layer].frame.show();
+    }
+
+    const Layer& getLayer(int layer) const { return layers[layer]; }
+
+    // Show on the next render() even if the blend is unchanged, e.g.
+    // after the strip's brightness changed
+    void invalidate() { redraw = true; }
+
+    // Gamma and dithering on the output, on by default; off sends the
+    // blend as is
+    void setCorrection(bool enabled) {
+        correction = enabled;
+        memset(residual, 0, sizeof(residual));
+        redraw = true;
+    }
+
+    bool isCorrecting() const { return correction; }
+
+    // Update every layer's behavior and blend. Returns true if the strip
+    // was shown.
+    bool render(Adafruit_NeoPixel& strip) {
+        bool changed = false;
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+            if (layers[i].behavior) layers[i].behavior->update();
+            if (layers[i].frame.takeChanged()) changed = true;
+        }
+        bool due = redraw;
+        if (changed) {
+            uint8_t output[LED_COUNT][3];
+            compose(output);
+            if (memcmp(output, blended, sizeof(output)) != 0) {
+                memcpy(blended, output, sizeof(output));
+                due = true;
+            }
+        }
+        if (!due && !(dithering && ditherTimer.hasElapsed())) return false;
+        redraw = false;
+        ditherTimer.reset();
+        writeOutput(strip);
+        strip.show();
+        showCount++;
+        return true;
+    }
+
+    // Blend all layers over black into 'output'
+    void compose(uint8_t output[LED_COUNT][3]) const {
+        memset(output, 0, LED_COUNT * 3);
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+            const Layer& layer = layers[i];
+            if (!layer.behavior || layer.opacity == 0) continue;
+            blend(output, layer.frame, layer.mode, layer.opacity);
+        }
+    }
+
+    static void blend(uint8_t output[LED_COUNT][3], const LedFrame& frame, LedBlendMode mode, uint8_t opacity) {
+        for (uint16_t i = 0; i < LED_COUNT; ++i) {
+            const uint8_t* src = frame.rgb[i];
+            uint8_t* dst = output[i];
+            if (mode == LED_BLEND_ALPHA && (src[0] | src[1] | src[2]) == 0) continue;
+            for (int c = 0; c < 3; ++c) {
+                int value = ledScale8(src[c], opacity);
+                switch (mode) {
+                    case LED_BLEND_ADD:
+                        value += dst[c];
+                        dst[c] = value > 255 ? 255 : (uint8_t)value;
+                        break;
+                    case LED_BLEND_ALPHA:
+                        if (src[c] >= dst[c]) dst[c] += ledScale8(src[c] - dst[c], opacity);
+                        else dst[c] -= ledScale8(dst[c] - src[c], opacity);
+                        break;
+                    case LED_BLEND_MAX:
+                        if (value > dst[c]) dst[c] = (uint8_t)value;
+                        break;
+                }
+            }
+        }
+    }
+
+    static const char* getLayerName(int layer) {
+        static const char* names[LED_LAYER_COUNT] = {"base", "flash", "status"};
+        return layer >= 0 && layer < LED_LAYER_COUNT ? names[layer] : "";
+    }
+
+    static const char* getModeName(LedBlendMode mode) {
+        switch (mode) {
+            case LED_BLEND_ADD: return "add";
+            case LED_BLEND_ALPHA: return "alpha";
+            case LED_BLEND_MAX: return "max";
+        }
+        return "";
+    }
+
+    // -1 if 'name' is not a layer
+    static int parseLayer(const String& name) {
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+            if (name == getLayerName(i)) return i;
+        }
+        return -1;
+    }
+
+    static bool parseMode(const String& name, LedBlendMode& mode) {
+        for (LedBlendMode candidate : {LED_BLEND_ADD, LED_BLEND_ALPHA, LED_BLEND_MAX}) {
+            if (name == getModeName(candidate)) {
+                mode = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned long getShowCount() const { return showCount; }
+
+private:
+    // Gamma, dither and pack the blend into the strip's buffer, one pass
+    void writeOutput(Adafruit_NeoPixel& strip) {
+        if (!correction) {
+            dithering = false;
+            for (uint16_t i = 0; i < LED_COUNT; ++i) {
+                strip.setPixelColor(i, strip.Color(blended[i][0], blended[i][1], blended[i][2]));
+            }
+            return;
+        }
+        uint8_t fractions = 0;
+        for (uint16_t i = 0; i < LED_COUNT; ++i) {
+            uint8_t level[3];
+            for (int c = 0; c < 3; ++c) {
+                uint16_t target = LED_GAMMA_TABLES[c].values[blended[i][c]];
+                uint16_t value = target + residual[i][c];
+                level[c] = (uint8_t)(value >> 8);
+                residual[i][c] = (uint8_t)value;
+                fractions |= (uint8_t)target;
+            }
+            strip.setPixelColor(i, strip.Color(level[0], level[1], level[2]));
+        }
+        dithering = fractions != 0;
+    }
+
+    Layer layers[LED_LAYER_COUNT];
+    uint8_t blended[LED_COUNT][3];  // last blend of the layers, linear
+    uint8_t residual[LED_COUNT][3]; // fraction of a step carried to the next frame
+    Timer ditherTimer;
+    bool redraw;
+    bool correction;
+    bool dithering;                 // some channel is between two steps
+    unsigned long showCount;
+};
+
+#endif // LED_COMPOSITOR_H
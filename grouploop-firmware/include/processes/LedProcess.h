@@ -3,27 +3,81 @@
 
 #include <Adafruit_NeoPixel.h>
 #include <Ticker.h>
+#include <atomic>
 #include "Process.h"
+#include "ProcessManager.h"
 #include "config.h"
 #include "LedBehaviors.h"
+#include "LedBehaviorPool.h"
+#include "LedCompositor.h"
+#include "MotionSlot.h"
+#include "WebSocketManager.h"
 #include "Configuration.h"
 #include "CommandRegistry.h"
+#include "Log.h"
 
+// Drives the strip through an LedCompositor: the pattern on the base
+// layer, a flash on every tap, and a status pixel while the server link
+// is down. Runs on the LED ticker, so it takes taps and motion from the
+// IMU through motionSlot rather than from IMUProcess.
+//
+// The pattern is a LedBehaviorSpec. Setting one makes a fresh behavior in
+// the pool on the main loop and hands it to the ticker, which puts it on
+// the base layer between two frames and frees the one it replaced; the
+// ticker never sees a behavior half made or changing under it. The
+// commands that change brightness, the flash, blending or gamma post a
+// request the same way, which the ticker applies before its next frame.
+// Only the ticker renders: update(), which the ProcessManager calls from
+// the main loop, does nothing, so there is one consumer of the handoff.
 class LedProcess : public Process {
 public:
-    LedProcess() : Process(), pixels(LED_COUNT, configuration.getLEDPin(), NEO_GRB + NEO_KHZ800), currentBehavior(nullptr) {
+    LedProcess()
+        : Process(),
+          pixels(LED_COUNT, configuration.getLEDPin(), NEO_GRB + NEO_KHZ800),
+          currentBehavior(nullptr),
+          flash(LED_FLASH_COLOR, LED_FLASH_MS),
+          status(LED_STATUS_PIXEL),
+          pattern(ledDefaultSpec(LED_BEHAVIOR_BREATHING, 0xFFFFFF)),
+          selected(nullptr),
+          pending(nullptr),
+          pendingBrightness(-1),
+          pendingCorrection(-1),
+          pendingFlash(0),
+          seenTaps(0) {
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) pendingBlend[i].store(0);
     }
 
     ~LedProcess() {
         ledTicker.detach();
     }
 
-    void setBehavior(LedBehavior* newBehavior) {
-        currentBehavior = newBehavior;
-        if (currentBehavior) {
-            currentBehavior->setup(pixels);
-        }
+    // Show the pattern 'spec' describes, made fresh, from the next frame.
+    // Main loop only. False if no pool slot is free, which only happens
+    // while the ticker is between frames; the LEDs keep what they show.
+    bool setPattern(const LedBehaviorSpec& spec) {
+        LedBehavior* behavior = pool.create(spec);
+        if (!behavior) return false;
+        pattern = spec;
+        queue(behavior);
+        return true;
+    }
+
+    // Show 'behavior', which the caller owns and keeps alive, instead of
+    // the pattern until restorePattern()
+    void setBehavior(LedBehavior* behavior) {
+        if (behavior) queue(behavior);
     }
+
+    bool restorePattern() {
+        return setPattern(pattern);
+    }
+
+    // The last pattern set, also while a behavior from setBehavior() shows
+    const LedBehaviorSpec& getPattern() const { return pattern; }
+
+    // Whether the LEDs show 'behavior', or will from the next frame
+    bool isShowing(const LedBehavior* behavior) const { return selected == behavior; }
+    bool isShowingPattern() const { return pool.owns(selected); }
     
     // Change LED to a random non-red color
     void changeToRandomColor() {
@@ -41,100 +95,180 @@ public:
         int colorIndex = random(0, sizeof(colors) / sizeof(colors[0]));
         uint32_t selectedColor = colors[colorIndex];
         
-        // Set the breathing behavior to the selected color
-        ledsBreathing.setColor(selectedColor);
-        setBehavior(&ledsBreathing);
+        // Breathe in the selected color
+        setPattern(ledDefaultSpec(LED_BEHAVIOR_BREATHING, selectedColor));
         
-        // Log the color change
-        Serial.print("LED changed to random color: 0x");
-        Serial.print(selectedColor, HEX);
-        Serial.print(" (WiFi connected)");
-        
-        // Also log the color name for debugging
-        const char* colorNames[] = {"Green", "Blue", "Cyan", "Yellow", "Magenta", "Orange"};
-        Serial.print(" - ");
-        Serial.println(colorNames[colorIndex]);
+        // Log the color change, with the color name for debugging
+        [[maybe_unused]] const char* colorNames[] = {"Green", "Blue", "Cyan", "Yellow", "Magenta", "Orange"};
+        LOG_INFO("LED changed to random color: 0x%06lX (WiFi connected) - %s",
+                 (unsigned long)selectedColor, colorNames[colorIndex]);
     }
     
     // Set LED to red breathing (for WiFi disconnected state)
     void setToRedBreathing() {
-        ledsBreathing.setColor(0xFF0000); // Red
-        setBehavior(&ledsBreathing);
-        Serial.println("LED changed to red breathing (WiFi disconnected)");
+        setPattern(ledDefaultSpec(LED_BEHAVIOR_BREATHING, 0xFF0000)); // Red
+        LOG_INFO("LED changed to red breathing (WiFi disconnected)");
     }
 
     void setup() override {        
         pixels.begin();
         pixels.setBrightness(255); // Don't set too high to avoid high current draw
+        compositor.setBehavior(LED_LAYER_FLASH, &flash);
+        compositor.setBehavior(LED_LAYER_STATUS, &status);
+        MotionSample motion;
+        if (motionSlot.read(motion)) seenTaps = motion.taps;
         // Use a lambda to call the member function, passing 'this'
-        ledTicker.attach_ms(20, +[](LedProcess* instance) { instance->update(); }, this);
+        ledTicker.attach_ms(LED_FRAME_MS, +[](LedProcess* instance) { instance->tick(); }, this);
         
         // Register LED commands
         registerCommands();
     }
 
+    // The ticker draws the frames
     void update() override {
-        if (currentBehavior) {
-            currentBehavior->update();
-        }
-
     }
 
     // Public members for access by BleManager
     Adafruit_NeoPixel pixels;
-    LedBehavior* currentBehavior;
+    LedBehavior* currentBehavior;   // on the base layer; the ticker's
+    LedCompositor compositor;
+    FlashBehavior flash;
+    StatusPixelBehavior status;
 
 private:
     Ticker ledTicker;
+    LedBehaviorPool pool;
+    LedBehaviorSpec pattern;
+    LedBehavior* selected;                  // the last one queued, main loop side
+    std::atomic<LedBehavior*> pending;      // queued for the next frame
+    // Setting changes for the next frame, posted by the commands
+    std::atomic<int16_t> pendingBrightness; // -1 for none
+    std::atomic<int8_t> pendingCorrection;  // -1 for none, else on or off
+    std::atomic<uint32_t> pendingFlash;     // LED_REQUEST_* bits and a color
+    std::atomic<uint32_t> pendingBlend[LED_LAYER_COUNT]; // LED_REQUEST_SET, mode << 8, opacity
+    uint32_t seenTaps;
+
+    static constexpr uint32_t LED_REQUEST_SET = 1u << 31;
+    static constexpr uint32_t LED_REQUEST_COLOR = 1u << 30;
+
+    // Take up the settings the commands posted; on the ticker only
+    void applyRequests() {
+        int16_t brightness = pendingBrightness.exchange(-1, std::memory_order_acq_rel);
+        if (brightness >= 0) {
+            pixels.setBrightness((uint8_t)brightness);
+            compositor.invalidate();
+        }
+        int8_t correction = pendingCorrection.exchange(-1, std::memory_order_acq_rel);
+        if (correction >= 0) compositor.setCorrection(correction != 0);
+        for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+            uint32_t blend = pendingBlend[i].exchange(0, std::memory_order_acq_rel);
+            if (blend & LED_REQUEST_SET) compositor.setBlend(i, (LedBlendMode)((blend >> 8) & 0xFF), (uint8_t)blend);
+        }
+        uint32_t request = pendingFlash.exchange(0, std::memory_order_acq_rel);
+        if (request & LED_REQUEST_COLOR) flash.setColor(request & 0xFFFFFF);
+        if (request & LED_REQUEST_SET) flash.trigger();
+    }
+
+    // One frame, on the ticker only
+    void tick() {
+        applyRequests();
+        // A new base behavior starts between two frames
+        LedBehavior* next = pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (next) {
+            LedBehavior* previous = currentBehavior;
+            currentBehavior = next;
+            compositor.setBehavior(LED_LAYER_BASE, next);
+            pool.release(previous);
+        }
+
+        MotionSample motion;
+        if (motionSlot.read(motion) && motion.taps != seenTaps) {
+            seenTaps = motion.taps;
+            flash.trigger();
+        }
+        status.setStatus(webSocketManager.isConnected() ? 0 : LED_STATUS_OFFLINE_COLOR);
+        compositor.render(pixels);
+    }
+
+    void queue(LedBehavior* behavior) {
+        selected = behavior;
+        // One replaced before the ticker took it was never shown; freeing
+        // it is up to the main loop
+        pool.release(pending.exchange(behavior, std::memory_order_acq_rel));
+    }
+
+    // Change the pattern: now if it is showing, else for when it is back
+    bool updatePattern(const LedBehaviorSpec& spec) {
+        if (selected && !isShowingPattern()) {
+            pattern = spec;
+            return true;
+        }
+        return setPattern(spec);
+    }
+
+    void printPattern(const char* prefix) {
+        char text[64];
+        ledFormatSpec(pattern, text, sizeof(text));
+        Serial.printf("%s%s, color %06lx\n", prefix, text, (unsigned long)pattern.color);
+    }
+
+    // pattern:<name>[:<first param>...] as the pattern takes them
+    void printPatternUsage(LedBehaviorType type) {
+        const LedBehaviorInfo& info = LED_BEHAVIOR_INFO[type];
+        Serial.printf("pattern:%s", info.name);
+        for (int i = 0; i < LED_BEHAVIOR_PARAMS && info.params[i].name; ++i) {
+            Serial.printf("[:<%s %u-%u>", info.params[i].name, info.params[i].low, info.params[i].high);
+        }
+        for (int i = 0; i < LED_BEHAVIOR_PARAMS && info.params[i].name; ++i) Serial.print("]");
+        Serial.println();
+    }
     
     void registerCommands() {
         // Register LED command
         commandRegistry.registerCommand("led", [this](const String& params) {
             if (params.length() == 0) return;             
             // Try to parse as hex color
-            unsigned long color = strtoul(params.c_str(), NULL, 16);
-            currentBehavior->setColor(color);
+            LedBehaviorSpec spec = pattern;
+            spec.color = strtoul(params.c_str(), NULL, 16);
+            if (!updatePattern(spec)) {
+                Serial.println("LED busy, try again");
+                return;
+            }
             Serial.print("Set LED color to: ");
             Serial.println(params);
         
         });
         
-        // Register pattern command
+        // Register pattern command: pattern:<name>[:<param>...] with the
+        // parameters of LED_BEHAVIOR_INFO, in order; the ones left out take
+        // their defaults. pattern alone prints the current one.
         commandRegistry.registerCommand("pattern", [this](const String& params) {
-            if (params == "breathing") {
-                setBehavior(&ledsBreathing);
-                Serial.println("Set LED pattern to breathing");
-            }
-            else if (params == "heartbeat") {
-                setBehavior(&ledsHeartBeat);
-                Serial.println("Set LED pattern to heartbeat");
-            }
-            else if (params == "solid") {
-                setBehavior(&ledsSolid);
-                Serial.println("Set LED pattern to solid");
-            }
-            else if (params == "cycle") {
-                setBehavior(&ledsCycle);
-                Serial.println("Set LED pattern to cycle");
-            }
-            else if (params == "spring") {
-                setBehavior(&ledsSpring);
-                Serial.println("Set LED pattern to spring");
+            if (params.length() == 0) {
+                printPattern("LED pattern: ");
+                return;
             }
-            else if (params == "off") {
-                setBehavior(&ledsOff);
-                Serial.println("Set LED pattern to off");
+            LedBehaviorSpec spec;
+            if (!ledParseSpec(params.c_str(), pattern.color, spec)) {
+                int separator = params.indexOf(':');
+                int type = ledFindBehaviorType(params.c_str(), separator < 0 ? params.length() : separator);
+                if (type < 0) {
+                    Serial.print("Unknown pattern: ");
+                    Serial.println(params);
+                } else {
+                    printPatternUsage((LedBehaviorType)type);
+                }
+                return;
             }
-            else {
-                Serial.print("Unknown pattern: ");
-                Serial.println(params);
+            if (!setPattern(spec)) {
+                Serial.println("LED busy, try again");
+                return;
             }
+            printPattern("Set LED pattern to ");
         });
         
         // Register reset command
         commandRegistry.registerCommand("reset", [this](const String& params) {
-            if (currentBehavior) {
-                currentBehavior->reset();
+            if (isShowingPattern() && restorePattern()) {
                 Serial.println("Reset LED pattern");
             }
         });
@@ -143,7 +277,7 @@ private:
         commandRegistry.registerCommand("brightness", [this](const String& params) {
             int brightness = params.toInt();
             if (brightness >= 0 && brightness <= 255) {
-                pixels.setBrightness(brightness);
+                pendingBrightness.store((int16_t)brightness, std::memory_order_release);
                 Serial.print("Set LED brightness to: ");
                 Serial.println(brightness);
             } else {
@@ -151,7 +285,125 @@ private:
             }
         });
 
-        // Register spring_param command
+        // Register flash command: flash the overlay layer, in the given
+        // color if there is one
+        commandRegistry.registerCommand("flash", [this](const String& params) {
+            if (params.length() > 0) {
+                uint32_t color = strtoul(params.c_str(), NULL, 16) & 0xFFFFFF;
+                pendingFlash.store(LED_REQUEST_SET | LED_REQUEST_COLOR | color, std::memory_order_release);
+            } else {
+                pendingFlash.fetch_or(LED_REQUEST_SET, std::memory_order_acq_rel);
+            }
+        });
+
+        // Register layer command: layer:<base|flash|status>:<add|alpha|max>[:<opacity>]
+        // sets how a layer is blended; layer on its own lists the layers
+        commandRegistry.registerCommand("layer", [this](const String& params) {
+            if (params.length() == 0) {
+                for (int i = 0; i < LED_LAYER_COUNT; ++i) {
+                    const LedCompositor::Layer& layer = compositor.getLayer(i);
+                    Serial.printf("Layer %s: %s, %s, opacity %u\n", LedCompositor::getLayerName(i),
+                                  layer.behavior ? layer.behavior->type : "empty",
+                                  LedCompositor::getModeName(layer.mode), layer.opacity);
+                }
+                return;
+            }
+            int separator = params.indexOf(':');
+            int layer = LedCompositor::parseLayer(separator < 0 ? params : params.substring(0, separator));
+            String rest = separator < 0 ? String("") : params.substring(separator + 1);
+            int opacitySeparator = rest.indexOf(':');
+            String modeName = opacitySeparator < 0 ? rest : rest.substring(0, opacitySeparator);
+            int opacity = opacitySeparator < 0 ? 255 : rest.substring(opacitySeparator + 1).toInt();
+            LedBlendMode mode;
+            if (layer < 0 || !LedCompositor::parseMode(modeName, mode) || opacity < 0 || opacity > 255) {
+                Serial.println("layer requires base, flash or status, then add, alpha or max, and an opacity 0-255 (e.g. flash:max:128)");
+                return;
+            }
+            pendingBlend[layer].store(LED_REQUEST_SET | ((uint32_t)mode << 8) | (uint32_t)opacity,
+                                      std::memory_order_release);
+            Serial.printf("Set layer %s to %s, opacity %d\n", LedCompositor::getLayerName(layer),
+                          LedCompositor::getModeName(mode), opacity);
+        });
+
+        // Register gamma command: gamma:on corrects the output for gamma
+        // and dithers it (the default), gamma:off sends the blend as is
+        commandRegistry.registerCommand("gamma", [this](const String& params) {
+            bool correcting = compositor.isCorrecting();
+            if (params == "on" || params == "off") {
+                correcting = params == "on";
+                pendingCorrection.store(correcting ? 1 : 0, std::memory_order_release);
+            } else if (params.length() > 0) {
+                Serial.println("gamma requires on or off");
+                return;
+            }
+            Serial.printf("LED gamma and dithering %s\n", correcting ? "on" : "off");
+        });
+
+        // Register palette command: palette:<name>[:<speed>] colors the
+        // current procedural pattern (gradient, comet, twinkle, fire, tilt)
+        // from a palette, mono for shades of the led color; speed 64 is
+        // the normal pace
+        commandRegistry.registerCommand("palette", [this](const String& params) {
+            int paletteParam = ledFindBehaviorParam(pattern.type, "palette");
+            int speedParam = ledFindBehaviorParam(pattern.type, "speed");
+            int separator = params.indexOf(':');
+            String name = separator < 0 ? params : params.substring(0, separator);
+            int speed = separator < 0 ? -1 : params.substring(separator + 1).toInt();
+            const LedPalette* palette = nullptr;
+            if (paletteParam < 0 || !ledFindPalette(name.c_str(), palette) ||
+                (separator >= 0 && (speed < 1 || speed > 255))) {
+                Serial.println("palette requires a gradient, comet, twinkle, fire or tilt pattern, then rainbow, fire, ocean, forest or mono, and a speed 1-255 (e.g. fire:96)");
+                return;
+            }
+            LedBehaviorSpec spec = pattern;
+            uint16_t index = 0;
+            while (LED_PALETTES[index].palette != palette) index++;
+            spec.params[paletteParam] = index;
+            if (speed > 0 && speedParam >= 0) spec.params[speedParam] = (uint16_t)speed;
+            if (!updatePattern(spec)) {
+                Serial.println("LED busy, try again");
+                return;
+            }
+            printPattern("Set LED pattern to ");
+        });
+
+        // Register react command: react:<shake|tilt|spring>[:<mg>] lights
+        // the LEDs from the IMU, <mg> of motion (or tilt) for full
+        // brightness; react alone prints the latest reading
+        commandRegistry.registerCommand("react", [this](const String& params) {
+            if (params.length() == 0) {
+                MotionSample motion;
+                if (!motionSlot.read(motion)) {
+                    Serial.println("No IMU reading yet");
+                    return;
+                }
+                Serial.printf("IMU x %d y %d z %d mg, motion %u mg, %lu taps, %lu ms old\n",
+                              motion.x, motion.y, motion.z, motion.motion, (unsigned long)motion.taps,
+                              (unsigned long)(millis() - motion.time));
+                return;
+            }
+            int separator = params.indexOf(':');
+            String name = separator < 0 ? params : params.substring(0, separator);
+            long fullScale = separator < 0 ? 0 : params.substring(separator + 1).toInt();
+            LedBehaviorType type = name == "shake" ? LED_BEHAVIOR_SHAKE
+                                 : name == "tilt" ? LED_BEHAVIOR_TILT
+                                 : name == "spring" ? LED_BEHAVIOR_MOTION_SPRING
+                                 : LED_BEHAVIOR_TYPE_COUNT;
+            if (type == LED_BEHAVIOR_TYPE_COUNT || (separator >= 0 && (fullScale < 100 || fullScale > 16000))) {
+                Serial.println("react requires shake, tilt or spring, and a full scale 100-16000 mg (e.g. shake:500)");
+                return;
+            }
+            LedBehaviorSpec spec = ledDefaultSpec(type, pattern.color);
+            if (fullScale) spec.params[ledFindBehaviorParam(type, "mg")] = (uint16_t)fullScale;
+            if (!setPattern(spec)) {
+                Serial.println("LED busy, try again");
+                return;
+            }
+            printPattern("Set LED pattern to ");
+        });
+
+        // Register spring_param command: the spring pattern with these
+        // parameters, in the current color
         commandRegistry.registerCommand("spring_param", [this](const String& params) {
             if (params.length() >= 6) {
                 // Parse hex string: 6 characters = 3 bytes
@@ -172,8 +424,16 @@ private:
                 float dampingConstant = dampingByte / 10.0f; // 0.0 to 25.5
                 float mass = (massByte / 10.0f) + 0.1f;     // 0.1 to 25.6
                 
-                // Apply to spring behavior
-                ledsSpring.setSpringParams(springConstant, dampingConstant, mass);
+                // The spring pattern's parameters are in tenths
+                LedBehaviorSpec spec = pattern.type == LED_BEHAVIOR_SPRING
+                                     ? pattern : ledDefaultSpec(LED_BEHAVIOR_SPRING, pattern.color);
+                spec.params[0] = springByte;
+                spec.params[1] = dampingByte;
+                spec.params[2] = massByte + 1;
+                if (!updatePattern(spec)) {
+                    Serial.println("LED busy, try again");
+                    return;
+                }
                 
                 Serial.print("Set spring parameters - k: ");
                 Serial.print(springConstant, 1);
@@ -0,0 +1,136 @@
+#ifndef LOG_PROCESS_H
+#define LOG_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "config.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
+#include "Log.h"
+
+// Uploads the binary log ring over the WebSocket as
+//   log:<device id>:<hex records>
+// either on request (log:send) or, at most every
+// LOG_ERROR_UPLOAD_INTERVAL_MS, after an error was logged. Records are not
+// formatted on the device; host/logdecode expands them using the format
+// strings in the firmware ELF.
+class LogProcess : public Process {
+public:
+    LogProcess()
+        : Process(),
+          uploadPos(0),
+          uploadEnd(0),
+          uploadedPos(0),
+          uploading(false),
+          lastErrorUploadAt(0),
+          errorUploadPending(false)
+    {
+    }
+
+    void setup() override {
+        registerCommands();
+    }
+
+    void update() override {
+        if (logger.takeErrorFlag()) errorUploadPending = true;
+        if (errorUploadPending && !uploading &&
+            (lastErrorUploadAt == 0 || millis() - lastErrorUploadAt >= LOG_ERROR_UPLOAD_INTERVAL_MS)) {
+            // Everything not uploaded yet, so the lead-up to the error is included
+            errorUploadPending = false;
+            lastErrorUploadAt = millis();
+            startUpload(uploadedPos);
+        }
+
+        if (!uploading || !webSocketManager.isConnected()) return;
+        for (int i = 0; i < LOG_UPLOAD_EVENTS_PER_UPDATE && uploading; ++i) {
+            if (!sendBatch()) break;
+        }
+    }
+
+    const char* getState() override {
+        return uploading ? "uploading" : "idle";
+    }
+
+private:
+    void startUpload(uint32_t from) {
+        uploadPos = from;
+        uploadEnd = logger.getHeadPosition();
+        uploading = uploadPos != uploadEnd;
+    }
+
+    // Pack as many whole records as fit into one event. Returns false when
+    // the event queue is full; the batch is retried on the next update.
+    bool sendBatch() {
+        char message[WS_EVENT_MAX_LEN];
+        int length = snprintf(message, sizeof(message), "log:%s:", webSocketManager.getDeviceId());
+        uint32_t position = uploadPos;
+        uint8_t record[LOG_RECORD_MAX];
+        while (position != uploadEnd) {
+            uint32_t next = position;
+            size_t recordLength = logger.readRecord(next, record, sizeof(record));
+            if (recordLength == 0) break;
+            if (length + recordLength * 2 >= sizeof(message)) break;
+            for (size_t i = 0; i < recordLength; ++i) {
+                static const char digits[] = "0123456789abcdef";
+                message[length++] = digits[record[i] >> 4];
+                message[length++] = digits[record[i] & 0x0F];
+            }
+            position = next;
+        }
+        message[length] = '\0';
+
+        if (position == uploadPos) {
+            // Nothing left (the rest was overwritten or cleared)
+            finishUpload();
+            return true;
+        }
+        if (!webSocketManager.sendEvent(message, length)) return false;
+        uploadPos = position;
+        if ((int32_t)(uploadPos - uploadEnd) >= 0) finishUpload();
+        return true;
+    }
+
+    void finishUpload() {
+        uploading = false;
+        if ((int32_t)(uploadEnd - uploadedPos) > 0) uploadedPos = uploadEnd;
+    }
+
+    void registerCommands() {
+        // log (or log:dump) prints the ring on Serial, log:send uploads it,
+        // log:clear empties it and log:serial:<none|error|warn|info|debug>
+        // sets what is echoed to Serial. Levels above the build's LOG_LEVEL
+        // are compiled out and never appear.
+        commandRegistry.registerCommand("log", [this](const String& params) {
+            if (params.length() == 0 || params == "dump") {
+                logger.dump();
+            } else if (params == "send") {
+                startUpload(0);
+                Serial.println("Uploading log");
+            } else if (params == "clear") {
+                logger.clear();
+                uploading = false;
+                Serial.println("Log cleared");
+            } else if (params.startsWith("serial:")) {
+                uint8_t level;
+                if (!Logger::parseLevel(params.substring(7), level)) {
+                    Serial.println("log:serial requires none, error, warn, info or debug");
+                    return;
+                }
+                logger.setSerialLevel(level);
+                Serial.print("Serial log level: ");
+                Serial.println(Logger::levelName(level));
+            } else {
+                Serial.println("log requires dump, send, clear or serial:<level>");
+            }
+        });
+    }
+
+    uint32_t uploadPos;             // next record to send
+    uint32_t uploadEnd;             // head position when the upload started
+    uint32_t uploadedPos;           // everything before this has been sent
+    bool uploading;
+    unsigned long lastErrorUploadAt;
+    bool errorUploadPending;
+};
+
+#endif // LOG_PROCESS_H
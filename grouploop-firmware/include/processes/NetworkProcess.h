@@ -0,0 +1,60 @@
+#ifndef NETWORK_PROCESS_H
+#define NETWORK_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "Configuration.h"
+#include "WebSocketManager.h"
+#include "Log.h"
+#include "processes/WiFiProcess.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Single service point for the shared WebSocket connection. The socket is
+// serviced by webSocketManager.service() on a dedicated task, so a blocked
+// TCP write stalls only that task and never the sensor loop. update() runs
+// on the main loop: it reports the WiFi link state to the manager and
+// dispatches connection state changes to the registered listeners.
+class NetworkProcess : public Process {
+public:
+    NetworkProcess() : Process(), wifiProcess(nullptr), taskHandle(nullptr) {}
+
+    void setup() override {
+        if (processManager) {
+            wifiProcess = static_cast<WiFiProcess*>(processManager->getProcess("wifi"));
+        }
+
+        webSocketManager.addConnectionListener([](ConnectionState state) {
+            LOG_INFO("WebSocket state: %s", WebSocketManager::stateName(state));
+        });
+
+        webSocketManager.initialize(configuration.getSocketServerURL());
+
+        // Same priority as the Arduino loop task, so the two time-slice
+        if (xTaskCreate(networkTask, "network", WS_TASK_STACK_SIZE, nullptr, 1, &taskHandle) != pdPASS) {
+            LOG_ERROR("Failed to start network task");
+        }
+    }
+
+    void update() override {
+        webSocketManager.setLinkUp(!wifiProcess || wifiProcess->isWiFiConnected());
+        webSocketManager.dispatch();
+    }
+
+    const char* getState() override {
+        return webSocketManager.getStateName();
+    }
+
+private:
+    static void networkTask(void* parameter) {
+        for (;;) {
+            webSocketManager.service();
+            vTaskDelay(pdMS_TO_TICKS(WS_SERVICE_INTERVAL_MS));
+        }
+    }
+
+    WiFiProcess* wifiProcess;
+    TaskHandle_t taskHandle;
+};
+
+#endif // NETWORK_PROCESS_H
@@ -8,6 +8,7 @@
 #include "processes/BLEProcess.h"
 #include "processes/IMUProcess.h"
 #include "WebSocketManager.h"
+#include "TelemetryFrame.h"
 #include <WiFi.h>
 
 class PublishProcess : public Process {
@@ -16,83 +17,55 @@ private:
 	BLEProcess* bleProcess;
 	IMUProcess* imuProcess;
 	Timer publishTimer; // send interval
-	String state;
-
-	static int clampInt(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
-	static String toHexByte(int v) { char buf[3]; snprintf(buf, sizeof(buf), "%02x", clampInt(v, 0, 255)); return String(buf); }
-	static String toHexWord(uint16_t v) { char buf[5]; snprintf(buf, sizeof(buf), "%04x", v); return String(buf); }
-	static int mapFloatToByte(float v, float inMin, float inMax) {
-		if (v < inMin) v = inMin; if (v > inMax) v = inMax;
-		float t = (v - inMin) / (inMax - inMin);
-		int b = (int)lroundf(t * 255.0f);
-		return clampInt(b, 0, 255);
-	}
-	static int mapRssiToByte(int rssiDbm) {
-		// Simple linear map: -100 dBm -> 0, -40 dBm -> 255
-		if (rssiDbm < -100) rssiDbm = -100; if (rssiDbm > -40) rssiDbm = -40;
-		float t = (float)(rssiDbm + 100) / 60.0f; // 0..1
-		int b = (int)lroundf(t * 255.0f);
-		return clampInt(b, 0, 255);
-	}
-
-	String buildFrame() const {
-		// IMU
-		IMUData imu = imuProcess ? imuProcess->getIMUData() : IMUData{0,0,0};
-		int ax = mapFloatToByte(imu.x_g, -2.0f, 2.0f);
-		int ay = mapFloatToByte(imu.y_g, -2.0f, 2.0f);
-		int az = mapFloatToByte(imu.z_g, -2.0f, 2.0f);
-		// BLE beacons
-		int dNE = 0, dNW = 0, dSE = 0, dSW = 0;
-		if (bleProcess) {
-			// Map RSSI dBm to 0..255 distances as per simulator expectations
-			dNW = mapRssiToByte(bleProcess->getBeaconRSSI("NW"));
-			dNE = mapRssiToByte(bleProcess->getBeaconRSSI("NE"));
-			dSE = mapRssiToByte(bleProcess->getBeaconRSSI("SE"));
-			dSW = mapRssiToByte(bleProcess->getBeaconRSSI("SW"));
-		}
-		// Tap detection
-		int tap = imuProcess ? (imuProcess->isTapped() ? 255 : 0) : 0;
-		
-		String frame;
-		frame.reserve(4 + 2*8 + 1); // Updated to account for tap byte
-		frame += webSocketManager.getDeviceId();
-		frame += toHexByte(ax);
-		frame += toHexByte(ay);
-		frame += toHexByte(az);
-		frame += toHexByte(dNW); // simulator expects TL->dNW first
-		frame += toHexByte(dNE);
-		frame += toHexByte(dSE);
-		frame += toHexByte(dSW);
-		frame += toHexByte(tap); // Tap detection: 0 if not tapped, 255 if tapped
-		frame += "\n";
-		return frame;
-	}
+	bool connected;     // maintained by the connection listener
+	char frameBuffer[WS_TELEMETRY_MAX_LEN];
 
 public:
 	PublishProcess()
 		: Process()
 		, bleProcess(nullptr)
 		, imuProcess(nullptr)
-		, publishTimer(50) // 20 Hz
-		, state("DISCONNECTED")
+		, publishTimer(PUBLISH_INTERVAL_MS)
+		, connected(false)
 	{}
 
+	// Format the current frame into 'out'; returns its length, 0 if it
+	// didn't fit. Public for the host tests and benchmarks.
+	size_t buildFrame(char* out, size_t size) const {
+		TelemetrySample sample = {};
+		IMUData imu = imuProcess ? imuProcess->getIMUData() : IMUData{0,0,0};
+		sample.ax = imu.x_g;
+		sample.ay = imu.y_g;
+		sample.az = imu.z_g;
+		sample.tapped = imuProcess && imuProcess->isTapped();
+		if (bleProcess) {
+			sample.hasBeacons = true;
+			sample.rssiNW = bleProcess->getBeaconCalibratedRSSI("NW");
+			sample.rssiNE = bleProcess->getBeaconCalibratedRSSI("NE");
+			sample.rssiSE = bleProcess->getBeaconCalibratedRSSI("SE");
+			sample.rssiSW = bleProcess->getBeaconCalibratedRSSI("SW");
+			sample.position = bleProcess->getPositionFix();
+		}
+		return formatTelemetryFrame(out, size, webSocketManager.getDeviceId(), sample,
+			configuration.getRoomWidth(), configuration.getRoomHeight());
+	}
+
 	void setup() override {
 		// Find dependencies through ProcessManager
 		findDependencies();
+		radioArbiter.setPublishPeriod(PUBLISH_INTERVAL_MS);
 		
-		// Initialize the shared WebSocket connection
-		webSocketManager.initialize(configuration.getSocketServerURL());
+		// NetworkProcess services the connection; just follow its state
+		webSocketManager.addConnectionListener([this](ConnectionState state) {
+			connected = state == ConnectionState::CONNECTED;
+		});
 	}
 
 	void update() override {
-		// Update the shared WebSocket connection
-		webSocketManager.update();
-		state = webSocketManager.getState();
-		
-		if (webSocketManager.isConnected() && publishTimer.checkAndReset()) {
-			String frame = buildFrame();
-			webSocketManager.sendMessage(frame);
+		if (connected && publishTimer.checkAndReset()) {
+			size_t length = buildFrame(frameBuffer, sizeof(frameBuffer));
+			// Queued latest-wins; the network task does the actual write
+			if (length > 0) webSocketManager.sendTelemetry(frameBuffer, length);
 		}
 	}
 
@@ -112,8 +85,8 @@ public:
 		}
 	}
 
-	String getDeviceId() const { return webSocketManager.getDeviceId(); }
-	String getState() const { return state; }
+	const char* getDeviceId() const { return webSocketManager.getDeviceId(); }
+	const char* getState() override { return webSocketManager.getStateName(); }
 
 };
 
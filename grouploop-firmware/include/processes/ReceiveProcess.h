@@ -7,32 +7,24 @@
 #include "Configuration.h"
 #include "WebSocketManager.h"
 #include "CommandRegistry.h"
+#include "Log.h"
 #include <WiFi.h>
 
 class ReceiveProcess : public Process {
 
 private:
-	String state;
 	Timer messageCheckTimer;
+	char messageBuffer[WS_RX_MAX_LEN + 1]; // parsed in place
 
 public:
 	ReceiveProcess()
 		: Process()
-		, state("DISCONNECTED")
 		, messageCheckTimer(10) // Check for messages every 10ms
-	{}
-
-	void setup() override {
-		// Set up message callback for the shared WebSocket connection
-		webSocketManager.setMessageCallback([this](const String& message) {
-			// This callback will be called when messages are received
-			// The message is already stored in webSocketManager
-		});
+	{
+		messageBuffer[0] = '\0';
 	}
 
 	void update() override {
-		state = webSocketManager.getState();
-		
 		// Check for new messages and process them
 		if (webSocketManager.isConnected() && messageCheckTimer.checkAndReset()) {
 			processMessages();
@@ -44,18 +36,18 @@ public:
 		return webSocketManager.hasMessage();
 	}
 
-	// Get the last received message and mark it as processed
-	String getMessage() {
-		return webSocketManager.getMessage();
+	// Take the oldest received message into 'out'; returns its length
+	size_t getMessage(char* out, size_t size) {
+		return webSocketManager.getMessage(out, size);
 	}
 
 	// Get the current connection state
-	String getState() const {
-		return state;
+	const char* getState() override {
+		return webSocketManager.getStateName();
 	}
 
 	// Get the device ID
-	String getDeviceId() const {
+	const char* getDeviceId() const {
 		return webSocketManager.getDeviceId();
 	}
 
@@ -64,36 +56,17 @@ public:
 		return webSocketManager.isConnected();
 	}
 
-private:
-	// Process incoming messages and execute commands
+	// Execute the oldest received message, if any. update() calls this
+	// every 10 ms; public for the host tests and benchmarks.
 	void processMessages() {
 		if (!webSocketManager.hasMessage()) return;
 		
-		String message = getMessage();
-		Serial.print("Received message from server: '");
-		Serial.print(message);
-		Serial.print("' (length: ");
-		Serial.print(message.length());
-		Serial.println(")");
+		getMessage(messageBuffer, sizeof(messageBuffer));
+		LOG_DEBUG_EVERY(LOG_HOT_INTERVAL_MS, "Received message from server: '%s' (length: %u)",
+		                messageBuffer, (unsigned)strlen(messageBuffer));
 		
-		// Parse command:parameters
-		int colonIndex = message.indexOf(':');
-		if (colonIndex > 0) {
-			String command = message.substring(0, colonIndex);
-			String parameters = message.substring(colonIndex + 1);
-			
-			// Use the command registry to execute the command
-			if (!commandRegistry.executeCommand(command, parameters)) {
-				Serial.print("Failed to execute command: ");
-				Serial.println(command);
-			}
-		} else {
-			// Command without parameters
-			if (!commandRegistry.executeCommand(message, "")) {
-				Serial.print("Failed to execute command: ");
-				Serial.println(message);
-			}
-		}
+		// Split command:parameters and run it through the command registry
+		commandRegistry.executeMessage(messageBuffer);
 	}
 };
 
@@ -0,0 +1,201 @@
+#ifndef SEQUENCE_BEHAVIOR_H
+#define SEQUENCE_BEHAVIOR_H
+
+#include <atomic>
+#include "LedBehaviors.h"
+#include "SequenceFormat.h"
+
+// Plays an uploaded keyframe sequence (SequenceFormat.h). Every frame is
+// drawn from the time since play() on the local clock, so playback does
+// not drift however late the ticker runs, and devices started at the same
+// synchronized time stay together. The sequence bytes are not copied;
+// they must stay put until unload().
+//
+// play() runs on the main loop while update() runs on the LED ticker, so
+// it only posts the start: the ticker takes it up on its next frame, the
+// way LedProcess hands over a behavior. stop() takes effect at once.
+class SequenceBehavior : public LedBehavior {
+public:
+    SequenceBehavior()
+        : LedBehavior("Sequence"),
+          loaded(false),
+          state(SEQUENCE_STOPPED),
+          requestedStart(0),
+          startMs(0),
+          cursor(0),
+          cursorPosition(0) {
+        setTimerInterval(20); // 50Hz, as the ticker
+        view = SequenceView{0, 0, 0, 0, nullptr};
+    }
+
+    bool load(const uint8_t* data, size_t length) {
+        stop();
+        loaded = sequenceParse(data, length, view);
+        if (!loaded) view = SequenceView{0, 0, 0, 0, nullptr};
+        seek(0);
+        return loaded;
+    }
+
+    void unload() {
+        loaded = false;
+        stop();
+    }
+
+    // Start playing at local millis() 'atMs', which may be in the future,
+    // from the next frame; the pixels stay dark until then
+    void play(unsigned long atMs) {
+        if (!loaded) return;
+        requestedStart.store(atMs, std::memory_order_relaxed);
+        state.store(SEQUENCE_STARTING, std::memory_order_release);
+    }
+
+    void stop() {
+        state.store(SEQUENCE_STOPPED, std::memory_order_release);
+    }
+
+    bool isLoaded() const { return loaded; }
+    // Also while a start waits for the next frame
+    bool isPlaying() const { return state.load(std::memory_order_acquire) != SEQUENCE_STOPPED; }
+    const SequenceView& getView() const { return view; }
+
+    // Milliseconds since the start last asked for, negative while waiting
+    // for it
+    long getElapsed() const {
+        return (long)(millis() - requestedStart.load(std::memory_order_relaxed));
+    }
+
+    // True once a sequence without a loop has reached its end
+    bool isFinished() const {
+        return isPlaying() && view.loopEnd == 0 && getElapsed() >= (long)view.duration;
+    }
+
+    void setup(LedFrame& frame) override {
+        LedBehavior::setup(frame);
+        this->frame->clear();
+        this->frame->show();
+        seek(0);
+    }
+
+    void update() override {
+        uint8_t starting = SEQUENCE_STARTING;
+        if (state.compare_exchange_strong(starting, SEQUENCE_PLAYING, std::memory_order_acq_rel)) {
+            startMs = requestedStart.load(std::memory_order_relaxed);
+            updateTimer.last_update = 0; // draw on this update
+        }
+        if (state.load(std::memory_order_acquire) != SEQUENCE_PLAYING || !updateTimer.checkAndReset()) return;
+        long elapsed = (long)(millis() - startMs);
+        if (elapsed < 0) return;
+        renderAt(positionAt((uint32_t)elapsed));
+    }
+
+    // Sequence time for 'elapsed' ms of playback: loops wrap, the end holds
+    uint32_t positionAt(uint32_t elapsed) const {
+        if (view.loopEnd != 0 && elapsed >= view.loopEnd) {
+            return view.loopStart + (elapsed - view.loopStart) % (view.loopEnd - view.loopStart);
+        }
+        return elapsed < view.duration ? elapsed : view.duration;
+    }
+
+    // Draw the frame at sequence time 'position'. Public for the tests.
+    void renderAt(uint32_t position) {
+        if (!loaded || !frame) return;
+        if (position < cursorPosition) seek(position);
+        advance(position);
+
+        bool changed = false;
+        for (uint16_t p = 0; p < LED_COUNT; ++p) {
+            uint32_t color = colorAt(p, position);
+            if (color != frame->getPixelColor(p)) {
+                frame->setPixelColor(p, color);
+                changed = true;
+            }
+        }
+        if (changed) frame->show();
+    }
+
+private:
+    enum : uint8_t { SEQUENCE_STOPPED, SEQUENCE_STARTING, SEQUENCE_PLAYING };
+
+    // Keyframes [0, cursor) are at or before cursorPosition; last[p] is
+    // the latest of them for pixel p and next[p] the first after, -1 for
+    // none. Rebuilt from the start when time goes back (a loop).
+    void seek(uint32_t position) {
+        cursor = 0;
+        cursorPosition = 0;
+        for (uint16_t p = 0; p < LED_COUNT; ++p) {
+            last[p] = -1;
+            next[p] = findNext(p, 0);
+        }
+        advance(position);
+    }
+
+    void advance(uint32_t position) {
+        cursorPosition = position;
+        bool moved = false;
+        while (cursor < view.keyframeCount) {
+            SequenceKeyframe keyframe = sequenceKeyframe(view, cursor);
+            if (keyframe.time > position) break;
+            if (keyframe.pixel == SEQUENCE_ALL_PIXELS) {
+                for (uint16_t p = 0; p < LED_COUNT; ++p) last[p] = cursor;
+            } else if (keyframe.pixel < LED_COUNT) {
+                last[keyframe.pixel] = cursor;
+            }
+            cursor++;
+            moved = true;
+        }
+        if (!moved) return;
+        for (uint16_t p = 0; p < LED_COUNT; ++p) {
+            if (next[p] >= 0 && next[p] < cursor) next[p] = findNext(p, cursor);
+        }
+    }
+
+    int32_t findNext(uint16_t pixel, uint16_t from) const {
+        for (uint16_t i = from; i < view.keyframeCount; ++i) {
+            uint8_t target = view.keyframes[(size_t)i * SEQUENCE_KEYFRAME_SIZE + 4];
+            if (target == pixel || target == SEQUENCE_ALL_PIXELS) return i;
+        }
+        return -1;
+    }
+
+    uint32_t colorAt(uint16_t pixel, uint32_t position) const {
+        uint32_t fromTime = 0;
+        uint32_t fromColor = 0;
+        if (last[pixel] >= 0) {
+            SequenceKeyframe from = sequenceKeyframe(view, (uint16_t)last[pixel]);
+            fromTime = from.time;
+            fromColor = from.color;
+        }
+        if (next[pixel] < 0) return fromColor;
+        SequenceKeyframe to = sequenceKeyframe(view, (uint16_t)next[pixel]);
+        uint32_t span = to.time - fromTime;
+        if (to.mode == SEQUENCE_STEP || span == 0) return fromColor;
+
+        // Progress toward the next keyframe, Q16
+        uint32_t progress = (uint32_t)(((uint64_t)(position - fromTime) << 16) / span);
+        if (to.mode == SEQUENCE_EASE) {
+            // smoothstep: p^2 (3 - 2p)
+            uint64_t square = ((uint64_t)progress * progress) >> 16;
+            progress = (uint32_t)((square * ((3u << 16) - 2 * progress)) >> 16);
+        }
+        uint32_t color = 0;
+        for (int shift = 16; shift >= 0; shift -= 8) {
+            int32_t a = (fromColor >> shift) & 0xFF;
+            int32_t b = (to.color >> shift) & 0xFF;
+            int32_t channel = a + (int32_t)(((int64_t)(b - a) * progress) >> 16);
+            color |= (uint32_t)channel << shift;
+        }
+        return color;
+    }
+
+    SequenceView view;
+    bool loaded;
+    std::atomic<uint8_t> state;
+    std::atomic<unsigned long> requestedStart; // posted by play()
+    unsigned long startMs;                     // the ticker's copy
+    uint16_t cursor;
+    uint32_t cursorPosition;
+    int32_t last[LED_COUNT];
+    int32_t next[LED_COUNT];
+};
+
+#endif // SEQUENCE_BEHAVIOR_H
@@ -0,0 +1,272 @@
+#ifndef SEQUENCE_PROCESS_H
+#define SEQUENCE_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "config.h"
+#include "Timer.h"
+#include "Utils.h"
+#include "ClockSync.h"
+#include "SequenceFormat.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
+#include "SequenceBehavior.h"
+#include "LedProcess.h"
+
+// Receives LED sequences (SequenceFormat.h) over the WebSocket and plays
+// them on the LED base layer, if asked from a time on the server's clock
+// so a group of devices starts together:
+//   seq:begin:<length>          start an upload of <length> bytes
+//   seq:data:<offset>:<hex>     the bytes at <offset> (8 hex digits)
+//   seq:end:<crc32>             check the upload and load it
+//   seq:play[:<server ms>]      play now, or from a server time
+//   seq:stop                    back to the pattern that ran before
+// Chunks must arrive in order; a repeated chunk is ignored, a gap fails
+// the upload. The device answers with events
+//   seq:<device id>:loaded:<crc32>
+//   seq:<device id>:error:<reason>
+//
+// The clock offset comes from clock:<device id>:<millis> probes, which the
+// server answers with a clock command (see ClockSync.h).
+class SequenceProcess : public Process {
+public:
+    SequenceProcess()
+        : Process(),
+          ledProcess(nullptr),
+          expected(0),
+          received(0),
+          uploading(false),
+          probeTimer(CLOCK_SYNC_PROBE_MS),
+          burstTimer(CLOCK_SYNC_INTERVAL_MS),
+          probesLeft(0),
+          burstOpen(false),
+          burstClosesAt(0),
+          connected(false)
+    {
+    }
+
+    void setup() override {
+        if (processManager) {
+            ledProcess = static_cast<LedProcess*>(processManager->getProcess("led"));
+        }
+        registerCommands();
+    }
+
+    void update() override {
+        bool online = webSocketManager.isConnected();
+        if (online && !connected) startBurst(); // sync again after every reconnect
+        connected = online;
+        if (!online) return;
+
+        if (burstTimer.checkAndReset()) startBurst();
+        if (probesLeft > 0 && probeTimer.checkAndReset()) {
+            char message[48];
+            int length = snprintf(message, sizeof(message), "clock:%s:%lu",
+                                  webSocketManager.getDeviceId(), (unsigned long)millis());
+            if (webSocketManager.sendEvent(message, length) && --probesLeft == 0) {
+                burstClosesAt = millis() + CLOCK_SYNC_MAX_RTT_MS;
+            }
+        }
+        if (burstOpen && probesLeft == 0 && (long)(millis() - burstClosesAt) >= 0) {
+            clock.endBurst();
+            burstOpen = false;
+        }
+    }
+
+    const char* getState() override {
+        if (uploading) return "uploading";
+        if (player.isPlaying()) return player.getElapsed() < 0 ? "waiting" : "playing";
+        return player.isLoaded() ? "loaded" : "empty";
+    }
+
+    const ClockSync& getClock() const { return clock; }
+    SequenceBehavior& getPlayer() { return player; }
+
+private:
+    void startBurst() {
+        probesLeft = CLOCK_SYNC_PROBES;
+        probeTimer.last_update = 0; // first probe right away
+        burstOpen = true;
+        burstTimer.reset();
+    }
+
+    void reply(const char* state, const char* detail) {
+        char message[64];
+        int length = snprintf(message, sizeof(message), "seq:%s:%s:%s",
+                              webSocketManager.getDeviceId(), state, detail);
+        webSocketManager.sendEvent(message, length);
+    }
+
+    void fail(const char* reason) {
+        uploading = false;
+        Serial.printf("Sequence upload failed: %s\n", reason);
+        reply("error", reason);
+    }
+
+    void begin(const String& params) {
+        // The buffer is the player's until the LEDs are off it
+        if (!stopPlayback()) {
+            fail("busy");
+            return;
+        }
+        player.unload();
+        long length = params.toInt();
+        if (length < SEQUENCE_HEADER_SIZE || length > SEQUENCE_MAX_BYTES) {
+            fail("size");
+            return;
+        }
+        expected = (uint32_t)length;
+        received = 0;
+        uploading = true;
+    }
+
+    // <offset>:<hex bytes>
+    void data(const String& params) {
+        if (!uploading) return;
+        int separator = params.indexOf(':');
+        if (separator < 0) {
+            fail("format");
+            return;
+        }
+        uint32_t offset = strtoul(params.substring(0, separator).c_str(), NULL, 16);
+        const char* hex = params.c_str() + separator + 1;
+        size_t digits = strlen(hex);
+        if (digits % 2 != 0) {
+            fail("format");
+            return;
+        }
+        size_t length = digits / 2;
+        // In 64 bits, so an offset near 2^32 can't wrap around
+        if ((uint64_t)offset + length <= received) return; // a chunk sent again
+        if (offset != received) {
+            fail("gap");
+            return;
+        }
+        if (received + length > expected) {
+            fail("size");
+            return;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            int high = hexNibble(hex[2 * i]);
+            int low = hexNibble(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                fail("format");
+                return;
+            }
+            buffer[received + i] = (uint8_t)(high << 4 | low);
+        }
+        received += length;
+    }
+
+    void end(const String& params) {
+        if (!uploading) return;
+        if (received != expected) {
+            fail("short");
+            return;
+        }
+        uint32_t crc = sequenceCrc32(buffer, received);
+        if (crc != strtoul(params.c_str(), NULL, 16)) {
+            fail("crc");
+            return;
+        }
+        if (!player.load(buffer, received)) {
+            fail("invalid");
+            return;
+        }
+        uploading = false;
+        char detail[9];
+        snprintf(detail, sizeof(detail), "%08lx", (unsigned long)crc);
+        const SequenceView& view = player.getView();
+        Serial.printf("Sequence loaded: %u keyframes, %lu ms\n", view.keyframeCount, (unsigned long)view.duration);
+        reply("loaded", detail);
+    }
+
+    // Empty plays now; a server time before now joins the sequence part
+    // way through, in step with the devices that started on time. The
+    // player takes the start up on its next frame.
+    void play(const String& params) {
+        if (!player.isLoaded() || !ledProcess) {
+            Serial.println("No sequence loaded");
+            return;
+        }
+        unsigned long start = millis();
+        if (params.length() > 0) {
+            if (clock.isSynced()) {
+                start = (unsigned long)clock.toLocal(strtoull(params.c_str(), NULL, 10));
+            } else {
+                Serial.println("Clock not synced, playing now");
+                reply("error", "unsynced");
+            }
+        }
+        if (!ledProcess->isShowing(&player)) ledProcess->setBehavior(&player);
+        player.play(start);
+    }
+
+    // False if the pattern could not be put back (no pool slot free until
+    // the next frame); the player stays on the LEDs, stopped
+    bool stopPlayback() {
+        player.stop();
+        if (ledProcess && ledProcess->isShowing(&player)) return ledProcess->restorePattern();
+        return true;
+    }
+
+    void printStatus() {
+        const SequenceView& view = player.getView();
+        Serial.printf("Sequence: %s, %u keyframes, %lu ms", getState(), view.keyframeCount, (unsigned long)view.duration);
+        if (uploading) Serial.printf(", %lu/%lu bytes", (unsigned long)received, (unsigned long)expected);
+        if (clock.isSynced()) {
+            Serial.printf(", clock synced (rtt %lu ms)\n", (unsigned long)clock.getRtt());
+        } else {
+            Serial.println(", clock not synced");
+        }
+    }
+
+    void registerCommands() {
+        commandRegistry.registerCommand("seq", [this](const String& params) {
+            int separator = params.indexOf(':');
+            String action = separator < 0 ? params : params.substring(0, separator);
+            String rest = separator < 0 ? String("") : params.substring(separator + 1);
+            if (action.length() == 0 || action == "status") {
+                printStatus();
+            } else if (action == "begin") {
+                begin(rest);
+            } else if (action == "data") {
+                data(rest);
+            } else if (action == "end") {
+                end(rest);
+            } else if (action == "play") {
+                play(rest);
+            } else if (action == "stop") {
+                if (!stopPlayback()) Serial.println("LED busy, try again");
+            } else {
+                Serial.println("seq requires begin, data, end, play, stop or status");
+            }
+        });
+
+        // The server's answer to a probe: clock:<sent millis>:<server ms>
+        commandRegistry.registerCommand("clock", [this](const String& params) {
+            int separator = params.indexOf(':');
+            if (separator < 0) return;
+            unsigned long sent = strtoul(params.substring(0, separator).c_str(), NULL, 10);
+            uint64_t serverMs = strtoull(params.c_str() + separator + 1, NULL, 10);
+            clock.onReply(sent, serverMs, millis());
+        });
+    }
+
+    LedProcess* ledProcess;
+    SequenceBehavior player;
+    uint8_t buffer[SEQUENCE_MAX_BYTES];
+    uint32_t expected;              // upload length
+    uint32_t received;              // bytes so far, all in order
+    bool uploading;
+
+    ClockSync clock;
+    Timer probeTimer;
+    Timer burstTimer;
+    int probesLeft;
+    bool burstOpen;
+    unsigned long burstClosesAt;
+    bool connected;
+};
+
+#endif // SEQUENCE_PROCESS_H
@@ -0,0 +1,140 @@
+#ifndef TRACE_PROCESS_H
+#define TRACE_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "config.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
+#include "TraceRecorder.h"
+
+// Bytes of the record stream per upload message: what fits hex-encoded in
+// one event after the "trace:<id>:<offset>:" prefix
+#define TRACE_UPLOAD_CHUNK ((WS_EVENT_MAX_LEN - 24) / 2)
+
+// Controls input capture and uploads the trace ring over the WebSocket as
+//   trace:<device id>:<offset>:<hex bytes>
+// where <offset> is the stream position of the first byte, 8 hex digits.
+// Chunks are cut at any byte, so a host puts the stream back together by
+// offset; a jump in the offset means records were overwritten before they
+// went out, and the stream resumes at a record boundary.
+//
+// Capture either keeps the last TRACE_RING_SIZE bytes on the device
+// (trace:start, then trace:send after the problem was seen) or streams
+// everything as it is recorded (trace:stream). host/replay reads the
+// socket server output and replays the trace.
+class TraceProcess : public Process {
+public:
+    TraceProcess()
+        : Process(),
+          uploadPos(0),
+          uploadEnd(0),
+          uploading(false),
+          streaming(false)
+    {
+    }
+
+    void setup() override {
+        registerCommands();
+    }
+
+    void update() override {
+        if (streaming) {
+            uploadEnd = traceRecorder.getHeadPosition();
+            uploading = true;
+        }
+        if (!uploading || !webSocketManager.isConnected()) return;
+        for (int i = 0; i < TRACE_UPLOAD_EVENTS_PER_UPDATE && uploading; ++i) {
+            if (!sendChunk()) break;
+        }
+    }
+
+    const char* getState() override {
+        if (traceRecorder.isCapturing()) return streaming ? "streaming" : "capturing";
+        return uploading ? "uploading" : "idle";
+    }
+
+private:
+    // Returns false when there is nothing to send or the event queue is
+    // full; the chunk is retried on the next update
+    bool sendChunk() {
+        uint8_t bytes[TRACE_UPLOAD_CHUNK];
+        uint32_t position = uploadPos;
+        size_t available = (int32_t)(uploadEnd - position) > 0 ? uploadEnd - position : 0;
+        size_t length = traceRecorder.read(position, bytes, available < sizeof(bytes) ? available : sizeof(bytes));
+        if ((int32_t)(position - uploadEnd) >= 0 || length == 0) {
+            // Caught up (or the rest was overwritten or cleared)
+            uploadPos = position;
+            if (!streaming) uploading = false;
+            return false;
+        }
+
+        char message[WS_EVENT_MAX_LEN];
+        int prefix = snprintf(message, sizeof(message), "trace:%s:%08lx:",
+                              webSocketManager.getDeviceId(), (unsigned long)position);
+        size_t messageLength = prefix;
+        for (size_t i = 0; i < length; ++i) {
+            static const char digits[] = "0123456789abcdef";
+            message[messageLength++] = digits[bytes[i] >> 4];
+            message[messageLength++] = digits[bytes[i] & 0x0F];
+        }
+        message[messageLength] = '\0';
+
+        if (!webSocketManager.sendEvent(message, messageLength)) return false;
+        uploadPos = position + length;
+        return true;
+    }
+
+    void printStatus() {
+        Serial.printf("Trace: %s, %lu records, %lu bytes buffered, %lu overwritten, %lu skipped\n",
+                      getState(), (unsigned long)traceRecorder.getRecordCount(),
+                      (unsigned long)traceRecorder.getBufferedBytes(),
+                      (unsigned long)traceRecorder.getOverwrittenCount(),
+                      (unsigned long)traceRecorder.getSkippedCount());
+    }
+
+    void registerCommands() {
+        // trace:start captures into the ring, trace:stream also uploads as
+        // it goes, trace:stop ends the capture (a stream finishes sending
+        // what was recorded), trace:send uploads the ring, trace:clear
+        // empties it; trace on its own prints the status
+        commandRegistry.registerCommand("trace", [this](const String& params) {
+            if (params.length() == 0 || params == "status") {
+                printStatus();
+            } else if (params == "start" || params == "stream") {
+                traceRecorder.start();
+                streaming = params == "stream";
+                uploading = false;
+                uploadPos = 0; // from the oldest record: the start marker
+                Serial.println(streaming ? "Trace streaming" : "Trace capturing");
+            } else if (params == "stop") {
+                traceRecorder.stop();
+                if (streaming) {
+                    streaming = false;
+                    uploadEnd = traceRecorder.getHeadPosition();
+                }
+                printStatus();
+            } else if (params == "send") {
+                uploadPos = 0;
+                uploadEnd = traceRecorder.getHeadPosition();
+                uploading = true;
+                Serial.println("Uploading trace");
+            } else if (params == "clear") {
+                traceRecorder.stop();
+                traceRecorder.clear();
+                streaming = false;
+                uploading = false;
+                Serial.println("Trace cleared");
+            } else {
+                Serial.println("trace requires start, stream, stop, send, clear or status");
+            }
+        });
+    }
+
+    uint32_t uploadPos;             // next byte to send
+    uint32_t uploadEnd;             // send up to here (the head, while streaming)
+    bool uploading;
+    bool streaming;
+};
+
+#endif // TRACE_PROCESS_H
@@ -6,6 +6,7 @@
 #include "config.h"
 #include "VibrationBehaviors.h"
 #include "CommandRegistry.h"
+#include "Log.h"
 
 class VibrationProcess : public Process {
 public:
@@ -36,9 +37,7 @@ public:
     // Method to trigger vibration for a specific duration
     void vibrate(int duration) {
         // This would need to be implemented based on your vibration hardware
-        Serial.print("Vibrating for ");
-        Serial.print(duration);
-        Serial.println("ms");
+        LOG_DEBUG("Vibrating for %dms", duration);
         // TODO: Implement actual vibration control
     }
 
@@ -4,187 +4,585 @@
 #include "Process.h"
 #include "Timer.h"
 #include "Configuration.h"
-#include <WiFiMulti.h>
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "config.h"
+#include "Utils.h"
+#include "BootTiming.h"
 #include <WiFi.h>
 
+// Non-blocking WiFi connection state machine. WiFi.begin() returns
+// immediately; progress is reported through WiFi.onEvent() and handled in
+// update(), so the rest of the firmware keeps running while connecting.
+// Failed attempts back off exponentially (with jitter, so a room full of
+// devices doesn't retry in lockstep) and recovery never gives up.
+//
+// The first attempt after boot or a lost connection joins the last-good
+// BSSID on its cached channel directly, skipping the all-channel scan. If
+// that fails the next attempt falls back to an async scan of all known
+// networks and joins the best access point found. An optional static IP
+// from the configuration skips DHCP as well.
+//
+// While connected the signal strength is sampled; when it stays below
+// WIFI_ROAM_RSSI_THRESHOLD a background scan looks for a clearly stronger
+// access point and the device joins its BSSID on its channel directly,
+// without a scan or dropping back through the disconnected states. This is
+// not seamless roaming: the Arduino WiFi.begin() disconnects from the old
+// AP before associating with the new one, so the link and the WebSocket
+// drop for the length of the join and the socket reconnects after it.
 class WiFiProcess : public Process {
 public:
-    WiFiProcess() 
+    enum class State { IDLE, SCANNING, CONNECTING, CONNECTED, ROAMING, BACKOFF };
+
+    WiFiProcess()
         : Process(),
           connectionCheckTimer(5000), // Check connection every 5 seconds
-          reconnectAttemptTimer(10000), // Wait 10 seconds between reconnect attempts
-          lastConnectionCheck(0),
-          isConnected(false),
+          rssiTimer(WIFI_RSSI_CHECK_MS),
+          state(State::IDLE),
+          attemptStartedAt(0),
+          attemptTimeout(WIFI_CONNECT_TIMEOUT_MS),
+          fastPathAttempt(false),
+          fastPathFailed(false),
+          nextAttemptAt(0),
           reconnectAttempts(0),
-          maxReconnectAttempts(5)
+          reconnectCount(0),
+          roamCount(0),
+          smoothedRssi(0),
+          roamScanRunning(false),
+          lastRoamScanAt(0),
+          gotIpEvent(false),
+          disconnectedEvent(false),
+          lastDisconnectReason(0)
     {
+        connectedSsid[0] = '\0';
+        stateText[0] = '\0';
     }
 
     void setup() override {
-        // Initialize WiFi in station mode
+        // Initialize WiFi in station mode; reconnection is handled here
         WiFi.mode(WIFI_STA);
-        
-        // Add the configured WiFi network to WiFiMulti
-        String ssid = configuration.getWifiSSID();
-        String password = configuration.getWifiPassword();
-        
-        if (ssid.length() > 0) {
-            wifiMulti.addAP(ssid.c_str(), password.c_str());
-            Serial.print("Added WiFi network: ");
-            Serial.println(ssid);
+        WiFi.setAutoReconnect(false);
+        // We keep our own copy of the AP in NVS; don't let the SDK rewrite
+        // its flash copy on every begin()
+        WiFi.persistent(false);
+        applyStaticIP();
+
+        // Events arrive on the WiFi event task: only set flags here
+        WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+            if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+                gotIpEvent = true;
+            } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+                lastDisconnectReason = info.wifi_sta_disconnected.reason;
+                disconnectedEvent = true;
+            }
+        });
+
+        registerCommands();
+
+        for (int i = 0; i < configuration.getNetworkCount(); ++i) {
+            const WiFiNetwork& network = configuration.getNetwork(i);
+            if (network.ssid.length() == 0) continue;
+            LOG_INFO("Added WiFi network: %s (priority %d)", network.ssid.c_str(), network.priority);
+        }
+
+        if (configuration.getWifiSSID().length() > 0) {
+            startConnection();
         } else {
-            Serial.println("No WiFi SSID configured");
+            LOG_WARN("No WiFi SSID configured");
         }
-        
-        // Start initial connection attempt
-        attemptConnection();
     }
 
     void update() override {
-        uint32_t currentTime = millis();
-        
-        // Check connection status periodically
-        if (connectionCheckTimer.checkAndReset()) {
-            checkConnection();
-        }
-        
-        // Attempt reconnection if needed
-        if (!isConnected && reconnectAttemptTimer.checkAndReset()) {
-            if (reconnectAttempts < maxReconnectAttempts) {
-                attemptConnection();
-            } else {
-                Serial.println("Max reconnection attempts reached. Stopping WiFi attempts.");
-            }
+        handleEvents();
+
+        switch (state) {
+            case State::SCANNING:
+                handleConnectScan();
+                break;
+
+            case State::CONNECTING:
+                if (millis() - attemptStartedAt > attemptTimeout) {
+                    LOG_WARN("WiFi connection attempt timed out");
+                    WiFi.disconnect();
+                    attemptFailed();
+                }
+                break;
+
+            case State::ROAMING:
+                if (millis() - attemptStartedAt > WIFI_FAST_CONNECT_TIMEOUT_MS) {
+                    LOG_WARN("WiFi roam timed out, rescanning");
+                    WiFi.disconnect();
+                    reconnectCount++;
+                    fastPathFailed = true;
+                    startConnection();
+                }
+                break;
+
+            case State::BACKOFF:
+                if ((long)(millis() - nextAttemptAt) >= 0) {
+                    startConnection();
+                }
+                break;
+
+            case State::CONNECTED:
+                // Safety net in case a disconnect event was missed
+                if (connectionCheckTimer.checkAndReset() && WiFi.status() != WL_CONNECTED) {
+                    LOG_WARN("WiFi connection lost");
+                    abortScan();
+                    fastPathFailed = false;
+                    enterBackoff();
+                    break;
+                }
+                monitorSignal();
+                break;
+
+            case State::IDLE:
+                break;
         }
     }
 
-    String getState() override {
-        if (isConnected) {
-            return String("CONNECTED (") + WiFi.SSID() + ")";
-        } else if (reconnectAttempts >= maxReconnectAttempts) {
-            return String("FAILED");
-        } else {
-            return String("CONNECTING (") + String(reconnectAttempts) + "/" + String(maxReconnectAttempts) + ")";
+    // Formatted into a member buffer; valid until the next call
+    const char* getState() override {
+        switch (state) {
+            case State::CONNECTED:
+                snprintf(stateText, sizeof(stateText), "CONNECTED (%s)", connectedSsid);
+                return stateText;
+            case State::SCANNING:
+                return "SCANNING";
+            case State::CONNECTING:
+                snprintf(stateText, sizeof(stateText), "CONNECTING (%d)", reconnectAttempts + 1);
+                return stateText;
+            case State::ROAMING:
+                return "ROAMING";
+            case State::BACKOFF:
+                snprintf(stateText, sizeof(stateText), "BACKOFF (%d)", reconnectAttempts);
+                return stateText;
+            default:
+                return "IDLE";
         }
     }
-    
-    // Public methods for other processes to check WiFi status
+
+    // Public methods for other processes to check WiFi status. A roam is a
+    // short handover to another AP of a known network, so it still counts
+    // as connected and dependents (BLE, LEDs) are left running.
     bool isWiFiConnected() const {
-        return isConnected;
+        return state == State::CONNECTED || state == State::ROAMING;
+    }
+
+    State getConnectionState() const {
+        return state;
     }
-    
+
+    // Number of times the connection was lost or an attempt failed
+    uint32_t getReconnectCount() const {
+        return reconnectCount;
+    }
+
+    // Number of successful handovers to a stronger access point
+    uint32_t getRoamCount() const {
+        return roamCount;
+    }
+
     String getIPAddress() const {
-        if (isConnected) {
+        if (isWiFiConnected()) {
             return WiFi.localIP().toString();
         }
         return String("");
     }
-    
+
     String getSSID() const {
-        if (isConnected) {
+        if (isWiFiConnected()) {
             return WiFi.SSID();
         }
         return String("");
     }
-    
+
     int getRSSI() const {
-        if (isConnected) {
+        if (isWiFiConnected()) {
             return WiFi.RSSI();
         }
         return 0;
     }
-    
+
     // Method to force reconnection (useful for configuration changes)
     void forceReconnect() {
-        Serial.println("Forcing WiFi reconnection...");
-        isConnected = false;
-        reconnectAttempts = 0;
+        LOG_INFO("Forcing WiFi reconnection");
+        abortScan();
         WiFi.disconnect();
-        reconnectAttemptTimer.reset();
-    }
-    
-    // Method to update WiFi credentials and reconnect
-    void updateCredentials(const String& ssid, const String& password) {
-        Serial.println("Updating WiFi credentials...");
-        
-        // Clear existing networks by reinitializing WiFiMulti
-        wifiMulti = WiFiMulti();
-        
-        // Add new network
-        if (ssid.length() > 0) {
-            wifiMulti.addAP(ssid.c_str(), password.c_str());
-            Serial.print("Updated WiFi network: ");
-            Serial.println(ssid);
-        }
-        
+        reconnectAttempts = 0;
+        fastPathFailed = false;
+        // Retry right away; the disconnect event is ignored while in BACKOFF
+        state = State::BACKOFF;
+        nextAttemptAt = millis();
+    }
+
+    // Replace the primary network and reconnect. Additional networks are
+    // kept; they are managed with the wifi command or the configuration.
+    void updateCredentials(const String& newSsid, const String& newPassword) {
+        configuration.setWifiSSID(newSsid);
+        configuration.setWifiPassword(newPassword);
+        // The cached access point may belong to the old network
+        configuration.setLastAccessPoint("", "", 0);
+        LOG_INFO("Updated WiFi network: %s", newSsid.c_str());
+
         // Force reconnection with new credentials
         forceReconnect();
     }
 
 private:
-    void checkConnection() {
-        bool wasConnected = isConnected;
-        isConnected = (WiFi.status() == WL_CONNECTED);
-        
-        if (isConnected && !wasConnected) {
-            // Just connected
-            Serial.println("WiFi connected successfully!");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-            Serial.print("SSID: ");
-            Serial.println(WiFi.SSID());
-            Serial.print("Signal strength: ");
-            Serial.print(WiFi.RSSI());
-            Serial.println(" dBm");
-            
-            // Reset reconnect attempts counter
-            reconnectAttempts = 0;
-        } else if (!isConnected && wasConnected) {
-            // Just disconnected
-            Serial.println("WiFi connection lost!");
-            reconnectAttemptTimer.reset();
-        }
-    }
-    
-    void attemptConnection() {
-        Serial.print("Attempting WiFi connection (attempt ");
-        Serial.print(reconnectAttempts + 1);
-        Serial.print("/");
-        Serial.print(maxReconnectAttempts);
-        Serial.println(")...");
-        
-        // Try to connect using WiFiMulti
-        uint8_t result = wifiMulti.run(10000); // 10 second timeout
-        
-        if (result == WL_CONNECTED) {
-            isConnected = true;
-            reconnectAttempts = 0;
-            Serial.println("WiFi connected successfully!");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-        } else {
-            isConnected = false;
-            reconnectAttempts++;
-            Serial.print("WiFi connection failed. Status: ");
-            Serial.println(result);
-            
-            if (reconnectAttempts < maxReconnectAttempts) {
-                Serial.print("Retrying in 10 seconds... (");
-                Serial.print(reconnectAttempts);
-                Serial.print("/");
-                Serial.print(maxReconnectAttempts);
-                Serial.println(")");
+    // Best access point of a known network seen in the last scan
+    struct Candidate {
+        int network;        // index into configuration.getNetwork()
+        int rssi;
+        int score;          // rssi plus the network's priority bonus
+        int channel;
+        uint8_t bssid[6];
+    };
+
+    void registerCommands() {
+        // wifi:list | wifi:add:<ssid>,<password>[,<priority>] |
+        // wifi:remove:<ssid> | wifi:roam
+        commandRegistry.registerCommand("wifi", [this](const String& params) {
+            if (params == "list" || params.length() == 0) {
+                printNetworks();
+            } else if (params.startsWith("add:")) {
+                String args = params.substring(4);
+                int firstComma = args.indexOf(',');
+                if (firstComma <= 0) {
+                    Serial.println("wifi:add requires <ssid>,<password>[,<priority>]");
+                    return;
+                }
+                int secondComma = args.indexOf(',', firstComma + 1);
+                String newSsid = args.substring(0, firstComma);
+                String newPassword = secondComma < 0 ? args.substring(firstComma + 1)
+                                                     : args.substring(firstComma + 1, secondComma);
+                int priority = secondComma < 0 ? 0 : args.substring(secondComma + 1).toInt();
+                if (configuration.addNetwork(newSsid, newPassword, priority)) {
+                    Serial.print("Added WiFi network: ");
+                    Serial.println(newSsid);
+                } else {
+                    Serial.println("WiFi network list is full");
+                }
+            } else if (params.startsWith("remove:")) {
+                String oldSsid = params.substring(7);
+                if (configuration.removeNetwork(oldSsid)) {
+                    Serial.print("Removed WiFi network: ");
+                    Serial.println(oldSsid);
+                } else {
+                    Serial.println("Unknown network (the primary network cannot be removed)");
+                }
+            } else if (params == "roam") {
+                if (state == State::CONNECTED && !roamScanRunning) {
+                    startRoamScan();
+                } else {
+                    Serial.println("Not connected, nothing to roam from");
+                }
+            } else {
+                Serial.println("Unknown wifi command");
+            }
+        });
+    }
+
+    void printNetworks() {
+        for (int i = 0; i < configuration.getNetworkCount(); ++i) {
+            const WiFiNetwork& network = configuration.getNetwork(i);
+            Serial.print(i == 0 ? "* " : "  ");
+            Serial.print(network.ssid);
+            Serial.print(" (priority ");
+            Serial.print(network.priority);
+            Serial.println(")");
+        }
+        Serial.print("Roams: ");
+        Serial.print(roamCount);
+        Serial.print(", reconnects: ");
+        Serial.print(reconnectCount);
+        Serial.print(", smoothed RSSI: ");
+        Serial.println(smoothedRssi);
+    }
+
+    // The disconnect first: a roam leaves the old AP and gets its IP from
+    // the new one, and both can arrive before one update(). Handled the
+    // other way round, the roam's disconnect would be taken for a lost
+    // connection. A real loss right after joining is caught by the
+    // connection check in CONNECTED instead.
+    void handleEvents() {
+        if (disconnectedEvent) {
+            disconnectedEvent = false;
+            if (state == State::CONNECTED) {
+                LOG_WARN("WiFi connection lost, reason %u", (unsigned)lastDisconnectReason);
+                // Roaming or AP reboot: the cached AP is still the best guess
+                abortScan();
+                fastPathFailed = false;
+                enterBackoff();
+            } else if (state == State::CONNECTING && lastDisconnectReason != WIFI_REASON_ASSOC_LEAVE) {
+                // ASSOC_LEAVE is the echo of our own disconnect() after a
+                // timed out attempt, not a failure of this one
+                LOG_WARN("WiFi connection failed, reason %u", (unsigned)lastDisconnectReason);
+                attemptFailed();
+            }
+            // In BACKOFF the event is the echo of our own disconnect(); in
+            // ROAMING it is leaving the old AP, the timeout covers failures
+        }
+
+        if (gotIpEvent) {
+            gotIpEvent = false;
+            if (state == State::CONNECTING) {
+                state = State::CONNECTED;
+                reconnectAttempts = 0;
+                onLinkUp();
+                bootTiming.markWiFiConnected(fastPathAttempt);
+                LOG_INFO("WiFi connected to %s in %lu ms%s, IP %s, signal %d dBm",
+                         connectedSsid, millis() - attemptStartedAt,
+                         fastPathAttempt ? " (fast path)" : "",
+                         WiFi.localIP().toString().c_str(), (int)WiFi.RSSI());
+            } else if (state == State::ROAMING) {
+                state = State::CONNECTED;
+                roamCount++;
+                onLinkUp();
+                LOG_INFO("Roamed to %s in %lu ms, signal %d dBm",
+                         WiFi.BSSIDstr().c_str(), millis() - attemptStartedAt, (int)WiFi.RSSI());
             }
         }
     }
-    
+
+    void onLinkUp() {
+        connectionCheckTimer.reset();
+        rssiTimer.reset();
+        smoothedRssi = WiFi.RSSI();
+        rememberAccessPoint();
+    }
+
+    void startConnection() {
+        if (configuration.getWifiSSID().length() == 0) {
+            state = State::IDLE;
+            return;
+        }
+
+        uint8_t bssid[6];
+        int channel = configuration.getLastChannel();
+        int network = findNetwork(configuration.getLastSSID());
+        fastPathAttempt = !fastPathFailed && channel > 0 && network >= 0 &&
+                          parseMacAddress(configuration.getLastBSSID().c_str(), bssid);
+
+        if (!fastPathAttempt) {
+            // Find the best access point of any known network first
+            if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+                LOG_ERROR("WiFi scan failed to start");
+                enterBackoff();
+                return;
+            }
+            state = State::SCANNING;
+            attemptStartedAt = millis();
+            return;
+        }
+
+        LOG_INFO("Attempting WiFi connection (attempt %d, cached AP)", reconnectAttempts + 1);
+        const WiFiNetwork& target = configuration.getNetwork(network);
+        WiFi.begin(target.ssid.c_str(), target.password.c_str(), channel, bssid, true);
+        attemptTimeout = WIFI_FAST_CONNECT_TIMEOUT_MS;
+        state = State::CONNECTING;
+        attemptStartedAt = millis();
+    }
+
+    // SCANNING: wait for the async scan, then join the best candidate
+    void handleConnectScan() {
+        int16_t found = WiFi.scanComplete();
+        if (found == WIFI_SCAN_RUNNING) {
+            if (millis() - attemptStartedAt > WIFI_SCAN_TIMEOUT_MS) {
+                LOG_WARN("WiFi scan timed out");
+                abortScan();
+                enterBackoff();
+            }
+            return;
+        }
+
+        Candidate best;
+        bool haveCandidate = found > 0 && selectCandidate(found, best);
+        WiFi.scanDelete();
+        if (!haveCandidate) {
+            LOG_WARN("No known WiFi network in range");
+            enterBackoff();
+            return;
+        }
+
+        const WiFiNetwork& target = configuration.getNetwork(best.network);
+        LOG_INFO("Attempting WiFi connection (attempt %d) to %s at %d dBm",
+                 reconnectAttempts + 1, target.ssid.c_str(), (int)best.rssi);
+        WiFi.begin(target.ssid.c_str(), target.password.c_str(), best.channel, best.bssid, true);
+        attemptTimeout = WIFI_CONNECT_TIMEOUT_MS;
+        state = State::CONNECTING;
+        attemptStartedAt = millis();
+    }
+
+    // Track the link quality and look for a better AP when it degrades
+    void monitorSignal() {
+        if (roamScanRunning) {
+            handleRoamScan();
+            return;
+        }
+        if (!rssiTimer.checkAndReset()) return;
+
+        // Moving average (alpha = 1/4) so a single fade doesn't trigger a scan
+        int rssi = WiFi.RSSI();
+        if (rssi == 0) return;
+        smoothedRssi += (rssi - smoothedRssi) / 4;
+
+        if (smoothedRssi < WIFI_ROAM_RSSI_THRESHOLD &&
+            (lastRoamScanAt == 0 || millis() - lastRoamScanAt > WIFI_ROAM_COOLDOWN_MS)) {
+            startRoamScan();
+        }
+    }
+
+    void startRoamScan() {
+        lastRoamScanAt = millis();
+        if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) return;
+        roamScanRunning = true;
+        LOG_INFO("WiFi signal at %d dBm, scanning for a better AP", (int)smoothedRssi);
+    }
+
+    void handleRoamScan() {
+        int16_t found = WiFi.scanComplete();
+        if (found == WIFI_SCAN_RUNNING) {
+            if (millis() - lastRoamScanAt > WIFI_SCAN_TIMEOUT_MS) abortScan();
+            return;
+        }
+        roamScanRunning = false;
+
+        Candidate best;
+        bool haveCandidate = found > 0 && selectCandidate(found, best);
+        WiFi.scanDelete();
+        if (!haveCandidate) return;
+
+        // Compare against the current link with the same priority bonus,
+        // so a preferred network isn't abandoned for a slightly louder one
+        int current = findNetwork(WiFi.SSID());
+        int currentScore = WiFi.RSSI() +
+            (current >= 0 ? configuration.getNetwork(current).priority * WIFI_PRIORITY_STEP_DB : 0);
+        const uint8_t* currentBssid = WiFi.BSSID();
+        if (currentBssid && memcmp(currentBssid, best.bssid, 6) == 0) return;
+        if (best.score < currentScore + WIFI_ROAM_HYSTERESIS_DB) return;
+
+        // Join the new BSSID directly: no scan, and with a static IP or an
+        // unexpired lease no DHCP round trip either. begin() still leaves
+        // the old AP first, so the link is down until the join completes.
+        const WiFiNetwork& target = configuration.getNetwork(best.network);
+        LOG_INFO("Roaming to %s (%d dBm)", target.ssid.c_str(), (int)best.rssi);
+        WiFi.begin(target.ssid.c_str(), target.password.c_str(), best.channel, best.bssid, true);
+        state = State::ROAMING;
+        attemptStartedAt = millis();
+    }
+
+    // Pick the highest scoring access point of a known network from the
+    // scan results
+    bool selectCandidate(int16_t found, Candidate& best) {
+        bool haveCandidate = false;
+        for (int16_t i = 0; i < found; ++i) {
+            int network = findNetwork(WiFi.SSID(i));
+            if (network < 0) continue;
+            int rssi = WiFi.RSSI(i);
+            int score = rssi + configuration.getNetwork(network).priority * WIFI_PRIORITY_STEP_DB;
+            if (haveCandidate && score <= best.score) continue;
+            const uint8_t* bssid = WiFi.BSSID(i);
+            if (!bssid) continue;
+            best.network = network;
+            best.rssi = rssi;
+            best.score = score;
+            best.channel = WiFi.channel(i);
+            memcpy(best.bssid, bssid, 6);
+            haveCandidate = true;
+        }
+        return haveCandidate;
+    }
+
+    int findNetwork(const String& ssid) const {
+        if (ssid.length() == 0) return -1;
+        for (int i = 0; i < configuration.getNetworkCount(); ++i) {
+            if (configuration.getNetwork(i).ssid == ssid) return i;
+        }
+        return -1;
+    }
+
+    void abortScan() {
+        if (roamScanRunning || state == State::SCANNING) WiFi.scanDelete();
+        roamScanRunning = false;
+    }
+
+    // A failed fast-path join falls back to a full scan immediately rather
+    // than backing off; the cached AP may simply have moved channel.
+    void attemptFailed() {
+        if (fastPathAttempt) {
+            LOG_INFO("Cached AP join failed, falling back to full scan");
+            fastPathFailed = true;
+            startConnection();
+            return;
+        }
+        enterBackoff();
+    }
+
+    void rememberAccessPoint() {
+        const uint8_t* bssid = WiFi.BSSID();
+        if (!bssid) return;
+        char text[18];
+        formatMacAddress(bssid, text);
+        String ssid = WiFi.SSID();
+        snprintf(connectedSsid, sizeof(connectedSsid), "%s", ssid.c_str());
+        configuration.setLastAccessPoint(ssid, String(text), WiFi.channel());
+        fastPathFailed = false;
+    }
+
+    void applyStaticIP() {
+        if (configuration.getStaticIP().length() == 0) return;
+        IPAddress ip, gateway, subnet, dns;
+        if (!ip.fromString(configuration.getStaticIP()) ||
+            !gateway.fromString(configuration.getGateway()) ||
+            !subnet.fromString(configuration.getSubnet())) {
+            LOG_WARN("Invalid static IP configuration, using DHCP");
+            return;
+        }
+        // Fall back to the gateway as resolver when no DNS is configured
+        if (!dns.fromString(configuration.getDNS())) dns = gateway;
+        WiFi.config(ip, gateway, subnet, dns);
+        LOG_INFO("Using static IP %s", ip.toString().c_str());
+    }
+
+    // Exponential backoff with "equal jitter": wait between half and all of
+    // min(base * 2^attempts, max)
+    void enterBackoff() {
+        reconnectAttempts++;
+        reconnectCount++;
+        int shift = reconnectAttempts - 1;
+        if (shift > 10) shift = 10;
+        unsigned long backoff = (unsigned long)WIFI_BACKOFF_BASE_MS << shift;
+        if (backoff > WIFI_BACKOFF_MAX_MS) backoff = WIFI_BACKOFF_MAX_MS;
+        unsigned long wait = backoff / 2 + random(0, backoff / 2 + 1);
+
+        state = State::BACKOFF;
+        nextAttemptAt = millis() + wait;
+        LOG_INFO("Retrying WiFi in %lu ms", wait);
+    }
+
     Timer connectionCheckTimer;
-    Timer reconnectAttemptTimer;
-    WiFiMulti wifiMulti;
-    uint32_t lastConnectionCheck;
-    bool isConnected;
-    int reconnectAttempts;
-    int maxReconnectAttempts;
+    Timer rssiTimer;
+    State state;
+    unsigned long attemptStartedAt;
+    unsigned long attemptTimeout;
+    bool fastPathAttempt;           // current attempt targets the cached AP
+    bool fastPathFailed;            // skip the cached AP until the next success
+    unsigned long nextAttemptAt;
+    int reconnectAttempts;          // consecutive failures, reset on success
+    uint32_t reconnectCount;        // total failures/losses since boot
+    uint32_t roamCount;             // successful handovers since boot
+    int smoothedRssi;               // dBm, moving average while connected
+    bool roamScanRunning;
+    unsigned long lastRoamScanAt;
+
+    // Set from the WiFi event task, consumed in update()
+    volatile bool gotIpEvent;
+    volatile bool disconnectedEvent;
+    volatile uint8_t lastDisconnectReason;
+
+    char connectedSsid[33];         // SSID of the current AP, kept for getState()
+    char stateText[48];
 };
 
 #endif // WIFI_PROCESS_H
@@ -0,0 +1,4 @@
+#include "BootTiming.h"
+
+// Global boot timing instance
+BootTiming bootTiming;
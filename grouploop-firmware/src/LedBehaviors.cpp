@@ -1,13 +1,109 @@
-#include "processes/LedBehaviors.h"
+#include "processes/LedBehaviorPool.h"
 
-// --- Global LED Behavior Instances ---
-// These instances are defined here and available globally
+// --- LED Behavior Factory ---
+// Builds the behaviors of LedBehaviorPool from their specs
 
-// Basic behaviors
-LedsOffBehavior ledsOff;
-SolidBehavior ledsSolid;
-BreathingBehavior ledsBreathing(0xFFFFFF, 2000);
-HeartBeatBehavior ledsHeartBeat;
-CycleBehavior ledsCycle(0x000000, 100);
-SpringBehavior ledsSpring(0xFFFFFF); // Green spring with default parameters
+LedBehavior* ledMakeBehavior(const LedBehaviorSpec& spec, void* memory) {
+    if (!ledSpecValid(spec)) return nullptr;
+    const uint16_t* p = spec.params;
+    switch (spec.type) {
+        case LED_BEHAVIOR_OFF:
+            return new (memory) LedsOffBehavior();
+        case LED_BEHAVIOR_SOLID:
+            return new (memory) SolidBehavior(spec.color);
+        case LED_BEHAVIOR_BREATHING:
+            return new (memory) BreathingBehavior(spec.color, p[0]);
+        case LED_BEHAVIOR_HEARTBEAT:
+            return new (memory) HeartBeatBehavior(spec.color, p[0], p[1]);
+        case LED_BEHAVIOR_CYCLE:
+            return new (memory) CycleBehavior(spec.color, p[0]);
+        case LED_BEHAVIOR_SPRING:
+            return new (memory) SpringBehavior(spec.color, 0.0f, p[0] / 10.0f, p[1] / 10.0f, p[2] / 10.0f);
+        case LED_BEHAVIOR_GRADIENT: {
+            GradientBehavior* gradient = new (memory) GradientBehavior(LED_PALETTES[p[0]].palette, (uint8_t)p[1], p[2]);
+            gradient->setColor(spec.color);
+            return gradient;
+        }
+        case LED_BEHAVIOR_COMET: {
+            CometBehavior* comet = new (memory) CometBehavior(LED_PALETTES[p[0]].palette, (uint8_t)p[1], p[2], (uint8_t)p[3]);
+            comet->setColor(spec.color);
+            return comet;
+        }
+        case LED_BEHAVIOR_TWINKLE: {
+            TwinkleBehavior* twinkle = new (memory) TwinkleBehavior(LED_PALETTES[p[0]].palette, (uint8_t)p[1], (uint8_t)p[2], (uint8_t)p[3]);
+            twinkle->setColor(spec.color);
+            return twinkle;
+        }
+        case LED_BEHAVIOR_FIRE: {
+            FireBehavior* fire = new (memory) FireBehavior(LED_PALETTES[p[0]].palette, (uint8_t)p[1], (uint8_t)p[2], (uint8_t)p[3]);
+            fire->setColor(spec.color);
+            return fire;
+        }
+        case LED_BEHAVIOR_SHAKE:
+            return new (memory) ShakeBehavior(spec.color, p[0], (uint8_t)p[1], (uint8_t)p[2]);
+        case LED_BEHAVIOR_TILT: {
+            TiltBehavior* tilt = new (memory) TiltBehavior(LED_PALETTES[p[0]].palette, p[1], (uint8_t)p[2]);
+            tilt->setColor(spec.color);
+            return tilt;
+        }
+        case LED_BEHAVIOR_MOTION_SPRING:
+            return new (memory) MotionSpringBehavior(spec.color, p[0], p[1]);
+        default:
+            return nullptr;
+    }
+}
 
+static bool isParamName(const LedBehaviorParam& param, const char* name) {
+    return param.name && strcmp(param.name, name) == 0;
+}
+
+bool ledParseSpec(const char* text, uint32_t color, LedBehaviorSpec& spec) {
+    const char* separator = strchr(text, ':');
+    int type = ledFindBehaviorType(text, separator ? (size_t)(separator - text) : strlen(text));
+    if (type < 0) return false;
+
+    LedBehaviorSpec parsed = ledDefaultSpec((LedBehaviorType)type, color);
+    for (int i = 0; separator; ++i) {
+        const char* value = separator + 1;
+        separator = strchr(value, ':');
+        if (i >= LED_BEHAVIOR_PARAMS) return false;
+        const LedBehaviorParam& param = LED_BEHAVIOR_INFO[type].params[i];
+        if (!param.name) return false;
+
+        char token[16];
+        size_t length = separator ? (size_t)(separator - value) : strlen(value);
+        if (length == 0 || length >= sizeof(token)) return false;
+        memcpy(token, value, length);
+        token[length] = '\0';
+
+        long number;
+        char* end;
+        const LedPalette* palette;
+        if (isParamName(param, "palette") && ledFindPalette(token, palette)) {
+            number = 0;
+            while (LED_PALETTES[number].palette != palette) number++;
+        } else {
+            number = strtol(token, &end, 10);
+            if (*end != '\0') return false;
+        }
+        if (number < param.low || number > param.high) return false;
+        parsed.params[i] = (uint16_t)number;
+    }
+    spec = parsed;
+    return true;
+}
+
+int ledFormatSpec(const LedBehaviorSpec& spec, char* buffer, size_t size) {
+    if (spec.type >= LED_BEHAVIOR_TYPE_COUNT) return snprintf(buffer, size, "?");
+    const LedBehaviorInfo& info = LED_BEHAVIOR_INFO[spec.type];
+    int length = snprintf(buffer, size, "%s", info.name);
+    for (int i = 0; i < LED_BEHAVIOR_PARAMS && info.params[i].name; ++i) {
+        if (length < 0 || (size_t)length >= size) break;
+        if (isParamName(info.params[i], "palette")) {
+            length += snprintf(buffer + length, size - length, ":%s", LED_PALETTES[spec.params[i]].name);
+        } else {
+            length += snprintf(buffer + length, size - length, ":%u", spec.params[i]);
+        }
+    }
+    return length;
+}
@@ -0,0 +1,107 @@
+#include "Log.h"
+
+// Global logger instance
+Logger logger;
+
+void Logger::commit(uint8_t level, const uint8_t* record, size_t length) {
+    portENTER_CRITICAL(&lock);
+    // Drop whole records from the tail until the new one fits
+    while (headPos - tailPos + length > LOG_RING_SIZE) {
+        tailPos += ring[tailPos % LOG_RING_SIZE];
+        overwritten++;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        ring[(headPos + i) % LOG_RING_SIZE] = record[i];
+    }
+    headPos += length;
+    if (level == LOG_LEVEL_ERROR) errorLogged = true;
+    portEXIT_CRITICAL(&lock);
+
+    if (level <= serialLevel) {
+        printRecord(record, length);
+    }
+}
+
+size_t Logger::readRecord(uint32_t& position, uint8_t* out, size_t size) {
+    size_t length = 0;
+    portENTER_CRITICAL(&lock);
+    if ((int32_t)(position - tailPos) < 0) position = tailPos;
+    if (position != headPos) {
+        length = ring[position % LOG_RING_SIZE];
+        if (length <= size) {
+            for (size_t i = 0; i < length; ++i) {
+                out[i] = ring[(position + i) % LOG_RING_SIZE];
+            }
+        } else {
+            length = 0; // can't happen: records are at most LOG_RECORD_MAX
+        }
+        position += ring[position % LOG_RING_SIZE];
+    }
+    portEXIT_CRITICAL(&lock);
+    return length;
+}
+
+uint32_t Logger::getHeadPosition() {
+    portENTER_CRITICAL(&lock);
+    uint32_t position = headPos;
+    portEXIT_CRITICAL(&lock);
+    return position;
+}
+
+bool Logger::takeErrorFlag() {
+    if (!errorLogged) return false;
+    errorLogged = false;
+    return true;
+}
+
+void Logger::dump() {
+    // One record is copied out at a time, so the lock is never held across
+    // Serial writes. Records overwritten while dumping are skipped.
+    uint32_t position = 0;
+    uint32_t end = getHeadPosition();
+    Serial.printf("--- log (%lu records overwritten) ---\n", (unsigned long)overwritten);
+    uint8_t record[LOG_RECORD_MAX];
+    while (position != end) {
+        size_t length = readRecord(position, record, sizeof(record));
+        if (length == 0) break;
+        printRecord(record, length);
+    }
+    Serial.println("--- end of log ---");
+}
+
+void Logger::clear() {
+    portENTER_CRITICAL(&lock);
+    tailPos = headPos;
+    overwritten = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+// On the device the recorded format address is directly readable
+void Logger::printRecord(const uint8_t* record, size_t length) {
+    LogRecordView view;
+    if (!logParseRecord(record, length, sizeof(uintptr_t), view)) return;
+    char line[LOG_LINE_MAX];
+    size_t lineLength = logFormatLine(line, sizeof(line) - 1, (const char*)(uintptr_t)view.formatAddress, view);
+    line[lineLength++] = '\n';
+    Serial.write((const uint8_t*)line, lineLength);
+}
+
+const char* Logger::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_NONE: return "none";
+        case LOG_LEVEL_ERROR: return "error";
+        case LOG_LEVEL_WARN: return "warn";
+        case LOG_LEVEL_INFO: return "info";
+        default: return "debug";
+    }
+}
+
+bool Logger::parseLevel(const String& name, uint8_t& level) {
+    for (uint8_t candidate = LOG_LEVEL_NONE; candidate <= LOG_LEVEL_DEBUG; ++candidate) {
+        if (name == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,4 @@
+#include "MotionSlot.h"
+
+// Latest IMU reading, written by IMUProcess, read by the LED behaviors
+MotionSlot motionSlot;
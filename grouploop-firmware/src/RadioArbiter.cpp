@@ -0,0 +1,4 @@
+#include "RadioArbiter.h"
+
+// Global radio arbiter instance
+RadioArbiter radioArbiter;
@@ -0,0 +1,106 @@
+#include "TraceRecorder.h"
+
+// Global trace recorder instance
+TraceRecorder traceRecorder;
+
+void TraceRecorder::start() {
+    clear();
+    uint8_t record[TRACE_RECORD_HEADER_SIZE + 1];
+    size_t length = traceWriteHeader(record, TRACE_START, micros(), 1);
+    record[length++] = TRACE_FORMAT_VERSION;
+    commit(record, length);
+    capturing = true;
+}
+
+void TraceRecorder::writeImu(float x, float y, float z) {
+    uint8_t record[TRACE_RECORD_HEADER_SIZE + 6];
+    size_t length = traceWriteHeader(record, TRACE_IMU, micros(), 6);
+    logPutLE(record + length, (uint16_t)traceSampleToInt16(x), 2);
+    logPutLE(record + length + 2, (uint16_t)traceSampleToInt16(y), 2);
+    logPutLE(record + length + 4, (uint16_t)traceSampleToInt16(z), 2);
+    commit(record, length + 6);
+}
+
+void TraceRecorder::writeScan(bool started) {
+    uint8_t record[TRACE_RECORD_HEADER_SIZE + 1];
+    size_t length = traceWriteHeader(record, TRACE_SCAN, micros(), 1);
+    record[length++] = started ? 1 : 0;
+    commit(record, length);
+}
+
+void TraceRecorder::writeAdvert(const uint8_t* address, int rssi, const uint8_t* payload, size_t payloadLength) {
+    uint8_t record[TRACE_RECORD_MAX];
+    if (TRACE_RECORD_HEADER_SIZE + 7 + payloadLength > sizeof(record)) {
+        skipped++;
+        return;
+    }
+    size_t length = traceWriteHeader(record, TRACE_ADVERT, micros(), 7 + payloadLength);
+    memcpy(record + length, address, 6);
+    record[length + 6] = (uint8_t)(int8_t)(rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi));
+    memcpy(record + length + 7, payload, payloadLength);
+    commit(record, length + 7 + payloadLength);
+}
+
+void TraceRecorder::writeMessage(const char* data, size_t dataLength) {
+    // Longer messages are dropped by the receive queue, so replaying
+    // without them behaves the same
+    uint8_t record[TRACE_RECORD_MAX];
+    if (TRACE_RECORD_HEADER_SIZE + dataLength > sizeof(record)) {
+        skipped++;
+        return;
+    }
+    size_t length = traceWriteHeader(record, TRACE_MESSAGE, micros(), dataLength);
+    memcpy(record + length, data, dataLength);
+    commit(record, length + dataLength);
+}
+
+void TraceRecorder::commit(const uint8_t* record, size_t length) {
+    portENTER_CRITICAL(&lock);
+    // Drop whole records from the tail until the new one fits
+    while (headPos - tailPos + length > TRACE_RING_SIZE) {
+        uint16_t dropped = ring[tailPos % TRACE_RING_SIZE] | ring[(tailPos + 1) % TRACE_RING_SIZE] << 8;
+        tailPos += dropped;
+        overwritten++;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        ring[(headPos + i) % TRACE_RING_SIZE] = record[i];
+    }
+    headPos += length;
+    records++;
+    portEXIT_CRITICAL(&lock);
+}
+
+size_t TraceRecorder::read(uint32_t& position, uint8_t* out, size_t size) {
+    portENTER_CRITICAL(&lock);
+    if ((int32_t)(position - tailPos) < 0) position = tailPos;
+    size_t length = headPos - position;
+    if (length > size) length = size;
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = ring[(position + i) % TRACE_RING_SIZE];
+    }
+    portEXIT_CRITICAL(&lock);
+    return length;
+}
+
+uint32_t TraceRecorder::getHeadPosition() {
+    portENTER_CRITICAL(&lock);
+    uint32_t position = headPos;
+    portEXIT_CRITICAL(&lock);
+    return position;
+}
+
+uint32_t TraceRecorder::getBufferedBytes() {
+    portENTER_CRITICAL(&lock);
+    uint32_t bytes = headPos - tailPos;
+    portEXIT_CRITICAL(&lock);
+    return bytes;
+}
+
+void TraceRecorder::clear() {
+    portENTER_CRITICAL(&lock);
+    tailPos = headPos;
+    records = 0;
+    overwritten = 0;
+    skipped = 0;
+    portEXIT_CRITICAL(&lock);
+}
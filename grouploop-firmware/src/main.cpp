@@ -20,28 +20,38 @@ Commands van de server uitvoeren.                         |
 #include "processes/ReceiveProcess.h"
 #include "processes/ConfigurationProcess.h"
 #include "processes/WiFiProcess.h"
+#include "processes/NetworkProcess.h"
+#include "processes/HealthProcess.h"
+#include "processes/LogProcess.h"
+#include "processes/TraceProcess.h"
+#include "processes/SequenceProcess.h"
 #include "Process.h"
 #include "ProcessManager.h"
 #include "WebSocketManager.h"
 #include "CommandRegistry.h"
+#include "BootTiming.h"
+#include "RadioArbiter.h"
 
 
-// Global pointer for BLE callback
-BLEProcess* g_BLEProcess = nullptr;
-
 // Global Configuration instance
 Configuration configuration;
 
 // Global ProcessManager instance
 ProcessManager processManager;
 
+// Processes loop() consults directly, looked up once in setup() instead of
+// by name on every iteration
+ConfigurationProcess* configurationProcess = nullptr;
+WiFiProcess* wifiProcess = nullptr;
+BLEProcess* bleProcess = nullptr;
+LedProcess* ledProcess = nullptr;
+
 
 void registerGlobalCommands() {
   // Register status command
   commandRegistry.registerCommand("status", [](const String& params) {
     Serial.println("=== Device Status ===");
     Serial.print("WiFi: ");
-    WiFiProcess* wifiProcess = static_cast<WiFiProcess*>(processManager.getProcess("wifi"));
     if (wifiProcess) {
       Serial.println(wifiProcess->isWiFiConnected() ? "Connected" : "Disconnected");
     } else {
@@ -49,9 +59,9 @@ void registerGlobalCommands() {
     }
     
     Serial.print("BLE: ");
-    BLEProcess* bleProcess = static_cast<BLEProcess*>(processManager.getProcess("ble"));
     if (bleProcess) {
       Serial.println(bleProcess->isProcessRunning() ? "Running" : "Stopped");
+      bleProcess->printScanStats();
     } else {
       Serial.println("Unknown");
     }
@@ -62,11 +72,40 @@ void registerGlobalCommands() {
     Serial.print("Device ID: ");
     Serial.println(webSocketManager.getDeviceId());
     
+    bootTiming.print();
+    radioArbiter.printStats();
+    webSocketManager.printUplinkStats();
+    
+    Serial.print("Free Heap: ");
+    Serial.println(ESP.getFreeHeap());
+    
     Serial.print("Registered Commands: ");
     Serial.println(commandRegistry.getCommandCount());
     
     Serial.println("===================");
   });
+
+  // coex:<wifi|ble|balance> sets who wins when WiFi and BLE contend for the
+  // radio; coex:reset clears the uplink timing statistics
+  commandRegistry.registerCommand("coex", [](const String& params) {
+    if (params == "reset") {
+      radioArbiter.resetStats();
+      Serial.println("Radio statistics reset");
+      return;
+    }
+    CoexPreference preference;
+    if (!RadioArbiter::parseCoexName(params, preference)) {
+      Serial.println("coex requires wifi, ble, balance or reset");
+      return;
+    }
+    if (!radioArbiter.setCoexPreference(preference)) {
+      Serial.println("Failed to set coexistence preference");
+      return;
+    }
+    configuration.setCoexPreference((int)preference);
+    Serial.print("Coexistence preference: ");
+    Serial.println(RadioArbiter::coexName(preference));
+  });
 }
 
 void setup() {
@@ -88,18 +127,26 @@ void setup() {
   processManager.addProcess("vibration", new VibrationProcess());
   processManager.addProcess("imu", new IMUProcess());
   processManager.addProcess("ble", new BLEProcess());
+  processManager.addProcess("network", new NetworkProcess());
   processManager.addProcess("publish", new PublishProcess());
   processManager.addProcess("receive", new ReceiveProcess());
+  processManager.addProcess("health", new HealthProcess());
+  processManager.addProcess("log", new LogProcess());
+  processManager.addProcess("trace", new TraceProcess());
+  processManager.addProcess("sequence", new SequenceProcess());
   
   
+  configurationProcess = static_cast<ConfigurationProcess*>(processManager.getProcess("configuration"));
+  wifiProcess = static_cast<WiFiProcess*>(processManager.getProcess("wifi"));
+  bleProcess = static_cast<BLEProcess*>(processManager.getProcess("ble"));
+  ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
+  
   // Initially halt BLE process until WiFi is connected
   processManager.haltProcess("ble");
 
   // Set up LED behavior
-  LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
   if (ledProcess) {
-    ledsBreathing.setColor(0xFF0000);
-    ledProcess->setBehavior(&ledsBreathing);
+    ledProcess->setPattern(ledDefaultSpec(LED_BEHAVIOR_BREATHING, 0xFF0000));
   }
 
   // Initialize all processes
@@ -111,7 +158,6 @@ void setup() {
 
 void loop() {
   // Always update configuration process first
-  ConfigurationProcess* configurationProcess = static_cast<ConfigurationProcess*>(processManager.getProcess("configuration"));
   if (configurationProcess && configurationProcess->isProcessRunning()) {
     configurationProcess->update();
   }
@@ -122,10 +168,6 @@ void loop() {
   }
   
   // Check WiFi status and start BLE process when WiFi is connected
-  WiFiProcess* wifiProcess = static_cast<WiFiProcess*>(processManager.getProcess("wifi"));
-  BLEProcess* bleProcess = static_cast<BLEProcess*>(processManager.getProcess("ble"));
-  LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
-  
   if (wifiProcess && bleProcess) {
     if (wifiProcess->isWiFiConnected() && !bleProcess->isProcessRunning()) {
       Serial.println("WiFi connected - starting BLE process");
@@ -147,9 +189,6 @@ void loop() {
   }
   
   
-  // Update the shared WebSocket connection
-  webSocketManager.update();
-  
   // Update all other running processes
   processManager.updateProcesses();
 }
@@ -0,0 +1,808 @@
+// LED behaviors drawing into a frame, the compositor on a fake strip, and
+// the LED commands of LedProcess
+#include <Arduino.h>
+#include <unity.h>
+#include "Configuration.h"
+#include "LedMath.h"
+#include "processes/LedBehaviors.h"
+#include "processes/LedBehaviorPool.h"
+#include "processes/LedCompositor.h"
+#include "processes/LedProcess.h"
+#include "processes/IMUProcess.h"
+#include "ProcessManager.h"
+
+Configuration configuration;
+
+static LedFrame* frame;
+
+static uint8_t greenOf(uint32_t color) { return (color >> 8) & 0xFF; }
+
+// Run 'behavior' for 'durationMs' in 'stepMs' steps, tracking the range of
+// green channel of the first pixel
+static void run(LedBehavior& behavior, unsigned long durationMs, unsigned long stepMs, uint8_t& low, uint8_t& high) {
+    low = 255;
+    high = 0;
+    for (unsigned long t = 0; t < durationMs; t += stepMs) {
+        fake::advance(stepMs);
+        behavior.update();
+        uint8_t value = greenOf(frame->getPixelColor(0));
+        if (value < low) low = value;
+        if (value > high) high = value;
+    }
+}
+
+// An IMU reading taken now
+static void publishMotion(int16_t x, int16_t y, int16_t z, uint16_t motion, uint32_t taps = 0) {
+    motionSlot.publish(MotionSample{x, y, z, motion, taps, (uint32_t)millis()});
+}
+
+void setUp() {
+    fake::setMillis(10000);
+    Serial.reset();
+    publishMotion(0, 0, 1000, 0); // at rest, no taps
+    frame = new LedFrame();
+}
+
+void tearDown() {
+    delete frame;
+}
+
+void test_solid_fills_all_pixels() {
+    SolidBehavior solid(0x123456);
+    solid.setup(*frame);
+    for (uint16_t i = 0; i < frame->numPixels(); ++i) {
+        TEST_ASSERT_EQUAL_HEX32(0x123456, frame->getPixelColor(i));
+    }
+}
+
+void test_off_clears_frame() {
+    frame->fill(0xFFFFFF);
+    LedsOffBehavior off;
+    off.setup(*frame);
+    TEST_ASSERT_TRUE(frame->takeChanged());
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(0));
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(LED_COUNT - 1));
+}
+
+void test_breathing_sweeps_full_range() {
+    BreathingBehavior breathing(0x00FF00, 2000);
+    breathing.setup(*frame);
+    uint8_t low, high;
+    run(breathing, 2000, 21, low, high);
+    TEST_ASSERT_GREATER_OR_EQUAL(250, high);
+    TEST_ASSERT_LESS_OR_EQUAL(5, low);
+    // Only the green channel is lit
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(0) & 0xFF00FF);
+}
+
+void test_breathing_updates_at_50hz() {
+    BreathingBehavior breathing(0x00FF00, 2000);
+    breathing.setup(*frame);
+    frame->takeChanged();
+    int frames = 0;
+    for (int i = 0; i < 100; ++i) {
+        fake::advance(1);
+        breathing.update();
+        if (frame->takeChanged()) frames++;
+    }
+    TEST_ASSERT_INT_WITHIN(1, 4, frames);
+}
+
+void test_heartbeat_waits_then_beats_twice() {
+    HeartBeatBehavior heartbeat(0x00FF00, 770, 2000);
+    heartbeat.setup(*frame);
+
+    uint8_t low, high;
+    run(heartbeat, 1900, 21, low, high);
+    TEST_ASSERT_EQUAL(0, high);
+
+    // Count rising edges to full brightness over the next beat
+    int peaks = 0;
+    bool lit = false;
+    for (int t = 0; t < 1200; t += 21) {
+        fake::advance(21);
+        heartbeat.update();
+        bool full = greenOf(frame->getPixelColor(0)) == 255;
+        if (full && !lit) peaks++;
+        lit = full;
+    }
+    TEST_ASSERT_EQUAL(2, peaks);
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(0));
+}
+
+void test_cycle_walks_one_pixel() {
+    CycleBehavior cycle(0x0000FF, 100);
+    cycle.setup(*frame);
+    for (int step = 0; step < LED_COUNT + 1; ++step) {
+        fake::advance(101);
+        cycle.update();
+        int lit = step % LED_COUNT;
+        for (int i = 0; i < LED_COUNT; ++i) {
+            TEST_ASSERT_EQUAL_HEX32(i == lit ? 0x0000FF : 0, frame->getPixelColor(i));
+        }
+    }
+}
+
+void test_spring_settles_on_target() {
+    SpringBehavior spring(0x00FF00);
+    spring.setup(*frame);
+    uint8_t low, high;
+    run(spring, 5000, 17, low, high);
+    TEST_ASSERT_LESS_OR_EQUAL(5, greenOf(frame->getPixelColor(0)));
+
+    // Overshooting full brightness must not wrap around to dark
+    spring.setTargetBrightness(1.0f);
+    run(spring, 5000, 17, low, high);
+    run(spring, 1000, 17, low, high);
+    TEST_ASSERT_GREATER_OR_EQUAL(250, low);
+}
+
+// The integer kernels against the float and division code they replaced
+
+void test_scale_matches_division() {
+    for (uint32_t value = 0; value < 256; ++value) {
+        for (uint32_t scale = 0; scale < 256; ++scale) {
+            TEST_ASSERT_EQUAL(value * scale / 255, ledScale8((uint8_t)value, (uint8_t)scale));
+        }
+    }
+
+    // Alpha blending, for every pair of channel values
+    LedFrame layer;
+    uint8_t output[LED_COUNT][3];
+    for (int opacity : {1, 77, 128, 254, 255}) {
+        for (int src = 1; src < 256; ++src) {
+            for (int dst = 0; dst < 256; ++dst) {
+                layer.setPixelColor(0, LedFrame::Color(src, src, src));
+                output[0][0] = (uint8_t)dst;
+                LedCompositor::blend(output, layer, LED_BLEND_ALPHA, (uint8_t)opacity);
+                TEST_ASSERT_EQUAL(dst + (src - dst) * opacity / 255, output[0][0]);
+            }
+        }
+    }
+}
+
+void test_sine_table_matches_sin() {
+    // BreathingBehavior used (uint8_t)(((sin(t * 2 pi / period) + 1) / 2) * 255)
+    int mismatches = 0;
+    for (uint32_t period : {1000u, 2000u, 4000u, 100000u}) {
+        for (uint32_t t = 0; t < period; t += period / 1000) {
+            int expected = (uint8_t)(((sin(t * 2.0 * PI / period) + 1.0) / 2.0) * 255.0);
+            int actual = ledSineWave(ledPhase16(t, period)) >> 8;
+            TEST_ASSERT_INT_WITHIN(1, expected, actual);
+            if (actual != expected) mismatches++;
+        }
+    }
+    // About 1% off by one, where the sine is within a hundredth of a step
+    TEST_ASSERT_LESS_THAN(80, mismatches);
+    TEST_ASSERT_EQUAL(ledSineWave(0), ledSineWave(ledPhase16(4000, 4000)));
+}
+
+// The float Euler spring SpringBehavior ran before it went fixed point
+struct FloatSpring {
+    float k, c, m, target, position, velocity;
+    uint8_t step(float dt) {
+        float acceleration = (-k * (position - target) - c * velocity) / m;
+        velocity += acceleration * dt;
+        position += velocity * dt;
+        float level = fabsf(position);
+        if (level > 1.0f) level = 1.0f;
+        return (uint8_t)(level * 255.0f);
+    }
+};
+
+void test_spring_fixed_point_tracks_float() {
+    const float params[][4] = {
+        {20.1f, 2.0f, 1.0f, 0.0f},  // the default, settling to dark
+        {20.1f, 2.0f, 1.0f, 1.0f},  // overshooting full brightness
+        {2.5f, 0.3f, 0.4f, 0.5f},   // soft, barely damped
+        {25.5f, 10.0f, 1.0f, 0.0f}, // stiff and heavily damped
+    };
+    for (const auto& p : params) {
+        SpringBehavior spring(0x00FF00);
+        spring.setup(*frame);
+        spring.setSpringParams(p[0], p[1], p[2]);
+        spring.setTargetBrightness(p[3]);
+        FloatSpring reference = {p[0], p[1], p[2], p[3], 1.0f, 0.0f};
+
+        fake::advance(17);
+        spring.update(); // the first update only takes the time
+        for (int i = 0; i < 300; ++i) {
+            fake::advance(17);
+            spring.update();
+            uint8_t expected = reference.step(0.017f);
+            TEST_ASSERT_INT_WITHIN(1, expected, greenOf(frame->getPixelColor(0)));
+        }
+    }
+}
+
+void test_flash_fades_out() {
+    FlashBehavior flash(0x00FF00, 200);
+    flash.setup(*frame);
+    fake::advance(100);
+    flash.update();
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(0));
+
+    flash.trigger();
+    TEST_ASSERT_EQUAL(255, greenOf(frame->getPixelColor(0)));
+    uint8_t low, high;
+    run(flash, 100, 21, low, high);
+    TEST_ASSERT_LESS_THAN(255, low);
+    TEST_ASSERT_GREATER_THAN(0, low);
+    run(flash, 150, 21, low, high);
+    TEST_ASSERT_FALSE(flash.isActive());
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(LED_COUNT - 1));
+}
+
+void test_blend_modes() {
+    LedFrame layer;
+    layer.setPixelColor(0, 0x80C000);
+    uint8_t output[LED_COUNT][3];
+
+    memset(output, 0x60, sizeof(output));
+    LedCompositor::blend(output, layer, LED_BLEND_ADD, 255);
+    TEST_ASSERT_EQUAL_HEX8(0xE0, output[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, output[0][1]); // saturates
+    TEST_ASSERT_EQUAL_HEX8(0x60, output[0][2]);
+
+    memset(output, 0x60, sizeof(output));
+    LedCompositor::blend(output, layer, LED_BLEND_MAX, 255);
+    TEST_ASSERT_EQUAL_HEX8(0x80, output[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(0xC0, output[0][1]);
+    TEST_ASSERT_EQUAL_HEX8(0x60, output[0][2]);
+
+    // Alpha mixes lit pixels by opacity, dark ones let the layer below through
+    memset(output, 0x60, sizeof(output));
+    LedCompositor::blend(output, layer, LED_BLEND_ALPHA, 128);
+    TEST_ASSERT_UINT8_WITHIN(1, 0x70, output[0][0]);
+    TEST_ASSERT_UINT8_WITHIN(1, 0x90, output[0][1]);
+    TEST_ASSERT_UINT8_WITHIN(1, 0x30, output[0][2]);
+    TEST_ASSERT_EQUAL_HEX8(0x60, output[1][0]);
+}
+
+void test_compositor_layers_and_shows() {
+    Adafruit_NeoPixel strip(LED_COUNT, 2, NEO_GRB + NEO_KHZ800);
+    LedCompositor compositor;
+    compositor.setCorrection(false); // the blend itself on the strip
+    SolidBehavior solid(0x200000);
+    FlashBehavior flash(0x0000FF, 100);
+    StatusPixelBehavior status(LED_COUNT - 1, 0x00FF00);
+    compositor.setBehavior(LED_LAYER_BASE, &solid);
+    compositor.setBehavior(LED_LAYER_FLASH, &flash);
+    compositor.setBehavior(LED_LAYER_STATUS, &status);
+
+    TEST_ASSERT_TRUE(compositor.render(strip));
+    TEST_ASSERT_EQUAL_HEX32(0x200000, strip.shown[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, strip.shown[LED_COUNT - 1]);
+
+    // Nothing new drawn: no show()
+    unsigned long shows = strip.showCount;
+    for (int i = 0; i < 10; ++i) {
+        fake::advance(21);
+        TEST_ASSERT_FALSE(compositor.render(strip));
+    }
+    TEST_ASSERT_EQUAL(shows, strip.showCount);
+
+    // The flash adds onto the base and goes away again; one show() per frame
+    flash.trigger();
+    TEST_ASSERT_TRUE(compositor.render(strip));
+    TEST_ASSERT_EQUAL_HEX32(0x2000FF, strip.shown[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, strip.shown[LED_COUNT - 1]);
+    int renders = 1;
+    for (int i = 0; i < 10; ++i) {
+        fake::advance(21);
+        if (compositor.render(strip)) renders++;
+    }
+    TEST_ASSERT_EQUAL(shows + renders, strip.showCount);
+    TEST_ASSERT_EQUAL_HEX32(0x200000, strip.shown[0]);
+
+    // An indicator that does not change shows nothing; a new one does
+    status.setStatus(0x00FF00);
+    TEST_ASSERT_FALSE(compositor.render(strip));
+    status.setStatus(0);
+    TEST_ASSERT_TRUE(compositor.render(strip));
+    TEST_ASSERT_EQUAL_HEX32(0x200000, strip.shown[LED_COUNT - 1]);
+}
+
+void test_gamma_tables_match_pow() {
+    const double gammas[3] = {LED_GAMMA_RED, LED_GAMMA_GREEN, LED_GAMMA_BLUE};
+    for (int c = 0; c < 3; ++c) {
+        TEST_ASSERT_EQUAL(0, LED_GAMMA_TABLES[c].values[0]);
+        TEST_ASSERT_EQUAL(255 * 256, LED_GAMMA_TABLES[c].values[255]);
+        for (int i = 0; i < 256; ++i) {
+            double expected = pow(i / 255.0, gammas[c]) * 255 * 256;
+            TEST_ASSERT_INT_WITHIN(1, (int)(expected + 0.5), LED_GAMMA_TABLES[c].values[i]);
+            if (i > 0) TEST_ASSERT_TRUE(LED_GAMMA_TABLES[c].values[i] >= LED_GAMMA_TABLES[c].values[i - 1]);
+        }
+    }
+}
+
+void test_output_dithers_between_steps() {
+    Adafruit_NeoPixel strip(LED_COUNT, 2, NEO_GRB + NEO_KHZ800);
+    LedCompositor compositor;
+    SolidBehavior solid(0xFF4000);
+    compositor.setBehavior(LED_LAYER_BASE, &solid);
+
+    // Full and zero are exact: shown once, not again
+    TEST_ASSERT_TRUE(compositor.render(strip));
+    uint16_t target = LED_GAMMA_TABLES[1].values[0x40];
+    TEST_ASSERT_NOT_EQUAL(0, target & 0xFF);
+
+    // A steady dim green is sent every dither interval, and over 256
+    // frames its levels add up to the gamma-corrected value exactly
+    uint32_t sum = strip.shown[0] >> 8 & 0xFF;
+    for (int frame = 1; frame < 256; ++frame) {
+        TEST_ASSERT_FALSE(compositor.render(strip)); // not due yet
+        fake::advance(LED_DITHER_INTERVAL_MS + 1);
+        TEST_ASSERT_TRUE(compositor.render(strip));
+        TEST_ASSERT_EQUAL_HEX32(0xFF0000, strip.shown[0] & 0xFF00FF);
+        uint8_t level = strip.shown[0] >> 8 & 0xFF;
+        TEST_ASSERT_TRUE(level == target >> 8 || level == (target >> 8) + 1);
+        sum += level;
+    }
+    TEST_ASSERT_EQUAL(target, sum);
+
+    // Levels on a step are left alone
+    solid.setColor(0xFF00FF);
+    compositor.setBehavior(LED_LAYER_BASE, &solid);
+    TEST_ASSERT_TRUE(compositor.render(strip));
+    TEST_ASSERT_EQUAL_HEX32(0xFF00FF, strip.shown[0]);
+    fake::advance(LED_DITHER_INTERVAL_MS + 1);
+    TEST_ASSERT_FALSE(compositor.render(strip));
+}
+
+static uint32_t paletteColor(const LedPalette& palette, uint8_t index) {
+    return LedFrame::Color(palette.rgb[index][0], palette.rgb[index][1], palette.rgb[index][2]);
+}
+
+void test_palettes_fade_between_stops() {
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, paletteColor(LED_PALETTE_RAINBOW, 0));
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, paletteColor(LED_PALETTE_RAINBOW, 85));
+    TEST_ASSERT_EQUAL_HEX32(0x000000, paletteColor(LED_PALETTE_FIRE, 0));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFA0, paletteColor(LED_PALETTE_FIRE, 255));
+    TEST_ASSERT_EQUAL_HEX32(0x500000, paletteColor(LED_PALETTE_FIRE, 40)); // halfway to the first stop
+    for (int i = 1; i < 256; ++i) {
+        TEST_ASSERT_TRUE(LED_PALETTE_FIRE.rgb[i][0] >= LED_PALETTE_FIRE.rgb[i - 1][0]);
+    }
+
+    const LedPalette* palette = nullptr;
+    TEST_ASSERT_TRUE(ledFindPalette("ocean", palette));
+    TEST_ASSERT_EQUAL_PTR(&LED_PALETTE_OCEAN, palette);
+    TEST_ASSERT_TRUE(ledFindPalette("mono", palette));
+    TEST_ASSERT_NULL(palette);
+    TEST_ASSERT_FALSE(ledFindPalette("plaid", palette));
+}
+
+void test_gradient_spreads_the_palette_and_turns() {
+    GradientBehavior gradient(&LED_PALETTE_RAINBOW, 64, 4000);
+    gradient.setup(*frame);
+
+    // A quarter turn in: pixel i shows index 64 + i * 256 / LED_COUNT
+    fake::advance(1000);
+    gradient.update();
+    for (uint16_t i = 0; i < LED_COUNT; ++i) {
+        TEST_ASSERT_EQUAL_HEX32(paletteColor(LED_PALETTE_RAINBOW, (uint8_t)(64 + i * 256 / LED_COUNT)), frame->getPixelColor(i));
+    }
+
+    // Twice the speed: the next quarter in half the time
+    gradient.setSpeed(128);
+    fake::advance(500);
+    gradient.update();
+    TEST_ASSERT_EQUAL_HEX32(0x00FFFF, frame->getPixelColor(0));
+
+    // Without a palette, shades of the color
+    gradient.setPalette(nullptr);
+    gradient.setColor(0x00FF00);
+    fake::advance(21);
+    gradient.update();
+    TEST_ASSERT_EQUAL_HEX32(0x008200, frame->getPixelColor(0)); // index 130, 42 ms on at speed 128
+}
+
+void test_comet_moves_with_a_fading_trail() {
+    CometBehavior comet(&LED_PALETTE_FIRE, 64, 1200, 230);
+    comet.setup(*frame);
+    for (int t = 0; t < 610; t += 10) {
+        fake::advance(10);
+        comet.update();
+    }
+    // 200 ms per pixel: the head is just past pixel 3
+    TEST_ASSERT_GREATER_THAN(comet.getLevel(2), comet.getLevel(3));
+    TEST_ASSERT_GREATER_THAN(comet.getLevel(1), comet.getLevel(2));
+    TEST_ASSERT_GREATER_THAN(0, comet.getLevel(1));
+    TEST_ASSERT_EQUAL(0, comet.getLevel(5));
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(5));
+    uint8_t head = comet.getLevel(3);
+    TEST_ASSERT_EQUAL_HEX32(LedFrame::Color(ledScale8(LED_PALETTE_FIRE.rgb[head][0], head),
+                                            ledScale8(LED_PALETTE_FIRE.rgb[head][1], head),
+                                            ledScale8(LED_PALETTE_FIRE.rgb[head][2], head)),
+                            frame->getPixelColor(3));
+}
+
+void test_twinkle_and_fire_are_random_but_repeatable() {
+    TwinkleBehavior dark(&LED_PALETTE_RAINBOW, 64, 0, 8);
+    dark.setup(*frame);
+    for (int i = 0; i < 50; ++i) {
+        fake::advance(21);
+        dark.update();
+    }
+    for (uint16_t i = 0; i < LED_COUNT; ++i) TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(i));
+
+    // The same seed, the same twinkles
+    LedFrame other;
+    TwinkleBehavior a(&LED_PALETTE_RAINBOW, 64, 40, 8);
+    TwinkleBehavior b(&LED_PALETTE_RAINBOW, 64, 40, 8);
+    a.setup(*frame);
+    b.setup(other);
+    int lit = 0;
+    for (int step = 0; step < 100; ++step) {
+        fake::advance(21);
+        a.update();
+        b.update();
+        TEST_ASSERT_EQUAL_MEMORY(frame->rgb, other.rgb, sizeof(other.rgb));
+        for (uint16_t i = 0; i < LED_COUNT; ++i) lit += frame->getPixelColor(i) != 0;
+    }
+    TEST_ASSERT_GREATER_THAN(100, lit);
+
+    // Fire: hotter near pixel 0, colored straight from the palette
+    FireBehavior fire;
+    fire.setup(*frame);
+    long nearHeat = 0, farHeat = 0;
+    for (int step = 0; step < 500; ++step) {
+        fake::advance(21);
+        fire.update();
+        nearHeat += fire.getHeat(0) + fire.getHeat(1);
+        farHeat += fire.getHeat(LED_COUNT - 2) + fire.getHeat(LED_COUNT - 1);
+        for (uint16_t i = 0; i < LED_COUNT; ++i) {
+            TEST_ASSERT_EQUAL_HEX32(paletteColor(LED_PALETTE_FIRE, fire.getHeat(i)), frame->getPixelColor(i));
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(farHeat, nearHeat);
+    TEST_ASSERT_GREATER_THAN(0, farHeat);
+}
+
+void test_motion_slot_round_trip() {
+    MotionSlot slot;
+    MotionSample sample;
+    TEST_ASSERT_FALSE(slot.read(sample));
+
+    slot.publish(MotionSample{-1234, 567, -16000, 65535, 7, 123456});
+    TEST_ASSERT_TRUE(slot.read(sample));
+    TEST_ASSERT_EQUAL(-1234, sample.x);
+    TEST_ASSERT_EQUAL(567, sample.y);
+    TEST_ASSERT_EQUAL(-16000, sample.z);
+    TEST_ASSERT_EQUAL(65535, sample.motion);
+    TEST_ASSERT_EQUAL(7, sample.taps);
+    TEST_ASSERT_EQUAL(123456, sample.time);
+    TEST_ASSERT_EQUAL(2, slot.getSequence());
+
+    // The IMU hands its readings (cm/s^2) over in mg
+    IMUProcess imu;
+    imu.processReading(-490.3f, 0.0f, 849.3f);
+    TEST_ASSERT_TRUE(motionSlot.read(sample));
+    TEST_ASSERT_INT_WITHIN(1, -500, sample.x);
+    TEST_ASSERT_INT_WITHIN(1, 866, sample.z);
+    TEST_ASSERT_LESS_THAN(5, sample.motion);
+}
+
+void test_atan2_and_hypot_approximations() {
+    for (int y = -2000; y <= 2000; y += 50) {
+        for (int x = -2000; x <= 2000; x += 50) {
+            if (x == 0 && y == 0) continue;
+            float exact = atan2f((float)y, (float)x) * 128.0f / (float)M_PI;
+            float error = fmodf(ledAtan2_8(y, x) - exact + 384.0f, 256.0f) - 128.0f;
+            TEST_ASSERT_FLOAT_WITHIN(2.0f, 0.0f, error);
+            float length = sqrtf((float)(x * x + y * y));
+            TEST_ASSERT_FLOAT_WITHIN(length * 0.07f, length, (float)ledHypot(x, y));
+        }
+    }
+    TEST_ASSERT_EQUAL(64, ledAtan2_8(1000, 0));
+    TEST_ASSERT_EQUAL(128, ledAtan2_8(0, -1000));
+}
+
+void test_shake_brightens_and_releases() {
+    ShakeBehavior shake(0x00FF00, 1000, 16, 12);
+    shake.setup(*frame);
+    TEST_ASSERT_EQUAL(16, greenOf(frame->getPixelColor(0)));
+
+    fake::advance(21);
+    publishMotion(0, 0, 2000, 1000);
+    shake.update();
+    TEST_ASSERT_EQUAL(255, greenOf(frame->getPixelColor(LED_COUNT - 1)));
+
+    fake::advance(21);
+    publishMotion(0, 0, 1000, 0);
+    shake.update();
+    TEST_ASSERT_EQUAL(16 + ledScale8(243, 239), greenOf(frame->getPixelColor(0)));
+
+    // A reading that stops coming counts as rest
+    publishMotion(0, 0, 2000, 1000);
+    fake::advance(LED_MOTION_STALE_MS);
+    uint8_t low, high;
+    run(shake, 1000, 21, low, high);
+    TEST_ASSERT_EQUAL(16, low);
+}
+
+void test_tilt_follows_the_lean() {
+    TiltBehavior tilt;
+    tilt.setup(*frame);
+    fake::advance(21);
+    publishMotion(-1000, 0, 0, 0); // on its side, leaning to -x
+    tilt.update();
+    TEST_ASSERT_EQUAL_HEX32(paletteColor(LED_PALETTE_RAINBOW, 128), frame->getPixelColor(0));
+
+    fake::advance(21);
+    publishMotion(0, 500, 866, 0); // 30 degrees to +y
+    tilt.update();
+    uint8_t level = ledAdd8(24, ledScale8(127, 255 - 24));
+    const uint8_t* rgb = LED_PALETTE_RAINBOW.rgb[64];
+    TEST_ASSERT_EQUAL_HEX32(LedFrame::Color(ledScale8(rgb[0], level), ledScale8(rgb[1], level), ledScale8(rgb[2], level)),
+                            frame->getPixelColor(0));
+}
+
+void test_motion_spring_kicks_on_tap() {
+    MotionSpringBehavior spring(0x00FF00);
+    spring.setup(*frame);
+    uint8_t low, high;
+    for (int step = 0; step < 100; ++step) {
+        fake::advance(17);
+        publishMotion(0, 0, 1000, 0);
+        spring.update();
+    }
+    TEST_ASSERT_LESS_THAN(10, greenOf(frame->getPixelColor(0)));
+
+    // A tap yanks it up and it springs back
+    high = 0;
+    for (int step = 0; step < 6; ++step) {
+        fake::advance(17);
+        publishMotion(0, 0, 1000, 0, 1);
+        spring.update();
+        if (greenOf(frame->getPixelColor(0)) > high) high = greenOf(frame->getPixelColor(0));
+    }
+    TEST_ASSERT_GREATER_THAN(200, high);
+
+    // Steady motion holds it part way
+    for (int step = 0; step < 150; ++step) {
+        fake::advance(17);
+        publishMotion(0, 0, 1500, 500, 1);
+        spring.update();
+    }
+    low = greenOf(frame->getPixelColor(0));
+    TEST_ASSERT_INT_WITHIN(10, 120, low);
+}
+
+void test_led_process_flashes_on_tap() {
+    ProcessManager manager;
+    IMUProcess* imu = new IMUProcess();
+    LedProcess* led = new LedProcess();
+    manager.addProcess("imu", imu);
+    manager.addProcess("led", led);
+    manager.setupProcesses();
+    led->setPattern(ledDefaultSpec(LED_BEHAVIOR_OFF, 0));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(0, led->pixels.shown[0]);
+
+    imu->processReading(0, 0, 4000.0f); // about 4g
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(LED_FLASH_COLOR, led->pixels.shown[0]);
+
+    fake::advance(LED_FLASH_MS + 25);
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(0, led->pixels.shown[0]);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("flash", "ff0000"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, led->pixels.shown[0]);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("layer", "flash:alpha:0"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(0, led->pixels.shown[0]);
+    TEST_ASSERT_EQUAL(LED_BLEND_ALPHA, led->compositor.getLayer(LED_LAYER_FLASH).mode);
+
+    commandRegistry.executeCommand("layer", "flash:overlay");
+    TEST_ASSERT_TRUE(Serial.output.find("layer requires") != std::string::npos);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("gamma", "off"));
+    TEST_ASSERT_TRUE(led->compositor.isCorrecting());   // until the next frame
+    fake::fireTickers();
+    TEST_ASSERT_FALSE(led->compositor.isCorrecting());
+}
+
+void test_specs_parse_and_format() {
+    LedBehaviorSpec spec;
+    TEST_ASSERT_TRUE(ledParseSpec("breathing:3000", 0x00FF00, spec));
+    TEST_ASSERT_EQUAL(LED_BEHAVIOR_BREATHING, spec.type);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, spec.color);
+    TEST_ASSERT_EQUAL(3000, spec.params[0]);
+
+    // Parameters left out keep their defaults; a palette goes by name
+    TEST_ASSERT_TRUE(ledParseSpec("comet:ocean:96", 0, spec));
+    TEST_ASSERT_EQUAL(2, spec.params[0]);
+    TEST_ASSERT_EQUAL(96, spec.params[1]);
+    TEST_ASSERT_EQUAL(1200, spec.params[2]);
+    char text[64];
+    ledFormatSpec(spec, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("comet:ocean:96:1200:230", text);
+    TEST_ASSERT_TRUE(ledParseSpec("solid", 0, spec));
+    ledFormatSpec(spec, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("solid", text);
+
+    const char* invalid[] = {"sparkle", "breathing:50", "breathing:2x", "breathing:", "heartbeat:500:1000:7",
+                             "fire:plaid", "solid:1", "breathingg"};
+    for (const char* bad : invalid) {
+        TEST_ASSERT_FALSE(ledParseSpec(bad, 0, spec));
+    }
+    spec = ledDefaultSpec(LED_BEHAVIOR_GRADIENT, 0);
+    TEST_ASSERT_TRUE(ledSpecValid(spec));
+    spec.params[0] = 5; // past the last palette
+    TEST_ASSERT_FALSE(ledSpecValid(spec));
+}
+
+void test_pool_makes_behaviors_from_specs() {
+    LedBehaviorPool pool;
+    LedBehaviorSpec spec = ledDefaultSpec(LED_BEHAVIOR_HEARTBEAT, 0x0000FF);
+    spec.params[0] = 500;
+    spec.params[1] = 1000;
+    HeartBeatBehavior* beat = static_cast<HeartBeatBehavior*>(pool.create(spec));
+    TEST_ASSERT_NOT_NULL(beat);
+    TEST_ASSERT_EQUAL_STRING("HeartBeat", beat->type);
+    TEST_ASSERT_EQUAL(500, beat->pulse_duration);
+    TEST_ASSERT_EQUAL(1000, beat->pulse_interval);
+    TEST_ASSERT_TRUE(pool.owns(beat));
+
+    // Another of the same type starts from its own spec, not from the last
+    HeartBeatBehavior* other = static_cast<HeartBeatBehavior*>(pool.create(ledDefaultSpec(LED_BEHAVIOR_HEARTBEAT, 0)));
+    TEST_ASSERT_EQUAL(770, other->pulse_duration);
+
+    TEST_ASSERT_NOT_NULL(pool.create(ledDefaultSpec(LED_BEHAVIOR_TWINKLE, 0)));
+    TEST_ASSERT_EQUAL(LED_BEHAVIOR_SLOTS, pool.inUse());
+    TEST_ASSERT_NULL(pool.create(ledDefaultSpec(LED_BEHAVIOR_SOLID, 0)));
+    pool.release(beat);
+    TEST_ASSERT_EQUAL(LED_BEHAVIOR_SLOTS - 1, pool.inUse());
+
+    SolidBehavior outside;
+    pool.release(&outside); // not the pool's: left alone
+    TEST_ASSERT_FALSE(pool.owns(&outside));
+    TEST_ASSERT_EQUAL(LED_BEHAVIOR_SLOTS - 1, pool.inUse());
+
+    spec.type = LED_BEHAVIOR_TYPE_COUNT;
+    TEST_ASSERT_NULL(pool.create(spec));
+    TEST_ASSERT_EQUAL(LED_BEHAVIOR_SLOTS - 1, pool.inUse());
+    for (int type = 0; type < LED_BEHAVIOR_TYPE_COUNT; ++type) {
+        LedBehavior* behavior = pool.create(ledDefaultSpec((LedBehaviorType)type, 0));
+        TEST_ASSERT_NOT_NULL(behavior);
+        behavior->setup(*frame);
+        behavior->update();
+        pool.release(behavior);
+    }
+}
+
+void test_led_process_swaps_between_frames() {
+    LedProcess led;
+    led.setup();
+    TEST_ASSERT_TRUE(led.setPattern(ledDefaultSpec(LED_BEHAVIOR_SOLID, 0x00FF00)));
+    TEST_ASSERT_NULL(led.currentBehavior);
+    led.update(); // from the main loop: only the ticker draws
+    TEST_ASSERT_NULL(led.currentBehavior);
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Solid", led.currentBehavior->type);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, led.pixels.shown[0]);
+
+    // Patterns set faster than frames: only the last is shown, and the
+    // ones skipped give their slots back
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_TRUE(led.setPattern(ledDefaultSpec(i % 2 ? LED_BEHAVIOR_OFF : LED_BEHAVIOR_CYCLE, 0xFF0000)));
+    }
+    TEST_ASSERT_EQUAL_STRING("Solid", led.currentBehavior->type);
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Off", led.currentBehavior->type);
+    TEST_ASSERT_TRUE(led.isShowingPattern());
+
+    SolidBehavior outside(0x0000FF);
+    led.setBehavior(&outside);
+    TEST_ASSERT_TRUE(led.isShowing(&outside));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_PTR(&outside, led.currentBehavior);
+    TEST_ASSERT_TRUE(led.restorePattern());
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Off", led.currentBehavior->type);
+}
+
+void test_led_process_commands() {
+    LedProcess led;
+    led.setup();
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", "solid"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Solid", led.currentBehavior->type);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("led", "00ff00"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, led.pixels.shown[0]);
+
+    commandRegistry.executeCommand("pattern", "sparkle");
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Solid", led.currentBehavior->type);
+    TEST_ASSERT_TRUE(Serial.output.find("Unknown pattern: sparkle") != std::string::npos);
+    commandRegistry.executeCommand("pattern", "breathing:5");
+    TEST_ASSERT_TRUE(Serial.output.find("pattern:breathing[:<duration 100-60000>]") != std::string::npos);
+
+    // Parameters set remotely, and the color kept across patterns
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", "breathing:3000"));
+    fake::fireTickers();
+    BreathingBehavior* breathing = static_cast<BreathingBehavior*>(led.currentBehavior);
+    TEST_ASSERT_EQUAL(3000, breathing->duration);
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", "heartbeat:500:1000"));
+    fake::fireTickers();
+    HeartBeatBehavior* beat = static_cast<HeartBeatBehavior*>(led.currentBehavior);
+    TEST_ASSERT_EQUAL(500, beat->pulse_duration);
+    TEST_ASSERT_EQUAL(1000, beat->pulse_interval);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, led.getPattern().color);
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", "breathing"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL(2000, static_cast<BreathingBehavior*>(led.currentBehavior)->duration);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", "fire"));
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("palette", "ocean:128"));
+    fake::fireTickers();
+    FireBehavior* fire = static_cast<FireBehavior*>(led.currentBehavior);
+    TEST_ASSERT_EQUAL_STRING("Fire", fire->type);
+    TEST_ASSERT_EQUAL_PTR(&LED_PALETTE_OCEAN, fire->palette);
+    TEST_ASSERT_EQUAL(128, fire->speed);
+    commandRegistry.executeCommand("palette", "plaid");
+    TEST_ASSERT_TRUE(Serial.output.find("palette requires") != std::string::npos);
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("pattern", ""));
+    TEST_ASSERT_TRUE(Serial.output.find("LED pattern: fire:ocean:128:40:120, color 00ff00") != std::string::npos);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("spring_param", "C8280A"));
+    fake::fireTickers();
+    SpringBehavior* spring = static_cast<SpringBehavior*>(led.currentBehavior);
+    TEST_ASSERT_EQUAL_STRING("Spring", spring->type);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, spring->springConstant);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, spring->damping);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.1f, spring->mass);
+
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("react", "tilt:500"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Tilt", led.currentBehavior->type);
+    TEST_ASSERT_EQUAL(500, static_cast<TiltBehavior*>(led.currentBehavior)->fullScale);
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("react", "shake"));
+    commandRegistry.executeCommand("react", "spring:5");
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Shake", led.currentBehavior->type);
+    TEST_ASSERT_TRUE(Serial.output.find("react requires") != std::string::npos);
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("react", ""));
+    TEST_ASSERT_TRUE(Serial.output.find("IMU x 0 y 0 z 1000 mg") != std::string::npos);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_solid_fills_all_pixels);
+    RUN_TEST(test_off_clears_frame);
+    RUN_TEST(test_breathing_sweeps_full_range);
+    RUN_TEST(test_breathing_updates_at_50hz);
+    RUN_TEST(test_heartbeat_waits_then_beats_twice);
+    RUN_TEST(test_cycle_walks_one_pixel);
+    RUN_TEST(test_spring_settles_on_target);
+    RUN_TEST(test_scale_matches_division);
+    RUN_TEST(test_sine_table_matches_sin);
+    RUN_TEST(test_spring_fixed_point_tracks_float);
+    RUN_TEST(test_flash_fades_out);
+    RUN_TEST(test_blend_modes);
+    RUN_TEST(test_compositor_layers_and_shows);
+    RUN_TEST(test_gamma_tables_match_pow);
+    RUN_TEST(test_output_dithers_between_steps);
+    RUN_TEST(test_palettes_fade_between_stops);
+    RUN_TEST(test_gradient_spreads_the_palette_and_turns);
+    RUN_TEST(test_comet_moves_with_a_fading_trail);
+    RUN_TEST(test_twinkle_and_fire_are_random_but_repeatable);
+    RUN_TEST(test_motion_slot_round_trip);
+    RUN_TEST(test_atan2_and_hypot_approximations);
+    RUN_TEST(test_shake_brightens_and_releases);
+    RUN_TEST(test_tilt_follows_the_lean);
+    RUN_TEST(test_motion_spring_kicks_on_tap);
+    RUN_TEST(test_led_process_flashes_on_tap);
+    RUN_TEST(test_specs_parse_and_format);
+    RUN_TEST(test_pool_makes_behaviors_from_specs);
+    RUN_TEST(test_led_process_swaps_between_frames);
+    RUN_TEST(test_led_process_commands);
+    return UNITY_END();
+}
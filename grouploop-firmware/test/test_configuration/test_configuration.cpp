@@ -0,0 +1,137 @@
+// Configuration: defaults, JSON round trip and NVS persistence
+#include <Arduino.h>
+#include <unity.h>
+#include "Configuration.h"
+
+// Configuration.h defines its static members, so it is included by one
+// translation unit only; on the device that is main.cpp
+Configuration configuration;
+
+void setUp() {
+    fake::clearPreferences();
+    Serial.reset();
+}
+
+void tearDown() {}
+
+void test_initialize_without_stored_values_uses_defaults() {
+    Configuration config;
+    config.initialize();
+    Configuration defaults;
+    defaults.loadDefaults();
+
+    TEST_ASSERT_EQUAL_STRING(defaults.getWifiSSID().c_str(), config.getWifiSSID().c_str());
+    TEST_ASSERT_EQUAL_STRING(defaults.getSocketServerURL().c_str(), config.getSocketServerURL().c_str());
+    TEST_ASSERT_EQUAL(defaults.getLEDPin(), config.getLEDPin());
+    TEST_ASSERT_EQUAL(defaults.getMotorPin(), config.getMotorPin());
+    TEST_ASSERT_EQUAL(1, config.getNetworkCount());
+    TEST_ASSERT_EQUAL_STRING("", config.getStaticIP().c_str());
+}
+
+void test_parse_full_json() {
+    Configuration config;
+    config.initialize();
+    TEST_ASSERT_TRUE(config.parseFromJSON(R"({
+        "wifiSSID": "MyCustomWiFi",
+        "wifiPassword": "MySecurePassword123",
+        "socketServerURL": "ws://192.168.1.100:8080",
+        "LEDPin": 12,
+        "motorPin": 8,
+        "deviceNamePrefix": "CustomDevice"
+    })"));
+
+    TEST_ASSERT_EQUAL_STRING("MyCustomWiFi", config.getWifiSSID().c_str());
+    TEST_ASSERT_EQUAL_STRING("MySecurePassword123", config.getWifiPassword().c_str());
+    TEST_ASSERT_EQUAL_STRING("ws://192.168.1.100:8080", config.getSocketServerURL().c_str());
+    TEST_ASSERT_EQUAL(12, config.getLEDPin());
+    TEST_ASSERT_EQUAL(8, config.getMotorPin());
+    TEST_ASSERT_EQUAL_STRING("CustomDevice", config.getDeviceNamePrefix().c_str());
+}
+
+void test_partial_json_keeps_other_fields() {
+    Configuration config;
+    config.initialize();
+    config.parseFromJSON(R"({"wifiSSID": "First", "motorPin": 3})");
+    TEST_ASSERT_TRUE(config.parseFromJSON(R"({"wifiSSID": "PartialWiFi", "LEDPin": 15})"));
+
+    TEST_ASSERT_EQUAL_STRING("PartialWiFi", config.getWifiSSID().c_str());
+    TEST_ASSERT_EQUAL(15, config.getLEDPin());
+    TEST_ASSERT_EQUAL(3, config.getMotorPin());
+}
+
+void test_invalid_json_is_rejected() {
+    Configuration config;
+    config.initialize();
+    String before = config.getWifiSSID();
+    TEST_ASSERT_FALSE(config.parseFromJSON(R"({"wifiSSID": "Broken")"));
+    TEST_ASSERT_EQUAL_STRING(before.c_str(), config.getWifiSSID().c_str());
+}
+
+void test_to_json_round_trips() {
+    Configuration config;
+    config.initialize();
+    config.parseFromJSON(R"({"wifiSSID": "Hall", "LEDPin": 5, "roomWidth": 12.5, "roomHeight": 8})");
+    config.addNetwork("Backstage", "secret", 2);
+
+    Configuration copy;
+    copy.loadDefaults();
+    TEST_ASSERT_TRUE(copy.parseFromJSON(config.toJSON()));
+    TEST_ASSERT_EQUAL_STRING("Hall", copy.getWifiSSID().c_str());
+    TEST_ASSERT_EQUAL(5, copy.getLEDPin());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.5f, copy.getRoomWidth());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 8.0f, copy.getRoomHeight());
+    TEST_ASSERT_EQUAL(2, copy.getNetworkCount());
+    TEST_ASSERT_EQUAL_STRING("Backstage", copy.getNetwork(1).ssid.c_str());
+    TEST_ASSERT_EQUAL(2, copy.getNetwork(1).priority);
+}
+
+void test_values_persist_across_instances() {
+    {
+        Configuration config;
+        config.initialize();
+        config.setSocketServerURL("ws://10.0.0.2:5003/");
+        config.setLEDPin(4);
+        config.setRoomSize(6.0f, 4.0f);
+        config.addNetwork("Foyer", "pw", 1);
+    }
+    Configuration reloaded;
+    reloaded.initialize();
+    TEST_ASSERT_EQUAL_STRING("ws://10.0.0.2:5003/", reloaded.getSocketServerURL().c_str());
+    TEST_ASSERT_EQUAL(4, reloaded.getLEDPin());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 6.0f, reloaded.getRoomWidth());
+    TEST_ASSERT_EQUAL(2, reloaded.getNetworkCount());
+    TEST_ASSERT_EQUAL_STRING("Foyer", reloaded.getNetwork(1).ssid.c_str());
+}
+
+void test_network_list_limits_and_removal() {
+    Configuration config;
+    config.initialize();
+    for (int i = 0; i < MAX_WIFI_NETWORKS - 1; ++i) {
+        TEST_ASSERT_TRUE(config.addNetwork(String("net") + String(i), "pw", i));
+    }
+    TEST_ASSERT_FALSE(config.addNetwork("one-too-many", "pw", 0));
+    TEST_ASSERT_EQUAL(MAX_WIFI_NETWORKS, config.getNetworkCount());
+
+    // Updating a known network does not take a slot
+    TEST_ASSERT_TRUE(config.addNetwork("net1", "new", 9));
+    TEST_ASSERT_EQUAL(MAX_WIFI_NETWORKS, config.getNetworkCount());
+
+    TEST_ASSERT_TRUE(config.removeNetwork("net0"));
+    TEST_ASSERT_FALSE(config.removeNetwork("net0"));
+    TEST_ASSERT_FALSE(config.removeNetwork(config.getWifiSSID()));
+    TEST_ASSERT_EQUAL(MAX_WIFI_NETWORKS - 1, config.getNetworkCount());
+    TEST_ASSERT_EQUAL_STRING("net1", config.getNetwork(1).ssid.c_str());
+    TEST_ASSERT_EQUAL(9, config.getNetwork(1).priority);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_initialize_without_stored_values_uses_defaults);
+    RUN_TEST(test_parse_full_json);
+    RUN_TEST(test_partial_json_keeps_other_fields);
+    RUN_TEST(test_invalid_json_is_rejected);
+    RUN_TEST(test_to_json_round_trips);
+    RUN_TEST(test_values_persist_across_instances);
+    RUN_TEST(test_network_list_limits_and_removal);
+    return UNITY_END();
+}
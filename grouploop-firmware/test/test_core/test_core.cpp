@@ -0,0 +1,215 @@
+// Timer, ProcessManager, CommandRegistry and the helpers in Utils.h
+#include <Arduino.h>
+#include <unity.h>
+#include "Timer.h"
+#include "Process.h"
+#include "ProcessManager.h"
+#include "CommandRegistry.h"
+#include "RadioArbiter.h"
+#include "Utils.h"
+
+// Records update() calls into a shared trace
+class TraceProcess : public Process {
+public:
+    TraceProcess(const char* name, String& trace) : name(name), trace(trace) {}
+    void setup() override { setupCalls++; }
+    void update() override { trace += name; }
+    const char* getState() override { return "tracing"; }
+
+    const char* name;
+    String& trace;
+    int setupCalls = 0;
+};
+
+void setUp() {
+    fake::setMillis(1000);
+    Serial.reset();
+}
+
+void tearDown() {}
+
+// --- Timer ---
+
+void test_timer_elapses_after_interval() {
+    Timer timer(50);
+    timer.reset();
+    fake::advance(50);
+    TEST_ASSERT_FALSE(timer.checkAndReset()); // strictly longer than the interval
+    fake::advance(1);
+    TEST_ASSERT_TRUE(timer.checkAndReset());
+    TEST_ASSERT_FALSE(timer.checkAndReset());
+}
+
+void test_timer_zero_interval_never_fires() {
+    Timer timer;
+    fake::advance(100000);
+    TEST_ASSERT_FALSE(timer.checkAndReset());
+}
+
+void test_timer_elapsed_since_start() {
+    Timer timer(10);
+    fake::advance(250);
+    TEST_ASSERT_EQUAL_UINT32(250, timer.elapsed());
+    timer.resetMillis();
+    fake::advance(5);
+    TEST_ASSERT_EQUAL_UINT32(5, timer.elapsed());
+}
+
+void test_timer_survives_millis_wraparound() {
+    fake::setMillis(0xFFFFFFF0UL);
+    Timer timer(20);
+    timer.reset();
+    fake::advance(30); // millis() wraps past zero
+    TEST_ASSERT_TRUE(timer.checkAndReset());
+}
+
+// --- ProcessManager ---
+
+void test_process_manager_updates_running_processes_by_name() {
+    String trace;
+    ProcessManager manager;
+    manager.addProcess("b", new TraceProcess("b", trace));
+    manager.addProcess("a", new TraceProcess("a", trace));
+    manager.addProcess("c", new TraceProcess("c", trace));
+
+    manager.updateProcesses();
+    TEST_ASSERT_EQUAL_STRING("abc", trace.c_str());
+
+    manager.haltProcess("b");
+    manager.updateProcesses();
+    TEST_ASSERT_EQUAL_STRING("abcac", trace.c_str());
+
+    manager.startProcess("b");
+    manager.haltAllProcessesExcept("c");
+    manager.updateProcesses();
+    TEST_ASSERT_EQUAL_STRING("abcacc", trace.c_str());
+}
+
+void test_process_manager_setup_and_lookup() {
+    String trace;
+    ProcessManager manager;
+    TraceProcess* process = new TraceProcess("x", trace);
+    manager.addProcess("x", process);
+    manager.addProcess("null", nullptr);
+
+    manager.setupProcesses();
+    TEST_ASSERT_EQUAL(1, process->setupCalls);
+    TEST_ASSERT_EQUAL_PTR(process, manager.getProcess("x"));
+    TEST_ASSERT_EQUAL_PTR(&manager, process->getProcessManager());
+    TEST_ASSERT_NULL(manager.getProcess("missing"));
+    TEST_ASSERT_FALSE(manager.hasProcess("null"));
+    TEST_ASSERT_EQUAL_STRING("tracing", manager.getProcess("x")->getState());
+
+    // Halting an unknown process is ignored
+    manager.haltProcess("missing");
+    manager.haltAllProcesses();
+    TEST_ASSERT_FALSE(process->isProcessRunning());
+}
+
+// --- CommandRegistry ---
+
+void test_command_registry_dispatches_with_parameters() {
+    CommandRegistry registry;
+    String received;
+    registry.registerCommand("led", [&received](const String& params) { received = params; });
+
+    TEST_ASSERT_TRUE(registry.hasCommand("led"));
+    TEST_ASSERT_TRUE(registry.executeCommand("led", "ff0000"));
+    TEST_ASSERT_EQUAL_STRING("ff0000", received.c_str());
+
+    // The const char* overload, as used by ReceiveProcess
+    const char* name = "led";
+    TEST_ASSERT_TRUE(registry.executeCommand(name, String("00ff00")));
+    TEST_ASSERT_EQUAL_STRING("00ff00", received.c_str());
+}
+
+void test_command_registry_unknown_command() {
+    CommandRegistry registry;
+    TEST_ASSERT_FALSE(registry.hasCommand("nope"));
+    TEST_ASSERT_FALSE(registry.executeCommand("nope", ""));
+    TEST_ASSERT_EQUAL(0, registry.getCommandCount());
+}
+
+void test_command_registry_reregistering_replaces_handler() {
+    CommandRegistry registry;
+    int which = 0;
+    registry.registerCommand("mode", [&which](const String&) { which = 1; });
+    registry.registerCommand("mode", [&which](const String&) { which = 2; });
+    TEST_ASSERT_EQUAL(1, registry.getCommandCount());
+    registry.executeCommand("mode", "");
+    TEST_ASSERT_EQUAL(2, which);
+}
+
+void test_command_registry_contains_handler_exceptions() {
+    CommandRegistry registry;
+    registry.registerCommand("boom", [](const String&) { throw 1; });
+    TEST_ASSERT_FALSE(registry.executeCommand("boom", ""));
+}
+
+void test_command_registry_executes_messages_in_place() {
+    CommandRegistry registry;
+    String received = "unset";
+    registry.registerCommand("led", [&received](const String& params) { received = params; });
+
+    char message[] = "led:ff0000:extra";
+    TEST_ASSERT_TRUE(registry.executeMessage(message));
+    TEST_ASSERT_EQUAL_STRING("ff0000:extra", received.c_str()); // split at the first colon only
+
+    char bare[] = "led";
+    TEST_ASSERT_TRUE(registry.executeMessage(bare));
+    TEST_ASSERT_EQUAL_STRING("", received.c_str());
+
+    char leadingColon[] = ":led";
+    TEST_ASSERT_FALSE(registry.executeMessage(leadingColon));
+}
+
+// --- Utils / RadioArbiter ---
+
+void test_hex_to_color() {
+    TEST_ASSERT_EQUAL_HEX32(0xFF8000, hexToColor("#ff8000"));
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, hexToColor("00FF00"));
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, hexToColor("ff"));
+}
+
+void test_mac_address_round_trip() {
+    uint8_t mac[6];
+    TEST_ASSERT_TRUE(parseMacAddress("64:e8:33:84:43:9A", mac));
+    TEST_ASSERT_EQUAL_HEX8(0x64, mac[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x9A, mac[5]);
+    char text[18];
+    formatMacAddress(mac, text);
+    TEST_ASSERT_EQUAL_STRING("64:e8:33:84:43:9a", text);
+
+    TEST_ASSERT_TRUE(parseMacAddress("64-e8-33-84-43-9a", mac));
+    TEST_ASSERT_FALSE(parseMacAddress("64:e8:33:84:43", mac));
+    TEST_ASSERT_FALSE(parseMacAddress("64:e8:33:84:43:9a:00", mac));
+    TEST_ASSERT_FALSE(parseMacAddress("zz:e8:33:84:43:9a", mac));
+    TEST_ASSERT_FALSE(parseMacAddress(nullptr, mac));
+}
+
+void test_coex_names() {
+    CoexPreference preference;
+    TEST_ASSERT_TRUE(RadioArbiter::parseCoexName("ble", preference));
+    TEST_ASSERT_EQUAL(CoexPreference::BLE, preference);
+    TEST_ASSERT_EQUAL_STRING("ble", RadioArbiter::coexName(preference));
+    TEST_ASSERT_FALSE(RadioArbiter::parseCoexName("both", preference));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_elapses_after_interval);
+    RUN_TEST(test_timer_zero_interval_never_fires);
+    RUN_TEST(test_timer_elapsed_since_start);
+    RUN_TEST(test_timer_survives_millis_wraparound);
+    RUN_TEST(test_process_manager_updates_running_processes_by_name);
+    RUN_TEST(test_process_manager_setup_and_lookup);
+    RUN_TEST(test_command_registry_dispatches_with_parameters);
+    RUN_TEST(test_command_registry_unknown_command);
+    RUN_TEST(test_command_registry_reregistering_replaces_handler);
+    RUN_TEST(test_command_registry_contains_handler_exceptions);
+    RUN_TEST(test_command_registry_executes_messages_in_place);
+    RUN_TEST(test_hex_to_color);
+    RUN_TEST(test_mac_address_round_trip);
+    RUN_TEST(test_coex_names);
+    return UNITY_END();
+}
@@ -0,0 +1,396 @@
+// Uploaded LED sequences: the format, the player, the upload protocol and
+// starting on the server's clock
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "Configuration.h"
+#include "ClockSync.h"
+#include "SequenceFormat.h"
+#include "ProcessManager.h"
+#include "processes/LedProcess.h"
+#include "processes/SequenceBehavior.h"
+#include "processes/SequenceProcess.h"
+
+Configuration configuration;
+
+static LedFrame* frame;
+
+struct Key {
+    uint32_t time;
+    uint8_t pixel;
+    uint8_t mode;
+    uint32_t color;
+};
+
+static void putLE(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static std::vector<uint8_t> makeSequence(uint32_t duration, uint32_t loopStart, uint32_t loopEnd,
+                                         std::initializer_list<Key> keys) {
+    std::vector<uint8_t> data;
+    data.push_back(SEQUENCE_FORMAT_VERSION);
+    data.push_back(0);
+    putLE(data, (uint32_t)keys.size(), 2);
+    putLE(data, duration, 4);
+    putLE(data, loopStart, 4);
+    putLE(data, loopEnd, 4);
+    for (const Key& key : keys) {
+        putLE(data, key.time, 4);
+        data.push_back(key.pixel);
+        data.push_back(key.mode);
+        data.push_back((uint8_t)(key.color >> 16));
+        data.push_back((uint8_t)(key.color >> 8));
+        data.push_back((uint8_t)key.color);
+    }
+    return data;
+}
+
+static std::string hex(const uint8_t* data, size_t length) {
+    std::string text;
+    char digits[3];
+    for (size_t i = 0; i < length; ++i) {
+        snprintf(digits, sizeof(digits), "%02x", data[i]);
+        text += digits;
+    }
+    return text;
+}
+
+static bool seq(const std::string& params) {
+    return commandRegistry.executeCommand("seq", String(params.c_str()));
+}
+
+// Events the device sent that start with 'prefix'
+static std::vector<std::string> sentWith(const char* prefix) {
+    std::vector<std::string> found;
+    for (const std::string& message : WebSocketsClient::latest->sent) {
+        if (message.compare(0, strlen(prefix), prefix) == 0) found.push_back(message);
+    }
+    return found;
+}
+
+static void connect() {
+    if (!webSocketManager.isConnected()) {
+        webSocketManager.initialize("ws://10.0.0.1:5003/");
+        webSocketManager.setLinkUp(true);
+        WebSocketsClient::latest->injectConnected();
+        webSocketManager.service();
+        webSocketManager.dispatch();
+    }
+    WebSocketsClient::latest->sent.clear();
+}
+
+void setUp() {
+    fake::setMillis(10000);
+    Serial.reset();
+    frame = new LedFrame();
+}
+
+void tearDown() {
+    delete frame;
+}
+
+// --- Format ---
+
+void test_parse_checks_the_sequence() {
+    SequenceView view;
+    std::vector<uint8_t> good = makeSequence(1000, 200, 800, {
+        {0, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x000000},
+        {500, 1, SEQUENCE_LINEAR, 0xFF0000},
+    });
+    TEST_ASSERT_TRUE(sequenceParse(good.data(), good.size(), view));
+    TEST_ASSERT_EQUAL(2, view.keyframeCount);
+    TEST_ASSERT_EQUAL(1000, view.duration);
+    TEST_ASSERT_EQUAL(500, sequenceKeyframe(view, 1).time);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, sequenceKeyframe(view, 1).color);
+
+    std::vector<uint8_t> bad = good;
+    bad[0] = 2;
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // version
+    TEST_ASSERT_FALSE(sequenceParse(good.data(), good.size() - 1, view)); // length
+
+    bad = makeSequence(1000, 0, 0, {{500, 0, SEQUENCE_STEP, 1}, {400, 0, SEQUENCE_STEP, 2}});
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // order
+    bad = makeSequence(1000, 0, 0, {{1200, 0, SEQUENCE_STEP, 1}});
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // past the end
+    bad = makeSequence(1000, 0, 0, {{0, 0, 7, 1}});
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // mode
+    bad = makeSequence(1000, 800, 1200, {});
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // loop past the end
+    bad = makeSequence(1000, 800, 800, {});
+    TEST_ASSERT_FALSE(sequenceParse(bad.data(), bad.size(), view));     // empty loop
+}
+
+void test_crc32_matches_zlib() {
+    const char* text = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, sequenceCrc32((const uint8_t*)text, 9));
+    TEST_ASSERT_EQUAL_HEX32(0, sequenceCrc32(nullptr, 0));
+}
+
+// --- Player ---
+
+void test_step_linear_and_ease() {
+    std::vector<uint8_t> data = makeSequence(3000, 0, 0, {
+        {1000, 0, SEQUENCE_LINEAR, 0x00FF00},
+        {1000, 1, SEQUENCE_STEP, 0x0000FF},
+        {1000, 2, SEQUENCE_EASE, 0xFF0000},
+        {2000, 0, SEQUENCE_LINEAR, 0x000000},
+    });
+    SequenceBehavior player;
+    player.setup(*frame);
+    TEST_ASSERT_TRUE(player.load(data.data(), data.size()));
+
+    player.renderAt(500);
+    TEST_ASSERT_EQUAL_HEX32(0x007F00, frame->getPixelColor(0)); // halfway from black
+    TEST_ASSERT_EQUAL_HEX32(0x000000, frame->getPixelColor(1)); // not yet
+    TEST_ASSERT_EQUAL_HEX32(0x7F0000, frame->getPixelColor(2)); // smoothstep(0.5) = 0.5
+
+    player.renderAt(250);
+    TEST_ASSERT_EQUAL_HEX32(0x003F00, frame->getPixelColor(0));
+    TEST_ASSERT_EQUAL_HEX32(0x270000, frame->getPixelColor(2)); // smoothstep(0.25) = 0.156
+
+    player.renderAt(1000);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, frame->getPixelColor(0));
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, frame->getPixelColor(1));
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, frame->getPixelColor(2));
+
+    player.renderAt(1500);
+    TEST_ASSERT_EQUAL_HEX32(0x007F00, frame->getPixelColor(0)); // fading back out
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, frame->getPixelColor(2)); // holds after its last keyframe
+    player.renderAt(2500);
+    TEST_ASSERT_EQUAL_HEX32(0x000000, frame->getPixelColor(0));
+}
+
+void test_all_pixel_keyframes_and_overrides() {
+    std::vector<uint8_t> data = makeSequence(2000, 0, 0, {
+        {0, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x101010},
+        {1000, 3, SEQUENCE_STEP, 0x00FFFF},
+        {1500, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x202020},
+    });
+    SequenceBehavior player;
+    player.setup(*frame);
+    TEST_ASSERT_TRUE(player.load(data.data(), data.size()));
+
+    player.renderAt(0);
+    for (uint16_t p = 0; p < LED_COUNT; ++p) TEST_ASSERT_EQUAL_HEX32(0x101010, frame->getPixelColor(p));
+    player.renderAt(1200);
+    TEST_ASSERT_EQUAL_HEX32(0x00FFFF, frame->getPixelColor(3));
+    TEST_ASSERT_EQUAL_HEX32(0x101010, frame->getPixelColor(2));
+    player.renderAt(1600);
+    for (uint16_t p = 0; p < LED_COUNT; ++p) TEST_ASSERT_EQUAL_HEX32(0x202020, frame->getPixelColor(p));
+}
+
+void test_loop_wraps_and_end_holds() {
+    std::vector<uint8_t> looped = makeSequence(1000, 200, 600, {});
+    std::vector<uint8_t> once = makeSequence(1000, 0, 0, {});
+    SequenceBehavior player;
+    player.setup(*frame);
+
+    TEST_ASSERT_TRUE(player.load(looped.data(), looped.size()));
+    TEST_ASSERT_EQUAL(300, player.positionAt(300));
+    TEST_ASSERT_EQUAL(200, player.positionAt(600));
+    TEST_ASSERT_EQUAL(350, player.positionAt(750));
+    TEST_ASSERT_EQUAL(599, player.positionAt(200 + 400 * 1000 - 1));
+
+    TEST_ASSERT_TRUE(player.load(once.data(), once.size()));
+    TEST_ASSERT_EQUAL(1000, player.positionAt(5000));
+}
+
+void test_playback_follows_the_clock() {
+    std::vector<uint8_t> data = makeSequence(1000, 0, 1000, {
+        {0, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x0000FF},
+        {500, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0xFF0000},
+    });
+    SequenceBehavior player;
+    player.setup(*frame);
+    TEST_ASSERT_TRUE(player.load(data.data(), data.size()));
+    player.play(millis() + 100);
+
+    player.update();
+    TEST_ASSERT_EQUAL_HEX32(0, frame->getPixelColor(0)); // waiting for the start
+
+    fake::advance(120);
+    player.update();
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, frame->getPixelColor(0));
+
+    // A late update draws where the sequence is now, not where it was
+    fake::advance(1400); // 1420 ms in: 420 into the second pass
+    player.update();
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, frame->getPixelColor(0));
+    fake::advance(100);
+    player.update();
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, frame->getPixelColor(0));
+    TEST_ASSERT_FALSE(player.isFinished());
+}
+
+// --- Clock sync ---
+
+void test_clock_sync_keeps_the_fastest_reply() {
+    ClockSync clock;
+    TEST_ASSERT_FALSE(clock.isSynced());
+
+    // The first reply counts at once: rtt 100, server read at 1050
+    clock.onReply(1000, 5000050, 1100);
+    TEST_ASSERT_TRUE(clock.isSynced());
+    TEST_ASSERT_EQUAL(100, clock.getRtt());
+    TEST_ASSERT_EQUAL(5000000, (long)clock.serverNow(1000));
+
+    // Within a burst the fastest wins, once the burst ends
+    clock.onReply(2000, 5001030, 2060);  // rtt 60, offset 4999000
+    clock.onReply(2200, 5001705, 2210);  // rtt 10, offset 4999500
+    clock.onReply(2400, 5009999, 2600);  // rtt 200
+    clock.onReply(2700, 5009999, 2700 + CLOCK_SYNC_MAX_RTT_MS + 1); // too slow
+    TEST_ASSERT_EQUAL(100, clock.getRtt());
+    clock.endBurst();
+    TEST_ASSERT_EQUAL(10, clock.getRtt());
+    TEST_ASSERT_EQUAL(5001500, (long)clock.serverNow(2000));
+    TEST_ASSERT_EQUAL(2500, (long)clock.toLocal(5002000));
+}
+
+// --- SequenceProcess ---
+
+void test_upload_loads_and_plays() {
+    ProcessManager manager;
+    LedProcess* led = new LedProcess();
+    SequenceProcess* sequence = new SequenceProcess();
+    manager.addProcess("led", led);
+    manager.addProcess("sequence", sequence);
+    manager.setupProcesses();
+    led->setPattern(ledDefaultSpec(LED_BEHAVIOR_SOLID, 0xFF0000));
+    connect();
+
+    std::vector<uint8_t> data = makeSequence(400, 0, 0, {
+        {0, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x00FF00},
+        {200, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0x0000FF},
+    });
+    char line[64];
+    TEST_ASSERT_TRUE(seq("begin:" + std::to_string(data.size())));
+    TEST_ASSERT_EQUAL_STRING("uploading", sequence->getState());
+    snprintf(line, sizeof(line), "data:%08x:", 0);
+    seq(line + hex(data.data(), 20));
+    seq(line + hex(data.data(), 20)); // sent twice: ignored
+    snprintf(line, sizeof(line), "data:%08x:", 20);
+    seq(line + hex(data.data() + 20, data.size() - 20));
+    snprintf(line, sizeof(line), "end:%08lx", (unsigned long)sequenceCrc32(data.data(), data.size()));
+    seq(line);
+    webSocketManager.service();
+
+    std::vector<std::string> replies = sentWith("seq:");
+    TEST_ASSERT_EQUAL(1, replies.size());
+    snprintf(line, sizeof(line), "seq:ABCD:loaded:%08lx", (unsigned long)sequenceCrc32(data.data(), data.size()));
+    TEST_ASSERT_EQUAL_STRING(line, replies[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("loaded", sequence->getState());
+
+    TEST_ASSERT_TRUE(seq("play"));
+    TEST_ASSERT_TRUE(led->isShowing(&sequence->getPlayer()));
+    TEST_ASSERT_TRUE(sequence->getPlayer().isPlaying()); // from the next frame
+    const LedFrame& base = led->compositor.getLayer(LED_LAYER_BASE).frame;
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_PTR(&sequence->getPlayer(), led->currentBehavior);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, base.getPixelColor(0));
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00, led->pixels.shown[0]); // full levels come through gamma unchanged
+    fake::advance(250);
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("playing", sequence->getState());
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, base.getPixelColor(0));
+
+    // Back to the pattern, made afresh
+    TEST_ASSERT_TRUE(seq("stop"));
+    fake::fireTickers();
+    TEST_ASSERT_EQUAL_STRING("Solid", led->currentBehavior->type);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, base.getPixelColor(0));
+}
+
+void test_upload_errors_are_reported() {
+    ProcessManager manager;
+    manager.addProcess("led", new LedProcess());
+    manager.addProcess("sequence", new SequenceProcess());
+    manager.setupProcesses();
+    connect();
+
+    std::vector<uint8_t> data = makeSequence(400, 0, 0, {{0, 0, SEQUENCE_STEP, 0x00FF00}});
+    seq("begin:" + std::to_string(data.size()));
+    seq("data:00000004:" + hex(data.data() + 4, 4)); // the first 4 bytes never came
+    seq("begin:" + std::to_string(data.size()));
+    seq("data:00000000:" + hex(data.data(), data.size()));
+    seq("end:12345678");
+    seq("begin:" + std::to_string(data.size()));
+    seq("data:00000000:" + hex(data.data(), 4) + "0"); // half a byte
+    seq("begin:" + std::to_string(data.size()));
+    seq("data:00000000:" + hex(data.data(), 4));
+    seq("data:fffffffe:" + hex(data.data() + 4, 4)); // wraps around to before 4
+    seq("begin:" + std::to_string(SEQUENCE_MAX_BYTES + 1));
+    seq("play");
+    webSocketManager.service();
+    webSocketManager.service(); // more than WS_DRAIN_BUDGET
+
+    std::vector<std::string> replies = sentWith("seq:");
+    TEST_ASSERT_EQUAL(5, replies.size());
+    TEST_ASSERT_EQUAL_STRING("seq:ABCD:error:gap", replies[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("seq:ABCD:error:crc", replies[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("seq:ABCD:error:format", replies[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("seq:ABCD:error:gap", replies[3].c_str());
+    TEST_ASSERT_EQUAL_STRING("seq:ABCD:error:size", replies[4].c_str());
+    TEST_ASSERT_TRUE(Serial.output.find("No sequence loaded") != std::string::npos);
+}
+
+void test_probes_sync_the_clock_and_play_at_server_time() {
+    ProcessManager manager;
+    LedProcess* led = new LedProcess();
+    SequenceProcess* sequence = new SequenceProcess();
+    manager.addProcess("led", led);
+    manager.addProcess("sequence", sequence);
+    manager.setupProcesses();
+    connect();
+
+    // The first probe goes out at once; the server's clock is 1e12 ms
+    // ahead and its reply takes 20 ms
+    sequence->update();
+    fake::advance(20);
+    commandRegistry.executeCommand("clock", "10000:1000000010010");
+    TEST_ASSERT_TRUE(sequence->getClock().isSynced());
+    TEST_ASSERT_EQUAL(20, sequence->getClock().getRtt());
+
+    // The rest of the burst, one every CLOCK_SYNC_PROBE_MS
+    for (int i = 0; i < CLOCK_SYNC_PROBES * 2; ++i) {
+        fake::advance(CLOCK_SYNC_PROBE_MS + 1);
+        sequence->update();
+        webSocketManager.service();
+    }
+    std::vector<std::string> probes = sentWith("clock:");
+    TEST_ASSERT_EQUAL(CLOCK_SYNC_PROBES, probes.size());
+    TEST_ASSERT_EQUAL_STRING("clock:ABCD:10000", probes[0].c_str());
+    uint64_t serverNow = sequence->getClock().serverNow(millis());
+
+    std::vector<uint8_t> data = makeSequence(1000, 0, 0, {{0, SEQUENCE_ALL_PIXELS, SEQUENCE_STEP, 0xFF00FF}});
+    seq("begin:" + std::to_string(data.size()));
+    seq("data:00000000:" + hex(data.data(), data.size()));
+    char line[32];
+    snprintf(line, sizeof(line), "end:%08lx", (unsigned long)sequenceCrc32(data.data(), data.size()));
+    seq(line);
+
+    seq("play:" + std::to_string(serverNow + 500));
+    TEST_ASSERT_EQUAL_STRING("waiting", sequence->getState());
+    TEST_ASSERT_EQUAL(-500, sequence->getPlayer().getElapsed());
+    fake::advance(500);
+    TEST_ASSERT_EQUAL_STRING("playing", sequence->getState());
+
+    // A device told late joins part way through
+    seq("play:" + std::to_string(serverNow - 200));
+    TEST_ASSERT_EQUAL(700, sequence->getPlayer().getElapsed());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_checks_the_sequence);
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_step_linear_and_ease);
+    RUN_TEST(test_all_pixel_keyframes_and_overrides);
+    RUN_TEST(test_loop_wraps_and_end_holds);
+    RUN_TEST(test_playback_follows_the_clock);
+    RUN_TEST(test_clock_sync_keeps_the_fastest_reply);
+    RUN_TEST(test_upload_loads_and_plays);
+    RUN_TEST(test_upload_errors_are_reported);
+    RUN_TEST(test_probes_sync_the_clock_and_play_at_server_time);
+    return UNITY_END();
+}
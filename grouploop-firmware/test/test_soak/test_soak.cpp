@@ -0,0 +1,127 @@
+// Heap soak: the publish, receive and logging paths run for a long time
+// without allocating. On the device every allocation on these paths would
+// fragment the heap over a show; here the global operator new is counted.
+#include <Arduino.h>
+#include <unity.h>
+#include <new>
+#include "Configuration.h"
+#include "ProcessManager.h"
+#include "WebSocketManager.h"
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "processes/PublishProcess.h"
+#include "processes/ReceiveProcess.h"
+
+#ifndef SOAK_ITERATIONS
+#define SOAK_ITERATIONS 1000000
+#endif
+
+Configuration configuration;
+
+static unsigned long allocations = 0;
+static long liveBlocks = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    liveBlocks++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* block) noexcept {
+    if (!block) return;
+    liveBlocks--;
+    free(block);
+}
+
+void operator delete[](void* block) noexcept { operator delete(block); }
+void operator delete(void* block, size_t) noexcept { operator delete(block); }
+void operator delete[](void* block, size_t) noexcept { operator delete(block); }
+
+static WebSocketsClient* client;
+static ProcessManager* processes;
+
+void setUp() {
+    Serial.reset();
+}
+
+void tearDown() {}
+
+void test_publish_path_does_not_allocate() {
+    client->recordSent = false;
+    unsigned long sentBefore = client->sentCount;
+
+    // Warm up: first-use allocations (if any) don't count
+    for (int i = 0; i < 100; ++i) {
+        fake::advance(PUBLISH_INTERVAL_MS + 1);
+        processes->updateProcesses();
+        webSocketManager.service();
+    }
+
+    unsigned long before = allocations;
+    long liveBefore = liveBlocks;
+    for (unsigned long i = 0; i < SOAK_ITERATIONS; ++i) {
+        fake::advance(PUBLISH_INTERVAL_MS + 1);
+        processes->updateProcesses();
+        webSocketManager.service();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+    TEST_ASSERT_EQUAL_INT(liveBefore, liveBlocks);
+    TEST_ASSERT_EQUAL_UINT32(SOAK_ITERATIONS + 100, client->sentCount - sentBefore);
+}
+
+void test_receive_path_does_not_allocate() {
+    unsigned long handled = 0;
+    commandRegistry.registerCommand("noop", [&handled](const String& params) { handled++; });
+
+    // Short parameters, and ones well past String's inline buffer
+    std::string longMessage = "noop:" + std::string(WS_RX_MAX_LEN - 5, '7');
+    unsigned long firmwareAllocations = 0;
+    long liveBefore = liveBlocks;
+    for (unsigned long i = 0; i < SOAK_ITERATIONS / 10; ++i) {
+        // the fake server's side may allocate
+        client->injectText(i % 2 ? "noop:1234" : longMessage.c_str());
+        unsigned long before = allocations;
+        webSocketManager.service();
+        fake::advance(11);
+        processes->updateProcesses();
+        firmwareAllocations += allocations - before;
+    }
+    TEST_ASSERT_EQUAL_UINT32(SOAK_ITERATIONS / 10, handled);
+    TEST_ASSERT_EQUAL_UINT32(0, firmwareAllocations);
+    TEST_ASSERT_INT_WITHIN(2, liveBefore, liveBlocks);
+}
+
+void test_logging_does_not_allocate() {
+    unsigned long before = allocations;
+    for (unsigned long i = 0; i < SOAK_ITERATIONS; ++i) {
+        LOG_INFO("soak %lu %s %.2f", i, "text", 1.5);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+    TEST_ASSERT_GREATER_THAN(0, logger.getOverwrittenCount());
+}
+
+int main(int argc, char** argv) {
+    client = WebSocketsClient::latest;
+
+    // The same wiring as main.cpp, without the hardware-facing processes
+    processes = new ProcessManager();
+    processes->addProcess("publish", new PublishProcess());
+    processes->addProcess("receive", new ReceiveProcess());
+    processes->setupProcesses();
+    webSocketManager.initialize("ws://10.0.0.1:5003/");
+    webSocketManager.setLinkUp(true);
+    client->injectConnected();
+    webSocketManager.service();
+    webSocketManager.dispatch();
+    logger.setSerialLevel(LOG_LEVEL_NONE);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_path_does_not_allocate);
+    RUN_TEST(test_receive_path_does_not_allocate);
+    RUN_TEST(test_logging_does_not_allocate);
+    return UNITY_END();
+}
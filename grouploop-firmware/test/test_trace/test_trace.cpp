@@ -0,0 +1,370 @@
+// Input trace recording, upload, reassembly and replay
+#include <Arduino.h>
+#include <unity.h>
+#include <sstream>
+#include "Configuration.h"
+#include "TraceRecorder.h"
+#include "Advertisement.h"
+#include "processes/TraceProcess.h"
+#include "../../host/replay/TraceReplay.h"
+
+Configuration configuration;
+
+static const uint8_t anchorAddresses[4][6] = {
+    {0xaa, 0xbb, 0xcc, 0x00, 0x00, 0x01},   // NW
+    {0xaa, 0xbb, 0xcc, 0x00, 0x00, 0x02},   // NE
+    {0xaa, 0xbb, 0xcc, 0x00, 0x00, 0x03},   // SE
+    {0xaa, 0xbb, 0xcc, 0x00, 0x00, 0x04},   // SW
+};
+
+// Flags plus the beacon service UUID, as the anchors advertise it
+static size_t beaconPayload(uint8_t* out) {
+    out[0] = 2;
+    out[1] = 0x01;
+    out[2] = 0x06;
+    out[3] = 17;
+    out[4] = AD_TYPE_COMPLETE_UUID128;
+    parseUuid128(BEACON_SERVICE_UUID, out + 5);
+    return 21;
+}
+
+// The whole ring as one byte string
+static std::vector<uint8_t> readRing() {
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[100];
+    uint32_t position = 0;
+    while (size_t length = traceRecorder.read(position, chunk, sizeof(chunk))) {
+        bytes.insert(bytes.end(), chunk, chunk + length);
+        position += length;
+    }
+    return bytes;
+}
+
+static std::vector<TraceRecordView> parseAll(const std::vector<uint8_t>& bytes) {
+    std::vector<TraceRecordView> views;
+    size_t position = 0;
+    TraceRecordView view;
+    while (traceParseRecord(bytes.data() + position, bytes.size() - position, view)) {
+        views.push_back(view);
+        position += traceRecordLength(bytes.data() + position, bytes.size() - position);
+    }
+    TEST_ASSERT_EQUAL(bytes.size(), position);
+    return views;
+}
+
+// One upload message for bytes [offset, offset + length) of the stream
+static std::string chunkLine(const char* device, const std::vector<uint8_t>& bytes, size_t offset, size_t length) {
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "trace:%s:%08lx:", device, (unsigned long)offset);
+    std::string line = prefix;
+    for (size_t i = 0; i < length; ++i) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", bytes[offset + i]);
+        line += hex;
+    }
+    return line;
+}
+
+void setUp() {
+    fake::setMillis(5000);
+    Serial.reset();
+    traceRecorder.stop();
+    traceRecorder.clear();
+}
+
+void tearDown() {}
+
+void test_recorder_is_off_until_started() {
+    traceRecorder.recordImu(1, 2, 3);
+    traceRecorder.recordMessage("led:ff0000", 10);
+    TEST_ASSERT_EQUAL(0, readRing().size());
+
+    traceRecorder.start();
+    std::vector<uint8_t> bytes = readRing();
+    std::vector<TraceRecordView> views = parseAll(bytes);
+    TEST_ASSERT_EQUAL(1, views.size());
+    TEST_ASSERT_EQUAL(TRACE_START, views[0].type);
+    TEST_ASSERT_EQUAL_UINT32(5000000, views[0].timestamp);
+    TEST_ASSERT_EQUAL(TRACE_FORMAT_VERSION, views[0].payload[0]);
+}
+
+void test_records_round_trip() {
+    uint8_t payload[31];
+    size_t payloadLength = beaconPayload(payload);
+    traceRecorder.start();
+    fake::advanceMicros(10);
+    traceRecorder.recordImu(12.0f, -980.0f, 3999.6f);
+    traceRecorder.recordScan(true);
+    traceRecorder.recordAdvert(anchorAddresses[2], -71, payload, payloadLength);
+    traceRecorder.recordMessage("pattern:breathing", 17);
+
+    std::vector<uint8_t> bytes = readRing();
+    std::vector<TraceRecordView> views = parseAll(bytes);
+    TEST_ASSERT_EQUAL(5, views.size());
+
+    int16_t x, y, z;
+    TEST_ASSERT_TRUE(traceReadImu(views[1], x, y, z));
+    TEST_ASSERT_EQUAL_UINT32(5000010, views[1].timestamp);
+    TEST_ASSERT_EQUAL(12, x);
+    TEST_ASSERT_EQUAL(-980, y);
+    TEST_ASSERT_EQUAL(4000, z);
+
+    TEST_ASSERT_EQUAL(TRACE_SCAN, views[2].type);
+    TEST_ASSERT_EQUAL(1, views[2].payload[0]);
+
+    const uint8_t* address;
+    const uint8_t* advert;
+    size_t advertLength;
+    int rssi;
+    TEST_ASSERT_TRUE(traceReadAdvert(views[3], address, rssi, advert, advertLength));
+    TEST_ASSERT_EQUAL_MEMORY(anchorAddresses[2], address, 6);
+    TEST_ASSERT_EQUAL(-71, rssi);
+    TEST_ASSERT_EQUAL(payloadLength, advertLength);
+    TEST_ASSERT_EQUAL_MEMORY(payload, advert, payloadLength);
+
+    TEST_ASSERT_EQUAL(TRACE_MESSAGE, views[4].type);
+    TEST_ASSERT_EQUAL(17, views[4].payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY("pattern:breathing", views[4].payload, 17);
+}
+
+void test_ring_overwrites_oldest_records() {
+    traceRecorder.start();
+    for (int i = 0; i < TRACE_RING_SIZE; ++i) {
+        traceRecorder.recordImu((float)i, 0, 1000);
+    }
+    TEST_ASSERT_TRUE(traceRecorder.getOverwrittenCount() > 0);
+    TEST_ASSERT_TRUE(traceRecorder.getBufferedBytes() <= TRACE_RING_SIZE);
+
+    // Reading from the start skips to the oldest record still there
+    std::vector<uint8_t> bytes = readRing();
+    std::vector<TraceRecordView> views = parseAll(bytes);
+    int16_t x, y, z;
+    TEST_ASSERT_TRUE(traceReadImu(views.back(), x, y, z));
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE - 1, x);
+    TEST_ASSERT_TRUE(traceReadImu(views.front(), x, y, z));
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE - (int)views.size(), x);
+
+    // Too long to have reached the receive queue either
+    char longMessage[WS_RX_MAX_LEN + 1];
+    memset(longMessage, 'x', sizeof(longMessage));
+    traceRecorder.recordMessage(longMessage, sizeof(longMessage));
+    TEST_ASSERT_EQUAL_UINT32(1, traceRecorder.getSkippedCount());
+}
+
+void test_processes_record_their_input() {
+    IMUProcess imu;
+    BLEProcess ble;
+    ble.setup();
+    uint8_t payload[31];
+    size_t payloadLength = beaconPayload(payload);
+    traceRecorder.start();
+
+    imu.processReading(0, 0, 1000);
+    ble.onAdvertisement(anchorAddresses[0], -60, payload, payloadLength);
+    ble.startScan();
+    webSocketManager.queueReceived("vibrate:pulse", 13);
+    char message[32];
+    webSocketManager.getMessage(message, sizeof(message));
+    // Through the scanner backend, as the BLE stack hands it over
+    fake::bleAdvertise(anchorAddresses[1], -70, payload, payloadLength);
+
+    std::vector<TraceRecordView> views = parseAll(readRing());
+    TEST_ASSERT_EQUAL(6, views.size());
+    TEST_ASSERT_EQUAL(TRACE_IMU, views[1].type);
+    TEST_ASSERT_EQUAL(TRACE_ADVERT, views[2].type);
+    TEST_ASSERT_EQUAL(TRACE_SCAN, views[3].type);
+    TEST_ASSERT_EQUAL(TRACE_MESSAGE, views[4].type);
+    TEST_ASSERT_EQUAL(TRACE_ADVERT, views[5].type);
+    ble.stopScan();
+    fake::bleAdvertise(anchorAddresses[1], -70, payload, payloadLength);
+    views = parseAll(readRing());
+    TEST_ASSERT_EQUAL(7, views.size());
+    TEST_ASSERT_EQUAL(TRACE_SCAN, views[6].type);
+}
+
+void test_calibration_gives_up_without_the_anchor() {
+    configuration.setRssiAt1mNW(-50);
+    BLEProcess ble;
+    ble.setup();
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("calibrate", "NW"));
+    ble.update();
+    TEST_ASSERT_TRUE(Serial.output.find("Calibration failed") == std::string::npos);
+
+    // Scans come and go, the anchor is never in them
+    fake::advance(CALIBRATION_TIMEOUT_MS + 1);
+    ble.update();
+    TEST_ASSERT_TRUE(Serial.output.find("Calibration failed: NW not heard") != std::string::npos);
+    TEST_ASSERT_EQUAL(-50, configuration.getRssiAt1mNW());
+    configuration.setRssiAt1mNW(0);
+}
+
+void test_halting_stops_the_scan() {
+    ProcessManager manager;
+    BLEProcess* ble = new BLEProcess();
+    manager.addProcess("ble", ble);
+    manager.setupProcesses();
+    ble->startScan();
+    TEST_ASSERT_TRUE(fake::bleScanning);
+    TEST_ASSERT_TRUE(radioArbiter.isScanActive());
+
+    manager.haltProcess("ble");
+    TEST_ASSERT_FALSE(fake::bleScanning);
+    TEST_ASSERT_FALSE(radioArbiter.isScanActive());
+    manager.startProcess("ble");
+}
+
+void test_capture_reassembles_chunks_by_offset() {
+    traceRecorder.start();
+    for (int i = 0; i < 20; ++i) traceRecorder.recordImu((float)i, 0, 1000);
+    std::vector<uint8_t> bytes = readRing();
+
+    // Odd-sized chunks, one sent twice, interleaved with another device
+    std::ostringstream text;
+    size_t chunk = 17;
+    for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+        text << "[TRACE] " << chunkLine("abcd", bytes, offset, std::min(chunk, bytes.size() - offset)) << "\n";
+        if (offset == chunk) text << "trace:1234:00000000:0700\n";
+        if (offset == 2 * chunk) text << chunkLine("ABCD", bytes, chunk, 1) << "\n";
+    }
+    std::istringstream in(text.str());
+    TraceCapture capture;
+    TEST_ASSERT_TRUE(traceLoadCapture(in, "", capture));
+    TEST_ASSERT_EQUAL_STRING("abcd", capture.deviceId.c_str());
+    TEST_ASSERT_EQUAL(0, capture.gaps);
+    TEST_ASSERT_EQUAL(bytes.size(), capture.records.size());
+    TEST_ASSERT_EQUAL_MEMORY(bytes.data(), capture.records.data(), bytes.size());
+
+    // Records overwritten before they went out: the upload resumes at a
+    // later record, and the record cut off before the gap is dropped
+    size_t start = TRACE_RECORD_HEADER_SIZE + 1, imu = TRACE_RECORD_HEADER_SIZE + 6;
+    size_t resume = start + 4 * imu;
+    std::istringstream gappedIn(chunkLine("abcd", bytes, 0, start + imu + 5) + "\n" +
+                                chunkLine("abcd", bytes, resume, bytes.size() - resume) + "\n");
+    TraceCapture partial;
+    TEST_ASSERT_TRUE(traceLoadCapture(gappedIn, "ABCD", partial));
+    TEST_ASSERT_EQUAL(1, partial.gaps);
+    TEST_ASSERT_EQUAL(5, partial.droppedBytes);
+    TEST_ASSERT_EQUAL(18, parseAll(partial.records).size());
+}
+
+void test_trace_process_streams_the_ring() {
+    WebSocketsClient* client = WebSocketsClient::latest;
+    webSocketManager.initialize("ws://10.0.0.1:5003/");
+    webSocketManager.setLinkUp(true);
+    client->injectConnected();
+    webSocketManager.service();
+    client->sent.clear();
+
+    static TraceProcess trace;
+    trace.setup();
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("trace", "stream"));
+    for (int i = 0; i < 40; ++i) {
+        fake::advance(10);
+        traceRecorder.recordImu((float)i, 0, 1000);
+        trace.update();
+        webSocketManager.service();
+    }
+    TEST_ASSERT_TRUE(commandRegistry.executeCommand("trace", "stop"));
+    for (int i = 0; i < 20; ++i) {
+        trace.update();
+        webSocketManager.service();
+    }
+    TEST_ASSERT_EQUAL_STRING("idle", trace.getState());
+
+    std::ostringstream text;
+    for (const std::string& message : client->sent) {
+        TEST_ASSERT_TRUE(message.size() <= WS_EVENT_MAX_LEN);
+        text << message << "\n";
+    }
+    client->sent.clear();
+    std::istringstream in(text.str());
+    TraceCapture capture;
+    TEST_ASSERT_TRUE(traceLoadCapture(in, "ABCD", capture));
+    TEST_ASSERT_EQUAL(0, capture.gaps);
+    TEST_ASSERT_EQUAL(readRing().size(), capture.records.size());
+    TEST_ASSERT_EQUAL(41, parseAll(capture.records).size());
+}
+
+// Two seconds at the venue: the device lies flat, is tapped once, sees all
+// four anchors in one scan window and is asked for a health report
+void test_replay_feeds_trace_through_processes() {
+    configuration.setBeaconNW("aa:bb:cc:00:00:01");
+    configuration.setBeaconNE("aa:bb:cc:00:00:02");
+    configuration.setBeaconSE("aa:bb:cc:00:00:03");
+    configuration.setBeaconSW("aa:bb:cc:00:00:04");
+    uint8_t payload[31];
+    size_t payloadLength = beaconPayload(payload);
+
+    fake::setMillis(20000);
+    traceRecorder.start();
+    for (int ms = 0; ms < 2000; ms += 10) {
+        fake::setMillis(20000 + ms);
+        traceRecorder.recordImu(0, ms == 1000 ? 3500 : 0, 1000);
+        if (ms == 400) traceRecorder.recordScan(true);
+        if (ms >= 400 && ms < 1400 && ms % 100 == 0) {
+            for (int i = 0; i < 4; ++i) traceRecorder.recordAdvert(anchorAddresses[i], -65, payload, payloadLength);
+        }
+        if (ms == 1400) traceRecorder.recordScan(false);
+        if (ms == 1500) traceRecorder.recordMessage("health", 6);
+    }
+    traceRecorder.stop();
+    std::vector<uint8_t> trace = readRing();
+
+    TraceReplayer replayer;
+    TEST_ASSERT_TRUE(replayer.run(trace.data(), trace.size()));
+    TEST_ASSERT_EQUAL_UINT32(200, replayer.imuReadings);
+    TEST_ASSERT_EQUAL_UINT32(2, replayer.scans);
+    TEST_ASSERT_EQUAL_UINT32(40, replayer.adverts);
+    TEST_ASSERT_EQUAL_UINT32(1, replayer.messages);
+    TEST_ASSERT_TRUE(replayer.traceUs >= 1990000);
+    TEST_ASSERT_TRUE(replayer.wallNs < replayer.traceUs * 1000);
+
+    int frames = 0, tapped = 0, healthAt = -1;
+    unsigned long firstBeaconAt = 0;
+    for (const TraceReplayer::Output& output : replayer.getOutput()) {
+        const std::string& message = output.message;
+        if (message.rfind("health:ABCD:", 0) == 0) {
+            healthAt = (int)output.atMs;
+            continue;
+        }
+        TEST_ASSERT_EQUAL(27, message.size());
+        frames++;
+        if (message.substr(18, 2) == "ff") tapped++;
+        if (message.substr(10, 2) != "00" && firstBeaconAt == 0) firstBeaconAt = output.atMs;
+    }
+    TEST_ASSERT_INT_WITHIN(2, 39, frames);
+    TEST_ASSERT_EQUAL(1, tapped);
+    // Folded in when the scan window closed
+    TEST_ASSERT_TRUE(firstBeaconAt >= 21400);
+    TEST_ASSERT_TRUE(healthAt >= 21500 && healthAt < 21520);
+    TEST_ASSERT_TRUE(replayer.getBLEProcess()->getPositionFix().valid);
+
+    // The LEDs are off until the tap at 21000 flashes them on the next
+    // frame; the flash fades out over LED_FLASH_MS
+    TEST_ASSERT_INT_WITHIN(2, 100, (int)replayer.ledFrames);
+    const std::vector<TraceReplayer::LedFrame>& leds = replayer.getLeds();
+    TEST_ASSERT_TRUE(leds.size() >= 3);
+    TEST_ASSERT_EQUAL_HEX32(0, leds[0].pixels[0]);
+    TEST_ASSERT_EQUAL_HEX32(LED_FLASH_COLOR, leds[1].pixels[0]);
+    TEST_ASSERT_TRUE(leds[1].atMs > 21000 && leds[1].atMs <= 21000 + 2 * LED_FRAME_MS);
+    unsigned long flashOff = 0;
+    for (size_t i = 2; i < leds.size() && flashOff == 0; ++i) {
+        if (leds[i].pixels[0] == 0) flashOff = leds[i].atMs;
+    }
+    TEST_ASSERT_INT_WITHIN(2 * LED_FRAME_MS, LED_FLASH_MS, (int)(flashOff - leds[1].atMs));
+    TEST_ASSERT_EQUAL_HEX32(0, replayer.getLedProcess()->pixels.shown[0]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_recorder_is_off_until_started);
+    RUN_TEST(test_records_round_trip);
+    RUN_TEST(test_ring_overwrites_oldest_records);
+    RUN_TEST(test_processes_record_their_input);
+    RUN_TEST(test_calibration_gives_up_without_the_anchor);
+    RUN_TEST(test_halting_stops_the_scan);
+    RUN_TEST(test_capture_reassembles_chunks_by_offset);
+    RUN_TEST(test_trace_process_streams_the_ring);
+    RUN_TEST(test_replay_feeds_trace_through_processes);
+    return UNITY_END();
+}
@@ -0,0 +1,330 @@
+// WebSocketManager queues, the publish and receive paths, telemetry frames and log records
+#include <Arduino.h>
+#include <unity.h>
+#include "Configuration.h"
+#include "ProcessManager.h"
+#include "WebSocketManager.h"
+#include "CommandRegistry.h"
+#include "Log.h"
+#include "processes/PublishProcess.h"
+#include "processes/ReceiveProcess.h"
+#include "TelemetryFrame.h"
+
+Configuration configuration;
+
+// The client owned by the global webSocketManager
+static WebSocketsClient* globalClient;
+
+// A manager of its own per test, connected to a fake server
+struct Link {
+    WebSocketManager* manager;
+    WebSocketsClient* client;
+};
+
+static Link openLink() {
+    Link link;
+    link.manager = new WebSocketManager();
+    link.client = WebSocketsClient::latest;
+    link.manager->initialize("ws://10.0.0.1:5003/socket");
+    link.manager->setLinkUp(true);
+    link.client->injectConnected();
+    link.manager->service();
+    link.manager->dispatch();
+    return link;
+}
+
+static void connectGlobal() {
+    if (webSocketManager.isConnected()) return;
+    webSocketManager.initialize("ws://10.0.0.1:5003/");
+    webSocketManager.setLinkUp(true);
+    globalClient->injectConnected();
+    webSocketManager.service();
+    webSocketManager.dispatch();
+}
+
+void setUp() {
+    fake::setMillis(5000);
+    Serial.reset();
+}
+
+void tearDown() {}
+
+// --- WebSocketManager ---
+
+void test_initialize_parses_url_and_device_id() {
+    Link link = openLink();
+    TEST_ASSERT_EQUAL_STRING("10.0.0.1", link.client->host.c_str());
+    TEST_ASSERT_EQUAL(5003, link.client->port);
+    TEST_ASSERT_EQUAL_STRING("/socket", link.client->url.c_str());
+    TEST_ASSERT_EQUAL_STRING("ABCD", link.manager->getDeviceId()); // last two MAC bytes
+    TEST_ASSERT_TRUE(link.manager->isConnected());
+    delete link.manager;
+}
+
+void test_telemetry_is_latest_wins() {
+    Link link = openLink();
+    TEST_ASSERT_TRUE(link.manager->sendTelemetry("frame1\n", 7));
+    TEST_ASSERT_TRUE(link.manager->sendTelemetry("frame2\n", 7));
+    link.manager->service();
+    link.manager->service();
+
+    TEST_ASSERT_EQUAL(1, link.client->sent.size());
+    TEST_ASSERT_EQUAL_STRING("frame2\n", link.client->sent[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, link.manager->getUplinkStats().telemetrySent);
+    TEST_ASSERT_EQUAL_UINT32(1, link.manager->getUplinkStats().telemetryCoalesced);
+
+    // Too long for the telemetry slot
+    char longFrame[WS_TELEMETRY_MAX_LEN + 1];
+    memset(longFrame, 'x', sizeof(longFrame));
+    TEST_ASSERT_FALSE(link.manager->sendTelemetry(longFrame, sizeof(longFrame)));
+    delete link.manager;
+}
+
+void test_events_keep_order_and_retry_failed_writes() {
+    Link link = openLink();
+    link.client->failSends = true;
+    TEST_ASSERT_TRUE(link.manager->sendEvent("a", 1));
+    TEST_ASSERT_TRUE(link.manager->sendEvent("b", 1));
+    link.manager->service();
+    TEST_ASSERT_EQUAL(0, link.client->sent.size());
+    TEST_ASSERT_EQUAL_UINT32(1, link.manager->getUplinkStats().sendFailures);
+
+    link.client->failSends = false;
+    link.manager->service();
+    TEST_ASSERT_EQUAL(2, link.client->sent.size());
+    TEST_ASSERT_EQUAL_STRING("a", link.client->sent[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("b", link.client->sent[1].c_str());
+    delete link.manager;
+}
+
+void test_empty_event_is_rejected() {
+    Link link = openLink();
+    TEST_ASSERT_FALSE(link.manager->sendEvent("", 0));
+    TEST_ASSERT_TRUE(link.manager->sendEvent("after", 5));
+    link.manager->service();
+    TEST_ASSERT_EQUAL(1, link.client->sent.size());
+    TEST_ASSERT_EQUAL_STRING("after", link.client->sent[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, link.manager->getUplinkStats().eventsSent);
+    delete link.manager;
+}
+
+void test_event_queue_rejects_when_full() {
+    Link link = openLink();
+    for (int i = 0; i < WS_EVENT_QUEUE_DEPTH; ++i) {
+        TEST_ASSERT_TRUE(link.manager->sendEvent("e", 1));
+    }
+    TEST_ASSERT_FALSE(link.manager->sendEvent("overflow", 8));
+    TEST_ASSERT_EQUAL_UINT32(1, link.manager->getUplinkStats().eventsDropped);
+    TEST_ASSERT_EQUAL(WS_EVENT_QUEUE_DEPTH, link.manager->getUplinkStats().eventQueueHighWater);
+
+    // WS_DRAIN_BUDGET events go out per pass
+    link.manager->service();
+    TEST_ASSERT_EQUAL(WS_DRAIN_BUDGET, link.client->sent.size());
+    delete link.manager;
+}
+
+void test_received_messages_are_queued() {
+    Link link = openLink();
+    link.client->injectText("led:ff0000");
+    link.client->inject(WStype_BIN, std::string("\x01\xab", 2));
+    for (int i = 0; i < WS_RX_QUEUE_DEPTH; ++i) link.client->injectText("extra");
+    link.manager->service();
+
+    char message[WS_RX_MAX_LEN + 1];
+    TEST_ASSERT_TRUE(link.manager->hasMessage());
+    TEST_ASSERT_EQUAL(10, link.manager->getMessage(message, sizeof(message)));
+    TEST_ASSERT_EQUAL_STRING("led:ff0000", message);
+    link.manager->getMessage(message, sizeof(message));
+    TEST_ASSERT_EQUAL_STRING("01ab", message); // binary arrives as hex
+    TEST_ASSERT_EQUAL_UINT32(2, link.manager->getUplinkStats().rxDropped);
+
+    // Truncated to the caller's buffer
+    char small[4];
+    TEST_ASSERT_EQUAL(3, link.manager->getMessage(small, sizeof(small)));
+    TEST_ASSERT_EQUAL_STRING("ext", small);
+    delete link.manager;
+}
+
+void test_disconnect_drops_pending_telemetry() {
+    Link link = openLink();
+    link.manager->sendTelemetry("stale\n", 6);
+    link.client->injectDisconnected();
+    link.manager->service();
+    TEST_ASSERT_EQUAL(ConnectionState::CONNECTING, link.manager->getConnectionState());
+
+    link.client->injectConnected();
+    link.manager->service();
+    TEST_ASSERT_TRUE(link.manager->isConnected());
+    TEST_ASSERT_EQUAL(0, link.client->sent.size());
+    delete link.manager;
+}
+
+void test_link_down_notifies_listeners() {
+    Link link = openLink();
+    ConnectionState seen = ConnectionState::CONNECTED;
+    int calls = 0;
+    link.manager->addConnectionListener([&](ConnectionState state) { seen = state; calls++; });
+
+    link.manager->setLinkUp(false);
+    link.manager->service();
+    TEST_ASSERT_FALSE(link.client->isConnected());
+    link.manager->dispatch();
+    link.manager->dispatch();
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL(ConnectionState::DISCONNECTED, seen);
+    TEST_ASSERT_FALSE(link.manager->sendTelemetry("x", 1));
+    delete link.manager;
+}
+
+// --- Publish / receive ---
+
+void test_publish_sends_frame_each_interval() {
+    ProcessManager manager;
+    PublishProcess* publish = new PublishProcess();
+    manager.addProcess("publish", publish);
+    manager.setupProcesses(); // no imu/ble: neutral sensor bytes
+    connectGlobal();
+    globalClient->sent.clear();
+
+    fake::advance(PUBLISH_INTERVAL_MS + 1);
+    manager.updateProcesses();
+    manager.updateProcesses(); // not due yet: nothing new queued
+    webSocketManager.service();
+    TEST_ASSERT_EQUAL(1, globalClient->sent.size());
+    // id, ax ay az (0 g -> 0x80), dNW dNE dSE dSW, tap, px py pconf
+    TEST_ASSERT_EQUAL_STRING("ABCD808080" "00000000" "00" "000000" "\n", globalClient->sent[0].c_str());
+
+    fake::advance(PUBLISH_INTERVAL_MS + 1);
+    manager.updateProcesses();
+    webSocketManager.service();
+    TEST_ASSERT_EQUAL(2, globalClient->sent.size());
+}
+
+void test_receive_dispatches_commands() {
+    String lastParams = "unset";
+    int pings = 0;
+    commandRegistry.registerCommand("ping", [&](const String& params) { lastParams = params; pings++; });
+
+    ReceiveProcess receive;
+    connectGlobal();
+    globalClient->injectText("ping:a:b");
+    globalClient->injectText("ping");
+    webSocketManager.service();
+
+    fake::advance(11);
+    receive.update();
+    TEST_ASSERT_EQUAL(1, pings);
+    TEST_ASSERT_EQUAL_STRING("a:b", lastParams.c_str()); // split at the first colon only
+
+    receive.update(); // the check timer has not elapsed
+    TEST_ASSERT_EQUAL(1, pings);
+
+    fake::advance(11);
+    receive.update();
+    TEST_ASSERT_EQUAL(2, pings);
+    TEST_ASSERT_EQUAL_STRING("", lastParams.c_str());
+}
+
+void test_telemetry_frame_scales_sensor_values() {
+    TelemetrySample sample = {};
+    sample.ax = -2.0f;  // -> 00
+    sample.ay = 2.5f;   // clamped -> ff
+    sample.az = 1.0f;   // -> bf
+    sample.hasBeacons = true;
+    sample.rssiNW = -100; // -> 00
+    sample.rssiNE = -40;  // -> ff
+    sample.rssiSE = -70;  // -> 80
+    sample.rssiSW = -128; // not seen -> 00
+    sample.tapped = true;
+    sample.position = PositionFix{5.0f, 10.0f, 1.0f, true};
+
+    char frame[WS_TELEMETRY_MAX_LEN];
+    TEST_ASSERT_EQUAL(27, formatTelemetryFrame(frame, sizeof(frame), "ABCD", sample, 10.0f, 10.0f));
+    TEST_ASSERT_EQUAL_STRING("ABCD" "00ffbf" "00ff8000" "ff" "80ffff" "\n", frame);
+
+    char small[10];
+    TEST_ASSERT_EQUAL(0, formatTelemetryFrame(small, sizeof(small), "ABCD", sample, 10.0f, 10.0f));
+}
+
+// --- Log records ---
+
+void test_log_record_formats_like_printf() {
+    logger.clear();
+    uint32_t position = logger.getHeadPosition();
+    static const char* format = "beacon %s rssi %d at %.1f m, flags %x";
+    logger.write(LOG_LEVEL_WARN, format, "NE", -67, 2.5, 0xBEEFu);
+
+    uint8_t record[LOG_RECORD_MAX];
+    size_t length = logger.readRecord(position, record, sizeof(record));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    LogRecordView view;
+    TEST_ASSERT_TRUE(logParseRecord(record, length, sizeof(uintptr_t), view));
+    TEST_ASSERT_EQUAL_PTR(format, (const char*)(uintptr_t)view.formatAddress);
+    TEST_ASSERT_EQUAL_UINT32(millis(), view.timestamp);
+
+    char line[LOG_LINE_MAX];
+    logFormatLine(line, sizeof(line), format, view);
+    TEST_ASSERT_EQUAL_STRING("    5000 W beacon NE rssi -67 at 2.5 m, flags beef", line);
+    TEST_ASSERT_EQUAL(0, logger.readRecord(position, record, sizeof(record)));
+}
+
+void test_log_ring_overwrites_oldest() {
+    logger.clear();
+    for (int i = 0; i < LOG_RING_SIZE; ++i) {
+        logger.write(LOG_LEVEL_INFO, "record %d", i);
+    }
+    TEST_ASSERT_GREATER_THAN(0, logger.getOverwrittenCount());
+
+    // Reading from an overwritten position skips ahead to the oldest record
+    uint32_t position = 0;
+    uint8_t record[LOG_RECORD_MAX];
+    LogRecordView view;
+    size_t length = logger.readRecord(position, record, sizeof(record));
+    TEST_ASSERT_TRUE(logParseRecord(record, length, sizeof(uintptr_t), view));
+    size_t offset = 0;
+    LogArgValue arg;
+    TEST_ASSERT_TRUE(logReadArg(view, offset, arg));
+    TEST_ASSERT_GREATER_THAN(0, arg.integer);
+}
+
+void test_unknown_commands_are_logged_at_a_limited_rate() {
+    logger.clear();
+    uint32_t position = logger.getHeadPosition();
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_FALSE(commandRegistry.executeCommand("bogus", ""));
+    }
+    fake::advance(LOG_HOT_INTERVAL_MS);
+    commandRegistry.executeCommand("bogus", "");
+
+    uint8_t record[LOG_RECORD_MAX];
+    LogRecordView view;
+    size_t length = logger.readRecord(position, record, sizeof(record));
+    TEST_ASSERT_TRUE(logParseRecord(record, length, sizeof(uintptr_t), view));
+    TEST_ASSERT_EQUAL(0, view.suppressed);
+    length = logger.readRecord(position, record, sizeof(record));
+    TEST_ASSERT_TRUE(logParseRecord(record, length, sizeof(uintptr_t), view));
+    TEST_ASSERT_EQUAL(9, view.suppressed);
+    TEST_ASSERT_EQUAL(0, logger.readRecord(position, record, sizeof(record)));
+}
+
+int main(int argc, char** argv) {
+    globalClient = WebSocketsClient::latest;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_initialize_parses_url_and_device_id);
+    RUN_TEST(test_telemetry_is_latest_wins);
+    RUN_TEST(test_events_keep_order_and_retry_failed_writes);
+    RUN_TEST(test_empty_event_is_rejected);
+    RUN_TEST(test_event_queue_rejects_when_full);
+    RUN_TEST(test_received_messages_are_queued);
+    RUN_TEST(test_disconnect_drops_pending_telemetry);
+    RUN_TEST(test_link_down_notifies_listeners);
+    RUN_TEST(test_publish_sends_frame_each_interval);
+    RUN_TEST(test_receive_dispatches_commands);
+    RUN_TEST(test_telemetry_frame_scales_sensor_values);
+    RUN_TEST(test_log_record_formats_like_printf);
+    RUN_TEST(test_log_ring_overwrites_oldest);
+    RUN_TEST(test_unknown_commands_are_logged_at_a_limited_rate);
+    return UNITY_END();
+}
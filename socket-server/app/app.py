@@ -1,6 +1,7 @@
 import asyncio
 import json
 import os
+import time
 from typing import Optional, Set, Dict
 import aiohttp
 
@@ -67,6 +68,24 @@ async def broadcast_to_subscribers(message: str) -> None:
         for ws in stale:
             subscribers.discard(ws)
 
+def parse_device_id(text: str) -> str:
+    """The device id in lower case, or "" if it is not 4 hex digits"""
+    device_id = text.lower()
+    if len(device_id) == 4 and all(c in '0123456789abcdef' for c in device_id):
+        return device_id
+    return ""
+
+async def device_event(websocket: WebSocketServerProtocol, message: str, tag: str) -> None:
+    """Handle <tag>:<device_id>:<payload> from a device: register the sender
+    as that device, print the event and pass it on to the subscribers"""
+    parts = message.strip().split(":", 2)
+    device_id = parse_device_id(parts[1]) if len(parts) == 3 else ""
+    if not device_id:
+        return
+    devices[device_id] = websocket
+    print(f"[{tag.upper()}] {tag}:{device_id}:{parts[2]}", flush=True)
+    await broadcast_to_subscribers(message.strip() + "\n")
+
 async def send_to_device(device_id: str, message: str, parameters: str = "") -> bool:
     """Send a message to a specific device by device ID"""
     if device_id in devices:
@@ -167,6 +186,30 @@ async def handle_websocket_connection(websocket: WebSocketServerProtocol) -> Non
                         await websocket.send("cmd:error:invalid_format")
                 except Exception as e:
                     await websocket.send(f"cmd:error:{str(e)}")
+            elif isinstance(message, str) and message.startswith("health:"):
+                # Periodic device health report: health:<device_id>:{json}
+                await device_event(websocket, message, "health")
+            elif isinstance(message, str) and message.startswith("log:"):
+                # Binary log upload: log:<device_id>:<hex records>. Decode the
+                # printed lines with grouploop-firmware/host/logdecode.
+                await device_event(websocket, message, "log")
+            elif isinstance(message, str) and message.startswith("trace:"):
+                # Input trace upload: trace:<device_id>:<offset>:<hex bytes>.
+                # Replay the printed lines with grouploop-firmware/host/replay.
+                await device_event(websocket, message, "trace")
+            elif isinstance(message, str) and message.startswith("clock:"):
+                # Clock probe: clock:<id>:<sender millis>. Answered at once
+                # with the server time so the sender can work out its offset
+                # (grouploop-firmware/include/ClockSync.h).
+                parts = message.split(":", 2)
+                if len(parts) == 3 and parts[2].strip().isdigit():
+                    device_id = parse_device_id(parts[1])
+                    if device_id:
+                        devices[device_id] = websocket
+                    await websocket.send(f"clock:{parts[2].strip()}:{int(time.time() * 1000)}")
+            elif isinstance(message, str) and message.startswith("seq:"):
+                # Sequence upload result: seq:<device_id>:<loaded|error>:<detail>
+                await device_event(websocket, message, "seq")
             else:
                 # Handle device registration and hex frames
                 try:
@@ -175,7 +218,8 @@ async def handle_websocket_connection(websocket: WebSocketServerProtocol) -> Non
                         parts = [p for p in text.splitlines() if p]
                         for p in parts:
                             hp = p.strip()
-                            if len(hp) == 20 and all(c in '0123456789abcdefABCDEF' for c in hp):
+                            # 20 hex chars = base frame, 26 = base frame + on-device position (x, y, confidence)
+                            if len(hp) in (20, 26) and all(c in '0123456789abcdefABCDEF' for c in hp):
                                 # Extract device ID from first 4 characters
                                 device_id = hp[:4].lower()
                                 # Register this websocket as a device